@@ -80,6 +80,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plAgeLoader/plAgeLoader.h"
 #include "plAgeLoader/plResPatcher.h"
 #include "plAnimation/plAGAnimInstance.h"
+#include "plAnimation/plAGMasterMod.h"
 #include "plAudio/plAudioSystem.h"
 #include "plAvatar/plArmatureMod.h"
 #include "plAvatar/plAvatarClothing.h"
@@ -918,6 +919,8 @@ void plClient::IQueueRoomLoad(const std::vector<plLocation>& locs, bool hold)
     bool allSameAge = true;
     ST::string lastAgeName;
 
+    plResManager* mgr = (plResManager*)hsgResMgr::ResMgr();
+
     uint32_t numRooms = 0;
     for (int i = 0; i < locs.size(); i++)
     {
@@ -942,6 +945,9 @@ void plClient::IQueueRoomLoad(const std::vector<plLocation>& locs, bool hold)
 
         fLoadRooms.push_back(new LoadRequest(loc, hold));
 
+        // Get the page off the disk while the rooms ahead of it are loading
+        mgr->PrefetchPage(loc);
+
         if (lastAgeName.empty() || info->GetAge() == lastAgeName)
             lastAgeName = info->GetAge();
         else
@@ -995,6 +1001,11 @@ void plClient::ILoadNextRoom()
         plClientMsg* nextRoom = new plClientMsg(plClientMsg::kLoadNextRoom);
         nextRoom->Send(GetKey());
     }
+    else
+    {
+        // Nothing is left in the queue to use pages that were read ahead
+        ((plResManager*)hsgResMgr::ResMgr())->CancelPrefetches();
+    }
 }
 
 void plClient::IUnloadRooms(const std::vector<plLocation>& locs)
@@ -1626,6 +1637,9 @@ bool plClient::IUpdate()
     plProfile_BeginTiming(EvalMsg);
     plEvalMsg* eval = new plEvalMsg(nullptr, nullptr, nullptr, nullptr);
     plgDispatch::MsgSend(eval);
+    // Avatars queue their animations while handling the eval; run them all
+    // now, before the transforms go out.
+    plAGMasterMod::ApplyQueuedAnimations();
     plProfile_EndTiming(EvalMsg);
 
     char *xFormLap1 = "Main";
@@ -270,6 +270,8 @@ public:
     void Transform(const hsMatrix44 *m) override;
     virtual void Translate(const hsVector3 &v);
 
+    bool IsAxisAligned() const { return 0 != (fExtFlags & kAxisAligned); }
+
     virtual float GetRadius() const;
     virtual void GetAxes(hsVector3 *fAxis0, hsVector3 *fAxis1, hsVector3 *fAxis2) const;
     virtual hsPoint3 *GetCorner(hsPoint3 *c) const { *c = (fExtFlags & kAxisAligned ? fMins : fCorner); return c; }
@@ -0,0 +1,169 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "hsJobPool.h"
+#include "hsLockGuard.h"
+
+#include <algorithm>
+
+hsJobPool::~hsJobPool()
+{
+    {
+        hsLockGuard(fMutex);
+        fStop = true;
+    }
+    fWorkQueued.notify_all();
+    for (std::thread& thread : fThreads)
+        thread.join();
+}
+
+hsJobPool& hsJobPool::Instance()
+{
+    static hsJobPool sInstance;
+    return sInstance;
+}
+
+void hsJobPool::SetThreadInit(void (*init)())
+{
+    hsLockGuard(fMutex);
+    fThreadInit = init;
+}
+
+size_t hsJobPool::GetNumThreads()
+{
+    hsLockGuard(fMutex);
+    IStartThreads();
+    return fThreads.size() + 1;
+}
+
+void hsJobPool::IStartThreads()
+{
+    if (fThreads.empty())
+    {
+        // The calling thread pitches in, so leave a core for it.
+        unsigned numThreads = std::min(std::max(std::thread::hardware_concurrency(), 2U) - 1, 3U);
+        for (unsigned i = 0; i < numThreads; ++i)
+            fThreads.emplace_back(&hsJobPool::IThreadRun, this, fThreadInit);
+    }
+}
+
+void hsJobPool::IRunJobs(const std::shared_ptr<Batch>& batch)
+{
+    size_t done = 0;
+    for (size_t i = batch->fNextJob++; i < batch->fNumJobs; i = batch->fNextJob++)
+    {
+        batch->fJob(i);
+        done++;
+    }
+
+    hsLockGuard(fMutex);
+
+    // Everything's claimed, so the workers can stop looking at this one
+    auto it = std::find(fBatches.begin(), fBatches.end(), batch);
+    if (it != fBatches.end())
+        fBatches.erase(it);
+
+    if (done)
+    {
+        batch->fNumDone += done;
+        if (batch->fNumDone == batch->fNumJobs)
+            fBatchDone.notify_all();
+    }
+}
+
+void hsJobPool::IThreadRun(void (*init)())
+{
+    if (init)
+        init();
+
+    for (;;)
+    {
+        std::shared_ptr<Batch> batch;
+        {
+            std::unique_lock<std::mutex> lock(fMutex);
+            fWorkQueued.wait(lock, [this] { return fStop || !fBatches.empty(); });
+            if (fStop)
+                return;
+            batch = fBatches.front();
+        }
+        IRunJobs(batch);
+    }
+}
+
+void hsJobPool::Run(size_t numJobs, std::function<void(size_t)> job)
+{
+    if (!numJobs)
+        return;
+
+    auto batch = std::make_shared<Batch>(numJobs, std::move(job));
+    if (numJobs > 1)
+    {
+        {
+            hsLockGuard(fMutex);
+            IStartThreads();
+            fBatches.push_back(batch);
+        }
+        fWorkQueued.notify_all();
+    }
+
+    IRunJobs(batch);
+
+    std::unique_lock<std::mutex> lock(fMutex);
+    fBatchDone.wait(lock, [&batch] { return batch->fNumDone == batch->fNumJobs; });
+}
+
+void hsJobPool::RunRanges(uint32_t count, uint32_t perJob, const std::function<void(uint32_t, uint32_t)>& func)
+{
+    perJob = std::max(perJob, 1U);
+    if (count <= perJob)
+    {
+        if (count)
+            func(0, count);
+        return;
+    }
+
+    size_t numJobs = (count + perJob - 1) / perJob;
+    Run(numJobs, [count, perJob, &func](size_t i) {
+        uint32_t first = uint32_t(i) * perJob;
+        func(first, std::min(first + perJob, count));
+    });
+}
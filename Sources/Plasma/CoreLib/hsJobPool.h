@@ -0,0 +1,114 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef _hsJobPool_h_inc_
+#define _hsJobPool_h_inc_
+
+#include "HeadSpin.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Worker threads for splitting a bit of work up and waiting for it, shared
+// by everything that does that (animation, skinning, image processing) so
+// they don't each keep their own threads around.
+//
+// Every thread working on a batch, including the one that asked, keeps
+// claiming the next unclaimed job until there are none left, so a few slow
+// jobs don't hold up the rest.  Each batch keeps its own count of claimed
+// and finished jobs, so any number of threads can Run at once (and jobs can
+// Run their own batches) without their jobs getting mixed up.
+//
+class hsJobPool
+{
+    struct Batch
+    {
+        std::function<void(size_t)> fJob;
+        size_t fNumJobs;
+        std::atomic<size_t> fNextJob;
+        size_t fNumDone;    // Guarded by the pool's fMutex
+
+        Batch(size_t numJobs, std::function<void(size_t)> job)
+            : fJob(std::move(job)), fNumJobs(numJobs), fNextJob(), fNumDone() { }
+    };
+
+    std::vector<std::thread> fThreads;
+    std::mutex fMutex;
+    std::condition_variable fWorkQueued;
+    std::condition_variable fBatchDone;
+    std::list<std::shared_ptr<Batch>> fBatches;     // Ones with jobs left to claim
+    void (*fThreadInit)();
+    bool fStop;
+
+    void IStartThreads();
+    void IRunJobs(const std::shared_ptr<Batch>& batch);
+    void IThreadRun(void (*init)());
+
+public:
+    hsJobPool() : fThreadInit(), fStop() { }
+    ~hsJobPool();
+
+    static hsJobPool& Instance();
+
+    // Called first thing on each worker thread (for naming it in profiles and
+    // the like).  Only affects threads that haven't been started yet.
+    void SetThreadInit(void (*init)());
+
+    // Number of threads that can work on a batch at once, counting the caller.
+    size_t GetNumThreads();
+
+    // Runs job(0) .. job(numJobs - 1) and waits for them all to finish.
+    void Run(size_t numJobs, std::function<void(size_t)> job);
+
+    // Splits [0, count) into runs of perJob and calls func(first, end) for
+    // each.  Stays on the calling thread if that's only one run.
+    void RunRanges(uint32_t count, uint32_t perJob, const std::function<void(uint32_t, uint32_t)>& func);
+};
+
+#endif // _hsJobPool_h_inc_
@@ -0,0 +1,137 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef _hsMPSCQueue_h_inc_
+#define _hsMPSCQueue_h_inc_
+
+#include "HeadSpin.h"
+
+#include <atomic>
+#include <memory>
+
+//
+// Bounded lock-free queue for many producer threads and a single consumer.
+// Each slot carries a sequence number that tells producers when it's free
+// and the consumer when it's been filled, so the only contended operation
+// is the compare-exchange producers use to claim a slot.
+//
+// Capacity must be a power of two.  TryPush fails rather than blocking when
+// the queue is full; what to do about that is up to the caller.
+//
+template <typename T>
+class hsMPSCQueue
+{
+    struct Cell
+    {
+        std::atomic<size_t> fSequence;
+        T fData;
+    };
+
+    std::unique_ptr<Cell[]> fCells;
+    size_t fMask;
+
+    alignas(64) std::atomic<size_t> fEnqueuePos;
+    alignas(64) std::atomic<size_t> fDequeuePos; // Only advanced by the consumer
+
+public:
+    hsMPSCQueue(size_t capacity)
+        : fCells(new Cell[capacity]), fMask(capacity - 1), fEnqueuePos(0), fDequeuePos(0)
+    {
+        hsAssert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "Queue capacity must be a power of two");
+        for (size_t i = 0; i < capacity; ++i)
+            fCells[i].fSequence.store(i, std::memory_order_relaxed);
+    }
+
+    hsMPSCQueue(const hsMPSCQueue&) = delete;
+    hsMPSCQueue& operator=(const hsMPSCQueue&) = delete;
+
+    // Safe to call from any thread
+    bool TryPush(T data)
+    {
+        size_t pos = fEnqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = fCells[pos & fMask];
+            size_t seq = cell.fSequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (fEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;   // Full
+            } else {
+                pos = fEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        Cell& cell = fCells[pos & fMask];
+        cell.fData = std::move(data);
+        cell.fSequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only
+    bool TryPop(T& data)
+    {
+        size_t pos = fDequeuePos.load(std::memory_order_relaxed);
+        Cell& cell = fCells[pos & fMask];
+        size_t seq = cell.fSequence.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(pos + 1) < 0)
+            return false;       // Empty, or the producer hasn't finished writing
+
+        data = std::move(cell.fData);
+        cell.fSequence.store(pos + fMask + 1, std::memory_order_release);
+        fDequeuePos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Approximate, since producers may be mid-push
+    size_t GetSize() const
+    {
+        size_t enqueuePos = fEnqueuePos.load(std::memory_order_relaxed);
+        size_t dequeuePos = fDequeuePos.load(std::memory_order_relaxed);
+        return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+    }
+
+    size_t GetCapacity() const { return fMask + 1; }
+};
+
+#endif // _hsMPSCQueue_h_inc_
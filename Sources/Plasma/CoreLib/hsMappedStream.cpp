@@ -0,0 +1,167 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "hsMappedStream.h"
+
+#if HS_BUILD_FOR_WIN32
+#   include "hsWindows.h"
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+hsMappedStream::~hsMappedStream()
+{
+    Close();
+}
+
+bool hsMappedStream::Open(const plFileName& name, const char* mode)
+{
+    hsAssert(strcmp(mode, "rb") == 0, "hsMappedStream only supports reading");
+    Close();
+
+    // Zero length files can't be mapped, but they're still perfectly valid
+    // (and empty) streams, so only the size is checked for those.
+    uint64_t size = 0;
+
+#if HS_BUILD_FOR_WIN32
+    HANDLE file = CreateFileW(name.WideString().data(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize))
+        size = fileSize.QuadPart;
+    else
+        size = std::numeric_limits<uint64_t>::max();
+
+    if (size > 0 && size <= std::numeric_limits<uint32_t>::max()) {
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            // The view keeps the mapping (and file) alive until it's unmapped
+            fView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(name.AsString().c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(file, &info) == 0)
+        size = info.st_size;
+    else
+        size = std::numeric_limits<uint64_t>::max();
+
+    if (size > 0 && size <= std::numeric_limits<uint32_t>::max()) {
+        void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+        if (view != MAP_FAILED) {
+            // Pages are read front to back, so let the kernel read ahead
+            madvise(view, size, MADV_SEQUENTIAL);
+            fView = view;
+        }
+    }
+    close(file);
+#endif
+
+    if (size > std::numeric_limits<uint32_t>::max() || (size > 0 && !fView))
+        return false;
+
+    fViewSize = size;
+    Init((int)fViewSize, fView);
+    Rewind();
+    fOpen = true;
+    return true;
+}
+
+bool hsMappedStream::Close()
+{
+    if (fView) {
+#if HS_BUILD_FOR_WIN32
+        UnmapViewOfFile(fView);
+#else
+        munmap(fView, fViewSize);
+#endif
+    }
+
+    fView = nullptr;
+    fViewSize = 0;
+    fOpen = false;
+    Init(0, nullptr);
+    Rewind();
+    return true;
+}
+
+uint32_t hsMappedStream::Read(uint32_t byteCount, void* buffer)
+{
+    // Short read at the end, same as the file streams this stands in for
+    byteCount = std::min(byteCount, GetSizeLeft());
+    if (byteCount)
+        memcpy(buffer, fData, byteCount);
+    fData += byteCount;
+    fBytesRead += byteCount;
+    fPosition += byteCount;
+    return byteCount;
+}
+
+void hsMappedStream::Skip(uint32_t deltaByteCount)
+{
+    deltaByteCount = std::min(deltaByteCount, GetSizeLeft());
+    fData += deltaByteCount;
+    fBytesRead += deltaByteCount;
+    fPosition += deltaByteCount;
+}
+
+void hsMappedStream::FastFwd()
+{
+    fData = fStop;
+    fBytesRead = fPosition = GetEOF();
+}
@@ -0,0 +1,80 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef _hsMappedStream_h_inc_
+#define _hsMappedStream_h_inc_
+
+#include "hsStream.h"
+
+//
+// Read-only stream over a memory mapped file.  Reads are just copies out of
+// the mapping, and the OS page cache backing it is shared with any other
+// process that has the same file open.
+//
+// Like a file stream, reading or skipping past the end stops at the end
+// instead of throwing.  Keep these open only as long as they're being read:
+// on POSIX, touching the view after another process truncates the file
+// raises SIGBUS.
+//
+class hsMappedStream : public hsReadOnlyStream
+{
+    void*       fView;
+    size_t      fViewSize;
+    bool        fOpen;
+
+public:
+    hsMappedStream() : fView(), fViewSize(), fOpen() { }
+    ~hsMappedStream();
+
+    // Only "rb" is supported.  Fails if the file can't be mapped, in which
+    // case callers should fall back on a regular file stream.
+    bool      Open(const plFileName& name, const char* mode = "rb") override;
+    bool      Close() override;
+
+    uint32_t  Read(uint32_t byteCount, void* buffer) override;
+    void      Skip(uint32_t deltaByteCount) override;
+    void      FastFwd() override;
+
+    bool      IsOpen() const { return fOpen; }
+};
+
+#endif // _hsMappedStream_h_inc_
@@ -63,6 +63,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pfConsole.h"
 #include "pfDispatchLog.h"
 
+#include "pnDispatch/plDispatch.h"
 #include "pnInputCore/plKeyMap.h"
 #include "pnKeyedObject/plFixedKey.h"
 #include "pnKeyedObject/plKey.h"
@@ -86,6 +87,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "plAgeDescription/plAgeDescription.h"
 #include "plAgeLoader/plAgeLoader.h"
+#include "plAnimation/plAGMasterMod.h"
 #include "plAudio/plAudioSystem.h"
 #include "plAudio/plVoiceChat.h"
 #include "plAvatar/plArmatureMod.h"
@@ -572,6 +574,20 @@ PF_CONSOLE_CMD(Stats, SetAvgTime, "int ms", "Sets the amount of time stats are a
     plProfileManager::Instance().SetAvgTime((int)params[0]);
 }
 
+PF_CONSOLE_CMD(Stats, CaptureTrace, "int frames", "Traces the next few frames on every thread and writes\n"
+               "them to the profile folder as Chrome trace JSON")
+{
+    int frames = (int)params[0];
+    if (frames <= 0)
+    {
+        PrintString("Need at least one frame to capture");
+        return;
+    }
+
+    plProfileManagerFull::Instance().CaptureTrace(frames);
+    pfConsolePrintF(PrintString, "Capturing {} frames", frames);
+}
+
 PF_CONSOLE_CMD(Stats, Graph, "string stat, int min, int max", "Graphs the specified stat")
 {
     plProfileManagerFull::Instance().CreateGraph(params[0], (int)params[1], (int)params[2]);
@@ -2395,6 +2411,14 @@ PF_CONSOLE_CMD(App,
     plStatusLogMgr::GetInstance().BounceLogs();
 }
 
+PF_CONSOLE_CMD(App,
+               EnableAsyncLogWrites,
+               "",
+               "Write log files from a background thread from now on. Can't be turned off again; best set from an .ini file.")
+{
+    plStatusLogMgr::GetInstance().EnableAsyncWrites();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //// Dispatch Group Commands /////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
@@ -2404,6 +2428,26 @@ PF_CONSOLE_CMD(App,
 PF_CONSOLE_GROUP( Dispatch )        // Defines a main command group
 PF_CONSOLE_SUBGROUP( Dispatch, Log )        // Creates a sub-group under a given group
 
+PF_CONSOLE_CMD( Dispatch,       // groupName
+               QueueStats,      // fxnName
+               "", // paramList
+               "Prints stats for messages queued to the main thread from other threads" )  // helpString
+{
+    plDispatch* dispatch = dynamic_cast<plDispatch*>(plgDispatch::Dispatch());
+    if (!dispatch)
+    {
+        PrintString("No message queue stats available");
+        return;
+    }
+
+    plDispatch::QueueStats stats = dispatch->GetMsgQueueStats();
+    ST::string str = ST::format("Queued msgs: {} waiting, {} peak, {} processed, {} overflowed",
+        stats.fDepth, stats.fPeakDepth, stats.fProcessed, stats.fEnqueueFailures);
+    PrintString(str.c_str());
+    str = ST::format("Time in queue: {.2f} ms avg, {.2f} ms max", stats.fAvgTimeInQueue, stats.fMaxTimeInQueue);
+    PrintString(str.c_str());
+}
+
 PF_CONSOLE_CMD( Dispatch_Log,       // groupName
                LongReceives,        // fxnName
                "", // paramList
@@ -2520,6 +2564,13 @@ PF_CONSOLE_CMD( Registry, SetLoggingLevel, "int level", "Sets the logging level
     }
 }
 
+PF_CONSOLE_CMD( Registry, SetAsyncPaging, "bool enable", "Enables reading queued pages into memory on background threads before they're paged in." )
+{
+    bool enable = (bool)params[ 0 ];
+    plResMgrSettings::Get().SetAsyncPaging( enable );
+    PrintString( enable ? "Async paging enabled" : "Async paging disabled" );
+}
+
 class plActiveRefPeekerKey : public plKeyImp
 {
     public:
@@ -5450,6 +5501,18 @@ PF_CONSOLE_CMD( ParticleSystem,
     }
 }
 
+PF_CONSOLE_CMD( ParticleSystem,
+               Threaded,
+               "bool on",
+               "Update particle systems on worker threads (on by default)" )
+{
+    plParticleSystem::SetThreadedUpdates((bool)params[0]);
+    if (plParticleSystem::GetThreadedUpdates())
+        PrintString("Particle systems now update on worker threads");
+    else
+        PrintString("Particle systems now update inline");
+}
+
 
 PF_CONSOLE_SUBGROUP( ParticleSystem, Flock )
 
@@ -5750,6 +5813,28 @@ PF_CONSOLE_CMD( Animation,
     pfConsolePrintF(PrintString, "Potential delay of transform eval is now {}", (enabled ? "ENABLED" : "DISABLED"));
 }
 
+PF_CONSOLE_CMD( Animation,
+               ToggleCompiledGraphs,
+               "",
+               "Toggle evaluating animation graphs from their compiled form." )
+{
+    bool enabled = !plAGMasterMod::GetCompiledEvalEnabled();
+    plAGMasterMod::SetCompiledEvalEnabled(enabled);
+
+    pfConsolePrintF(PrintString, "Compiled animation graph eval is now {}", (enabled ? "ENABLED" : "DISABLED"));
+}
+
+PF_CONSOLE_CMD( Animation,
+               ToggleParallelEval,
+               "",
+               "Toggle evaluating avatar animation graphs on the worker threads." )
+{
+    bool enabled = !plAGMasterMod::GetParallelEvalEnabled();
+    plAGMasterMod::SetParallelEvalEnabled(enabled);
+
+    pfConsolePrintF(PrintString, "Parallel animation graph eval is now {}", (enabled ? "ENABLED" : "DISABLED"));
+}
+
 #endif // LIMIT_CONSOLE_COMMANDS
 
 ////////////////////////////////////////////////////////////////////////
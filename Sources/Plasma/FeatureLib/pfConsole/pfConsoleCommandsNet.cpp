@@ -63,6 +63,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pnMessage/plClientMsg.h"
 #include "pnMessage/plEnableMsg.h"
 #include "pnModifier/plLogicModBase.h"
+#include "pnNetBase/pnNetBase.h"
+#include "pnNetCli/pnNetCli.h"
 #include "pnUUID/pnUUID.h"
 
 #include "plAgeDescription/plAgeDescription.h"
@@ -207,6 +209,31 @@ PF_CONSOLE_CMD( Net,
     NetClientPingEnable(enable);
 }
 
+// Net.SendStats
+PF_CONSOLE_CMD( Net,
+                SendStats,
+                "",
+                "Print bytes, socket sends and send buffer allocations per client protocol" )
+{
+    static const ENetProtocol protocols[] = {
+        kNetProtocolCli2GateKeeper,
+        kNetProtocolCli2Auth,
+        kNetProtocolCli2Game,
+        kNetProtocolCli2File,
+    };
+
+    for (ENetProtocol protocol : protocols) {
+        NetMsgSendStats stats;
+        if (!NetMsgProtocolGetSendStats(protocol, false, &stats))
+            continue;
+        ST::string str = ST::format("{}: {} sent in {} sends, {} buffer allocs",
+                                    ST::string::from_wchar(NetProtocolToString(protocol)),
+                                    plFileSystem::ConvertFileSize(stats.bytesSent),
+                                    stats.sendCalls, stats.bufferAllocs);
+        PrintString(str.c_str());
+    }
+}
+
 //
 // Temp until we get real text chat
 //
@@ -297,6 +324,19 @@ PF_CONSOLE_CMD( Net,        // groupName
     plNetClientMgr::GetInstance()->SetConsoleOutput( params[0] );
 }
 
+PF_CONSOLE_CMD( Net,        // groupName
+               CompactSDL,      // fxnName
+               "bool on", // paramList
+               "Send SDL state in the compact delta format. The server must support it." )  // helpString
+{
+    uint32_t flags = plSDLMgr::GetInstance()->GetBehaviorFlags();
+    if ((bool)params[0])
+        flags |= plSDL::kAllowCompactDelta;
+    else
+        flags &= ~plSDL::kAllowCompactDelta;
+    plSDLMgr::GetInstance()->SetBehaviorFlags(flags);
+}
+
 
 
 /////////////
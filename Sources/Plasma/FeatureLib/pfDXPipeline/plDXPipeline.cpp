@@ -99,6 +99,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plAvatar/plAvatarClothing.h"
 #include "plDrawable/plAccessSpan.h"
 #include "plDrawable/plAuxSpan.h"
+#include "plDrawable/plCpuSkinner.h"
 #include "plDrawable/plDrawableGenerator.h"
 #include "plDrawable/plDrawableSpans.h"
 #include "plDrawable/plGBufferGroup.h"
@@ -8569,20 +8570,7 @@ bool      plDXPipeline::ISoftwareVertexBlend(plDrawableSpans* drawable, const st
                     {
                         plProfile_Inc(NumSkin);
 
-                        hsMatrix44* matrixPalette = drawable->GetMatrixPalette(span.fBaseMatrix);
-                        matrixPalette[0] = span.fLocalToWorld;
-
-                        uint8_t* ptr = vRef->fOwner->GetVertBufferData(vRef->fIndex);
-                        ptr += span.fVStartIdx * vRef->fOwner->GetVertexSize();
-                        IBlendVertsIntoBuffer( (plSpan*)&span,
-                                                matrixPalette, span.fNumMatrices,
-                                                ptr, 
-                                                vRef->fOwner->GetVertexFormat(), 
-                                                vRef->fOwner->GetVertexSize(), 
-                                                destPtr + span.fVStartIdx * vRef->fVertexSize, 
-                                                vRef->fVertexSize, 
-                                                span.fVLength,
-                                                span.fLocalUVWChans );
+                        plCpuSkinner::BlendSpan(drawable, span, destPtr, vRef->fVertexSize);
                         vRef->SetDirty(true);
                     }
                 }
@@ -8722,187 +8710,6 @@ inline void inlTESTPOINT(const hsPoint3& destP,
         maxZ = destP.fZ;
 }
 
-//// IBlendVertsIntoBuffer ////////////////////////////////////////////////////
-//  Given a pointer into a buffer of verts that have blending data in the D3D
-//  format, blends them into the destination buffer given without the blending
-//  info.
-
-static inline void ISkinVertexFPU(const hsMatrix44& xfm, float wgt,
-                                  const float* pt_src, float* pt_dst,
-                                  const float* vec_src, float* vec_dst)
-{
-    const float& m00 = xfm.fMap[0][0];
-    const float& m01 = xfm.fMap[0][1];
-    const float& m02 = xfm.fMap[0][2];
-    const float& m03 = xfm.fMap[0][3];
-    const float& m10 = xfm.fMap[1][0];
-    const float& m11 = xfm.fMap[1][1];
-    const float& m12 = xfm.fMap[1][2];
-    const float& m13 = xfm.fMap[1][3];
-    const float& m20 = xfm.fMap[2][0];
-    const float& m21 = xfm.fMap[2][1];
-    const float& m22 = xfm.fMap[2][2];
-    const float& m23 = xfm.fMap[2][3];
-
-    // position
-    {
-        const float& srcX = pt_src[0];
-        const float& srcY = pt_src[1];
-        const float& srcZ = pt_src[2];
-
-        pt_dst[0] += (srcX * m00 + srcY * m01 + srcZ * m02 + m03) * wgt;
-        pt_dst[1] += (srcX * m10 + srcY * m11 + srcZ * m12 + m13) * wgt;
-        pt_dst[2] += (srcX * m20 + srcY * m21 + srcZ * m22 + m23) * wgt;
-    }
-
-    // normal
-    {
-        const float& srcX = vec_src[0];
-        const float& srcY = vec_src[1];
-        const float& srcZ = vec_src[2];
-
-        vec_dst[0] += (srcX * m00 + srcY * m01 + srcZ * m02) * wgt;
-        vec_dst[1] += (srcX * m10 + srcY * m11 + srcZ * m12) * wgt;
-        vec_dst[1] += (srcX * m20 + srcY * m21 + srcZ * m22) * wgt;
-    }
-}
-
-#ifdef HAVE_SSE3
-static inline void ISkinDpSSE3(const float* src, float* dst, const __m128& mc0,
-                               const __m128& mc1, const __m128& mc2, const __m128& mwt)
-{
-    __m128 msr = _mm_load_ps(src);
-    __m128 _x  = _mm_mul_ps(_mm_mul_ps(mc0, msr), mwt);
-    __m128 _y  = _mm_mul_ps(_mm_mul_ps(mc1, msr), mwt);
-    __m128 _z  = _mm_mul_ps(_mm_mul_ps(mc2, msr), mwt);
-
-    __m128 hbuf1 = _mm_hadd_ps(_x, _y);
-    __m128 hbuf2 = _mm_hadd_ps(_z, _z);
-    hbuf1 = _mm_hadd_ps(hbuf1, hbuf2);
-    __m128 _dst = _mm_load_ps(dst);
-    _dst = _mm_add_ps(_dst, hbuf1);
-    _mm_store_ps(dst, _dst);
-}
-#endif // HAVE_SSE3
-
-static inline void ISkinVertexSSE3(const hsMatrix44& xfm, float wgt,
-                                   const float* pt_src, float* pt_dst,
-                                   const float* vec_src, float* vec_dst)
-{
-#ifdef HAVE_SSE3
-    __m128 mc0 = _mm_load_ps(xfm.fMap[0]);
-    __m128 mc1 = _mm_load_ps(xfm.fMap[1]);
-    __m128 mc2 = _mm_load_ps(xfm.fMap[2]);
-    __m128 mwt = _mm_set_ps1(wgt);
-
-    ISkinDpSSE3(pt_src, pt_dst, mc0, mc1, mc2, mwt);
-    ISkinDpSSE3(vec_src, vec_dst, mc0, mc1, mc2, mwt);
-#endif // HAVE_SSE3
-}
-
-#ifdef HAVE_SSE41
-static inline void ISkinDpSSE41(const float* src, float* dst, const __m128& mc0,
-                                const __m128& mc1, const __m128& mc2, const __m128& mwt)
-{
-    enum { DP_F4_X = 0xF1, DP_F4_Y = 0xF2, DP_F4_Z = 0xF4 };
-
-    __m128 msr = _mm_load_ps(src);
-    __m128 _r =        _mm_dp_ps(msr, mc0, DP_F4_X);
-    _r = _mm_or_ps(_r, _mm_dp_ps(msr, mc1, DP_F4_Y));
-    _r = _mm_or_ps(_r, _mm_dp_ps(msr, mc2, DP_F4_Z));
-
-    __m128 _dst = _mm_load_ps(dst);
-    _dst = _mm_add_ps(_dst, _mm_mul_ps(_r, mwt));
-    _mm_store_ps(dst, _dst);
-}
-#endif // HAVE_SSE41
-
-static inline void ISkinVertexSSE41(const hsMatrix44& xfm, float wgt,
-                                    const float* pt_src, float* pt_dst,
-                                    const float* vec_src, float* vec_dst)
-{
-#ifdef HAVE_SSE41
-    __m128 mc0 = _mm_load_ps(xfm.fMap[0]);
-    __m128 mc1 = _mm_load_ps(xfm.fMap[1]);
-    __m128 mc2 = _mm_load_ps(xfm.fMap[2]);
-    __m128 mwt = _mm_set_ps1(wgt);
-
-    ISkinDpSSE41(pt_src, pt_dst, mc0, mc1, mc2, mwt);
-    ISkinDpSSE41(vec_src, vec_dst, mc0, mc1, mc2, mwt);
-#endif // HAVE_SSE41
-}
-
-typedef void(*skin_vert_ptr)(const hsMatrix44&, float, const float*, float*, const float*, float*);
-
-template<skin_vert_ptr T>
-static void IBlendVertBuffer(plSpan* span, hsMatrix44* matrixPalette, int numMatrices,
-                             const uint8_t* src, uint8_t format, uint32_t srcStride,
-                             uint8_t* dest, uint32_t destStride, uint32_t count,
-                             uint16_t localUVWChans)
-{
-    ALIGN(16) float pt_buf[] = { 0.f, 0.f, 0.f, 1.f };
-    ALIGN(16) float vec_buf[] = { 0.f, 0.f, 0.f, 0.f };
-    hsPoint3*       pt = reinterpret_cast<hsPoint3*>(pt_buf);
-    hsVector3*      vec = reinterpret_cast<hsVector3*>(vec_buf);
-
-    uint32_t        indices;
-    float           weights[4];
-
-    // Dropped support for localUVWChans at templatization of code
-    hsAssert(localUVWChans == 0, "support for skinned UVWs dropped. reimplement me?");
-    const size_t uvChanSize = plGBufferGroup::CalcNumUVs(format) * sizeof(float) * 3;
-    uint8_t numWeights = (format & plGBufferGroup::kSkinWeightMask) >> 4;
-
-    for (uint32_t i = 0; i < count; ++i) {
-        // Extract data
-        src = inlExtract<hsPoint3>(src, pt);
-
-        float weightSum = 0.f;
-        for (uint8_t j = 0; j < numWeights; ++j) {
-            src = inlExtract<float>(src, &weights[j]);
-            weightSum += weights[j];
-        }
-        weights[numWeights] = 1.f - weightSum;
-
-        if (format & plGBufferGroup::kSkinIndices)
-            src = inlExtract<uint32_t>(src, &indices);
-        else
-            indices = 1 << 8;
-        src = inlExtract<hsVector3>(src, vec);
-
-        // Destination buffers (float4 for SSE alignment)
-        ALIGN(16) float destNorm_buf[] = { 0.f, 0.f, 0.f, 0.f };
-        ALIGN(16) float destPt_buf[] = { 0.f, 0.f, 0.f, 1.f };
-
-        // Blend
-        for (uint32_t j = 0; j < numWeights + 1; ++j) {
-            if (weights[j])
-                T(matrixPalette[indices & 0xFF], weights[j], pt_buf, destPt_buf, vec_buf, destNorm_buf);
-            indices >>= 8;
-        }
-        // Probably don't really need to renormalize this. There errors are
-        // going to be subtle and "smooth".
-        /* hsFastMath::NormalizeAppr(destNorm); */
-
-        // Slam data into position now
-        dest = inlStuff<hsPoint3>(dest, reinterpret_cast<hsPoint3*>(destPt_buf));
-        dest = inlStuff<hsVector3>(dest, reinterpret_cast<hsVector3*>(destNorm_buf));
-
-        // memcpy the colors and UVs
-        inlCopy(src, dest, sizeof(uint32_t) * 2 + uvChanSize);
-    }
-}
-
-// CPU-optimized functions requiring dispatch
-hsCpuFunctionDispatcher<plDXPipeline::blend_vert_buffer_ptr> plDXPipeline::blend_vert_buffer {
-    &IBlendVertBuffer<ISkinVertexFPU>,
-    nullptr,                                // SSE1
-    nullptr,                                // SSE2
-    &IBlendVertBuffer<ISkinVertexSSE3>,
-    nullptr,                                // SSSE3
-    &IBlendVertBuffer<ISkinVertexSSE41>
-};
-
 // ISetPipeConsts //////////////////////////////////////////////////////////////////
 // A shader can request that the pipeline fill in certain constants that are indeterminate
 // until the pipeline is about to render the object the shader is applied to. For example,
@@ -11931,8 +11738,6 @@ void plDXPipeline::IPreprocessAvatarTextures()
     if (fClothingOutfits.empty())
         return;
 
-    plMipmap *itemBufferTex = nullptr;
-
     fForceMatHandle = true;
     ISetShaders(nullptr, nullptr); // Has a side effect of futzing with our cull settings...
 
@@ -11988,12 +11793,15 @@ void plDXPipeline::IPreprocessAvatarTextures()
             continue;
 
         plRenderTarget *rt = plRenderTarget::ConvertNoRef(co->fTargetLayer->GetTexture());
-        if (rt != nullptr && co->fDirtyItems.Empty())
+        if (rt != nullptr && co->fDirtyElements.empty())
         {
-            // we've still got our valid RT from last frame and we have nothing to do.
+            // we've still got our valid RT from last frame and nothing on it has changed.
+            co->fDirtyItems.Clear();
             continue;
         }
 
+        // A fresh RT needs everything drawn. Otherwise, only the tiles that changed.
+        bool redrawAll = (rt == nullptr);
         if (rt == nullptr)
         {
             rt = IGetNextAvRT();
@@ -12004,58 +11812,38 @@ void plDXPipeline::IPreprocessAvatarTextures()
         D3DVIEWPORT9 vp = {0, 0, rt->GetWidth(), rt->GetHeight(), 0.f, 1.f};
         WEAK_ERROR_CHECK(fD3DDevice->SetViewport(&vp));
 
-        float uOff = 0.5f / rt->GetWidth();
-        float vOff = 0.5f / rt->GetHeight();
-
-        // Copy over the base
-        fD3DDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
-        fD3DDevice->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
-        fD3DDevice->SetRenderState(D3DRS_TEXTUREFACTOR, 0xffffffff);
-        fLayerState[0].fBlendFlags = uint32_t(-1);
-        IDrawClothingQuad(-1.f, -1.f, 2.f, 2.f, uOff, vOff, co->fBase->fBaseTexture);
         plClothingLayout *layout = plClothingMgr::GetClothingMgr()->GetLayout(co->fBase->fLayoutName);
-
-        for (plClothingItem *item : co->fItems)
+        if (redrawAll)
+            IDrawClothingTiles(co, layout, rt, nullptr);
+        else
         {
-            //if (!co->fDirtyItems.IsBitSet(item->fTileset))
-            //  continue; // Not dirty, don't update
-
-            for (size_t j = 0; j < item->fElements.size(); j++)
+            // Scale layout coords to the target. Round outwards, so a tile
+            // that covers part of a texel still gets all of it redrawn.
+            const uint32_t origSize = layout->fOrigWidth;
+            auto scaleDown = [origSize](uint32_t pos, uint32_t size) {
+                return std::min(pos * size / origSize, size);
+            };
+            auto scaleUp = [origSize](uint32_t pos, uint32_t size) {
+                return std::min((pos * size + origSize - 1) / origSize, size);
+            };
+
+            fD3DDevice->SetRenderState(D3DRS_SCISSORTESTENABLE, TRUE);
+            for (plClothingElement* element : co->fDirtyElements)
             {
-                for (int k = 0; k < plClothingElement::kLayerMax; k++)
-                {
-                    if (item->fTextures[j][k] == nullptr)
-                        continue;
-
-                    itemBufferTex = item->fTextures[j][k];
-                    hsColorRGBA tint = co->GetItemTint(item, k);
-                    if (k >= plClothingElement::kLayerSkinBlend1 && k <= plClothingElement::kLayerSkinLast)
-                        tint.a = co->fSkinBlends[k - plClothingElement::kLayerSkinBlend1];
-
-                    if (k == plClothingElement::kLayerBase)
-                    {
-                        fD3DDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
-                        fD3DDevice->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
-                    }
-                    else
-                    {
-                        fD3DDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
-                        fD3DDevice->SetRenderState(D3DRS_SRCBLEND,  D3DBLEND_SRCALPHA);
-                        fD3DDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
-                        fD3DDevice->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE);
-                    }
-                    fD3DDevice->SetRenderState(D3DRS_TEXTUREFACTOR, tint.ToARGB32());
-                    fLayerState[0].fBlendFlags = uint32_t(-1);
-                    float screenW = (float)item->fElements[j]->fWidth / layout->fOrigWidth * 2.f;
-                    float screenH = (float)item->fElements[j]->fHeight / layout->fOrigWidth * 2.f;
-                    float screenX = (float)item->fElements[j]->fXPos / layout->fOrigWidth * 2.f - 1.f;
-                    float screenY = (1.f - (float)item->fElements[j]->fYPos / layout->fOrigWidth) * 2.f - 1.f - screenH;
-                    IDrawClothingQuad(screenX, screenY, screenW, screenH, uOff, vOff, itemBufferTex);
-                }
+                RECT rect;
+                rect.left = scaleDown(element->fXPos, rt->GetWidth());
+                rect.top = scaleDown(element->fYPos, rt->GetHeight());
+                rect.right = scaleUp(element->fXPos + element->fWidth, rt->GetWidth());
+                rect.bottom = scaleUp(element->fYPos + element->fHeight, rt->GetHeight());
+                fD3DDevice->SetScissorRect(&rect);
+
+                IDrawClothingTiles(co, layout, rt, element);
             }
+            fD3DDevice->SetRenderState(D3DRS_SCISSORTESTENABLE, FALSE);
         }
         PopRenderTarget();
         co->fDirtyItems.Clear();
+        co->fDirtyElements.clear();
     }
     // Nothing else sets this render state, so let's just set it back to the default to be safe
     fD3DDevice->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
@@ -12064,6 +11852,65 @@ void plDXPipeline::IPreprocessAvatarTextures()
     fClothingOutfits.swap(fPrevClothingOutfits);
 }
 
+// Draws the outfit's base texture and then each worn item's layers over it.
+// With a clip element, only items with tiles overlapping it get drawn, for
+// when the scissor rect is already set to it.
+void plDXPipeline::IDrawClothingTiles(plClothingOutfit* co, plClothingLayout* layout, plRenderTarget* rt,
+                                      const plClothingElement* clip)
+{
+    float uOff = 0.5f / rt->GetWidth();
+    float vOff = 0.5f / rt->GetHeight();
+
+    // Copy over the base
+    fD3DDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+    fD3DDevice->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
+    fD3DDevice->SetRenderState(D3DRS_TEXTUREFACTOR, 0xffffffff);
+    fLayerState[0].fBlendFlags = uint32_t(-1);
+    IDrawClothingQuad(-1.f, -1.f, 2.f, 2.f, uOff, vOff, co->fBase->fBaseTexture);
+
+    for (plClothingItem *item : co->fItems)
+    {
+        for (size_t j = 0; j < item->fElements.size(); j++)
+        {
+            const plClothingElement *element = item->fElements[j];
+            if (clip && (element->fXPos >= clip->fXPos + clip->fWidth || clip->fXPos >= element->fXPos + element->fWidth ||
+                         element->fYPos >= clip->fYPos + clip->fHeight || clip->fYPos >= element->fYPos + element->fHeight))
+                continue; // Scissored away anyhow
+
+            for (int k = 0; k < plClothingElement::kLayerMax; k++)
+            {
+                if (item->fTextures[j][k] == nullptr)
+                    continue;
+
+                plMipmap *itemBufferTex = item->fTextures[j][k];
+                hsColorRGBA tint = co->GetItemTint(item, k);
+                if (k >= plClothingElement::kLayerSkinBlend1 && k <= plClothingElement::kLayerSkinLast)
+                    tint.a = co->fSkinBlends[k - plClothingElement::kLayerSkinBlend1];
+
+                if (k == plClothingElement::kLayerBase)
+                {
+                    fD3DDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
+                    fD3DDevice->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
+                }
+                else
+                {
+                    fD3DDevice->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+                    fD3DDevice->SetRenderState(D3DRS_SRCBLEND,  D3DBLEND_SRCALPHA);
+                    fD3DDevice->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+                    fD3DDevice->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE);
+                }
+                fD3DDevice->SetRenderState(D3DRS_TEXTUREFACTOR, tint.ToARGB32());
+                fLayerState[0].fBlendFlags = uint32_t(-1);
+                float screenW = (float)element->fWidth / layout->fOrigWidth * 2.f;
+                float screenH = (float)element->fHeight / layout->fOrigWidth * 2.f;
+                float screenX = (float)element->fXPos / layout->fOrigWidth * 2.f - 1.f;
+                float screenY = (1.f - (float)element->fYPos / layout->fOrigWidth) * 2.f - 1.f - screenH;
+                IDrawClothingQuad(screenX, screenY, screenW, screenH, uOff, vOff, itemBufferTex);
+            }
+        }
+    }
+}
+
 void plDXPipeline::IDrawClothingQuad(float x, float y, float w, float h, 
                                      float uOff, float vOff, plMipmap *tex)
 {
@@ -401,11 +401,6 @@ protected:
     void            IMakeOcclusionSnap();
 
     bool            IAvatarSort(plDrawableSpans* d, const std::vector<int16_t>& visList);
-    void            IBlendVertsIntoBuffer( plSpan* span, 
-                                            hsMatrix44* matrixPalette, int numMatrices,
-                                            const uint8_t *src, uint8_t format, uint32_t srcStride, 
-                                            uint8_t *dest, uint32_t destStride, uint32_t count, uint16_t localUVWChans )
-                                                { blend_vert_buffer.call(span, matrixPalette, numMatrices, src, format, srcStride, dest, destStride, count, localUVWChans); };
     bool            ISoftwareVertexBlend(plDrawableSpans* drawable, const std::vector<int16_t>& visList);
 
 
@@ -518,6 +513,7 @@ protected:
 
     // Avatar Texture Rendering
     void                    IPreprocessAvatarTextures();
+    void                    IDrawClothingTiles(plClothingOutfit* co, plClothingLayout* layout, plRenderTarget* rt, const plClothingElement* clip);
     void                    IDrawClothingQuad(float x, float y, float w, float h, float uOff, float vOff, plMipmap *tex);
 
     void IPrintDeviceInitError();
@@ -605,13 +601,6 @@ public:
     int             GetMaxAntiAlias(int Width, int Height, int ColorDepth) override;
 
     void RenderSpans(plDrawableSpans *ice, const std::vector<int16_t>& visList) override;
-
-    //  CPU-optimized functions
-protected:
-    typedef void(*blend_vert_buffer_ptr)(plSpan*, hsMatrix44*, int, const uint8_t *,
-                                         uint8_t , uint32_t, uint8_t *, uint32_t,
-                                         uint32_t, uint16_t);
-    static hsCpuFunctionDispatcher<blend_vert_buffer_ptr> blend_vert_buffer;
 };
 
 
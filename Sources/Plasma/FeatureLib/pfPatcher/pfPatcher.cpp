@@ -41,8 +41,12 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 *==LICENSE==*/
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <deque>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include "pfPatcher.h"
 
@@ -137,13 +141,58 @@ struct pfPatcherQueuedFile
     { }
 
     pfPatcherQueuedFile(const pfPatcherQueuedFile& copy) = delete;
+    pfPatcherQueuedFile(pfPatcherQueuedFile&& move) = default;
 
     pfPatcherQueuedFile& operator =(const pfPatcherQueuedFile& copy) = delete;
+    pfPatcherQueuedFile& operator =(pfPatcherQueuedFile&& move) = default;
 };
 
 // ===================================================
 
-/** Patcher grunt work thread */
+/** Running bytes-per-second estimate, shared between threads */
+class pfPatcherThroughput
+{
+    std::atomic<uint64_t> fBytes;
+
+    std::mutex fSampleMut;
+    double fSampleTime;
+    uint64_t fSampleBytes;
+    double fRate;
+
+    /** Don't resample faster than this, or tiny files make the rate jump all over the place */
+    static constexpr double kSampleInterval = 0.5;
+
+public:
+    pfPatcherThroughput()
+        : fBytes(), fSampleTime(hsTimer::GetSeconds<double>()), fSampleBytes(), fRate()
+    { }
+
+    void Add(uint64_t bytes) { fBytes += bytes; }
+
+    uint64_t GetRate()
+    {
+        hsLockGuard(fSampleMut);
+        double now = hsTimer::GetSeconds<double>();
+        double elapsed = now - fSampleTime;
+        if (elapsed >= kSampleInterval) {
+            uint64_t bytes = fBytes;
+            double rate = double(bytes - fSampleBytes) / elapsed;
+
+            // smooth it out a bit so the UI doesn't flicker between numbers
+            fRate = fRate > 0.0 ? (fRate + rate) * 0.5 : rate;
+            fSampleTime = now;
+            fSampleBytes = bytes;
+        }
+        return uint64_t(fRate);
+    }
+};
+
+// ===================================================
+
+/** Patcher grunt work thread
+ *  This thread pumps the network requests. The hashing and SFX decompression is
+ *  done by a small crew of file threads so that it overlaps with the downloads.
+ */
 struct pfPatcherWorker : public hsThread
 {
     /** Represents a File/Auth download request */
@@ -165,8 +214,16 @@ struct pfPatcherWorker : public hsThread
 
     std::mutex fRequestMut;
     std::mutex fFileMut;
+    std::condition_variable fFileQueued;
     hsSemaphore fFileSignal;
 
+    /** Serializes the user callbacks that the file threads can fire */
+    std::mutex fCallbackMut;
+
+    std::vector<std::thread> fFileThreads;
+    size_t fFilesInFlight;
+    bool fStopFileThreads;
+
     pfPatcher::CompletionFunc fOnComplete;
     pfPatcher::FileDownloadFunc fFileBeginDownload;
     pfPatcher::FileDesiredFunc fFileDownloadDesired;
@@ -177,11 +234,28 @@ struct pfPatcherWorker : public hsThread
     pfPatcher::FileDownloadFunc fSelfPatch;
 
     pfPatcher* fParent;
-    volatile bool fStarted;
-    volatile bool fRequestActive;
+    std::atomic<bool> fStarted;
+    std::atomic<bool> fRequestActive;
+    unsigned fRequestsInFlight;
+
+    std::atomic<uint64_t> fCurrBytes;
+    std::atomic<uint64_t> fTotalBytes;
+
+    pfPatcherThroughput fDownloadRate;
+    pfPatcherThroughput fHashRate;
+    uint64_t fLastTickBytes;
+
+    /** Set while a progress tick is on its way to the main thread, which owns the tick's copy below */
+    std::atomic<bool> fTickPending;
+    uint64_t fTickBytes;
+    uint64_t fTickTotal;
+    ST::string fTickMsg;
 
-    uint64_t fCurrBytes;
-    uint64_t fTotalBytes;
+    /** Downloads are written off the main thread, so the patch thread reports progress this often */
+    static constexpr unsigned kProgressTickMs = 100;
+
+    /** File downloads in flight at once. NetCli spreads these over its FileSrv connections. */
+    static constexpr unsigned kMaxDownloads = 8;
 
     pfPatcherWorker();
     ~pfPatcherWorker();
@@ -190,11 +264,20 @@ struct pfPatcherWorker : public hsThread
 
     void EndPatch(ENetError result, const ST::string& msg={});
     bool IssueRequest();
+    void IIssueRequest(const Request& req);
+    void FinishRequest();
+    void RetryRequest(const ST::string& name, class pfPatcherStream* s);
+    void QueueFile(pfPatcherQueuedFile file);
     void Run() override;
+    void IStartFileThreads();
+    void IStopFileThreads();
+    void IFileThreadRun();
     void IHashFile(pfPatcherQueuedFile& file);
     void IDecompressSound(const pfPatcherQueuedFile& sound) const;
-    void ProcessFile();
     void WhitelistFile(const plFileName& file, bool justDownloaded, hsStream* s=nullptr);
+    void ITickProgress();
+    void IFlushProgress();
+    ST::string GetStatusMsg();
 };
 
 // ===================================================
@@ -205,36 +288,45 @@ class pfPatcherStream : public plZlibStream
     plFileName fFilename;
     uint32_t fFlags;
 
-    uint64_t fBytesWritten;
-    float fDLStartTime;
+    /** Bytes the server has sent us in the current attempt */
+    uint64_t fReceived;
+    /** How far previous attempts got. This much is already on disk. */
+    uint64_t fResumeAt;
+    unsigned fRetries;
 
-    ST::string IMakeStatusMsg() const
-    {
-        float secs = hsTimer::GetSeconds<float>() - fDLStartTime;
-        auto bytesPerSec = uint64_t(fBytesWritten / secs);
-        return plFileSystem::ConvertFileSize(bytesPerSec) + "/s";
-    }
+    static constexpr unsigned kMaxRetries = 3;
+
+    /** Hash of the decompressed file, built up as it's written out */
+    plMD5Checksum fChecksum;
+    plMD5Checksum fExpected;
 
     void IUpdateProgress(uint32_t count)
     {
-        fBytesWritten += count; // just this file
+        // Downloads are written from the NetCli chunk writer thread, so the user
+        // callback is posted to the main thread by ITickProgress instead.
         fParent->fCurrBytes += count; // the entire everything
+        fParent->fDownloadRate.Add(count);
+    }
 
-        // tick-tick-tick, tick-tick-tock
-        if (fParent->fProgressTick)
-            fParent->fProgressTick(fParent->fCurrBytes, fParent->fTotalBytes, IMakeStatusMsg());
+    uint32_t IWriteOutput(uint32_t count, const void* buf) override
+    {
+        if (fExpected.IsValid())
+            fChecksum.AddTo(count, static_cast<const uint8_t*>(buf));
+        return fOutput->Write(count, buf);
     }
 
 public:
     pfPatcherStream(pfPatcherWorker* parent, const plFileName& filename, uint64_t size)
-        : fParent(parent), fFilename(filename), fFlags(), fBytesWritten(), fDLStartTime(), plZlibStream()
+        : fParent(parent), fFilename(filename), fFlags(), fReceived(), fResumeAt(), fRetries(),
+          plZlibStream()
     {
         fParent->fTotalBytes += size;
         fOutput = new hsRAMStream;
     }
 
     pfPatcherStream(pfPatcherWorker* parent, const pfPatcherQueuedFile& file)
-        : fParent(parent), fFilename(file.fClientPath.Normalize()), fFlags(file.fFlags), fBytesWritten(), fDLStartTime(), plZlibStream()
+        : fParent(parent), fFilename(file.fClientPath.Normalize()), fFlags(file.fFlags),
+          fReceived(), fResumeAt(), fRetries(), fExpected(file.fChecksum), plZlibStream()
     {
         // ugh. eap removed the compressed flag in his fail manifests
         if (file.fServerPath.GetFileExt().compare_i("gz") == 0) {
@@ -243,11 +335,13 @@ public:
         } else {
             parent->fTotalBytes += file.fFileSize;
         }
+
+        if (fExpected.IsValid())
+            fChecksum.Start();
     }
 
     void Begin()
     {
-        fDLStartTime = hsTimer::GetSeconds<float>();
         if (!fOutput)
             Open(fFilename, "wb");
     }
@@ -263,6 +357,17 @@ public:
 
     uint32_t Write(uint32_t count, const void* buf) override
     {
+        // A retried download starts over from the top, so drop whatever we
+        // already wrote out last time around
+        uint32_t skip = 0;
+        if (fReceived < fResumeAt)
+            skip = uint32_t(std::min<uint64_t>(count, fResumeAt - fReceived));
+        fReceived += count;
+        if (skip == count)
+            return count;
+        buf = static_cast<const uint8_t*>(buf) + skip;
+        count -= skip;
+
         // tick whatever progress bar we have
         IUpdateProgress(count);
 
@@ -270,7 +375,29 @@ public:
         if (hsCheckBits(fFlags, kFlagZipped))
             return plZlibStream::Write(count, buf);
         else
-            return fOutput->Write(count, buf);
+            return IWriteOutput(count, buf);
+    }
+
+    /** Sets up to pick up where the last attempt left off. False if we've tried enough already. */
+    bool Retry()
+    {
+        if (fRetries >= kMaxRetries)
+            return false;
+        ++fRetries;
+        fResumeAt = std::max(fResumeAt, fReceived);
+        fReceived = 0;
+        return true;
+    }
+
+    uint64_t GetResumeOffset() const { return fResumeAt; }
+
+    /** Checks what we wrote against the manifest, without reading the file back in */
+    bool VerifyChecksum()
+    {
+        if (!fExpected.IsValid())
+            return true;
+        fChecksum.Finish();
+        return fChecksum == fExpected;
     }
 
     bool AtEnd() override { return fOutput->AtEnd(); }
@@ -297,7 +424,6 @@ static void IAuthThingDownloadCB(ENetError result, void* param, const plFileName
 
     if (IS_NET_SUCCESS(result)) {
         PatcherLogGreen("\tDownloaded Legacy File '{}'", filename);
-        patcher->IssueRequest();
 
         // Now, we pass our RAM-backed file to the game code handlers. In the main client,
         // this will trickle down and add a new friend to plStreamSource. This should never
@@ -308,6 +434,9 @@ static void IAuthThingDownloadCB(ENetError result, void* param, const plFileName
         PatcherLogRed("\tDownloaded Failed: File '{}'", filename);
         patcher->EndPatch(result, filename.AsString());
     }
+
+    // The patch thread may tear us down once this is done, so it goes last
+    patcher->FinishRequest();
 }
 
 static void IGotAuthFileList(ENetError result, void* param, const NetCliAuthFileInfo infoArr[], unsigned infoCount)
@@ -331,10 +460,11 @@ static void IGotAuthFileList(ENetError result, void* param, const NetCliAuthFile
                 patcher->fRequests.emplace_back(fn.AsString(), pfPatcherWorker::Request::kAuthFile, s);
             }
         }
-        patcher->IssueRequest();
+        patcher->FinishRequest();
     } else {
         PatcherLogRed("\tSHIT! Some legacy manifest phailed");
         patcher->EndPatch(result, "SecurePreloader failed");
+        patcher->FinishRequest();
     }
 }
 
@@ -345,9 +475,9 @@ static void IHandleManifestDownload(pfPatcherWorker* patcher, const wchar_t grou
         hsLockGuard(patcher->fFileMut);
         for (unsigned i = 0; i < entryCount; ++i)
             patcher->fQueuedFiles.emplace_back(pfPatcherQueuedFile::Type::kManifestHash, manifest[i]);
-        patcher->fFileSignal.Signal();
     }
-    patcher->IssueRequest();
+    patcher->fFileQueued.notify_all();
+    patcher->FinishRequest();
 }
 
 static void IPreloaderManifestDownloadCB(ENetError result, void* param, const wchar_t group[], const NetCliFileManifestEntry manifest[], unsigned entryCount)
@@ -367,7 +497,7 @@ static void IPreloaderManifestDownloadCB(ENetError result, void* param, const wc
         }
 
         // continue pumping requests
-        patcher->IssueRequest();
+        patcher->FinishRequest();
     }
 }
 
@@ -380,15 +510,35 @@ static void IFileManifestDownloadCB(ENetError result, void* param, const wchar_t
     else {
         PatcherLogRed("\tDownload Failed: Manifest '{}'", group);
         patcher->EndPatch(result, ST::string::from_wchar(group));
+        patcher->FinishRequest();
     }
 }
 
+static bool IIsRetryable(ENetError result)
+{
+    // These are what a dropped FileSrv connection looks like
+    return result == kNetErrTimeout || result == kNetErrDisconnected;
+}
+
 static void IFileThingDownloadCB(ENetError result, void* param, const plFileName& filename, hsStream* writer)
 {
     pfPatcherWorker* patcher = static_cast<pfPatcherWorker*>(param);
     pfPatcherStream* stream = static_cast<pfPatcherStream*>(writer);
+
+    // One flaky connection shouldn't kill the whole patch. The file stays open
+    // and the next attempt skips ahead to where this one stopped.
+    if (IIsRetryable(result) && stream->Retry()) {
+        PatcherLogYellow("\tRetrying '{}' from {} bytes", stream->GetFileName(), stream->GetResumeOffset());
+        patcher->RetryRequest(filename.AsString(), stream);
+        return;
+    }
     stream->Close();
 
+    if (IS_NET_SUCCESS(result) && !stream->VerifyChecksum()) {
+        PatcherLogRed("\tChecksum Mismatch: File '{}'", stream->GetFileName());
+        result = kNetErrBadServerData;
+    }
+
     if (IS_NET_SUCCESS(result)) {
         PatcherLogGreen("\tDownloaded File '{}'", stream->GetFileName());
         patcher->WhitelistFile(stream->GetFileName(), true);
@@ -397,18 +547,17 @@ static void IFileThingDownloadCB(ENetError result, void* param, const plFileName
         if (patcher->fRedistUpdateDownloaded && stream->IsRedistUpdate())
             patcher->fRedistUpdateDownloaded(stream->GetFileName());
 
-        // Punt the SFX decompression to the patcher thread (this is the main/draw thread)
+        // Punt the SFX decompression to the file threads (this is the main/draw thread)
         if (stream->RequiresSfxCache()) {
-            hsLockGuard(patcher->fFileMut);
-            patcher->fQueuedFiles.emplace_back(pfPatcherQueuedFile::Type::kSoundDecompress,
-                                               stream->GetFileName(), stream->GetFlags());
-            patcher->fFileSignal.Signal();
+            patcher->QueueFile(pfPatcherQueuedFile(pfPatcherQueuedFile::Type::kSoundDecompress,
+                                                   stream->GetFileName(), stream->GetFlags()));
         }
-        patcher->IssueRequest();
+        patcher->FinishRequest();
     } else {
         PatcherLogRed("\tDownloaded Failed: File '{}'", stream->GetFileName());
         stream->Unlink();
         patcher->EndPatch(result, filename.AsString());
+        patcher->FinishRequest();
     }
 
     delete stream;
@@ -417,11 +566,14 @@ static void IFileThingDownloadCB(ENetError result, void* param, const plFileName
 // ===================================================
 
 pfPatcherWorker::pfPatcherWorker() :
-    fStarted(false), fCurrBytes(0), fTotalBytes(0), fRequestActive(true), fParent(nullptr)
+    fFilesInFlight(0), fStopFileThreads(false), fStarted(false), fCurrBytes(0), fTotalBytes(0),
+    fLastTickBytes(0), fTickPending(false), fTickBytes(0), fTickTotal(0), fRequestActive(true), fRequestsInFlight(0), fParent(nullptr)
 { }
 
 pfPatcherWorker::~pfPatcherWorker()
 {
+    IStopFileThreads();
+
     {
         hsLockGuard(fRequestMut);
         std::for_each(fRequests.begin(), fRequests.end(),
@@ -447,8 +599,9 @@ void pfPatcherWorker::OnQuit()
 
 void pfPatcherWorker::EndPatch(ENetError result, const ST::string& msg)
 {
-    // Guard against multiple calls
-    if (fStarted) {
+    // Guard against multiple calls. The main thread and the file threads can
+    // both get here, so only whoever clears the flag gets to finish up.
+    if (fStarted.exchange(false)) {
         // Send end status
         if (fOnComplete)
             fOnComplete(result, msg);
@@ -462,26 +615,48 @@ void pfPatcherWorker::EndPatch(ENetError result, const ST::string& msg)
         }
     }
 
-    fStarted = false;
     fFileSignal.Signal();
 }
 
 bool pfPatcherWorker::IssueRequest()
 {
-    hsLockGuard(fRequestMut);
-    if (fRequests.empty()) {
-        fRequestActive = false;
-        fFileSignal.Signal(); // make sure the patch thread doesn't deadlock!
-        return false;
-    } else
-        fRequestActive = true;
+    // Claim the requests under the lock, but send them after letting go of it.
+    // Beginning a download calls the user back, and NetCli has locks of its own.
+    std::vector<Request> requests;
+    bool active;
+    {
+        hsLockGuard(fRequestMut);
+        while (fStarted && !fRequests.empty()) {
+            // File downloads are pipelined, everything else waits for the net to go quiet
+            const Request& req = fRequests.front();
+            if (req.fType == Request::kFile ? fRequestsInFlight >= kMaxDownloads : fRequestsInFlight != 0)
+                break;
 
-    const Request& req = fRequests.front();
+            requests.emplace_back(std::move(fRequests.front()));
+            ++fRequestsInFlight;
+            fRequests.pop_front();
+        }
+
+        active = fRequestsInFlight != 0;
+        fRequestActive = active;
+        if (!active)
+            fFileSignal.Signal(); // make sure the patch thread doesn't deadlock!
+    }
+
+    for (const Request& req : requests)
+        IIssueRequest(req);
+    return active;
+}
+
+void pfPatcherWorker::IIssueRequest(const Request& req)
+{
     switch (req.fType) {
         case Request::kFile:
             req.fStream->Begin();
-            if (fFileBeginDownload)
+            if (fFileBeginDownload) {
+                hsLockGuard(fCallbackMut);
                 fFileBeginDownload(req.fStream->GetFileName());
+            }
 
             NetCliFileDownloadRequest(req.fName, req.fStream, IFileThingDownloadCB, this);
             break;
@@ -496,8 +671,10 @@ bool pfPatcherWorker::IssueRequest()
         case Request::kAuthFile:
             // ffffffuuuuuu
             req.fStream->Begin();
-            if (fFileBeginDownload)
+            if (fFileBeginDownload) {
+                hsLockGuard(fCallbackMut);
                 fFileBeginDownload(req.fStream->GetFileName());
+            }
 
             NetCliAuthFileRequest(req.fName, req.fStream, IAuthThingDownloadCB, this);
             break;
@@ -509,50 +686,155 @@ bool pfPatcherWorker::IssueRequest()
             break;
         DEFAULT_FATAL(req.fType);
     }
+}
 
-    fRequests.pop_front();
-    return true;
+void pfPatcherWorker::FinishRequest()
+{
+    {
+        hsLockGuard(fRequestMut);
+        --fRequestsInFlight;
+    }
+    IssueRequest();
+}
+
+void pfPatcherWorker::RetryRequest(const ST::string& name, pfPatcherStream* s)
+{
+    {
+        hsLockGuard(fRequestMut);
+        fRequests.emplace_front(name, Request::kFile, s);
+    }
+    FinishRequest();
+}
+
+void pfPatcherWorker::QueueFile(pfPatcherQueuedFile file)
+{
+    {
+        hsLockGuard(fFileMut);
+        fQueuedFiles.emplace_back(std::move(file));
+    }
+    fFileQueued.notify_one();
 }
 
 void pfPatcherWorker::Run()
 {
     // So here's the rub:
     // We have one or many manifests in the fRequests deque. We begin issuing those requests one-by one, starting here.
-    // As we receive the answer, the NetCli thread populates fQueuedFiles and pings the fFileSignal semaphore, then issues the next request...
-    // In this non-UI/non-Net thread, we do the stutter-prone/time-consuming IO/hashing operations. (Typically, the UI thread == Net thread)
+    // As we receive the answer, the NetCli thread populates fQueuedFiles and wakes up the file threads, then issues the next request...
+    // The file threads do the stutter-prone/time-consuming IO/hashing operations in parallel. (Typically, the UI thread == Net thread)
     // As we find files that need updating, we add them to fRequests.
     // If there is no net request from ME when we find a file, we issue the request
     // Once a file is downloaded, the next request is issued.
-    // When there are no files in my deque and no requests in my deque, we exit without errors.
+    // When there are no files in my deque, no files being worked on, and no requests in my deque, we exit without errors.
     PatcherLogWhite("--- Patch Started ({} requests) ---", fRequests.size());
     fStarted = true;
+    IStartFileThreads();
     IssueRequest();
 
-    // Now, work until we're done processing files
+    // Now, wait until everyone is done processing files
+    uint32_t nextTickMs = hsTimer::GetMilliSeconds<uint32_t>() + kProgressTickMs;
     do {
-        fFileSignal.Wait();
-
-        hsLockGuard(fFileMut);
-        if (!fQueuedFiles.empty()) {
-            ProcessFile();
+        // Tick on time, no matter how often we're woken up
+        uint32_t nowMs = hsTimer::GetMilliSeconds<uint32_t>();
+        if (int32_t(nowMs - nextTickMs) >= 0) {
+            ITickProgress();
+            nextTickMs = nowMs + kProgressTickMs;
+        }
+        if (!fFileSignal.Wait(std::chrono::milliseconds(nextTickMs - nowMs)))
             continue;
+
+        {
+            hsLockGuard(fFileMut);
+            if (!fQueuedFiles.empty() || fFilesInFlight != 0)
+                continue;
         }
 
-        // This makes sure both queues are empty before exiting.
-        if (!fRequestActive)
-            if(!IssueRequest())
+        // This makes sure both queues are empty before exiting.  Claim the
+        // idle flag first so we don't race another thread that saw it too.
+        bool active = false;
+        if (fRequestActive.compare_exchange_strong(active, true))
+            if (!IssueRequest())
                 break;
     } while (fStarted);
 
+    // If we bailed on an error, other downloads may still be out there and
+    // they'll call back into us, so wait for them to land.
+    for (;;) {
+        {
+            hsLockGuard(fRequestMut);
+            if (fRequestsInFlight == 0)
+                break;
+        }
+        fFileSignal.Wait();
+    }
+
+    IStopFileThreads();
+    IFlushProgress();
     EndPatch(kNetSuccess);
 }
 
+void pfPatcherWorker::IStartFileThreads()
+{
+    unsigned numThreads = std::min(std::max(std::thread::hardware_concurrency(), 2U), 4U);
+    PatcherLogWhite("\tUsing {} file threads", numThreads);
+
+    fFileThreads.reserve(numThreads);
+    for (unsigned i = 0; i < numThreads; ++i)
+        fFileThreads.emplace_back(&pfPatcherWorker::IFileThreadRun, this);
+}
+
+void pfPatcherWorker::IStopFileThreads()
+{
+    {
+        hsLockGuard(fFileMut);
+        fStopFileThreads = true;
+    }
+    fFileQueued.notify_all();
+
+    for (std::thread& thread : fFileThreads)
+        thread.join();
+    fFileThreads.clear();
+}
+
+void pfPatcherWorker::IFileThreadRun()
+{
+    for (;;) {
+        std::unique_lock<std::mutex> lock(fFileMut);
+        fFileQueued.wait(lock, [this] { return fStopFileThreads || !fQueuedFiles.empty(); });
+        if (fStopFileThreads)
+            return;
+
+        pfPatcherQueuedFile file = std::move(fQueuedFiles.front());
+        fQueuedFiles.pop_front();
+        ++fFilesInFlight;
+        lock.unlock();
+
+        switch (file.fType) {
+        case pfPatcherQueuedFile::Type::kManifestHash:
+            IHashFile(file);
+            break;
+        case pfPatcherQueuedFile::Type::kSoundDecompress:
+            IDecompressSound(file);
+            break;
+        }
+
+        // Get the download going before we tell the patch thread that we're done,
+        // otherwise it might think everything is finished.
+        IssueRequest();
+
+        lock.lock();
+        --fFilesInFlight;
+        lock.unlock();
+        fFileSignal.Signal();
+    }
+}
+
 void pfPatcherWorker::IHashFile(pfPatcherQueuedFile& file)
 {
     // Check to see if ours matches
     plFileInfo mine(file.fClientPath);
     if (mine.FileSize() == file.fFileSize) {
         plMD5Checksum cliMD5(file.fClientPath);
+        fHashRate.Add(file.fFileSize);
         if (cliMD5 == file.fChecksum) {
             WhitelistFile(file.fClientPath, false);
             return;
@@ -561,7 +843,12 @@ void pfPatcherWorker::IHashFile(pfPatcherQueuedFile& file)
 
     // It's different... but do we want it?
     if (fFileDownloadDesired) {
-        if (!fFileDownloadDesired(file.fClientPath)) {
+        bool desired;
+        {
+            hsLockGuard(fCallbackMut);
+            desired = fFileDownloadDesired(file.fClientPath);
+        }
+        if (!desired) {
             PatcherLogRed("\tDeclined '{}'", file.fClientPath);
             return;
         }
@@ -596,27 +883,11 @@ void pfPatcherWorker::IDecompressSound(const pfPatcherQueuedFile& file) const
         plAudioFileReader::CacheFile(file.fClientPath, false);
 }
 
-void pfPatcherWorker::ProcessFile()
-{
-    do {
-        pfPatcherQueuedFile& file = fQueuedFiles.front();
-        switch (file.fType) {
-        case pfPatcherQueuedFile::Type::kManifestHash:
-            IHashFile(file);
-            break;
-        case pfPatcherQueuedFile::Type::kSoundDecompress:
-            IDecompressSound(file);
-            break;
-        }
-        fQueuedFiles.pop_front();
-
-        if (!fRequestActive)
-            IssueRequest();
-    } while (!fQueuedFiles.empty());
-}
-
 void pfPatcherWorker::WhitelistFile(const plFileName& file, bool justDownloaded, hsStream* stream)
 {
+    // the file threads and the net thread can both get here
+    hsLockGuard(fCallbackMut);
+
     // if this is a newly downloaded file, fire off a completion callback
     if (justDownloaded && fFileDownloaded)
         fFileDownloaded(file);
@@ -642,6 +913,62 @@ void pfPatcherWorker::WhitelistFile(const plFileName& file, bool justDownloaded,
     }
 }
 
+static void IProgressTickCB(void* param)
+{
+    pfPatcherWorker* patcher = static_cast<pfPatcherWorker*>(param);
+    patcher->fProgressTick(patcher->fTickBytes, patcher->fTickTotal, patcher->fTickMsg);
+    patcher->fTickPending = false;
+    patcher->fFileSignal.Signal();
+}
+
+void pfPatcherWorker::ITickProgress()
+{
+    // tick-tick-tick, tick-tick-tock
+    uint64_t curBytes = fCurrBytes;
+    if (!fProgressTick || curBytes == fLastTickBytes)
+        return;
+
+    // The callback gets to touch the UI, so it runs on the main thread like
+    // everything else NetCli calls back. If the last tick still hasn't made
+    // it there, this one can wait for the next.
+    bool pending = false;
+    if (!fTickPending.compare_exchange_strong(pending, true))
+        return;
+
+    fLastTickBytes = curBytes;
+    fTickBytes = curBytes;
+    fTickTotal = fTotalBytes;
+    fTickMsg = GetStatusMsg();
+    NetClientPost(IProgressTickCB, this);
+}
+
+void pfPatcherWorker::IFlushProgress()
+{
+    // The final count has to go out, and everything we've posted has to
+    // land, before anyone hears that we're done.
+    while (fTickPending)
+        fFileSignal.Wait();
+    ITickProgress();
+    while (fTickPending)
+        fFileSignal.Wait();
+}
+
+ST::string pfPatcherWorker::GetStatusMsg()
+{
+    ST::string msg = plFileSystem::ConvertFileSize(fDownloadRate.GetRate()) + "/s";
+
+    // while we're still chewing through the manifests, show how fast the local files are verifying
+    uint64_t hashRate = fHashRate.GetRate();
+    bool hashing;
+    {
+        hsLockGuard(fFileMut);
+        hashing = !fQueuedFiles.empty() || fFilesInFlight != 0;
+    }
+    if (hashing && hashRate != 0)
+        msg += ST::format(" (verifying {}/s)", plFileSystem::ConvertFileSize(hashRate));
+    return msg;
+}
+
 // ===================================================
 
 plStatusLog* pfPatcher::GetLog()
@@ -101,7 +101,8 @@ public:
 
     /** Set a callback that will be fired when the patcher wants to download a file. You are
      *  given the ability to approve or veto the download. With great power comes great responsibility...
-     *  \remarks This will be called from the patcher thread.
+     *  \remarks This will be called from one of the patcher's file threads, but never from
+     *  more than one at a time.
      */
     void OnFileDownloadDesired(FileDesiredFunc cb);
 
@@ -116,9 +117,11 @@ public:
     */
     void OnGameCodeDiscovery(GameCodeDiscoverFunc cb);
 
-    /** Set a callback that will be fired when the patcher receives a chunk from the server. The status string
-     *  will contain the current download speed.
-     *  \remarks This will be called from the network thread.
+    /** Set a callback that will be fired about every 100ms while the patcher is running, as long as the
+     *  downloaded byte count has changed since the last tick. The final count is ticked before the
+     *  completion callback of a successful patch. The status string will contain the current download
+     *  speed and, while local files are still being checked, the verification speed.
+     *  \remarks This is posted to the main thread and called from NetClientUpdate().
      */
     void OnProgressTick(ProgressTickFunc cb);
 
@@ -43,6 +43,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define plProfile_h_inc
 
 #include "HeadSpin.h"
+#include "plProfileTrace.h"
 
 #ifndef PLASMA_EXTERNAL_RELEASE
 #define PL_PROFILE_ENABLED
@@ -76,6 +77,22 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 //     plProfile_EndLap(FoobarTime, pKeyedObj->GetKeyName());
 // }
 //
+// Timers and laps also show up in trace captures (see plProfileTrace), on
+// whichever thread they ran. For code with no timer of its own, such as a
+// worker thread's jobs, a scope can be traced by name alone:
+//
+// void WorkerThread()
+// {
+//     plProfile_SetThreadName("Foobar Worker");
+//     (wait for jobs...)
+// }
+//
+// void WorkerJob()
+// {
+//     plProfile_TraceScope("Foobar Job");
+//     (execute some code...)
+// }
+//
 
 #ifdef PL_PROFILE_ENABLED
 
@@ -104,6 +121,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #define plProfile_Extern(varName)                   extern plProfileVar gProfileVar##varName
 
+#define plProfile_TraceScope(name)                  plProfileTraceScope hsUniqueIdentifier(_TraceScope_)(name)
+#define plProfile_SetThreadName(name)               plProfileTrace::SetThreadName(name)
+
 #else
 
 #define plProfile_CreateTimerNoReset(name, group, varName)
@@ -131,6 +151,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #define plProfile_Extern(varName)
 
+#define plProfile_TraceScope(name)
+#define plProfile_SetThreadName(name)
+
 #endif
 
 class plProfileLaps;
@@ -220,8 +243,8 @@ public:
     ~plProfileVar();
 
     // For timing
-    void BeginTiming() { if (fActive && fRunning) IBeginTiming(); }
-    void EndTiming() { if (fActive && fRunning) IEndTiming(); }
+    void BeginTiming() { plProfileTrace::Begin(fName, fGroup); if (fActive && fRunning) IBeginTiming(); }
+    void EndTiming() { if (fActive && fRunning) IEndTiming(); plProfileTrace::End(fName, fGroup); }
 
     void NewMem(uint32_t memAmount) { fValue += memAmount; }
     void DelMem(uint32_t memAmount) { fValue -= memAmount; }
@@ -238,8 +261,10 @@ public:
     // Will output to log like
     // Timername : lapCnt: (lapName) : 3.22 msec
     //
-    void BeginLap(const char* lapName) { if(fActive && fRunning) IBeginLap(lapName); }
-    void EndLap(const char* lapName) { if(fActive && fRunning) IEndLap(lapName); }
+    // In trace captures, the lap is the event name, and the timer its category.
+    //
+    void BeginLap(const char* lapName) { plProfileTrace::BeginCopy(lapName, fName); if(fActive && fRunning) IBeginLap(lapName); }
+    void EndLap(const char* lapName) { if(fActive && fRunning) IEndLap(lapName); plProfileTrace::EndCopy(lapName, fName); }
     
     const char* GetGroup() { return fGroup; }
 
@@ -41,11 +41,17 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 *==LICENSE==*/
 #include "plProfileManager.h"
 #include "plProfile.h"
+#include "hsJobPool.h"
 #include "hsTimer.h"
 #include <algorithm>
 
 plProfileManager::plProfileManager() : fLastAvgTime(0), fProcessorSpeed(0)
 {
+#ifdef PL_PROFILE_ENABLED
+    // Timers register with us during static init, on the main thread
+    plProfile_SetThreadName("Main");
+    hsJobPool::Instance().SetThreadInit([] { plProfile_SetThreadName("Job Worker"); });
+#endif
 }
 
 plProfileManager::~plProfileManager()
@@ -74,6 +80,8 @@ static plProfileVar gVarEFPS("EFPS", "General", plProfileVar::kDisplayTime | plP
 
 void plProfileManager::BeginFrame()
 {
+    plProfileTrace::BeginFrame();
+
     for (int i = 0; i < fVars.size(); i++)
     {
         fVars[i]->BeginFrame();
@@ -266,27 +274,9 @@ void plProfileBase::PrintMax(char* buf, bool printType)
 
 plProfileLaps::LapInfo* plProfileLaps::IFindLap(const char* lapName)
 {
-    static int lastSearch = 0;
-
-    int i;
-    for (i = lastSearch; i < fLapTimes.size(); i++)
-    {
-        if(fLapTimes[i].GetName() == lapName)
-        {
-            lastSearch = i;
-            return &fLapTimes[i];
-        }
-    }
-
-    if(lastSearch > fLapTimes.size()) lastSearch = fLapTimes.size();
-    for (i = 0; i < lastSearch; i++)
-    {
-        if(fLapTimes[i].GetName() == lapName)
-        {
-            lastSearch = i;
-            return &fLapTimes[i];
-        }
-    }
+    auto it = fLapIndex.find(lapName);
+    if (it != fLapIndex.end())
+        return &fLapTimes[it->second];
     return nullptr;
 }
 
@@ -298,6 +288,7 @@ void plProfileLaps::BeginLap(uint64_t curValue, const char* name)
         // Technically we shouldn't hold on to this pointer.  However, I think
         // it will be ok in all cases, so I'll wait until this blows up
         LapInfo info(name);
+        fLapIndex[name] = fLapTimes.size();
         fLapTimes.push_back(info);
         lap = &(*(fLapTimes.end()-1));
     }
@@ -328,6 +319,7 @@ void plProfileLaps::BeginFrame()
 
 void plProfileLaps::EndFrame()
 {
+    bool dropped = false;
     for (int i = 0; i < fLapTimes.size(); i++)
     {
         fLapTimes[i].EndFrame();
@@ -338,8 +330,16 @@ void plProfileLaps::EndFrame()
             hsStatusMessage(buf);
             fLapTimes.erase(fLapTimes.begin()+i);
             i--;
+            dropped = true;
         }
     }
+
+    if (dropped)
+    {
+        fLapIndex.clear();
+        for (size_t i = 0; i < fLapTimes.size(); i++)
+            fLapIndex[fLapTimes[i].GetName()] = i;
+    }
 }
 
 void plProfileLaps::UpdateAvgs()
@@ -385,12 +385,12 @@ void plProfileVar::IBeginLap(const char* lapName)
     fDisplayFlags |= kDisplayLaps;
     if(fLapsActive)
         fLaps->BeginLap(fValue, lapName);
-    BeginTiming();
+    IBeginTiming();
 }
 
 void plProfileVar::IEndLap(const char* lapName)
 {
-    EndTiming();
+    IEndTiming();
     if(fLapsActive)
         fLaps->EndLap(fValue, lapName);
 }
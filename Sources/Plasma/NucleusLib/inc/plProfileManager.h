@@ -43,6 +43,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define plProfileManager_h_inc
 
 #include "HeadSpin.h"
+#include <unordered_map>
 #include <vector>
 
 #include "plProfile.h"
@@ -96,6 +97,10 @@ protected:
     };
     std::vector<LapInfo> fLapTimes;
 
+    // Laps are told apart by their name pointers, same as always, but looked
+    // up here instead of searched for.
+    std::unordered_map<const char*, size_t> fLapIndex;
+
     LapInfo* IFindLap(const char* lapName);
 
 public:
@@ -0,0 +1,325 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#include "plProfileTrace.h"
+#include "hsLockGuard.h"
+#include "hsStream.h"
+#include "hsTimer.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char* fName;
+        const char* fCategory;
+        uint64_t    fTicks;
+        char        fPhase;
+    };
+
+    // One thread's events. Only the thread holding it ever writes to it,
+    // publishing each event by bumping fCount, so everything below fCount
+    // can be read from anywhere. fCapture says which capture the events
+    // belong to, and fNames holds the names copied for it. A thread only
+    // gets a buffer once it records something during a capture, and hands
+    // it back when it exits, for the next thread to reuse.
+    struct TraceBuffer
+    {
+        static constexpr uint32_t kMaxEvents = 1 << 16;
+
+        uint32_t                        fThreadId;      // Only changed with the list locked
+        std::atomic<const char*>        fThreadName;
+        std::atomic<uint32_t>           fCapture;
+        std::atomic<uint32_t>           fCount;
+        std::unique_ptr<TraceEvent[]>   fEvents;
+        std::unordered_set<std::string> fNames;
+
+        TraceBuffer()
+            : fThreadId(), fThreadName(), fCapture(), fCount(),
+              fEvents(new TraceEvent[kMaxEvents])
+        { }
+    };
+
+    struct TraceBufferList
+    {
+        std::mutex                                  fMutex;
+        std::vector<std::unique_ptr<TraceBuffer>>   fBuffers;
+        std::vector<TraceBuffer*>                   fFree;  // Their threads are gone
+    };
+
+    // Timers start tracing during static init, and worker threads can still
+    // be tracing during static destruction, so this is made on first use and
+    // never freed.
+    TraceBufferList& IGetBufferList()
+    {
+        static TraceBufferList* sList = new TraceBufferList;
+        return *sList;
+    }
+
+    std::atomic<uint32_t>   sCaptureId;
+    std::atomic<uint32_t>   sDropped;
+    std::atomic<uint32_t>   sNextThreadId;
+
+    // The calling thread's id and name, which it has whether or not it ever
+    // gets a buffer.
+    struct TraceThread
+    {
+        uint32_t        fId;
+        const char*     fName;
+        TraceBuffer*    fBuffer;
+
+        TraceThread() : fId(sNextThreadId.fetch_add(1) + 1), fName(), fBuffer() { }
+        ~TraceThread()
+        {
+            if (fBuffer)
+            {
+                TraceBufferList& list = IGetBufferList();
+                hsLockGuard(list.fMutex);
+                list.fFree.emplace_back(fBuffer);
+            }
+        }
+    };
+
+    thread_local TraceThread sThread;
+
+    // These are only touched by the main thread, in BeginFrame and WriteJson
+    uint32_t                sFramesToCapture = 0;
+    uint32_t                sFramesLeft = 0;
+    std::vector<uint64_t>   sFrameStarts;
+
+    TraceBuffer* IGetBuffer()
+    {
+        TraceThread& thread = sThread;
+        if (!thread.fBuffer)
+        {
+            TraceBufferList& list = IGetBufferList();
+            hsLockGuard(list.fMutex);
+
+            // Free buffers still holding the current capture are kept for
+            // WriteJson, anything older can be reused.
+            const uint32_t capture = sCaptureId.load();
+            auto it = std::find_if(list.fFree.begin(), list.fFree.end(),
+                [capture](const TraceBuffer* buf) {
+                    return buf->fCapture.load(std::memory_order_relaxed) != capture;
+                });
+            if (it != list.fFree.end())
+            {
+                thread.fBuffer = *it;
+                list.fFree.erase(it);
+            }
+            else
+            {
+                list.fBuffers.emplace_back(std::make_unique<TraceBuffer>());
+                thread.fBuffer = list.fBuffers.back().get();
+            }
+            thread.fBuffer->fThreadId = thread.fId;
+            thread.fBuffer->fThreadName.store(thread.fName);
+        }
+        return thread.fBuffer;
+    }
+
+    void IWriteString(hsStream* s, const char* str)
+    {
+        s->WriteByte((uint8_t)'"');
+        for (; str && *str; ++str)
+        {
+            unsigned char c = *str;
+            if (c == '"' || c == '\\')
+            {
+                s->WriteByte((uint8_t)'\\');
+                s->WriteByte(c);
+            }
+            else if (c < 0x20)
+            {
+                char buf[8];
+                snprintf(buf, std::size(buf), "\\u%04x", c);
+                s->Write(strlen(buf), buf);
+            }
+            else
+                s->WriteByte(c);
+        }
+        s->WriteByte((uint8_t)'"');
+    }
+
+    void IWriteRaw(hsStream* s, const char* str)
+    {
+        s->Write(strlen(str), str);
+    }
+}
+
+std::atomic<bool> plProfileTrace::fCapturing;
+bool plProfileTrace::fCaptureDone = false;
+
+void plProfileTrace::StartCapture(uint32_t numFrames)
+{
+    fCapturing.store(false);
+    fCaptureDone = false;
+    sFramesToCapture = numFrames;
+}
+
+void plProfileTrace::BeginFrame()
+{
+    uint64_t now = hsTimer::GetTicks();
+
+    if (IsCapturing())
+    {
+        if (--sFramesLeft == 0)
+        {
+            fCapturing.store(false);
+            fCaptureDone = true;
+        }
+        sFrameStarts.emplace_back(now);
+    }
+    else if (sFramesToCapture)
+    {
+        sFramesLeft = sFramesToCapture;
+        sFramesToCapture = 0;
+
+        sFrameStarts.clear();
+        sFrameStarts.emplace_back(now);
+        sDropped.store(0);
+        sCaptureId.fetch_add(1);
+        fCapturing.store(true);
+    }
+}
+
+void plProfileTrace::IRecord(const char* name, const char* category, char phase, bool copyName)
+{
+    TraceBuffer* buf = IGetBuffer();
+
+    // First event of a new capture, throw out whatever was left from the last
+    uint32_t capture = sCaptureId.load(std::memory_order_acquire);
+    if (buf->fCapture.load(std::memory_order_relaxed) != capture)
+    {
+        buf->fCount.store(0, std::memory_order_relaxed);
+        buf->fNames.clear();
+        buf->fCapture.store(capture, std::memory_order_release);
+    }
+
+    uint32_t count = buf->fCount.load(std::memory_order_relaxed);
+    if (count >= TraceBuffer::kMaxEvents)
+    {
+        sDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (copyName && name)
+        name = buf->fNames.emplace(name).first->c_str();
+
+    buf->fEvents[count] = { name, category, hsTimer::GetTicks(), phase };
+    buf->fCount.store(count + 1, std::memory_order_release);
+}
+
+void plProfileTrace::SetThreadName(const char* name)
+{
+    TraceThread& thread = sThread;
+    thread.fName = name;
+    if (thread.fBuffer)
+        thread.fBuffer->fThreadName.store(name);
+}
+
+void plProfileTrace::WriteJson(hsStream* s)
+{
+    if (sFrameStarts.empty())
+        return;
+
+    const uint64_t start = sFrameStarts.front();
+    const uint32_t capture = sCaptureId.load();
+
+    char buf[256];
+    IWriteRaw(s, "{\"traceEvents\":[\n");
+
+    // One instant event across all threads at the start of every frame,
+    // plus the last one marking the end of the capture.
+    for (size_t i = 0; i < sFrameStarts.size(); i++)
+    {
+        snprintf(buf, std::size(buf),
+                 "%s{\"name\":\"Frame %zu\",\"cat\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f}\n",
+                 i ? "," : "", i, hsTimer::GetMilliSeconds<double>(sFrameStarts[i] - start) * 1000.0);
+        IWriteRaw(s, buf);
+    }
+
+    TraceBufferList& list = IGetBufferList();
+    hsLockGuard(list.fMutex);
+    for (const std::unique_ptr<TraceBuffer>& tb : list.fBuffers)
+    {
+        if (tb->fCapture.load(std::memory_order_acquire) != capture)
+            continue;
+
+        if (const char* threadName = tb->fThreadName.load())
+        {
+            snprintf(buf, std::size(buf), ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                     tb->fThreadId);
+            IWriteRaw(s, buf);
+            IWriteString(s, threadName);
+            IWriteRaw(s, "}}\n");
+        }
+
+        uint32_t count = tb->fCount.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const TraceEvent& ev = tb->fEvents[i];
+
+            // Anything a thread was in the middle of logging when the
+            // capture started can land just before it.
+            if (ev.fTicks < start)
+                continue;
+
+            IWriteRaw(s, ",{\"name\":");
+            IWriteString(s, ev.fName);
+            IWriteRaw(s, ",\"cat\":");
+            IWriteString(s, ev.fCategory);
+            snprintf(buf, std::size(buf), ",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}\n",
+                     ev.fPhase, tb->fThreadId, hsTimer::GetMilliSeconds<double>(ev.fTicks - start) * 1000.0);
+            IWriteRaw(s, buf);
+        }
+    }
+
+    snprintf(buf, std::size(buf), "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%u}}\n",
+             sDropped.load());
+    IWriteRaw(s, buf);
+}
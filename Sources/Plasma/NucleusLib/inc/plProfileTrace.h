@@ -0,0 +1,113 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#ifndef plProfileTrace_h_inc
+#define plProfileTrace_h_inc
+
+#include "HeadSpin.h"
+#include <atomic>
+
+class hsStream;
+
+//
+// Per-thread tracing for the plProfile timers. While a capture is running,
+// every BeginTiming/EndTiming and BeginLap/EndLap, plus any
+// plProfile_TraceScope, is recorded as a begin or end event on the thread
+// it happened on. Each thread appends to its own buffer, so there's no
+// locking on the way in, and when nothing is being captured each call
+// costs one load and a branch. Threads only get a buffer once they record
+// something during a capture, and give it back when they exit.
+//
+// A capture covers a number of whole frames, as marked out by
+// plProfileManager::BeginFrame, and can then be written out as Chrome trace
+// JSON for chrome://tracing or ui.perfetto.dev.
+//
+class plProfileTrace
+{
+protected:
+    static std::atomic<bool> fCapturing;
+    static bool fCaptureDone;
+
+    static void IRecord(const char* name, const char* category, char phase, bool copyName);
+
+public:
+    // Captures the next numFrames frames, starting with the next one.
+    static void StartCapture(uint32_t numFrames);
+    static bool IsCapturing() { return fCapturing.load(std::memory_order_relaxed); }
+
+    // True once a capture has run all its frames, until the next one starts.
+    static bool IsCaptureDone() { return fCaptureDone; }
+
+    // Writes the last finished capture out as Chrome trace JSON.
+    static void WriteJson(hsStream* s);
+
+    static void Begin(const char* name, const char* category) { if (IsCapturing()) IRecord(name, category, 'B', false); }
+    static void End(const char* name, const char* category) { if (IsCapturing()) IRecord(name, category, 'E', false); }
+
+    // Same, for names that might not be around by the time the capture is
+    // written out (like lap names, which are usually key names). These get
+    // copied, so they cost a bit more.
+    static void BeginCopy(const char* name, const char* category) { if (IsCapturing()) IRecord(name, category, 'B', true); }
+    static void EndCopy(const char* name, const char* category) { if (IsCapturing()) IRecord(name, category, 'E', true); }
+
+    // Names the calling thread in captures. The name has to stay around.
+    // Use plProfile_SetThreadName, so it gets compiled out with the rest.
+    static void SetThreadName(const char* name);
+
+    static void BeginFrame();   // Called by plProfileManager
+};
+
+// Traces everything from here to the end of the scope, for code that
+// doesn't have (or can't share) a plProfile timer, like worker threads.
+class plProfileTraceScope
+{
+protected:
+    const char* fName;
+
+public:
+    plProfileTraceScope(const char* name) : fName(name) { plProfileTrace::Begin(fName, "Trace"); }
+    ~plProfileTraceScope() { plProfileTrace::End(fName, "Trace"); }
+
+    plProfileTraceScope(const plProfileTraceScope&) = delete;
+    plProfileTraceScope& operator=(const plProfileTraceScope&) = delete;
+};
+
+#endif // plProfileTrace_h_inc
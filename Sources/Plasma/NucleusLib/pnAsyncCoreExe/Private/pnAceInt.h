@@ -74,6 +74,15 @@ long PerfSetCounter (unsigned id, unsigned n);
 void DnsDestroy (unsigned exitThreadWaitMs);
 
 
+/*****************************************************************************
+*
+*   Socket.cpp
+*
+***/
+
+void SocketDestroy (unsigned exitThreadWaitMs);
+
+
 /*****************************************************************************
 *
 *   Thread.cpp
@@ -0,0 +1,863 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "Pch.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include <asio/write.hpp>
+
+using tcp = asio::ip::tcp;
+
+/****************************************************************************
+*
+*   Private
+*
+***/
+
+// how long to wait for connect() to complete
+static const unsigned   kConnectTimeMs      = 10*1000;
+
+static const int        kTcpSndBufSize      = 64*1024-1;
+static const int        kTcpRcvBufSize      = 64*1024-1;
+
+// wait before checking for backlog problems
+static const unsigned   kBacklogInitMs      = 3*60*1000;
+
+// destroy a connection if it has a backlog "problem"
+static const unsigned   kBacklogFailMs      = 2*60*1000;
+
+static const unsigned   kMinBacklogBytes    = 4 * 1024;
+
+// how long to wait for the remote end to close a soft-closed socket
+static const unsigned   kCloseTimeoutMs     = 8*1000;
+
+// number of spare write buffers each socket keeps around for reuse
+static const size_t     kMaxSpareWriteBuffers = 4;
+
+// the sockets only wait on I/O, so a few threads go a long way
+static const unsigned   kMaxWorkerThreads   = 4;
+
+struct SocketWriteBuffer
+{
+    unsigned                fQueueTimeMs;
+    std::vector<uint8_t>    fData;
+};
+
+struct AsyncSocketStruct
+{
+    std::recursive_mutex            fCritsect;
+    tcp::socket                     fSock;
+    asio::steady_timer              fCloseTimer;
+    FAsyncNotifySocketProc          fNotifyProc;
+    void*                           fUserState;
+    unsigned                        fConnType;
+    unsigned                        fInitTimeMs;
+    unsigned                        fCloseTimeMs;
+
+    // Number of outstanding asynchronous operations (plus one while the
+    // connection is being set up).  When this drops to zero, the socket
+    // is closed and the application receives kNotifySocketDisconnect.
+    std::atomic<long>               fIoCount;
+    bool                            fClosed;
+
+    AsyncNotifySocketRead           fRead;
+    unsigned                        fBytesLeft;
+    uint8_t                         fBuffer[kAsyncSocketBufferSize];
+
+    // Data queued by AsyncSocketSend.  The first fWritesInFlight entries
+    // are being written by a single gathered async_write; anything queued
+    // behind them is sent together once that write completes.
+    std::deque<SocketWriteBuffer>   fWriteQueue;
+    std::vector<asio::const_buffer> fWriteBufs;
+    std::vector<std::vector<uint8_t>> fSpareBuffers;
+    size_t                          fWritesInFlight;
+    size_t                          fBytesInFlight;
+
+    AsyncSocketStruct(tcp::socket&& sock);
+    ~AsyncSocketStruct();
+};
+
+struct SocketConnectOperation
+{
+    tcp::socket             fSock;
+    asio::steady_timer      fTimeout;
+    AsyncCancelId           fCancelId;
+    bool                    fCanceled;
+    plNetAddress            fRemoteAddr;
+    FAsyncNotifySocketProc  fNotifyProc;
+    void*                   fParam;
+    std::vector<uint8_t>    fSendData;
+
+    SocketConnectOperation(asio::io_context& context)
+        : fSock(context), fTimeout(context), fCancelId(), fCanceled(),
+          fNotifyProc(), fParam()
+    { }
+};
+
+struct SocketManager
+{
+    asio::io_context fContext;
+    asio::executor_work_guard<asio::io_context::executor_type> fWorkGuard;
+    std::vector<std::thread> fIoThreads;
+    std::atomic<unsigned> fThreadsRunning;
+
+    SocketManager() : fWorkGuard(fContext.get_executor()), fThreadsRunning()
+    {
+        unsigned threadCount = std::min(std::max(std::thread::hardware_concurrency(), 2U), kMaxWorkerThreads);
+
+        fIoThreads.reserve(threadCount);
+        for (unsigned i = 0; i < threadCount; ++i) {
+            ++fThreadsRunning;
+            fIoThreads.emplace_back([this] {
+#ifdef USE_VLD
+                VLDEnable();
+#endif
+                PerfAddCounter(kAsyncPerfThreadsTotal, 1);
+                PerfAddCounter(kAsyncPerfThreadsCurr, 1);
+
+                fContext.run();
+
+                PerfSubCounter(kAsyncPerfThreadsCurr, 1);
+                --fThreadsRunning;
+            });
+        }
+    }
+
+    // Returns false if sockets that still use the context are left over,
+    // in which case it has to be left alone.
+    bool Destroy(unsigned exitThreadWaitMs);
+};
+
+static std::recursive_mutex         s_socketCrit;
+static SocketManager*               s_socketMgr = nullptr;
+
+// Sockets that haven't been deleted yet. They all use the manager's context.
+static std::mutex                   s_liveSocketCrit;
+static std::unordered_set<AsyncSocket> s_liveSockets;
+
+static std::recursive_mutex         s_connectCrit;
+static std::list<std::shared_ptr<SocketConnectOperation>> s_connectList;
+static unsigned                     s_nextConnectCancelId = 1;
+
+
+//===========================================================================
+AsyncSocketStruct::AsyncSocketStruct(tcp::socket&& sock)
+    : fSock(std::move(sock)), fCloseTimer(fSock.get_executor()),
+      fNotifyProc(), fUserState(), fConnType(), fInitTimeMs(TimeGetMs()),
+      fCloseTimeMs(), fIoCount(1), fClosed(), fBytesLeft(),
+      fWritesInFlight(), fBytesInFlight()
+{
+    memset(fBuffer, 0, sizeof(fBuffer));
+
+    {
+        hsLockGuard(s_liveSocketCrit);
+        s_liveSockets.insert(this);
+    }
+
+    PerfAddCounter(kAsyncPerfSocketsCurr, 1);
+    PerfAddCounter(kAsyncPerfSocketsTotal, 1);
+}
+
+//===========================================================================
+AsyncSocketStruct::~AsyncSocketStruct()
+{
+    // Make sure socket can only be deleted after receiving NOTIFY_DISCONNECT
+    ASSERT(fClosed);
+
+    {
+        hsLockGuard(s_liveSocketCrit);
+        s_liveSockets.erase(this);
+    }
+
+    size_t bytesQueued = 0;
+    for (size_t i = fWritesInFlight; i < fWriteQueue.size(); ++i)
+        bytesQueued += fWriteQueue[i].fData.size();
+    if (bytesQueued)
+        PerfSubCounter(kAsyncPerfSocketBytesWaitQueued, (unsigned)bytesQueued);
+
+    asio::error_code ignore;
+    fSock.close(ignore);
+
+    PerfSubCounter(kAsyncPerfSocketsCurr, 1);
+}
+
+//===========================================================================
+static SocketManager* SocketGetManager()
+{
+    hsLockGuard(s_socketCrit);
+    if (!s_socketMgr)
+        s_socketMgr = new SocketManager;
+    return s_socketMgr;
+}
+
+//===========================================================================
+static tcp::endpoint SocketGetEndpoint(const plNetAddress& addr)
+{
+    // plNetAddress stores the host in network byte order
+    asio::ip::address_v4::bytes_type bytes;
+    uint32_t host = addr.GetHost();
+    memcpy(bytes.data(), &host, bytes.size());
+    return tcp::endpoint(asio::ip::address_v4(bytes), addr.GetPort());
+}
+
+//===========================================================================
+static plNetAddress SocketGetNetAddress(const tcp::endpoint& endpoint)
+{
+    if (!endpoint.address().is_v4())
+        return {};
+    return plNetAddress(endpoint.address().to_v4().to_bytes(), endpoint.port());
+}
+
+//===========================================================================
+static void SocketGetAddresses(
+    AsyncSocket     sock,
+    plNetAddress*   localAddr,
+    plNetAddress*   remoteAddr
+) {
+    asio::error_code err;
+    tcp::endpoint endpoint = sock->fSock.local_endpoint(err);
+    if (err)
+        LogMsg(kLogError, "getsockname failed: {}", err.message());
+    *localAddr = SocketGetNetAddress(endpoint);
+
+    endpoint = sock->fSock.remote_endpoint(err);
+    if (err)
+        LogMsg(kLogError, "getpeername failed: {}", err.message());
+    *remoteAddr = SocketGetNetAddress(endpoint);
+}
+
+//===========================================================================
+static void SocketHardClose(AsyncSocket sock)
+{
+    // caller must own sock->fCritsect
+    asio::error_code ignore;
+    if (sock->fSock.is_open()) {
+        // Abortive close; any unsent data is lost
+        sock->fSock.set_option(asio::socket_base::linger(true, 0), ignore);
+        sock->fSock.close(ignore);
+    }
+    sock->fCloseTimer.cancel(ignore);
+}
+
+//===========================================================================
+bool SocketManager::Destroy(unsigned exitThreadWaitMs)
+{
+    // Close everything, so that whatever is outstanding completes and the
+    // application hears about the disconnects while we can still tell it
+    {
+        hsLockGuard(s_liveSocketCrit);
+        for (AsyncSocket sock : s_liveSockets) {
+            hsLockGuard(sock->fCritsect);
+            sock->fCloseTimeMs |= 1;
+            SocketHardClose(sock);
+        }
+    }
+
+    // Without the guard, the threads leave run() once that has all drained
+    fWorkGuard.reset();
+    unsigned bailAt = TimeGetMs() + exitThreadWaitMs;
+    while (fThreadsRunning && signed(bailAt - TimeGetMs()) > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (fThreadsRunning)
+        LogMsg(kLogDebug, "Socket threads did not finish after {} ms", exitThreadWaitMs);
+
+    // Don't dispatch any more completions for sockets that the application
+    // failed to disconnect in time. Nobody may be in run() once we're done.
+    fContext.stop();
+    for (std::thread& thread : fIoThreads)
+        thread.join();
+    fIoThreads.clear();
+
+    hsLockGuard(s_liveSocketCrit);
+    if (!s_liveSockets.empty()) {
+        LogMsg(kLogError, "{} sockets were never deleted", s_liveSockets.size());
+        return false;
+    }
+    return true;
+}
+
+//===========================================================================
+static void SocketCompleteOperation(AsyncSocket sock)
+{
+    {
+        hsLockGuard(sock->fCritsect);
+
+        // are we completing the last operation for this socket?
+        if (--sock->fIoCount)
+            return;
+
+        ASSERT(!sock->fClosed);
+        sock->fClosed = true;
+    }
+
+    if (sock->fNotifyProc) {
+        // We have to be extremely careful from this point because
+        // sockets can be deleted during the notification callback.
+        // After this call, the application becomes responsible for
+        // calling AsyncSocketDelete at some later point in time.
+        FAsyncNotifySocketProc notifyProc = sock->fNotifyProc;
+        sock->fNotifyProc = nullptr;
+        notifyProc(sock, kNotifySocketDisconnect, nullptr, &sock->fUserState);
+    } else {
+        // Since the no application notification procedure was
+        // ever set, the socket can now be deleted safely.
+        AsyncSocketDelete(sock);
+    }
+}
+
+//===========================================================================
+static void SocketCompleteRead(AsyncSocket sock, size_t bytes);
+
+static void SocketStartAsyncRead(AsyncSocket sock)
+{
+    // enter critical section in case someone attempts to close socket from another thread
+    hsLockGuard(sock->fCritsect);
+    if (!sock->fSock.is_open())
+        return;
+
+    ++sock->fIoCount;
+    sock->fSock.async_read_some(
+        asio::buffer(sock->fBuffer + sock->fBytesLeft, sizeof(sock->fBuffer) - sock->fBytesLeft),
+        [sock](const asio::error_code& err, size_t bytes) {
+            SocketCompleteRead(sock, err ? 0 : bytes);
+        });
+}
+
+//===========================================================================
+static void SocketCompleteRead(AsyncSocket sock, size_t bytes)
+{
+    do {
+        // a zero-byte read means the socket is going
+        // to shutdown, so don't start another read
+        if (!bytes)
+            break;
+
+        // add new bytes to buffer bytes
+        sock->fBytesLeft += (unsigned)bytes;
+
+        // dispatch data
+        sock->fRead.param           = nullptr;
+        sock->fRead.asyncId         = nullptr;
+        sock->fRead.buffer          = sock->fBuffer;
+        sock->fRead.bytes           = sock->fBytesLeft;
+        sock->fRead.bytesProcessed  = 0;
+
+        if (!sock->fNotifyProc || !sock->fNotifyProc(sock, kNotifySocketRead, &sock->fRead, &sock->fUserState))
+            break;
+
+        // if only some of the bytes were used then shift
+        // remaining bytes down otherwise clear buffer.
+        if (sock->fRead.bytesProcessed > sock->fBytesLeft) {
+            LogMsg(kLogError, "SocketDispatchRead error for {#x}: {} {} {}",
+                   (uintptr_t)sock, sock->fBytesLeft, sock->fRead.bytes,
+                   sock->fRead.bytesProcessed);
+            break;
+        }
+
+        if (0 != (sock->fBytesLeft -= sock->fRead.bytesProcessed)) {
+            if (sock->fRead.bytesProcessed) {
+                memmove(
+                    sock->fBuffer,
+                    sock->fBuffer + sock->fRead.bytesProcessed,
+                    sock->fBytesLeft
+                );
+            }
+
+            // make sure there's enough space left in the buffer for another read
+            if (sock->fBytesLeft >= sizeof(sock->fBuffer))
+                break;
+        }
+
+        SocketStartAsyncRead(sock);
+        SocketCompleteOperation(sock);
+        return;
+    } while (false);
+
+    // No more reads will be issued, so there is nothing left for the
+    // soft close timer to wait for.
+    {
+        hsLockGuard(sock->fCritsect);
+        asio::error_code ignore;
+        sock->fCloseTimer.cancel(ignore);
+    }
+
+    SocketCompleteOperation(sock);
+}
+
+//===========================================================================
+static void SocketCompleteWrite(AsyncSocket sock, const asio::error_code& err);
+
+static void SocketStartAsyncWrite(AsyncSocket sock)
+{
+    // caller must own sock->fCritsect
+    ASSERT(!sock->fWritesInFlight);
+    ASSERT(!sock->fWriteQueue.empty());
+
+    // Gather everything queued so far into a single write
+    sock->fWriteBufs.clear();
+    size_t bytes = 0;
+    for (const SocketWriteBuffer& buffer : sock->fWriteQueue) {
+        sock->fWriteBufs.emplace_back(asio::buffer(buffer.fData));
+        bytes += buffer.fData.size();
+    }
+    sock->fWritesInFlight = sock->fWriteQueue.size();
+    sock->fBytesInFlight = bytes;
+
+    PerfSubCounter(kAsyncPerfSocketBytesWaitQueued, (unsigned)bytes);
+    PerfAddCounter(kAsyncPerfSocketBytesWriteQueued, (unsigned)bytes);
+
+    ++sock->fIoCount;
+    asio::async_write(sock->fSock, sock->fWriteBufs,
+        [sock](const asio::error_code& err, size_t) {
+            SocketCompleteWrite(sock, err);
+        });
+}
+
+//===========================================================================
+static void SocketCompleteWrite(AsyncSocket sock, const asio::error_code& err)
+{
+    {
+        hsLockGuard(sock->fCritsect);
+
+        PerfSubCounter(kAsyncPerfSocketBytesWriteQueued, (unsigned)sock->fBytesInFlight);
+
+        // Recycle the buffers we just sent
+        for (; sock->fWritesInFlight; --sock->fWritesInFlight) {
+            std::vector<uint8_t>& data = sock->fWriteQueue.front().fData;
+            if (sock->fSpareBuffers.size() < kMaxSpareWriteBuffers) {
+                data.clear();
+                sock->fSpareBuffers.emplace_back(std::move(data));
+            }
+            sock->fWriteQueue.pop_front();
+        }
+        sock->fBytesInFlight = 0;
+
+        if (err) {
+            // an error occurred -- destroy connection
+            if (err != asio::error::operation_aborted)
+                SocketHardClose(sock);
+        } else if (!sock->fWriteQueue.empty()) {
+            SocketStartAsyncWrite(sock);
+        } else if (sock->fCloseTimeMs && sock->fSock.is_open()) {
+            // A soft close was requested while data was still queued;
+            // now that it has been flushed, finish the shutdown.
+            asio::error_code ignore;
+            sock->fSock.shutdown(tcp::socket::shutdown_send, ignore);
+        }
+    }
+
+    SocketCompleteOperation(sock);
+}
+
+//===========================================================================
+static bool SocketQueueWrite(
+    AsyncSocket     sock,
+    const uint8_t*  data,
+    unsigned        bytes
+) {
+    // caller must own sock->fCritsect
+    unsigned currTimeMs = TimeGetMs();
+
+    // check for data backlog
+    if (!sock->fWriteQueue.empty()) {
+        const SocketWriteBuffer& firstQueuedWrite = sock->fWriteQueue.front();
+        if (((long) (currTimeMs - firstQueuedWrite.fQueueTimeMs) >= (long) kBacklogFailMs)
+        &&  ((long) (currTimeMs - sock->fInitTimeMs) >= (long) kBacklogInitMs)
+        ) {
+            PerfAddCounter(kAsyncPerfSocketDisconnectBacklog, 1);
+
+            if (sock->fConnType) {
+                LogMsg(
+                    kLogPerf,
+                    "Backlog, c:{} q:{}, i:{}",
+                    sock->fConnType,
+                    currTimeMs - firstQueuedWrite.fQueueTimeMs,
+                    currTimeMs - sock->fInitTimeMs
+                );
+            }
+            AsyncSocketDisconnect(sock, true);
+            return false;
+        }
+    }
+
+    PerfAddCounter(kAsyncPerfSocketBytesWaitQueued, bytes);
+
+    // if the last buffer isn't part of the current write and still has
+    // space available then add data to it
+    if (sock->fWriteQueue.size() > sock->fWritesInFlight) {
+        std::vector<uint8_t>& lastQueuedWrite = sock->fWriteQueue.back().fData;
+        unsigned bytesLeft = (unsigned)(lastQueuedWrite.capacity() - lastQueuedWrite.size());
+        bytesLeft = std::min(bytesLeft, bytes);
+        if (bytesLeft) {
+            lastQueuedWrite.insert(lastQueuedWrite.end(), data, data + bytesLeft);
+            data += bytesLeft;
+            if (0 == (bytes -= bytesLeft))
+                return true;
+        }
+    }
+
+    // allocate a buffer large enough to hold the data, plus
+    // extra space in case more data needs to be queued later
+    SocketWriteBuffer& buffer = sock->fWriteQueue.emplace_back();
+    if (!sock->fSpareBuffers.empty()) {
+        buffer.fData = std::move(sock->fSpareBuffers.back());
+        sock->fSpareBuffers.pop_back();
+    }
+    buffer.fQueueTimeMs = currTimeMs;
+    buffer.fData.reserve(std::max(bytes, kMinBacklogBytes));
+    buffer.fData.assign(data, data + bytes);
+
+    return true;
+}
+
+//===========================================================================
+static bool SocketInitCommon(tcp::socket& sock)
+{
+    asio::error_code err;
+
+    // make socket non-blocking, so AsyncSocketSend can try writing directly
+    sock.non_blocking(true, err);
+    if (err) {
+        LogMsg(kLogError, "ioctlsocket failed (make non-blocking): {}", err.message());
+        return false;
+    }
+
+    // set socket buffer sizes
+    sock.set_option(asio::socket_base::send_buffer_size(kTcpSndBufSize), err);
+    if (err)
+        LogMsg(kLogError, "setsockopt(send) failed (set send buffer size): {}", err.message());
+
+    sock.set_option(asio::socket_base::receive_buffer_size(kTcpRcvBufSize), err);
+    if (err)
+        LogMsg(kLogError, "setsockopt(recv) failed (set recv buffer size): {}", err.message());
+
+    return true;
+}
+
+//===========================================================================
+static bool SocketInitConnect(
+    AsyncSocket                     sock,
+    const SocketConnectOperation&   op
+) {
+    bool notified = false;
+    for (;;) {
+        // send initial data
+        if (!op.fSendData.empty() && !AsyncSocketSend(sock, op.fSendData.data(), (unsigned)op.fSendData.size()))
+            break;
+
+        // Determine connType
+        if (!op.fSendData.empty()) {
+            sock->fConnType = op.fSendData[0];
+            if (!IS_TEXT_CONNTYPE(sock->fConnType)) {
+                if (op.fSendData.size() < sizeof(AsyncSocketConnectPacket))
+                    break;
+
+                auto connectPacket = reinterpret_cast<const AsyncSocketConnectPacket*>(op.fSendData.data());
+                if (sock->fConnType != connectPacket->connType)
+                    break;
+            }
+        }
+
+        // perform callback notification
+        notified = true;
+        AsyncNotifySocketConnect notify;
+        SocketGetAddresses(sock, &notify.localAddr, &notify.remoteAddr);
+        notify.param        = op.fParam;
+        notify.asyncId      = nullptr;
+        notify.connType     = sock->fConnType;
+        sock->fNotifyProc   = op.fNotifyProc;
+        if (!sock->fNotifyProc(sock, kNotifySocketConnectSuccess, &notify, &sock->fUserState))
+            break;
+
+        // start reading from the socket
+        SocketStartAsyncRead(sock);
+        break;
+    }
+
+    SocketCompleteOperation(sock);
+    return notified;
+}
+
+//===========================================================================
+static void SocketCompleteConnect(
+    const std::shared_ptr<SocketConnectOperation>&  op,
+    const asio::error_code&                         err
+) {
+    AsyncSocket sock = nullptr;
+    {
+        hsLockGuard(s_connectCrit);
+        s_connectList.remove(op);
+
+        asio::error_code ignore;
+        op->fTimeout.cancel(ignore);
+
+        if (err) {
+            if (err != asio::error::operation_aborted)
+                LogMsg(kLogError, "socket connect failed: {}", err.message());
+        } else if (!op->fCanceled && SocketInitCommon(op->fSock)) {
+            sock = new AsyncSocketStruct(std::move(op->fSock));
+        }
+    }
+
+    bool notified = sock && SocketInitConnect(sock, *op);
+
+    // handle connection failure
+    if (!notified) {
+        AsyncNotifySocketConnect failed;
+        failed.param      = op->fParam;
+        failed.connType   = op->fSendData.empty() ? kConnTypeNil : op->fSendData[0];
+        failed.remoteAddr = op->fRemoteAddr;
+        op->fNotifyProc(nullptr, kNotifySocketConnectFailed, &failed, nullptr);
+    }
+
+    PerfSubCounter(kAsyncPerfSocketConnAttemptsOutCurr, 1);
+}
+
+
+/****************************************************************************
+*
+*   Module functions
+*
+***/
+
+//===========================================================================
+void SocketDestroy(unsigned exitThreadWaitMs)
+{
+    // Abort any connection attempts still in progress
+    AsyncSocketConnectCancel(nullptr);
+
+    SocketManager* mgr;
+    {
+        hsLockGuard(s_socketCrit);
+        mgr = s_socketMgr;
+        s_socketMgr = nullptr;
+    }
+
+    // Not under s_socketCrit, since the completions we wait for may need it.
+    // If sockets are left over, the context has to outlive them.
+    if (mgr && mgr->Destroy(exitThreadWaitMs))
+        delete mgr;
+}
+
+
+/****************************************************************************
+*
+*   Exported functions
+*
+***/
+
+//===========================================================================
+void AsyncSocketConnect(
+    AsyncCancelId *         cancelId,
+    const plNetAddress&     netAddr,
+    FAsyncNotifySocketProc  notifyProc,
+    void *                  param,
+    const void *            sendData,
+    unsigned                sendBytes
+) {
+    ASSERT(notifyProc);
+
+    SocketManager* mgr = SocketGetManager();
+
+    auto op = std::make_shared<SocketConnectOperation>(mgr->fContext);
+    op->fRemoteAddr     = netAddr;
+    op->fNotifyProc     = notifyProc;
+    op->fParam          = param;
+    if (sendBytes) {
+        auto bytes = reinterpret_cast<const uint8_t*>(sendData);
+        op->fSendData.assign(bytes, bytes + sendBytes);
+    }
+
+    PerfAddCounter(kAsyncPerfSocketConnAttemptsOutCurr, 1);
+    PerfAddCounter(kAsyncPerfSocketConnAttemptsOutTotal, 1);
+
+    hsLockGuard(s_connectCrit);
+
+    // get cancel id; we can avoid checking for zero by always using an odd number
+    ASSERT(s_nextConnectCancelId & 1);
+    s_nextConnectCancelId += 2;
+
+    *cancelId = op->fCancelId = (AsyncCancelId)(uintptr_t)s_nextConnectCancelId;
+    s_connectList.emplace_back(op);
+
+    // if the socket has taken too long to connect then abort attempt
+    op->fTimeout.expires_after(std::chrono::milliseconds(kConnectTimeMs));
+    op->fTimeout.async_wait([op](const asio::error_code& err) {
+        if (err == asio::error::operation_aborted)
+            return;
+
+        hsLockGuard(s_connectCrit);
+        asio::error_code ignore;
+        op->fCanceled = true;
+        op->fSock.close(ignore);
+    });
+
+    op->fSock.async_connect(SocketGetEndpoint(netAddr), [op](const asio::error_code& err) {
+        SocketCompleteConnect(op, err);
+    });
+}
+
+//===========================================================================
+// due to the asynchronous nature sockets, the connect may occur
+// before the cancel can complete... you have been warned
+void AsyncSocketConnectCancel(
+    AsyncCancelId          cancelId        // nullptr = cancel all
+) {
+    hsLockGuard(s_connectCrit);
+    for (const auto& op : s_connectList) {
+        if (cancelId && (op->fCancelId != cancelId))
+            continue;
+
+        asio::error_code ignore;
+        op->fCanceled = true;
+        op->fSock.close(ignore);
+    }
+}
+
+//===========================================================================
+// This function must ONLY be called after receiving a NOTIFY_DISCONNECT message
+// for a socket. After a NOTIFY_DISCONNECT, the socket will fail all I/O initiated
+// against it, but will otherwise continue to exist. The memory for the socket will
+// only be freed when AsyncSocketDelete is called.
+void AsyncSocketDelete(AsyncSocket sock)
+{
+    delete sock;
+}
+
+//===========================================================================
+void AsyncSocketDisconnect(AsyncSocket sock, bool hardClose)
+{
+    ASSERT(sock);
+
+    // must enter critical section in case someone attempts to close socket from another thread
+    hsLockGuard(sock->fCritsect);
+    if (hardClose || sock->fClosed) {
+        // Mark the socket closed so no more data can be sent
+        sock->fCloseTimeMs |= 1;
+        SocketHardClose(sock);
+    } else if (!sock->fCloseTimeMs) {
+        // The socket hasn't been closed previously; perform shutdown once
+        // all queued data has been written, and give the remote end some
+        // time to close its end of the connection before forcing it.
+        sock->fCloseTimeMs = (TimeGetMs() + kCloseTimeoutMs) | 1;
+
+        asio::error_code ignore;
+        if (!sock->fWritesInFlight)
+            sock->fSock.shutdown(tcp::socket::shutdown_send, ignore);
+
+        ++sock->fIoCount;
+        sock->fCloseTimer.expires_after(std::chrono::milliseconds(kCloseTimeoutMs));
+        sock->fCloseTimer.async_wait([sock](const asio::error_code& err) {
+            if (err != asio::error::operation_aborted) {
+                hsLockGuard(sock->fCritsect);
+                SocketHardClose(sock);
+            }
+            SocketCompleteOperation(sock);
+        });
+    }
+}
+
+//===========================================================================
+bool AsyncSocketSend(
+    AsyncSocket     sock,
+    const void *    data,
+    unsigned        bytes
+) {
+    ASSERT(sock);
+    ASSERT(data);
+    ASSERT(bytes);
+
+    hsLockGuard(sock->fCritsect);
+
+    // Is the socket closing?
+    if (sock->fCloseTimeMs || sock->fClosed || !sock->fSock.is_open())
+        return false;
+
+    // if there isn't any data queued, send this batch immediately
+    if (sock->fWriteQueue.empty()) {
+        asio::error_code err;
+        size_t bytesSent = sock->fSock.write_some(asio::buffer(data, bytes), err);
+        if (err && err != asio::error::would_block && err != asio::error::try_again) {
+            // an error occurred -- destroy connection
+            AsyncSocketDisconnect(sock, true);
+            return false;
+        }
+
+        // if we sent all the data then exit
+        if (bytesSent >= bytes)
+            return true;
+
+        // subtract the data we already sent and queue the rest below
+        data = (const uint8_t *) data + bytesSent;
+        bytes -= (unsigned)bytesSent;
+    }
+
+    if (!SocketQueueWrite(sock, (const uint8_t *) data, bytes))
+        return false;
+
+    if (!sock->fWritesInFlight)
+        SocketStartAsyncWrite(sock);
+    return true;
+}
+
+//===========================================================================
+// -- use only for server<->client connections, not server<->server!
+// -- Note that Nagling is enabled by default
+void AsyncSocketEnableNagling(AsyncSocket sock, bool enable)
+{
+    ASSERT(sock);
+
+    // must enter critical section in case someone attempts to close socket from another thread
+    hsLockGuard(sock->fCritsect);
+    if (sock->fSock.is_open()) {
+        asio::error_code err;
+        sock->fSock.set_option(tcp::no_delay(!enable), err);
+        if (err)
+            LogMsg(kLogError, "setsockopt failed (nagling): {}", err.message());
+    }
+}
@@ -47,6 +47,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "Pch.h"
 
+#ifndef HS_BUILD_FOR_WIN32
+#   include <future>
+#endif
+
 
 /*****************************************************************************
 *
@@ -61,3 +65,31 @@ void ThreadDestroy (unsigned exitThreadWaitMs) {
     while (AsyncPerfGetCounter(kAsyncPerfThreadsCurr) && signed(bailAt - TimeGetMs()) > 0)
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
 }
+
+
+/*****************************************************************************
+*
+*   Exports
+*
+***/
+
+#ifndef HS_BUILD_FOR_WIN32
+//============================================================================
+void AsyncThreadTimedJoin(std::thread& thread, unsigned timeoutMs)
+{
+    // The Win32 version waits on the native handle. Without one, a helper
+    // does the join, and we stop waiting for it after the timeout.
+    std::promise<void> joined;
+    std::future<void> done = joined.get_future();
+    std::thread joiner([worker = std::move(thread), joined = std::move(joined)]() mutable {
+        worker.join();
+        joined.set_value();
+    });
+    if (done.wait_for(std::chrono::milliseconds(timeoutMs)) == std::future_status::timeout) {
+        LogMsg(kLogDebug, "Thread did not terminate after {} ms", timeoutMs);
+        joiner.detach();
+    } else {
+        joiner.join();
+    }
+}
+#endif
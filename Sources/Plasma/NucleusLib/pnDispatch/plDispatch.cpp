@@ -61,6 +61,8 @@ plProfile_CreateTimer("  TimeMsg", "Update", TimeMsg);
 plProfile_CreateTimer("  EvalMsg", "Update", EvalMsg);
 plProfile_CreateTimer("  TransformMsg", "Update", TransformMsg);
 plProfile_CreateTimer("  CameraMsg", "Update", CameraMsg);
+plProfile_CreateCounter("Queued Msgs", "Update", QueuedMsgs);
+plProfile_CreateCounter("Queued Msg Overflows", "Update", QueuedMsgOverflows);
 
 class plMsgWrap
 {
@@ -100,7 +102,10 @@ std::mutex              plDispatch::fMsgDispatchLock; // mutex for IMsgDispatch
 
 
 plDispatch::plDispatch()
-: fOwner(), fFutureMsgQueue(), fQueuedMsgOn(true)
+: fOwner(), fFutureMsgQueue(), fQueuedMsgs(kMsgQueueSize),
+  fQueuedMsgOverflowing(false), fQueuedMsgOn(true),
+  fQueuedMsgEnqueueFailures(0), fQueuedMsgPeakDepth(0), fQueuedMsgProcessed(0),
+  fQueuedMsgTotalWait(0), fQueuedMsgMaxWait(0)
 {
 }
 
@@ -505,36 +510,91 @@ void plDispatch::MsgQueue(plMessage* msg)
 {
     if (fQueuedMsgOn)
     {
-        hsLockGuard(fQueuedMsgListMutex);
         hsAssert(msg,"Message missing");
-        fQueuedMsgList.push_back(msg);
+        QueuedMsg queued = { msg, hsTimer::GetTicks() };
+
+        if (fQueuedMsgOverflowing.load(std::memory_order_acquire) || !fQueuedMsgs.TryPush(queued))
+        {
+            hsLockGuard(fQueuedMsgOverflowMutex);
+            fQueuedMsgOverflowing.store(true, std::memory_order_release);
+            fQueuedMsgOverflow.push_back(queued);
+            fQueuedMsgEnqueueFailures.fetch_add(1, std::memory_order_relaxed);
+        }
     }
     else
         MsgSend(msg, false);
 }
 
+void plDispatch::IQueuedMsgSend(const QueuedMsg& queued)
+{
+    uint64_t wait = hsTimer::GetTicks() - queued.fQueuedAt;
+    fQueuedMsgTotalWait.fetch_add(wait, std::memory_order_relaxed);
+    if (wait > fQueuedMsgMaxWait.load(std::memory_order_relaxed))
+        fQueuedMsgMaxWait.store(wait, std::memory_order_relaxed);
+    fQueuedMsgProcessed.fetch_add(1, std::memory_order_relaxed);
+
+    MsgSend(queued.fMsg, false);
+}
+
 void plDispatch::MsgQueueProcess()
 {
-    // Process all messages on Queue, unlock while sending them
-    // this would allow other threads to put new messages on the list while we send()
+    // Process all messages on Queue.  Other threads can keep adding new
+    // messages while we send(), so keep going until both the ring and the
+    // overflow list come up empty.
+    uint32_t depth = (uint32_t)fQueuedMsgs.GetSize();
+    {
+        hsLockGuard(fQueuedMsgOverflowMutex);
+        depth += (uint32_t)fQueuedMsgOverflow.size();
+    }
+    if (depth > fQueuedMsgPeakDepth.load(std::memory_order_relaxed))
+        fQueuedMsgPeakDepth.store(depth, std::memory_order_relaxed);
+    plProfile_Set(QueuedMsgs, depth);
+    plProfile_Set(QueuedMsgOverflows, fQueuedMsgEnqueueFailures.load(std::memory_order_relaxed));
+
+    std::vector<QueuedMsg> overflow;
     bool empty = false;
     while (!empty)
     {
-        plMessage * pMsg = nullptr;
+        empty = true;
+
+        QueuedMsg queued;
+        while (fQueuedMsgs.TryPop(queued))
+        {
+            IQueuedMsgSend(queued);
+            empty = false;
+        }
+
+        // Only once the ring is drained can the overflowed messages go, and
+        // they all have to go before anything newer in the ring.
+        if (fQueuedMsgOverflowing.load(std::memory_order_acquire))
         {
-            hsLockGuard(fQueuedMsgListMutex);
-            empty = fQueuedMsgList.empty();
-            if (!empty)
             {
-                pMsg = fQueuedMsgList.front();
-                fQueuedMsgList.pop_front();
+                hsLockGuard(fQueuedMsgOverflowMutex);
+                overflow.swap(fQueuedMsgOverflow);
+                fQueuedMsgOverflowing.store(false, std::memory_order_release);
             }
+            for (const QueuedMsg& msg : overflow)
+                IQueuedMsgSend(msg);
+            empty = empty && overflow.empty();
+            overflow.clear();
         }
-        if (pMsg)
-            MsgSend(pMsg, false);
     }
 }
 
+plDispatch::QueueStats plDispatch::GetMsgQueueStats() const
+{
+    QueueStats stats;
+    stats.fDepth = (uint32_t)fQueuedMsgs.GetSize();
+    stats.fPeakDepth = fQueuedMsgPeakDepth.load(std::memory_order_relaxed);
+    stats.fEnqueueFailures = fQueuedMsgEnqueueFailures.load(std::memory_order_relaxed);
+    stats.fProcessed = fQueuedMsgProcessed.load(std::memory_order_relaxed);
+
+    uint64_t totalWait = fQueuedMsgTotalWait.load(std::memory_order_relaxed);
+    stats.fAvgTimeInQueue = stats.fProcessed ? hsTimer::GetMilliSeconds<float>(totalWait / stats.fProcessed) : 0.f;
+    stats.fMaxTimeInQueue = hsTimer::GetMilliSeconds<float>(fQueuedMsgMaxWait.load(std::memory_order_relaxed));
+    return stats;
+}
+
 void plDispatch::RegisterForType(uint16_t hClass, const plKey& receiver)
 {
     int i;
@@ -43,9 +43,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #ifndef plDispatch_inc
 #define plDispatch_inc
 
-#include <list>
+#include <atomic>
 #include <mutex>
 #include "plgDispatch.h"
+#include "hsMPSCQueue.h"
 #include "hsThread.h"
 #include "pnKeyedObject/hsKeyedObject.h"
 
@@ -83,10 +84,29 @@ protected:
     static MsgRecieveCallback       fMsgRecieveCallback;
 
     std::vector<plTypeFilter*>      fRegisteredExactTypes;
-    std::list<plMessage*>           fQueuedMsgList;
-    std::mutex                      fQueuedMsgListMutex; // mutex for above
+
+    // Messages sent from other threads with MsgQueue.  They normally go into
+    // the lock-free ring; if that fills up, they spill over into the locked
+    // overflow list, and keep doing so until MsgQueueProcess has emptied it
+    // so that no thread's messages get reordered.
+    enum { kMsgQueueSize = 4096 };
+    struct QueuedMsg
+    {
+        plMessage*  fMsg;
+        uint64_t    fQueuedAt;  // hsTimer ticks
+    };
+    hsMPSCQueue<QueuedMsg>          fQueuedMsgs;
+    std::vector<QueuedMsg>          fQueuedMsgOverflow;
+    std::mutex                      fQueuedMsgOverflowMutex; // mutex for above
+    std::atomic<bool>               fQueuedMsgOverflowing;
     bool                            fQueuedMsgOn;       // Turns on or off Queued Messages, Plugins need them off
 
+    std::atomic<uint32_t>           fQueuedMsgEnqueueFailures;
+    std::atomic<uint32_t>           fQueuedMsgPeakDepth;
+    std::atomic<uint32_t>           fQueuedMsgProcessed;
+    std::atomic<uint64_t>           fQueuedMsgTotalWait;
+    std::atomic<uint64_t>           fQueuedMsgMaxWait;
+
     hsKeyedObject*                  IGetOwner() { return fOwner; }
     plKey                           IGetOwnerKey() { return IGetOwner() ? IGetOwner()->GetKey() : nullptr; }
     int                             IFindType(uint16_t hClass);
@@ -107,6 +127,8 @@ protected:
 
     void                            ITrashUndelivered(); // Just pitches them, doesn't try to deliver.
 
+    void                            IQueuedMsgSend(const QueuedMsg& queued);
+
 public:
     plDispatch();
     virtual ~plDispatch();
@@ -129,6 +151,17 @@ public:
     void MsgQueue(plMessage* msg) override;
     void MsgQueueProcess() override;
 
+    struct QueueStats
+    {
+        uint32_t    fDepth;             // Messages waiting right now
+        uint32_t    fPeakDepth;         // Most messages seen waiting at once
+        uint32_t    fEnqueueFailures;   // Messages that didn't fit in the ring
+        uint32_t    fProcessed;         // Messages delivered by MsgQueueProcess
+        float       fAvgTimeInQueue;    // In milliseconds
+        float       fMaxTimeInQueue;    // In milliseconds
+    };
+    QueueStats GetMsgQueueStats() const;
+
     // Turn on or off Queued Messages, if off, uses MsgSend Immediately (for
     // plugins)
     void MsgQueueOnOff(bool sw) override;
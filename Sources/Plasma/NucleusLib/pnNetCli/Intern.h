@@ -83,6 +83,11 @@ void NetMsgChannelGetDhConstants (
     const plBigNum**        dh_xa,  // client: dh_x     server: dh_a
     const plBigNum**        dh_n
 );
+void NetMsgChannelAddSendStats (
+    NetMsgChannel * channel,
+    unsigned        bytes,
+    unsigned        allocs
+);
 
 
 /*****************************************************************************
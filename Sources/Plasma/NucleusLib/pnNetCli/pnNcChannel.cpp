@@ -46,6 +46,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 ***/
 
 #include "Pch.h"
+#include <atomic>
 #include <list>
 #include <mutex>
 #include "hsRefCnt.h"
@@ -82,7 +83,10 @@ private:
 };
 
 struct NetMsgChannel : hsRefCnt {
-    NetMsgChannel() : hsRefCnt(0), m_protocol(), m_server(), m_largestRecv(), m_dh_g() { }
+    NetMsgChannel()
+        : hsRefCnt(0), m_protocol(), m_server(), m_largestRecv(), m_dh_g(),
+          m_bytesSent(), m_sendCalls(), m_bufferAllocs()
+    { }
 
     uint32_t                m_protocol;
     bool                    m_server;
@@ -96,6 +100,11 @@ struct NetMsgChannel : hsRefCnt {
     uint32_t                m_dh_g;
     plBigNum                m_dh_xa;    // client: dh_x     server: dh_a
     plBigNum                m_dh_n;
+
+    // Send statistics, updated by every connection using this channel
+    std::atomic<uint64_t>   m_bytesSent;
+    std::atomic<uint64_t>   m_sendCalls;
+    std::atomic<uint64_t>   m_bufferAllocs;
 };
 
 static ChannelCrit                  s_channelCrit;
@@ -370,6 +379,20 @@ void NetMsgChannelGetDhConstants (
     if (dh_n) *dh_n   = &channel->m_dh_n;
 }
 
+//============================================================================
+void NetMsgChannelAddSendStats (
+    NetMsgChannel * channel,
+    unsigned        bytes,
+    unsigned        allocs
+) {
+    if (bytes) {
+        channel->m_bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+        channel->m_sendCalls.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (allocs)
+        channel->m_bufferAllocs.fetch_add(allocs, std::memory_order_relaxed);
+}
+
 
 }   // namespace pnNetCli
 
@@ -420,3 +443,21 @@ void NetMsgProtocolDestroy (uint32_t protocol, bool server) {
         channel->UnRef("ChannelLink");
     }
 }
+
+//===========================================================================
+bool NetMsgProtocolGetSendStats (
+    uint32_t                protocol,
+    bool                    server,
+    NetMsgSendStats *       stats
+) {
+    hsLockGuard(s_channelCrit);
+
+    const NetMsgChannel * channel = FindChannel_CS(protocol, server);
+    if (!channel)
+        return false;
+
+    stats->bytesSent    = channel->m_bytesSent.load(std::memory_order_relaxed);
+    stats->sendCalls    = channel->m_sendCalls.load(std::memory_order_relaxed);
+    stats->bufferAllocs = channel->m_bufferAllocs.load(std::memory_order_relaxed);
+    return true;
+}
@@ -145,6 +145,7 @@ struct NetCli {
 
     // Message buffers
     uint8_t                    sendBuffer[kAsyncSocketBufferSize];
+    std::vector<uint8_t>       sendScratch;    // encrypted copies of oversize messages
     std::vector<uint8_t>       recvBuffer;
 
     NetCli()
@@ -180,10 +181,7 @@ namespace pnNetCli {
 ***/
 
 //============================================================================
-static void PutBufferOnWire (NetCli * cli, void * data, unsigned bytes) {
-
-    uint8_t * temp = nullptr;
-
+static void LogBufferOnWire (NetCli * cli, const void * data, unsigned bytes) {
 #if !defined(PLASMA_EXTERNAL_RELEASE) && defined(HS_BUILD_FOR_WIN32)
     // Write to the netlog
     if (s_netlog) {
@@ -199,19 +197,46 @@ static void PutBufferOnWire (NetCli * cli, void * data, unsigned bytes) {
         WriteFile(s_netlog, data, bytes, &bytesWritten, nullptr);
     }
 #endif // PLASMA_EXTERNAL_RELEASE
+}
 
-    if (cli->mode == kNetCliModeEncrypted && cli->cryptOut) {
-        temp = (uint8_t *)malloc(bytes);
+//============================================================================
+static void SendBufferOnWire (NetCli * cli, const void * data, unsigned bytes) {
+    if (!cli->sock)
+        return;
+
+    // The socket layer has either sent or queued the data by the time
+    // AsyncSocketSend returns, so the caller's buffer may be reused
+    // immediately afterwards.
+    AsyncSocketSend(cli->sock, data, bytes);
+    NetMsgChannelAddSendStats(cli->channel, bytes, 0);
+}
+
+//============================================================================
+// Sends a buffer owned by the connection; the data is encrypted in place
+static void PutBufferOnWire (NetCli * cli, uint8_t * data, unsigned bytes) {
+    LogBufferOnWire(cli, data, bytes);
+
+    if (cli->mode == kNetCliModeEncrypted && cli->cryptOut)
+        CryptEncrypt(cli->cryptOut, bytes, data);
 
-        memcpy(temp, data, bytes);
-        CryptEncrypt(cli->cryptOut, bytes, temp);
-        data = temp;
+    SendBufferOnWire(cli, data, bytes);
+}
+
+//============================================================================
+// Sends a buffer owned by the caller, which must not be modified
+static void PutConstBufferOnWire (NetCli * cli, const uint8_t * data, unsigned bytes) {
+    if (cli->mode == kNetCliModeEncrypted && cli->cryptOut) {
+        // Encrypt a copy in the connection's scratch buffer, which only
+        // needs to grow when a message larger than any previous one is sent
+        if (cli->sendScratch.capacity() < bytes)
+            NetMsgChannelAddSendStats(cli->channel, 0, 1);
+        cli->sendScratch.assign(data, data + bytes);
+        PutBufferOnWire(cli, cli->sendScratch.data(), bytes);
+    }
+    else {
+        LogBufferOnWire(cli, data, bytes);
+        SendBufferOnWire(cli, data, bytes);
     }
-    if (cli->sock)
-        AsyncSocketSend(cli->sock, data, bytes);
-        
-    // free heap buffer (if any)
-    free(temp);
 }
 
 //============================================================================
@@ -233,10 +258,7 @@ static void AddToSendBuffer (
     if (bytes > std::size(cli->sendBuffer)) {
         // Let the OS fragment oversize buffers
         FlushSendBuffer(cli);
-        void * heap = malloc(bytes);
-        memcpy(heap, data, bytes);
-        PutBufferOnWire(cli, heap, bytes);
-        free(heap);
+        PutConstBufferOnWire(cli, src, bytes);
     }
     else {
         for (;;) {
@@ -246,8 +268,7 @@ static void AddToSendBuffer (
             unsigned const copy = std::min(bytes, left);
 
             // copy the data into the buffer
-            for (unsigned i = 0; i < copy; ++i)
-                cli->sendCurr[i] = src[i];
+            memcpy(cli->sendCurr, src, copy);
             cli->sendCurr += copy;
             ASSERT(cli->sendCurr - cli->sendBuffer <= sizeof(cli->sendBuffer));
 
@@ -263,6 +284,41 @@ static void AddToSendBuffer (
     }
 }
 
+//============================================================================
+static void AddIntegerToSendBuffer (
+    NetCli *            cli,
+    unsigned            size,
+    const void *        value
+) {
+    // Convert a single value to little endian on the stack
+    switch (size) {
+        case sizeof(uint8_t): {
+            AddToSendBuffer(cli, size, value);
+        }
+        break;
+
+        case sizeof(uint16_t): {
+            const uint16_t temp = hsToLE16(*(const uint16_t *)value);
+            AddToSendBuffer(cli, size, &temp);
+        }
+        break;
+
+        case sizeof(uint32_t): {
+            const uint32_t temp = hsToLE32(*(const uint32_t *)value);
+            AddToSendBuffer(cli, size, &temp);
+        }
+        break;
+
+        case sizeof(uint64_t): {
+            const uint64_t temp = hsToLE64(*(const uint64_t *)value);
+            AddToSendBuffer(cli, size, &temp);
+        }
+        break;
+
+        DEFAULT_FATAL(size);
+    }
+}
+
 //============================================================================
 static void BufferedSendData (
     NetCli *            cli,
@@ -300,42 +356,17 @@ static void BufferedSendData (
         switch (cmd->type) {
             case kNetMsgFieldInteger: {
                 const unsigned count = cmd->count ? cmd->count : 1;
-                const unsigned bytes = cmd->size * count;
-                void * temp = malloc(bytes);
-                
-                if (count == 1)
-                {
+
+                if (count == 1) {
                     // Single values are passed by value
-                    if (cmd->size == sizeof(uint8_t)) {
-                        *(uint8_t*)temp = *(uint8_t*)msg;
-                    } else if (cmd->size == sizeof(uint16_t)) {
-                        *(uint16_t*)temp = hsToLE16(*(uint16_t*)msg);
-                    } else if (cmd->size == sizeof(uint32_t)) {
-                        *(uint32_t*)temp = hsToLE32(*(uint32_t*)msg);
-                    } else if (cmd->size == sizeof(uint64_t)) {
-                        *(uint64_t*)temp = hsToLE64(*(uint64_t*)msg);
-                    }
+                    AddIntegerToSendBuffer(cli, cmd->size, (const void *) msg);
                 }
-                else
-                {
+                else {
                     // Value arrays are passed in by ptr
-                    for (size_t i = 0; i < count; i++) {
-                        if (cmd->size == sizeof(uint8_t)) {
-                            ((uint8_t*)temp)[i] = ((uint8_t*)*msg)[i];
-                        } else if (cmd->size == sizeof(uint16_t)) {
-                            ((uint16_t*)temp)[i] = hsToLE16(((uint16_t*)*msg)[i]);
-                        } else if (cmd->size == sizeof(uint32_t)) {
-                            ((uint32_t*)temp)[i] = hsToLE32(((uint32_t*)*msg)[i]);
-                        } else if (cmd->size == sizeof(uint64_t)) {
-                            ((uint64_t*)temp)[i] = hsToLE64(((uint64_t*)*msg)[i]);
-                        }
-                    }
+                    const uint8_t * values = (const uint8_t *) *msg;
+                    for (unsigned i = 0; i < count; ++i)
+                        AddIntegerToSendBuffer(cli, cmd->size, values + i * cmd->size);
                 }
-                
-                // Write values to send buffer
-                AddToSendBuffer(cli, bytes, temp);
-
-                free(temp);
             }
             break;
 
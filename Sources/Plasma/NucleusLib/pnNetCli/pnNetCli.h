@@ -336,6 +336,19 @@ void NetMsgProtocolDestroy (
     bool                    server
 );
 
+struct NetMsgSendStats {
+    uint64_t    bytesSent;      // bytes handed to the socket layer
+    uint64_t    sendCalls;      // number of AsyncSocketSend calls
+    uint64_t    bufferAllocs;   // send buffer (re)allocations
+};
+
+// Returns false if the protocol has not been registered
+bool NetMsgProtocolGetSendStats (
+    uint32_t                protocol,
+    bool                    server,
+    NetMsgSendStats *       stats
+);
+
 
 /*****************************************************************************
 *
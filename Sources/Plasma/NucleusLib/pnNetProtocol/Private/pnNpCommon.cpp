@@ -296,6 +296,7 @@ void NetVaultNode::Clear()
     fUsedFields = 0;
     fDirtyFields = 0;
     fRevision = kNilUuid;
+    IFieldsChanged(kValidFields);
 }
 
 //============================================================================
@@ -371,6 +372,8 @@ void NetVaultNode::CopyFrom(const NetVaultNode* node)
     COPYORZERO(Blob_2);
 
 #undef COPYORZERO
+
+    IFieldsChanged(kValidFields);
 }
 
 //============================================================================
@@ -431,6 +434,46 @@ bool NetVaultNode::Matches(const NetVaultNode* rhs) const
     return true;
 }
 
+//============================================================================
+static inline uint64_t IIndexKey(uint64_t field, uint32_t nodeType, uint64_t hash)
+{
+    // splitmix64's finalizer, so that similar values in different fields
+    // (or nodes of different types) don't land on the same key
+    uint64_t key = hash ^ ((field * 0x9E3779B97F4A7C15ULL) + nodeType);
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+static inline uint64_t IHashUuid(const plUUID& uuid)
+{
+    uint64_t lo, hi;
+    memcpy(&lo, uuid.fData, sizeof(lo));
+    memcpy(&hi, uuid.fData + sizeof(lo), sizeof(hi));
+    return lo ^ (hi * 0x9E3779B97F4A7C15ULL);
+}
+
+size_t NetVaultNode::GetIndexKeys(uint64_t* keys) const
+{
+    if (!(fUsedFields & kNodeType))
+        return 0;
+
+    size_t count = 0;
+    keys[count++] = IIndexKey(kNodeType, fNodeType, 0);
+
+#define KEY(field, hash) if (fUsedFields & k##field) keys[count++] = IIndexKey(k##field, fNodeType, hash);
+    KEY(CreatorId, fCreatorId);
+    KEY(Int32_1, uint32_t(fInt32_1));
+    KEY(UInt32_1, fUInt32_1);
+    KEY(Uuid_1, IHashUuid(fUuid_1));
+    KEY(String64_1, ST::hash()(fString64_1));
+    KEY(String64_2, ST::hash()(fString64_2));
+    KEY(IString64_1, ST::hash_i()(fIString64_1));
+#undef KEY
+
+    return count;
+}
+
 //============================================================================
 template<typename T>
 inline void IRead(const uint8_t*& buf, T& dest)
@@ -507,6 +550,7 @@ void NetVaultNode::Read(const uint8_t* buf, size_t size)
 #undef READ
 
     fDirtyFields = 0;
+    IFieldsChanged(kValidFields);
 }
 
 //============================================================================
@@ -604,4 +648,5 @@ void NetVaultNode::ISetVaultBlob(uint64_t bits, NetVaultNode::Blob& blob, const
 
     fUsedFields |= bits;
     fDirtyFields |= bits;
+    IFieldsChanged(bits);
 }
@@ -198,7 +198,11 @@ protected:
                         kInt32_4 | kUInt32_1 | kUInt32_2 | kUInt32_3 | kUInt32_3 | kUInt32_4 |
                         kUuid_1 | kUuid_2 | kUuid_3 | kUuid_4 | kString64_1 | kString64_2 |
                         kString64_3 | kString64_4 | kString64_5 | kString64_6 | kIString64_1 |
-                        kIString64_2 | kText_1 | kText_2 | kBlob_1 | kBlob_2)
+                        kIString64_2 | kText_1 | kText_2 | kBlob_1 | kBlob_2),
+
+        /** Fields commonly searched on, which GetIndexKeys() hashes */
+        kIndexedFields = (kNodeType | kCreatorId | kInt32_1 | kUInt32_1 | kUuid_1 |
+                          kString64_1 | kString64_2 | kIString64_1)
     };
 
 public:
@@ -268,6 +272,7 @@ private:
         field = value;
         fUsedFields |= bits;
         fDirtyFields |= bits;
+        IFieldsChanged(bits);
     }
 
     template<typename T>
@@ -275,6 +280,7 @@ private:
     {
         field = value;
         fUsedFields |= bits;
+        IFieldsChanged(bits);
     }
 
     void ISetVaultBlob(uint64_t bits, Blob& blob, const uint8_t* buf, size_t size);
@@ -310,12 +316,26 @@ public:
 
     bool Matches(const NetVaultNode* rhs) const;
 
+    /** Most keys GetIndexKeys() will return */
+    static constexpr size_t kMaxIndexKeys = 8;
+
+    /**
+     * Fills \a keys with hashes of the commonly searched fields this node
+     * uses, each mixed with the node type, and returns how many there are.
+     * A node that Matches() another has all of that node's keys, so they can
+     * be used to look nodes up by template. Nodes without a type have none.
+     */
+    size_t GetIndexKeys(uint64_t* keys) const;
+
     void Read(const uint8_t* buf, size_t size);
     void Write(std::vector<uint8_t>* buf, uint32_t ioFlags=0);
 
 protected:
     uint64_t GetFieldFlags() const { return fUsedFields; }
 
+    /** Called after any of \a fields may have changed value */
+    virtual void IFieldsChanged(uint64_t fields) { }
+
 public:
     bool IsDirty() const { return fDirtyFields != 0; }
     bool IsUsed() const { return fUsedFields != 0; }
@@ -0,0 +1,365 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plAGCompiledGraph.h"
+
+#include "plAGModifier.h"
+#include "plMatrixChannel.h"
+#include "plScalarChannel.h"
+
+#include "plProfile.h"
+#include "plInterp/hsInterp.h"
+#include "plInterp/plController.h"
+
+plProfile_Extern(AffineValue);
+plProfile_Extern(AffineBlend);
+plProfile_Extern(AffineCompose);
+plProfile_Extern(MatrixApplicator);
+
+void plAGCompiledGraph::Clear()
+{
+    fOps.clear();
+    fTargets.clear();
+    fParts.clear();
+    fBiases.clear();
+    fBlends.clear();
+    fL2P.clear();
+    fP2L.clear();
+    for (plControllerCacheInfo *cache : fOwnedCaches)
+        delete cache;
+    fOwnedCaches.clear();
+    fValid = false;
+    fThreadSafe = true;
+}
+
+void plAGCompiledGraph::AddMod(plAGModifier *mod)
+{
+    Target target;
+    target.fMod = mod;
+    target.fApp = nullptr;
+    target.fRoot = nullptr;
+    target.fFirstOp = target.fEndOp = (uint32_t)fOps.size();
+    target.fResult = 0;
+    target.fCurrent = true;
+    target.fActive = false;
+
+    // Subclasses of the matrix applicator do their own thing with the
+    // value, so only the plain one can be folded into the batch.
+    plAGApplicator *app = mod->GetApplicator(kAGPinTransform);
+    if (app && app->ClassIndex() == plMatrixChannelApplicator::Index())
+    {
+        plMatrixChannel *root = plMatrixChannel::ConvertNoRef(app->GetChannel());
+        if (root)
+        {
+            target.fApp = plMatrixChannelApplicator::ConvertNoRef(app);
+            target.fRoot = root;
+            target.fResult = ICompileChannel(root);
+            target.fEndOp = (uint32_t)fOps.size();
+        }
+    }
+
+    fTargets.push_back(target);
+    fL2P.resize(fTargets.size());
+    fP2L.resize(fTargets.size());
+}
+
+// Emits the ops for a channel and returns the slot its value ends up in.
+// A blend becomes
+//      bias
+//      <A>     (skipped if the bias is 1)
+//      skipB
+//      <B>     (skipped if the bias is 0)
+//      blend
+// which evaluates the same channels plMatrixBlend::AffineValue would.
+uint32_t plAGCompiledGraph::ICompileChannel(plMatrixChannel *channel)
+{
+    uint32_t dst = (uint32_t)fParts.size();
+    fParts.emplace_back();
+
+    Op op = {};
+    op.fDst = dst;
+
+    plMatrixTimeScale *scale = plMatrixTimeScale::ConvertNoRef(channel);
+    if (scale && ICompileController(scale, op))
+    {
+        fOps.push_back(op);
+        return dst;
+    }
+
+    plMatrixBlend *blend = plMatrixBlend::ConvertNoRef(channel);
+    if (!blend)
+    {
+        // Constants just hand back what they were built with; anything
+        // else might write to a node shared with another master.
+        if (!plMatrixConstant::ConvertNoRef(channel) && channel->ClassIndex() != plMatrixChannel::Index())
+            fThreadSafe = false;
+
+        op.fType = kValue;
+        op.fValueChannel = channel;
+        fOps.push_back(op);
+        return dst;
+    }
+
+    if (!plScalarConstant::ConvertNoRef(blend->fChannelBias))
+        fThreadSafe = false;
+
+    op.fBias = (uint32_t)fBiases.size();
+    fBiases.push_back(0.f);
+
+    size_t biasIdx = fOps.size();
+    op.fType = kBias;
+    op.fBiasChannel = blend->fChannelBias;
+    fOps.push_back(op);
+
+    op.fA = ICompileChannel(blend->fOptimizedA);
+
+    size_t skipIdx = fOps.size();
+    op.fType = kSkipB;
+    op.fBiasChannel = nullptr;
+    fOps.push_back(op);
+
+    fOps[biasIdx].fJump = (uint32_t)fOps.size();
+    op.fB = ICompileChannel(blend->fOptimizedB);
+
+    fOps[skipIdx].fJump = (uint32_t)fOps.size();
+    op.fType = kBlend;
+    fOps.push_back(op);
+
+    return dst;
+}
+
+// An animation instance's time scale sits on top of a controller channel,
+// possibly through a cache channel. The controller channel belongs to the
+// plAGAnim, so its scratch value is shared by every instance of the
+// animation; interpolate into our own slot instead. Unanimated parts of the
+// transform keep whatever the channel was loaded with.
+bool plAGCompiledGraph::ICompileController(plMatrixTimeScale *scale, Op &op)
+{
+    plMatrixControllerChannel *ctlChan = plMatrixControllerChannel::ConvertNoRef(scale->fChannelIn);
+    plControllerCacheInfo *cache = nullptr;
+    if (!ctlChan)
+    {
+        plMatrixControllerCacheChannel *cacheChan = plMatrixControllerCacheChannel::ConvertNoRef(scale->fChannelIn);
+        if (!cacheChan)
+            return false;
+        ctlChan = cacheChan->fControllerChannel;
+        cache = cacheChan->fCache;
+    }
+    if (!ctlChan || !ctlChan->fController)
+        return false;
+
+    // Without a cache, the controller remembers its last key itself, and
+    // that's shared too. Key lookups come out the same wherever they start,
+    // so we're free to give ourselves a cache.
+    plATCChannel *atcChan = plATCChannel::ConvertNoRef(scale->fTimeSource);
+    if (!cache && atcChan)
+    {
+        cache = ctlChan->fController->CreateCache();
+        if (cache)
+        {
+            cache->SetATC(atcChan->fConvert);
+            fOwnedCaches.push_back(cache);
+        }
+    }
+
+    if (!cache || !(atcChan || plScalarConstant::ConvertNoRef(scale->fTimeSource)))
+        fThreadSafe = false;
+
+    op.fType = kController;
+    op.fController = ctlChan->fController;
+    op.fCache = cache;
+    op.fTimeChannel = scale->fTimeSource;
+    fParts[op.fDst] = ctlChan->fAP;
+    return true;
+}
+
+// Detaching an animation or swapping out an applicator rebuilds the graph
+// out from under us. Those paths all flag the master for a recompile, but
+// make sure we never chase a stale pointer in the meantime.
+bool plAGCompiledGraph::IIsCurrent(const Target &target) const
+{
+    return target.fMod->GetApplicator(kAGPinTransform) == target.fApp &&
+           target.fApp->GetChannel() == target.fRoot;
+}
+
+void plAGCompiledGraph::IRunOps(const Target &target, double time)
+{
+    uint32_t i = target.fFirstOp;
+    while (i < target.fEndOp)
+    {
+        const Op &op = fOps[i];
+        switch (op.fType)
+        {
+        case kValue:
+            fParts[op.fDst] = op.fValueChannel->AffineValue(time);
+            break;
+
+        case kBias:
+            fBiases[op.fBias] = op.fBiasChannel->Value(time);
+            if (fBiases[op.fBias] == 1.f)
+            {
+                i = op.fJump;
+                continue;
+            }
+            break;
+
+        case kSkipB:
+            if (fBiases[op.fBias] == 0.f)
+            {
+                i = op.fJump;
+                continue;
+            }
+            break;
+
+        case kBlend:
+            fBlends.push_back({ op.fDst, op.fA, op.fB, fBiases[op.fBias] });
+            break;
+
+        case kController:
+            op.fController->Interp(op.fTimeChannel->Value(time), &fParts[op.fDst], op.fCache);
+            break;
+        }
+        i++;
+    }
+}
+
+bool plAGCompiledGraph::IRunTargets(double time)
+{
+    hsAssert(fValid, "Evaluating an uncompiled graph");
+
+    bool allCurrent = true;
+    fBlends.clear();
+
+    for (Target &target : fTargets)
+    {
+        target.fActive = false;
+        if (!target.fApp)
+            continue;
+
+        target.fCurrent = IIsCurrent(target);
+        if (!target.fCurrent)
+        {
+            allCurrent = false;
+            continue;
+        }
+
+        if (target.fMod->IsEnabled() && target.fApp->IsEnabled())
+        {
+            IRunOps(target, time);
+            target.fActive = true;
+        }
+    }
+
+    return allCurrent;
+}
+
+// Children always queue their blends before their parents do, so the
+// queue can be run straight through.
+void plAGCompiledGraph::IRunBlends()
+{
+    for (const Blend &blend : fBlends)
+        hsInterp::LinInterp(&fParts[blend.fA], &fParts[blend.fB], blend.fBias, &fParts[blend.fDst]);
+}
+
+void plAGCompiledGraph::ICompose()
+{
+    for (size_t i = 0; i < fTargets.size(); i++)
+    {
+        if (!fTargets[i].fActive)
+            continue;
+
+        const hsAffineParts &ap = fParts[fTargets[i].fResult];
+        ap.ComposeMatrix(&fL2P[i]);
+        ap.ComposeInverseMatrix(&fP2L[i]);
+    }
+}
+
+bool plAGCompiledGraph::Eval(double time)
+{
+    bool allCurrent = IRunTargets(time);
+    IRunBlends();
+    return allCurrent;
+}
+
+// Composing stays on the main thread with the rest, since hsAffineParts
+// times itself.
+void plAGCompiledGraph::Commit(double time)
+{
+    plProfile_BeginTiming(AffineCompose);
+    ICompose();
+    plProfile_EndTiming(AffineCompose);
+
+    for (size_t i = 0; i < fTargets.size(); i++)
+    {
+        const Target &target = fTargets[i];
+        if (target.fApp && target.fCurrent)
+        {
+            if (target.fActive)
+            {
+                plProfile_BeginTiming(MatrixApplicator);
+                target.fApp->SetLocalToParent(target.fMod, fL2P[i], fP2L[i]);
+                plProfile_EndTiming(MatrixApplicator);
+            }
+            target.fMod->Apply(time, target.fApp);
+        }
+        else
+        {
+            target.fMod->Apply(time);
+        }
+    }
+}
+
+bool plAGCompiledGraph::Apply(double time)
+{
+    // Pull the values out of the leaves. This is where the keyframe
+    // lookups happen, and the only part that still goes through the graph.
+    plProfile_BeginTiming(AffineValue);
+    bool allCurrent = IRunTargets(time);
+    plProfile_EndTiming(AffineValue);
+
+    plProfile_BeginTiming(AffineBlend);
+    IRunBlends();
+    plProfile_EndTiming(AffineBlend);
+
+    Commit(time);
+    return allCurrent;
+}
@@ -0,0 +1,191 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+/** \file plAGCompiledGraph.h
+    \brief Flattened evaluation of a master mod's transform graphs
+
+    \ingroup Avatar
+    \ingroup AniGraph
+*/
+#ifndef PLAGCOMPILEDGRAPH_INC
+#define PLAGCOMPILEDGRAPH_INC
+
+#include "HeadSpin.h"
+#include "hsMatrix44.h"
+#include "plTransform/hsAffineParts.h"
+
+#include <vector>
+
+class plAGModifier;
+class plController;
+class plControllerCacheInfo;
+class plMatrixChannel;
+class plMatrixChannelApplicator;
+class plMatrixTimeScale;
+class plScalarChannel;
+
+/** \class plAGCompiledGraph
+    The transform graphs of all the channel mods on a master mod, flattened
+    into a single linear program.
+    Walking the graph costs a couple of virtual calls per node per bone, and
+    the blends and matrix composition for one bone are interleaved with the
+    keyframe lookups for the next. The compiled program instead evaluates
+    every leaf channel and blend bias first, then runs all the blends, then
+    composes all the matrices, each as one pass over contiguous arrays.
+    Blend nodes still check their bias every frame and skip the side they
+    don't need, exactly as plMatrixBlend does.
+
+    The program holds raw pointers into the graph, so it must be rebuilt
+    whenever the graph changes. The master mod does this in Compile().
+
+    Animation time scales over a controller are run straight off the
+    controller into the program's own storage, rather than through the
+    controller channel's scratch value, which every avatar playing the
+    animation shares. If nothing else in the program touches shared state,
+    the program is thread safe: Eval() may run on any thread, as long as
+    Commit() follows on the main thread.
+    */
+class plAGCompiledGraph
+{
+public:
+    plAGCompiledGraph() : fValid(), fThreadSafe(true) { }
+    plAGCompiledGraph(const plAGCompiledGraph&) = delete;
+    plAGCompiledGraph& operator=(const plAGCompiledGraph&) = delete;
+    ~plAGCompiledGraph() { Clear(); }
+
+    /** Forget the current program. */
+    void Clear();
+
+    /** Add a channel mod to the program. If its transform is driven by a
+        plain plMatrixChannelApplicator, its graph is flattened; otherwise
+        (and for all its other applicators) it's applied the usual way.
+        Mods are applied in the order they were added. */
+    void AddMod(plAGModifier *mod);
+
+    /** Call once all the mods have been added. */
+    void Finish() { fValid = true; }
+
+    bool IsValid() const { return fValid; }
+
+    /** True if Eval() only touches state owned by this master's graph. */
+    bool IsThreadSafe() const { return fThreadSafe; }
+
+    /** Evaluate and apply every mod at the given time. Returns false if
+        the graph changed since it was compiled; the mods are still applied,
+        but the caller should recompile. */
+    bool Apply(double time);
+
+    /** The first half of Apply(): evaluate and blend the compiled
+        transforms without touching the scene. No profile timing is done
+        here, since the timers aren't thread safe. */
+    bool Eval(double time);
+
+    /** The second half of Apply(): compose the transforms evaluated by
+        Eval(), hand them to their applicators and apply everything else.
+        Main thread only. */
+    void Commit(double time);
+
+protected:
+    enum OpType : uint8_t
+    {
+        kValue,     // fParts[fDst] = fValueChannel->AffineValue()
+        kBias,      // fBiases[fBias] = fBiasChannel->Value(), jump to fJump if it's 1
+        kSkipB,     // jump to fJump if fBiases[fBias] is 0
+        kBlend,     // queue a blend of fParts[fA] and fParts[fB] into fParts[fDst]
+        kController,    // fController->Interp(fTimeChannel->Value(), &fParts[fDst], fCache)
+    };
+
+    struct Op
+    {
+        OpType          fType;
+        uint32_t        fDst;
+        uint32_t        fA;
+        uint32_t        fB;
+        uint32_t        fBias;
+        uint32_t        fJump;
+        plMatrixChannel *fValueChannel;
+        plScalarChannel *fBiasChannel;
+        plScalarChannel *fTimeChannel;
+        plController    *fController;
+        plControllerCacheInfo *fCache;
+    };
+
+    struct Blend
+    {
+        uint32_t        fDst;
+        uint32_t        fA;
+        uint32_t        fB;
+        float           fBias;
+    };
+
+    struct Target
+    {
+        plAGModifier                *fMod;
+        plMatrixChannelApplicator   *fApp;      // nullptr if nothing was compiled for this mod
+        plMatrixChannel             *fRoot;     // the applicator's channel when we compiled
+        uint32_t                    fFirstOp;
+        uint32_t                    fEndOp;
+        uint32_t                    fResult;    // slot in fParts holding the final transform
+        bool                        fCurrent;   // graph hasn't changed since we compiled
+        bool                        fActive;    // evaluated this time through
+    };
+
+    uint32_t ICompileChannel(plMatrixChannel *channel);
+    bool ICompileController(plMatrixTimeScale *scale, Op &op);
+    bool IIsCurrent(const Target &target) const;
+    void IRunOps(const Target &target, double time);
+    bool IRunTargets(double time);
+    void IRunBlends();
+    void ICompose();
+
+    std::vector<Op>             fOps;
+    std::vector<Target>         fTargets;
+    std::vector<hsAffineParts>  fParts;
+    std::vector<float>          fBiases;
+    std::vector<Blend>          fBlends;    // blends queued up this time through
+    std::vector<hsMatrix44>     fL2P;
+    std::vector<hsMatrix44>     fP2L;
+    std::vector<plControllerCacheInfo*> fOwnedCaches;
+    bool                        fValid;
+    bool                        fThreadSafe;
+};
+
+#endif // PLAGCOMPILEDGRAPH_INC
@@ -49,8 +49,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plMatrixChannel.h"
 
 // global
+#include "hsJobPool.h"
 #include "hsResMgr.h"
 #include "plgDispatch.h"
+#include "plProfile.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
 
 // other
 #include "plInterp/plAnimEaseTypes.h"
@@ -70,6 +76,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 // Coordinates the activities of a bunch of plAGModifiers
 // std::map<char *, plAGMasterMod *, stringISorter> plAGMasterMod::fInstances;
 
+bool plAGMasterMod::fCompiledEvalEnabled = true;
+bool plAGMasterMod::fParallelEvalEnabled = true;
+std::vector<plAGMasterMod*> plAGMasterMod::fEvalQueue;
+
 // CTOR
 plAGMasterMod::plAGMasterMod()
 : fTarget(),
@@ -77,6 +87,8 @@ plAGMasterMod::plAGMasterMod()
   fFirstEval(true),
   fAGMasterSDLMod(),
   fNeedCompile(false),
+  fQueuedTime(),
+  fQueued(false),
   fIsGrouped(false),
   fIsGroupMaster(false),
   fMsgForwarder()
@@ -86,6 +98,7 @@ plAGMasterMod::plAGMasterMod()
 // DTOR
 plAGMasterMod::~plAGMasterMod()
 {
+    IDequeue();
 }
 
 void plAGMasterMod::Write(hsStream *stream, hsResMgr *mgr)
@@ -193,6 +206,7 @@ void plAGMasterMod::RemoveTarget(plSceneObject* o)
 {
     hsAssert(o == fTarget, "Removing target I don't have");
 
+    IDequeue();
     DetachAllAnimations();
 
     // remove sdl modifier
@@ -207,9 +221,8 @@ void plAGMasterMod::RemoveTarget(plSceneObject* o)
     fTarget = nullptr;
 }
 
-#include "plProfile.h"
-
 plProfile_CreateTimer("ApplyAnimation", "Animation", ApplyAnimation);
+plProfile_CreateTimer("QueuedAnimations", "Animation", QueuedAnimations);
 plProfile_CreateTimer("  AffineValue", "Animation", AffineValue);
 plProfile_CreateTimer("    AffineInterp", "Animation", AffineInterp);
 plProfile_CreateTimer("    AffineBlend", "Animation", AffineBlend);
@@ -255,10 +268,129 @@ void plAGMasterMod::ApplyAnimations(double time, float elapsed)
     plProfile_EndLap(ApplyAnimation,this->GetKey()->GetUoid().GetObjectName().c_str());
 }
 
+void plAGMasterMod::QueueAnimations(double time, float elapsed)
+{
+    if (!fParallelEvalEnabled || !fCompiledEvalEnabled)
+    {
+        ApplyAnimations(time, elapsed);
+        return;
+    }
+
+    for (int i = 0; i < fAnimInstances.size(); i++)
+    {
+        fAnimInstances[i]->ProcessFade(elapsed);
+    }
+
+    // Compiling edits the graph, so it can't wait for the workers.
+    if (fNeedCompile)
+        Compile(time);
+
+    if (!fCompiledGraph.IsValid() || !fCompiledGraph.IsThreadSafe())
+    {
+        AdvanceAnimsToTime(time);
+        return;
+    }
+
+    if (!fQueued)
+    {
+        fEvalQueue.push_back(this);
+        fQueued = true;
+    }
+    fQueuedTime = time;
+}
+
+void plAGMasterMod::IDequeue()
+{
+    if (fQueued)
+    {
+        fEvalQueue.erase(std::find(fEvalQueue.begin(), fEvalQueue.end(), this));
+        fQueued = false;
+    }
+}
+
+// Nothing an animation sends may be delivered until we're done: a callback
+// is free to detach animations, which would pull the graphs we're
+// evaluating out from under us. So everything goes into deferred sends,
+// which are flushed at the very end, graph by graph in queue order.
+void plAGMasterMod::ApplyQueuedAnimations()
+{
+    if (fEvalQueue.empty())
+        return;
+
+    plProfile_BeginTiming(QueuedAnimations);
+
+    struct QueuedEval
+    {
+        plAGMasterMod *fMaster;
+        std::vector<std::function<void()>> fSends;
+        bool fCurrent;
+    };
+
+    std::vector<plAGMasterMod*> queue;
+    queue.swap(fEvalQueue);
+
+    std::vector<std::function<void()>> sends;
+    std::vector<QueuedEval> evals;
+    evals.reserve(queue.size());
+
+    plAnimTimeConvert::SetDeferredSends(&sends);
+    for (plAGMasterMod *master : queue)
+    {
+        master->fQueued = false;
+
+        // Someone may have edited the graph since it was queued
+        if (master->fNeedCompile)
+            master->Compile(master->fQueuedTime);
+
+        if (master->fCompiledGraph.IsValid() && master->fCompiledGraph.IsThreadSafe())
+            evals.push_back({ master, {}, true });
+        else
+            master->AdvanceAnimsToTime(master->fQueuedTime);
+    }
+    plAnimTimeConvert::SetDeferredSends(nullptr);
+
+    // Each graph is a job, so a few expensive avatars don't hold up the rest
+    hsJobPool::Instance().Run(evals.size(), [&evals](size_t i) {
+        plProfile_TraceScope("Anim Eval");
+        QueuedEval &eval = evals[i];
+        plAnimTimeConvert::SetDeferredSends(&eval.fSends);
+        eval.fCurrent = eval.fMaster->fCompiledGraph.Eval(eval.fMaster->fQueuedTime);
+        plAnimTimeConvert::SetDeferredSends(nullptr);
+    });
+
+    for (QueuedEval &eval : evals)
+        std::move(eval.fSends.begin(), eval.fSends.end(), std::back_inserter(sends));
+
+    plAnimTimeConvert::SetDeferredSends(&sends);
+    for (QueuedEval &eval : evals)
+    {
+        eval.fMaster->fCompiledGraph.Commit(eval.fMaster->fQueuedTime);
+        if (!eval.fCurrent)
+            eval.fMaster->fNeedCompile = true;
+    }
+    plAnimTimeConvert::SetDeferredSends(nullptr);
+
+    for (const std::function<void()> &send : sends)
+        send();
+
+    plProfile_EndTiming(QueuedAnimations);
+}
+
 void plAGMasterMod::AdvanceAnimsToTime(double time)
 {
+    IDequeue();
+
     if(fNeedCompile)
         Compile(time);
+
+    if (fCompiledEvalEnabled && fCompiledGraph.IsValid())
+    {
+        // If someone changed the graph without telling us, the compiled
+        // graph fell back to the slow path for it. Fix it up next time.
+        if (!fCompiledGraph.Apply(time))
+            fNeedCompile = true;
+        return;
+    }
     
     for(plChannelModMap::iterator j = fChannelMods.begin(); j != fChannelMods.end(); j++)
     {
@@ -276,6 +408,7 @@ void plAGMasterMod::Compile(double time)
 {
     plChannelModMap::iterator end = fChannelMods.end();
     fNeedCompile = false;
+    fCompiledGraph.Clear();
 
     for(plChannelModMap::iterator j = fChannelMods.begin(); j != end; j++)
     {
@@ -291,13 +424,16 @@ void plAGMasterMod::Compile(double time)
                     topChannel->Optimize(time);
             }
         }
+
+        // Has to come after Optimize, since it follows the optimized branches
+        fCompiledGraph.AddMod(mod);
     }
+    fCompiledGraph.Finish();
 }
 
 void plAGMasterMod::DumpAniGraph(const char *justThisChannel, bool optimized, double time)
 {
     plChannelModMap::iterator end = fChannelMods.end();
-    fNeedCompile = false;
 
     for(plChannelModMap::iterator j = fChannelMods.begin(); j != end; j++)
     {
@@ -741,6 +877,9 @@ bool plAGMasterMod::MsgReceive(plMessage* msg)
             else
                 fChannelMods.erase(agmod->GetChannelName());
 
+            // The compiled graph keeps pointers to our mods
+            fNeedCompile = true;
+
             return true;
         }
 
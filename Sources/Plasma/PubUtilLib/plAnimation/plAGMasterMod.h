@@ -49,8 +49,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define PLAGMASTERMOD_INC
 
 #include <map>
+#include <vector>
 #include "pnModifier/plModifier.h"
 #include "plAGDefs.h"
+#include "plAGCompiledGraph.h"
 
 
 class plAGModifier;
@@ -162,6 +164,17 @@ public:
         \param elapsed is the time since the previous frame */
     void ApplyAnimations(double timeNow, float elapsed);
 
+    /** Like ApplyAnimations, but if our compiled graph can be evaluated off
+        the main thread, only process the fades here and queue the rest up
+        for ApplyQueuedAnimations(). */
+    void QueueAnimations(double timeNow, float elapsed);
+
+    /** Evaluate all the queued graphs across the animation worker threads,
+        then apply the results. Messages the animations send while being
+        evaluated go out once everything has been applied.
+        Called once a frame, after the eval message has been handled. */
+    static void ApplyQueuedAnimations();
+
     /** Runs through our anims and applies them, without
         processing fades. This is used when we load in anim
         state from the server, and need to advance it to a
@@ -171,7 +184,9 @@ public:
     /** Change the connectivity in the graph so that inactive animations are bypassed.
         The original connectivity information is kept, so if the activity of different
         animations is changed (such as by changing blend biases or adding new animations,
-        the graph can be compiled again to the correct state. */
+        the graph can be compiled again to the correct state.
+        Also flattens the transform graphs into a plAGCompiledGraph, which is what
+        actually gets evaluated from then on if compiled evaluation is enabled. */
     void Compile(double time);
 
     /** We've done something that invalidates the cached connectivity in the graph.
@@ -190,6 +205,14 @@ public:
     void SetIsGrouped(bool grouped);
     void SetIsGroupMaster(bool master, plMsgForwarder* msgForwarder);
 
+    /** Evaluate the flattened graph instead of walking the channels. On by default. */
+    static void SetCompiledEvalEnabled(bool on) { fCompiledEvalEnabled = on; }
+    static bool GetCompiledEvalEnabled() { return fCompiledEvalEnabled; }
+
+    /** Let QueueAnimations() defer to the worker threads. On by default. */
+    static void SetParallelEvalEnabled(bool on) { fParallelEvalEnabled = on; }
+    static bool GetParallelEvalEnabled() { return fParallelEvalEnabled; }
+
     // PLASMA PROTOCOL
     size_t GetNumTargets() const override { return fTarget ? 1 : 0; }
     plSceneObject* GetTarget(size_t w) const override { /* hsAssert(w < GetNumTargets(), "Bad target"); */ return fTarget; }
@@ -245,6 +268,14 @@ protected:
     plAGMasterSDLModifier *fAGMasterSDLMod; 
 
     bool fNeedCompile;
+    plAGCompiledGraph fCompiledGraph;
+    static bool fCompiledEvalEnabled;
+
+    void IDequeue();
+    double fQueuedTime;
+    bool fQueued;
+    static std::vector<plAGMasterMod*> fEvalQueue;
+    static bool fParallelEvalEnabled;
 
     bool fIsGrouped;
     bool fIsGroupMaster;
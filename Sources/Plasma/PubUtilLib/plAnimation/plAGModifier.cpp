@@ -111,7 +111,7 @@ void plAGModifier::SetChannelName(const ST::string & name)
 // There are cases where we want to call this and won't know the delta,
 // we don't seem to ever need it for this function, so I'm taking it out.
 // If you run into a case where you think it's necessary, see me. -Bob
-void plAGModifier::Apply(double time) const
+void plAGModifier::Apply(double time, const plAGApplicator *skip) const
 {
     if (!fEnabled)
         return;
@@ -119,6 +119,8 @@ void plAGModifier::Apply(double time) const
     for (int i = 0; i < fApps.size(); i++)
     {
         plAGApplicator *app = fApps[i];
+        if (app == skip)
+            continue;
         
         app->Apply(this, time);
     }
@@ -116,13 +116,15 @@ public:
         with any other pin type, including itself. */
     plAGApplicator *GetApplicator(plAGPinType pin) const;
 
-    /** Apply the animation for our scene object. */
-    void Apply(double time) const;
+    /** Apply the animation for our scene object. If skip is given, that
+        applicator is left alone; the master mod has already handled it. */
+    void Apply(double time, const plAGApplicator *skip = nullptr) const;
 
     /** Get the channel tied to our ith applicator */
     plAGChannel * GetChannel(int i) { return fApps[i]->GetChannel(); }
 
     void Enable(bool val);
+    bool IsEnabled() const { return fEnabled; }
 
     // PERSISTENCE
     void Read(hsStream *stream, hsResMgr *mgr) override;
@@ -763,6 +763,13 @@ void plMatrixChannelApplicator::IApply(const plAGModifier *mod, double time)
     }
 }
 
+// SETLOCALTOPARENT
+void plMatrixChannelApplicator::SetLocalToParent(const plAGModifier *mod, const hsMatrix44 &l2p, const hsMatrix44 &p2l)
+{
+    plCoordinateInterface *CI = IGetCI(mod);
+    CI->SetLocalToParent(l2p, p2l);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 //
 // plMatrixDelayedCorrectionApplicator
@@ -128,6 +128,8 @@ public:
 // Use to instance animations while allowing each instance to run at different speeds.
 class plMatrixTimeScale : public plMatrixChannel
 {
+    friend class plAGCompiledGraph;
+
 protected:
     plScalarChannel *fTimeSource;
     plMatrixChannel *fChannelIn;
@@ -156,6 +158,8 @@ public:
 // blends two matrices into one with weighting
 class plMatrixBlend : public plMatrixChannel
 {
+    friend class plAGCompiledGraph;
+
 protected:
     plMatrixChannel * fChannelA;
     plMatrixChannel * fOptimizedA;
@@ -211,6 +215,8 @@ public:
 // converts a plController-style animation into a plMatrixChannel
 class plMatrixControllerChannel : public plMatrixChannel
 {
+    friend class plAGCompiledGraph;
+
 protected:
     plController    *fController;
 
@@ -246,6 +252,8 @@ public:
 // Same as plMatrixController, but with caching info
 class plMatrixControllerCacheChannel : public plMatrixChannel
 {
+    friend class plAGCompiledGraph;
+
 protected:
     plControllerCacheInfo *fCache;
     plMatrixControllerChannel *fControllerChannel;
@@ -316,6 +324,10 @@ public:
     CLASSNAME_REGISTER( plMatrixChannelApplicator );
     GETINTERFACE_ANY( plMatrixChannelApplicator, plAGApplicator );
 
+    /** Apply a transform that was already evaluated from our channel,
+        as plAGCompiledGraph does for a whole master mod at once. */
+    void SetLocalToParent(const plAGModifier *mod, const hsMatrix44 &l2p, const hsMatrix44 &p2l);
+
     bool CanCombine(plAGApplicator *app) override { return false; }
     plAGPinType GetPinType() override { return kAGPinTransform; }
 };
@@ -251,6 +251,8 @@ public:
 // Channel interface for a plAnimTimeConvert object
 class plATCChannel : public plScalarChannel
 {
+    friend class plAGCompiledGraph;
+
 protected:
     plAnimTimeConvert *fConvert;
 
@@ -43,6 +43,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "HeadSpin.h"
 #include "plFileSystem.h"
 #include "hsStream.h"
+#include "plProfile.h"
 
 #include "plSoundBuffer.h"
 
@@ -82,6 +83,8 @@ static plAudioFileReader *CreateReader( bool fullpath, const plFileName &filenam
 
 void plSoundPreloader::Run()
 {
+    plProfile_SetThreadName("Audio Preloader");
+
     std::vector<plSoundBuffer*> templist;
 
     while (fRunning)
@@ -106,6 +109,7 @@ void plSoundPreloader::Run()
 
                 if (buf->GetData())
                 {
+                    plProfile_TraceScope("Preload Sound");
                     reader = CreateReader(true, buf->GetFileName(), buf->GetAudioReaderType(), buf->GetReaderSelect());
                     
                     if( reader )
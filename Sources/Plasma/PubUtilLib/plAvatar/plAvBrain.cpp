@@ -77,7 +77,9 @@ plArmatureBrain::~plArmatureBrain()
 bool plArmatureBrain::Apply(double timeNow, float elapsed)
 {
     IProcessTasks(timeNow, elapsed);
-    fArmature->ApplyAnimations(timeNow, elapsed);
+
+    // The client applies all the avatars at once, once the eval is done.
+    fArmature->QueueAnimations(timeNow, elapsed);
     
     return true;
 }
@@ -586,7 +586,7 @@ void plClothingOutfit::IAddItem(plClothingItem *item)
         plClothingItemOptions *op = new plClothingItemOptions;
         fOptions.emplace(fOptions.begin() + iItem, op);
         IInstanceSharedMeshes(item);
-        fDirtyItems.SetBit(item->fTileset);
+        IDirtyItem(item);
         
         // A bit of hackage for bare feet sound effects.
         if (item->fType == plClothingMgr::kTypeLeftFoot)
@@ -624,7 +624,7 @@ void plClothingOutfit::IRemoveItem(plClothingItem *item)
         delete fOptions[index];
         fOptions.erase(fOptions.begin() + index);
         IRemoveSharedMeshes(item);
-        fDirtyItems.SetBit(item->fTileset);
+        IDirtyItem(item);
     }
 }
 
@@ -638,7 +638,7 @@ bool plClothingOutfit::ITintItem(plClothingItem *item, hsColorRGBA color, uint8_
             fOptions[index]->fTint1 = color;
         if (layer == plClothingElement::kLayerTint2)
             fOptions[index]->fTint2 = color;
-        fDirtyItems.SetBit(item->fTileset);
+        IDirtyItem(item);
 
         if (fItems[index]->fAccessory)
         {
@@ -651,7 +651,7 @@ bool plClothingOutfit::ITintItem(plClothingItem *item, hsColorRGBA color, uint8_
                     fOptions[accIndex]->fTint1 = color;
                 if (layer == plClothingElement::kLayerTint2)
                     fOptions[accIndex]->fTint2 = color;
-                fDirtyItems.SetBit(acc->fTileset);
+                IDirtyItem(acc);
             }
         }
         return true;
@@ -938,9 +938,29 @@ void plClothingOutfit::WriteToVault(const std::vector<plStateDataRecord*> & SDRs
 void plClothingOutfit::DirtyTileset(int tileset)
 {
     fDirtyItems.SetBit(tileset);
+    for (plClothingItem* item : fItems)
+    {
+        if (item->fTileset == tileset)
+            IDirtyItem(item);
+    }
     ForceUpdate(true);
 }
 
+void plClothingOutfit::IDirtyItem(plClothingItem *item)
+{
+    for (size_t i = 0; i < item->fElements.size(); i++)
+        IDirtyElement(item, i);
+}
+
+void plClothingOutfit::IDirtyElement(plClothingItem *item, size_t element)
+{
+    fDirtyItems.SetBit(item->fTileset);
+
+    plClothingElement *elem = item->fElements[element];
+    if (elem && std::find(fDirtyElements.cbegin(), fDirtyElements.cend(), elem) == fDirtyElements.cend())
+        fDirtyElements.emplace_back(elem);
+}
+
 void plClothingOutfit::IUpdate()
 {
     //GenerateTexture();
@@ -1305,7 +1325,7 @@ bool plClothingOutfit::MsgReceive(plMessage* msg)
             for (plClothingItem* item : fItems)
                 for (size_t j = 0; j < item->fElements.size(); j++)
                     if (item->fTextures[j][plClothingElement::kLayerSkin] != nullptr)
-                        fDirtyItems.SetBit(item->fTileset);
+                        IDirtyElement(item, j);
         }
 
         if (cMsg->GetCommand(plClothingMsg::kBlendSkin))
@@ -1323,7 +1343,7 @@ bool plClothingOutfit::MsgReceive(plMessage* msg)
                 for (plClothingItem* item : fItems)
                     for (size_t j = 0; j < item->fElements.size(); j++)
                         if (item->fTextures[j][cMsg->fLayer] != nullptr)
-                            fDirtyItems.SetBit(item->fTileset);
+                            IDirtyElement(item, j);
             }
         }
         if (cMsg->GetCommand(plClothingMsg::kSaveCustomizations))
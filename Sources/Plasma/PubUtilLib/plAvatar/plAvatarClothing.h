@@ -246,12 +246,17 @@ public:
 
 protected:
     hsBitVector fDirtyItems;
+    // Layout elements whose pixels need compositing again. The pipeline
+    // redraws just these on a texture it's already composited.
+    std::vector<plClothingElement*> fDirtyElements;
     bool fVaultSaveEnabled;
     bool fMorphsInitDone;
     plFileName fClothingFile;
 
     void IAddItem(plClothingItem *item);
     void IRemoveItem(plClothingItem *item);
+    void IDirtyItem(plClothingItem *item);
+    void IDirtyElement(plClothingItem *item, size_t element);
     bool ITintItem(plClothingItem *item, hsColorRGBA color, uint8_t layer);
     bool IMorphItem(plClothingItem *item, uint8_t layer, uint8_t delta, float weight);
     void IHandleMorphSDR(plStateDataRecord *sdr);
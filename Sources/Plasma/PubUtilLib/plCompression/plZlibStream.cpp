@@ -135,7 +135,7 @@ uint32_t plZlibStream::Write(uint32_t byteCount, const void* buffer)
             }
 
             amtWritten = zstream->total_out - amtWritten;
-            fOutput->Write(amtWritten, outBuf);
+            IWriteOutput(amtWritten, outBuf);
 
             // If zlib says we hit the end of the stream, ignore avail_in
             if (ret == Z_STREAM_END)
@@ -66,6 +66,9 @@ protected:
 
     int IValidateGzHeader(uint32_t byteCount, const void* buffer);
 
+    // Called with each block of decompressed data
+    virtual uint32_t IWriteOutput(uint32_t byteCount, const void* buffer) { return fOutput->Write(byteCount, buffer); }
+
 public:
     plZlibStream() : fOutput(), fZStream(), fHeader(kNeedMoreData), fDecompressedOk(), fMode() { }
     virtual ~plZlibStream();
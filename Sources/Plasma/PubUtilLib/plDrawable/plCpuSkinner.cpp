@@ -0,0 +1,184 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plCpuSkinner.h"
+
+#include "hsJobPool.h"
+#include "hsMatrix44.h"
+
+#include "plDrawableSpans.h"
+#include "plGBufferGroup.h"
+#include "plProfile.h"
+#include "plSpanTypes.h"
+
+#include <algorithm>
+#include <vector>
+
+uint32_t plCpuSkinner::fMinThreadedVerts = 1024;
+
+void plCpuSkinner::BlendVerts(const hsMatrix44* matrixPalette, uint32_t numMatrices,
+                              const uint8_t* src, uint8_t format, uint32_t srcStride,
+                              uint8_t* dest, uint32_t destStride, uint32_t count)
+{
+    if (!count)
+        return;
+
+    Layout layout;
+    layout.fNumWeights = (format & plGBufferGroup::kSkinWeightMask) >> 4;
+    uint32_t offset = sizeof(float) * (3 + layout.fNumWeights);
+    layout.fIndicesOffset = 0;
+    if (layout.fNumWeights && (format & plGBufferGroup::kSkinIndices))
+    {
+        layout.fIndicesOffset = offset;
+        offset += sizeof(uint32_t);
+    }
+    layout.fNormalOffset = offset;
+    layout.fTailSize = sizeof(uint32_t) * 2 + sizeof(float) * 3 * plGBufferGroup::CalcNumUVs(format);
+
+    // The vertex buffers get skinned one span at a time, so hang on to this
+    // rather than reallocating it for every span. It's big enough for any
+    // index a vertex can hold, so bad data can't send us off the end.
+    static thread_local std::vector<Matrix> palette(256);
+    hsAssert(numMatrices <= palette.size(), "Too many matrices for the skinning palette");
+    numMatrices = std::min<uint32_t>(numMatrices, (uint32_t)palette.size());
+    for (uint32_t i = 0; i < numMatrices; ++i)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            palette[i].fCol[col][0] = matrixPalette[i].fMap[0][col];
+            palette[i].fCol[col][1] = matrixPalette[i].fMap[1][col];
+            palette[i].fCol[col][2] = matrixPalette[i].fMap[2][col];
+            palette[i].fCol[col][3] = 0.f;
+        }
+    }
+
+    if (count < fMinThreadedVerts * 2)
+    {
+        blend_verts.call(palette.data(), layout, src, srcStride, dest, destStride, count);
+        return;
+    }
+
+    // A few chunks per thread, so one that gets held up doesn't hold up
+    // the whole span.
+    hsJobPool& pool = hsJobPool::Instance();
+    size_t numJobs = std::min<size_t>(count / fMinThreadedVerts, pool.GetNumThreads() * 4);
+    size_t chunk = (count + numJobs - 1) / numJobs;
+    const Matrix* pal = palette.data();
+    pool.Run(numJobs, [=, &layout](size_t i) {
+        plProfile_TraceScope("Skin Verts");
+        size_t first = i * chunk;
+        if (first >= count)
+            return;
+        size_t num = std::min(chunk, count - first);
+        blend_verts.call(pal, layout, src + first * srcStride, srcStride,
+                         dest + first * destStride, destStride, (uint32_t)num);
+    });
+}
+
+void plCpuSkinner::BlendSpan(plDrawableSpans* drawable, const plVertexSpan& span,
+                             uint8_t* destBuffer, uint32_t destStride)
+{
+    hsAssert(span.fLocalUVWChans == 0, "Software skinning doesn't support skinned UVWs");
+
+    hsMatrix44* matrixPalette = drawable->GetMatrixPalette(span.fBaseMatrix);
+    matrixPalette[0] = span.fLocalToWorld;
+
+    plGBufferGroup* group = drawable->GetBufferGroup(span.fGroupIdx);
+    const uint8_t* src = group->GetVertBufferData(span.fVBufferIdx) + span.fVStartIdx * group->GetVertexSize();
+
+    BlendVerts(matrixPalette, span.fNumMatrices,
+               src, group->GetVertexFormat(), group->GetVertexSize(),
+               destBuffer + span.fVStartIdx * destStride, destStride,
+               span.fVLength);
+}
+
+void plCpuSkinner::blend_verts_fpu(const Matrix* palette, const Layout& layout, const uint8_t* src, uint32_t srcStride,
+                                   uint8_t* dest, uint32_t destStride, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i, src += srcStride, dest += destStride)
+    {
+        float weights[4];
+        uint32_t indices = IGetWeights(src, layout, weights);
+
+        // Blend the matrices
+        float col[4][3] = {};
+        for (uint32_t j = 0; j <= layout.fNumWeights; ++j, indices >>= 8)
+        {
+            if (weights[j] == 0.f)
+                continue;
+
+            const Matrix& m = palette[indices & 0xFF];
+            for (int k = 0; k < 4; ++k)
+            {
+                col[k][0] += m.fCol[k][0] * weights[j];
+                col[k][1] += m.fCol[k][1] * weights[j];
+                col[k][2] += m.fCol[k][2] * weights[j];
+            }
+        }
+
+        // ...and apply them
+        float pos[3], norm[3];
+        memcpy(pos, src, sizeof(pos));
+        memcpy(norm, src + layout.fNormalOffset, sizeof(norm));
+
+        float out[6];
+        for (int r = 0; r < 3; ++r)
+        {
+            out[r]     = col[0][r] * pos[0] + col[1][r] * pos[1] + col[2][r] * pos[2] + col[3][r];
+            out[3 + r] = col[0][r] * norm[0] + col[1][r] * norm[1] + col[2][r] * norm[2];
+        }
+        memcpy(dest, out, sizeof(out));
+        memcpy(dest + sizeof(out), src + layout.fNormalOffset + sizeof(norm), layout.fTailSize);
+    }
+}
+
+// CPU-optimized functions requiring dispatch
+hsCpuFunctionDispatcher<plCpuSkinner::blend_verts_ptr> plCpuSkinner::blend_verts {
+    &plCpuSkinner::blend_verts_fpu,
+    nullptr,                                // SSE1
+    &plCpuSkinner::blend_verts_sse2,
+    nullptr,                                // SSE3
+    nullptr,                                // SSSE3
+    nullptr,                                // SSE41
+    nullptr,                                // SSE42
+    &plCpuSkinner::blend_verts_avx
+};
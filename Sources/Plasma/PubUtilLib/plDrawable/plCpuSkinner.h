@@ -0,0 +1,143 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef plCpuSkinner_inc
+#define plCpuSkinner_inc
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+
+#include <cstring>
+
+struct hsMatrix44;
+class plDrawableSpans;
+class plVertexSpan;
+
+//
+// Software vertex blending, for pipelines (or spans) that can't skin on the
+// card. Takes vertices in plGBufferGroup's interleaved format with skin
+// weights, and writes them out blended, in the same format minus the
+// weights and indices:
+//
+//      pos, [weights], [indices], normal, diffuse, specular, uvws
+//  ->  pos, normal, diffuse, specular, uvws
+//
+// Each vertex's weights are blended into a single matrix, which is then
+// applied to the position and normal once. Big spans are split up across
+// a few worker threads.
+//
+class plCpuSkinner
+{
+public:
+    // Blends count verts from src into dest. The matrix indices in the
+    // vertices index matrixPalette, which must hold numMatrices matrices.
+    static void BlendVerts(const hsMatrix44* matrixPalette, uint32_t numMatrices,
+                           const uint8_t* src, uint8_t format, uint32_t srcStride,
+                           uint8_t* dest, uint32_t destStride, uint32_t count);
+
+    // Blends all of a span's verts from its buffer group into a vertex
+    // buffer laid out like the group's, starting at destBuffer. Sets up the
+    // first palette matrix as the span's local to world, as the hardware
+    // path does.
+    static void BlendSpan(plDrawableSpans* drawable, const plVertexSpan& span,
+                          uint8_t* destBuffer, uint32_t destStride);
+
+    // Spans with fewer verts than this are done on the calling thread.
+    static void SetMinThreadedVerts(uint32_t n) { fMinThreadedVerts = n; }
+    static uint32_t GetMinThreadedVerts() { return fMinThreadedVerts; }
+
+    // The palette the kernels work from. Each matrix is stored by column,
+    // padded out to four floats, so that a blended column is just a sum of
+    // weighted columns.
+    struct alignas(16) Matrix
+    {
+        float fCol[4][4];
+    };
+
+    // Where things are in a source vertex. The position is always first,
+    // followed by the weights. In the destination, the normal always
+    // follows the position, and the rest follows the normal.
+    struct Layout
+    {
+        uint32_t    fNumWeights;
+        uint32_t    fIndicesOffset;     // 0 if there are no indices
+        uint32_t    fNormalOffset;
+        uint32_t    fTailSize;          // colors and uvws, copied straight across
+    };
+
+    // The individual implementations, for testing them against each other.
+    // Don't call the SIMD ones unless hsCpuId says the CPU has them.
+    static void blend_verts_fpu(const Matrix* palette, const Layout& layout, const uint8_t* src, uint32_t srcStride,
+                                uint8_t* dest, uint32_t destStride, uint32_t count);
+    static void blend_verts_sse2(const Matrix* palette, const Layout& layout, const uint8_t* src, uint32_t srcStride,
+                                 uint8_t* dest, uint32_t destStride, uint32_t count);
+    static void blend_verts_avx(const Matrix* palette, const Layout& layout, const uint8_t* src, uint32_t srcStride,
+                                uint8_t* dest, uint32_t destStride, uint32_t count);
+
+private:
+    // Reads a vertex's weights, including the implied last one, and returns
+    // its matrix indices, one per byte starting with the lowest.
+    static inline uint32_t IGetWeights(const uint8_t* vtx, const Layout& layout, float* weights)
+    {
+        float sum = 0.f;
+        for (uint32_t j = 0; j < layout.fNumWeights; ++j)
+        {
+            memcpy(&weights[j], vtx + sizeof(float) * (3 + j), sizeof(float));
+            sum += weights[j];
+        }
+        weights[layout.fNumWeights] = 1.f - sum;
+
+        uint32_t indices = 1 << 8;
+        if (layout.fIndicesOffset)
+            memcpy(&indices, vtx + layout.fIndicesOffset, sizeof(uint32_t));
+        return indices;
+    }
+
+    typedef void(*blend_verts_ptr)(const Matrix*, const Layout&, const uint8_t*, uint32_t,
+                                   uint8_t*, uint32_t, uint32_t);
+
+    static hsCpuFunctionDispatcher<blend_verts_ptr> blend_verts;
+
+    static uint32_t fMinThreadedVerts;
+};
+
+#endif // plCpuSkinner_inc
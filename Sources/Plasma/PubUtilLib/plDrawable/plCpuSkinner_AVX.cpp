@@ -0,0 +1,121 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plCpuSkinner.h"
+
+#ifdef HAVE_AVX
+#   include <immintrin.h>
+#endif
+
+// Two verts at a time, one per half of each register. Otherwise this is the
+// SSE2 version, and gives the same results.
+
+#ifdef HAVE_AVX
+static inline __m256 IPair(__m128 lo, __m128 hi)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+#endif
+
+void plCpuSkinner::blend_verts_avx(const Matrix* palette, const Layout& layout, const uint8_t* src, uint32_t srcStride,
+                                   uint8_t* dest, uint32_t destStride, uint32_t count)
+{
+#ifdef HAVE_AVX
+    for (; count >= 2; count -= 2, src += srcStride * 2, dest += destStride * 2)
+    {
+        const uint8_t* srcB = src + srcStride;
+        uint8_t* destB = dest + destStride;
+
+        float weightsA[4], weightsB[4];
+        uint32_t indicesA = IGetWeights(src, layout, weightsA);
+        uint32_t indicesB = IGetWeights(srcB, layout, weightsB);
+
+        __m256 c0 = _mm256_setzero_ps();
+        __m256 c1 = _mm256_setzero_ps();
+        __m256 c2 = _mm256_setzero_ps();
+        __m256 c3 = _mm256_setzero_ps();
+        for (uint32_t j = 0; j <= layout.fNumWeights; ++j, indicesA >>= 8, indicesB >>= 8)
+        {
+            if (weightsA[j] == 0.f && weightsB[j] == 0.f)
+                continue;
+
+            // A zero weight still has to be multiplied by something, and its
+            // index might be junk.
+            const Matrix& mA = palette[weightsA[j] != 0.f ? (indicesA & 0xFF) : 0];
+            const Matrix& mB = palette[weightsB[j] != 0.f ? (indicesB & 0xFF) : 0];
+            __m256 w = IPair(_mm_set1_ps(weightsA[j]), _mm_set1_ps(weightsB[j]));
+            c0 = _mm256_add_ps(c0, _mm256_mul_ps(IPair(_mm_load_ps(mA.fCol[0]), _mm_load_ps(mB.fCol[0])), w));
+            c1 = _mm256_add_ps(c1, _mm256_mul_ps(IPair(_mm_load_ps(mA.fCol[1]), _mm_load_ps(mB.fCol[1])), w));
+            c2 = _mm256_add_ps(c2, _mm256_mul_ps(IPair(_mm_load_ps(mA.fCol[2]), _mm_load_ps(mB.fCol[2])), w));
+            c3 = _mm256_add_ps(c3, _mm256_mul_ps(IPair(_mm_load_ps(mA.fCol[3]), _mm_load_ps(mB.fCol[3])), w));
+        }
+
+        const float* posA = reinterpret_cast<const float*>(src);
+        const float* posB = reinterpret_cast<const float*>(srcB);
+        const float* normA = reinterpret_cast<const float*>(src + layout.fNormalOffset);
+        const float* normB = reinterpret_cast<const float*>(srcB + layout.fNormalOffset);
+
+        __m256 p = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                        _mm256_mul_ps(c0, IPair(_mm_load1_ps(posA), _mm_load1_ps(posB))),
+                        _mm256_mul_ps(c1, IPair(_mm_load1_ps(posA + 1), _mm_load1_ps(posB + 1)))),
+                        _mm256_mul_ps(c2, IPair(_mm_load1_ps(posA + 2), _mm_load1_ps(posB + 2)))),
+                        c3);
+        __m256 n = _mm256_add_ps(_mm256_add_ps(
+                        _mm256_mul_ps(c0, IPair(_mm_load1_ps(normA), _mm_load1_ps(normB))),
+                        _mm256_mul_ps(c1, IPair(_mm_load1_ps(normA + 1), _mm_load1_ps(normB + 1)))),
+                        _mm256_mul_ps(c2, IPair(_mm_load1_ps(normA + 2), _mm_load1_ps(normB + 2))));
+
+        // Each store spills a float into the next field, which gets
+        // written properly right after.
+        _mm_storeu_ps(reinterpret_cast<float*>(dest), _mm256_castps256_ps128(p));
+        _mm_storeu_ps(reinterpret_cast<float*>(dest + sizeof(float) * 3), _mm256_castps256_ps128(n));
+        memcpy(dest + sizeof(float) * 6, src + layout.fNormalOffset + sizeof(float) * 3, layout.fTailSize);
+
+        _mm_storeu_ps(reinterpret_cast<float*>(destB), _mm256_extractf128_ps(p, 1));
+        _mm_storeu_ps(reinterpret_cast<float*>(destB + sizeof(float) * 3), _mm256_extractf128_ps(n, 1));
+        memcpy(destB + sizeof(float) * 6, srcB + layout.fNormalOffset + sizeof(float) * 3, layout.fTailSize);
+    }
+#endif
+
+    // Leftovers
+    blend_verts_fpu(palette, layout, src, srcStride, dest, destStride, count);
+}
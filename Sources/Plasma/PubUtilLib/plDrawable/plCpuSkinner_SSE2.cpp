@@ -0,0 +1,100 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plCpuSkinner.h"
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+#endif
+
+// Same math as the FPU version, in the same order, so the results match it
+// exactly. A blended column only uses three lanes; the fourth just comes
+// along for the ride.
+
+void plCpuSkinner::blend_verts_sse2(const Matrix* palette, const Layout& layout, const uint8_t* src, uint32_t srcStride,
+                                    uint8_t* dest, uint32_t destStride, uint32_t count)
+{
+#ifdef HAVE_SSE2
+    for (; count; --count, src += srcStride, dest += destStride)
+    {
+        float weights[4];
+        uint32_t indices = IGetWeights(src, layout, weights);
+
+        __m128 c0 = _mm_setzero_ps();
+        __m128 c1 = _mm_setzero_ps();
+        __m128 c2 = _mm_setzero_ps();
+        __m128 c3 = _mm_setzero_ps();
+        for (uint32_t j = 0; j <= layout.fNumWeights; ++j, indices >>= 8)
+        {
+            if (weights[j] == 0.f)
+                continue;
+
+            const Matrix& m = palette[indices & 0xFF];
+            __m128 w = _mm_set1_ps(weights[j]);
+            c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_load_ps(m.fCol[0]), w));
+            c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_load_ps(m.fCol[1]), w));
+            c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_load_ps(m.fCol[2]), w));
+            c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_load_ps(m.fCol[3]), w));
+        }
+
+        const float* pos = reinterpret_cast<const float*>(src);
+        const float* norm = reinterpret_cast<const float*>(src + layout.fNormalOffset);
+
+        __m128 p = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_load1_ps(pos)),
+                                                    _mm_mul_ps(c1, _mm_load1_ps(pos + 1))),
+                                         _mm_mul_ps(c2, _mm_load1_ps(pos + 2))),
+                              c3);
+        __m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_load1_ps(norm)),
+                                         _mm_mul_ps(c1, _mm_load1_ps(norm + 1))),
+                              _mm_mul_ps(c2, _mm_load1_ps(norm + 2)));
+
+        // Each store spills a float into the next field, which gets
+        // written properly right after.
+        _mm_storeu_ps(reinterpret_cast<float*>(dest), p);
+        _mm_storeu_ps(reinterpret_cast<float*>(dest + sizeof(float) * 3), n);
+        memcpy(dest + sizeof(float) * 6, src + layout.fNormalOffset + sizeof(float) * 3, layout.fTailSize);
+    }
+#endif
+
+    // Leftovers
+    blend_verts_fpu(palette, layout, src, srcStride, dest, destStride, count);
+}
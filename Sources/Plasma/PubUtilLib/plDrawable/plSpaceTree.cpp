@@ -52,6 +52,12 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 static hsBitVector scratchTotVec;
 static hsBitVector scratchBitVec;
 
+static std::vector<plVolumeSlab> scratchSlabs;
+static std::vector<int16_t> scratchLevel;
+static std::vector<int16_t> scratchNextLevel;
+static std::vector<int16_t> scratchBatch;
+static std::vector<uint8_t> scratchResults;
+
 plProfile_CreateCounter("Harvest Leaves", "Draw", HarvestLeaves);
 
 void plSpaceTreeNode::Read(hsStream* s)
@@ -82,7 +88,8 @@ void plSpaceTreeNode::Write(hsStream* s)
 plSpaceTree::plSpaceTree()
 :   fCullFunc(),
     fNumLeaves(),
-    fCache()
+    fCache(),
+    fPreCulled()
 {
 }
 
@@ -110,11 +117,187 @@ void plSpaceTree::IRefreshRecur(int16_t which)
             sub.fWorldBounds.Union(&fTree[sub.fChildren[0]].fWorldBounds);
         if( !(fTree[sub.fChildren[1]].fFlags & plSpaceTreeNode::kDisabled) )
             sub.fWorldBounds.Union(&fTree[sub.fChildren[1]].fWorldBounds);
+        IUpdateFlat(which);
 
         sub.fFlags &= ~plSpaceTreeNode::kDirty;
     }
 }
 
+void plSpaceTree::IFlatten() const
+{
+    fNodeToFlat.assign(fTree.size(), -1);
+    fFlatToNode.clear();
+    fFlatToNode.reserve(fTree.size());
+    fFlatChild.clear();
+    fFlatChild.reserve(fTree.size());
+
+    // The flat array is its own queue
+    fFlatToNode.emplace_back(fRoot);
+    for (size_t i = 0; i < fFlatToNode.size(); i++)
+    {
+        const plSpaceTreeNode& node = fTree[fFlatToNode[i]];
+        fNodeToFlat[fFlatToNode[i]] = int16_t(i);
+        if (node.fFlags & plSpaceTreeNode::kIsLeaf)
+        {
+            fFlatChild.emplace_back(-1);
+        }
+        else
+        {
+            fFlatChild.emplace_back(int16_t(fFlatToNode.size()));
+            fFlatToNode.emplace_back(node.fChildren[0]);
+            fFlatToNode.emplace_back(node.fChildren[1]);
+        }
+    }
+
+    fFlatBounds.resize(10 * fFlatToNode.size());
+    fFlatFlags.resize(fFlatToNode.size());
+    for (int16_t idx : fFlatToNode)
+        IUpdateFlat(idx);
+}
+
+void plSpaceTree::IUpdateFlat(int16_t which) const
+{
+    if (fFlatFlags.empty() || fNodeToFlat[which] < 0)
+        return;
+
+    const int16_t flat = fNodeToFlat[which];
+    const plSpaceTreeNode& node = fTree[which];
+    fFlatFlags[flat] = node.fFlags & (plSpaceTreeNode::kIsLeaf | plSpaceTreeNode::kDisabled);
+
+    // Anything other than normal, axis aligned bounds gets the real Test().
+    const hsBounds3Ext& bnd = node.fWorldBounds;
+    if (bnd.GetType() != kBoundsNormal || !bnd.IsAxisAligned())
+    {
+        fFlatFlags[flat] |= kFlatNeedsTest;
+        return;
+    }
+
+    const size_t stride = fFlatFlags.size();
+    const hsPoint3& center = bnd.GetCenter();
+    for (int i = 0; i < 3; i++)
+    {
+        fFlatBounds[i * stride + flat] = bnd.GetMins()[i];
+        fFlatBounds[(i + 3) * stride + flat] = bnd.GetMaxs()[i];
+        fFlatBounds[(i + 6) * stride + flat] = center[i];
+    }
+    fFlatBounds[9 * stride + flat] = bnd.GetRadius();
+}
+
+// Walks the flattened tree down from subRoot a level at a time, so that each
+// level's nodes can be tested together, instead of one by one on the way
+// down. test() fills in scratchResults for a whole level, then each node and
+// its result go to visit(), which says whether to go on to its children.
+// Only children that are eligible() make it into the next level.
+template <typename T, typename U, typename V>
+void plSpaceTree::ILevelPass(int16_t subRoot, T eligible, U test, V visit) const
+{
+    if (fFlatFlags.empty())
+        IFlatten();
+    if (scratchResults.size() < fFlatFlags.size())
+        scratchResults.resize(fFlatFlags.size());
+
+    scratchLevel.clear();
+    const int16_t flatRoot = fNodeToFlat[subRoot];
+    if (eligible(flatRoot))
+        scratchLevel.emplace_back(flatRoot);
+
+    while (!scratchLevel.empty())
+    {
+        test(scratchLevel);
+
+        scratchNextLevel.clear();
+        for (int16_t flat : scratchLevel)
+        {
+            if (!visit(flat, scratchResults[flat]) || (fFlatFlags[flat] & plSpaceTreeNode::kIsLeaf))
+                continue;
+
+            const int16_t child = fFlatChild[flat];
+            if (eligible(child))
+                scratchNextLevel.emplace_back(child);
+            if (eligible(int16_t(child + 1)))
+                scratchNextLevel.emplace_back(int16_t(child + 1));
+        }
+        scratchLevel.swap(scratchNextLevel);
+    }
+}
+
+// The level pass for the harvests with a cull volume. Which nodes get tested
+// is the same as in the recursive harvests: the root, then the children of
+// anything split, if eligible(). Each tested node and its result are passed
+// to visit(), and the results are left in scratchResults. Only volumes made
+// of slabs can be done this way, returns false for anything else.
+template <typename T, typename V>
+bool plSpaceTree::ICullLevels(T eligible, V visit) const
+{
+    if (!fCullFunc->GetSlabs(scratchSlabs))
+        return false;
+
+    ILevelPass(fRoot, eligible,
+        [this](const std::vector<int16_t>& level) {
+            scratchBatch.clear();
+            for (int16_t flat : level)
+            {
+                if (fFlatFlags[flat] & kFlatNeedsTest)
+                    scratchResults[flat] = fCullFunc->Test(fTree[fFlatToNode[flat]].fWorldBounds);
+                else
+                    scratchBatch.emplace_back(flat);
+            }
+            cull_bounds.call(fFlatBounds.data(), fFlatFlags.size(), scratchBatch.data(), scratchBatch.size(),
+                             scratchSlabs.data(), scratchSlabs.size(), scratchResults.data());
+        },
+        [&visit](int16_t flat, uint8_t res) {
+            visit(flat, plVolumeCullResult(res));
+            return res == kVolumeSplit;
+        }
+    );
+
+    return true;
+}
+
+void plSpaceTree::CullPlaneLevels(int16_t subRoot, const hsVector3& norm, float dist, float safetyDist) const
+{
+    if (IsEmpty())
+        return;
+
+    ILevelPass(subRoot,
+        [this](int16_t flat) {
+            const int16_t idx = fFlatToNode[flat];
+            return !IsDisabled(idx) && fTree[idx].fWorldBounds.GetType() == kBoundsNormal;
+        },
+        [this, &norm, dist, safetyDist](const std::vector<int16_t>& level) {
+            scratchBatch.clear();
+            for (int16_t flat : level)
+            {
+                if (fFlatFlags[flat] & kFlatNeedsTest)
+                    scratchResults[flat] = kFlatUntested;
+                else
+                    scratchBatch.emplace_back(flat);
+            }
+            cull_plane.call(fFlatBounds.data(), fFlatFlags.size(), scratchBatch.data(), scratchBatch.size(),
+                            norm, dist, safetyDist, scratchResults.data());
+        },
+        // Whoever tests the untested ones themselves may still find them split
+        [](int16_t, uint8_t res) { return res == kVolumeSplit || res == kFlatUntested; }
+    );
+}
+
+bool plSpaceTree::GetPlaneResult(int16_t idx, plVolumeCullResult& res) const
+{
+    const uint8_t flatRes = scratchResults[fNodeToFlat[idx]];
+    if (flatRes == kFlatUntested)
+        return false;
+
+    res = plVolumeCullResult(flatRes);
+    return true;
+}
+
+inline plVolumeCullResult plSpaceTree::ITestNode(const plSpaceTreeNode& node) const
+{
+    if (fPreCulled)
+        return plVolumeCullResult(scratchResults[fNodeToFlat[&node - fTree.data()]]);
+    return fCullFunc->Test(node.fWorldBounds);
+}
+
 void plSpaceTree::Refresh()
 {
     if( !IsEmpty() )
@@ -134,6 +317,7 @@ void plSpaceTree::SetTreeFlag(uint16_t f, bool on)
 
     for (plSpaceTreeNode& node : fTree)
         node.fFlags |= f;
+    fFlatFlags.clear();
 }
 
 void plSpaceTree::ClearTreeFlag(uint16_t f)
@@ -143,6 +327,7 @@ void plSpaceTree::ClearTreeFlag(uint16_t f)
 
     for (plSpaceTreeNode& node : fTree)
         node.fFlags &= ~f;
+    fFlatFlags.clear();
 }
 
 void plSpaceTree::SetLeafFlag(int16_t idx, uint16_t f, bool on)
@@ -159,6 +344,7 @@ void plSpaceTree::SetLeafFlag(int16_t idx, uint16_t f, bool on)
     }
 
     fTree[idx].fFlags |= f;
+    IUpdateFlat(idx);
 
     idx = fTree[idx].fParent;
 
@@ -172,6 +358,7 @@ void plSpaceTree::SetLeafFlag(int16_t idx, uint16_t f, bool on)
         else
         {
             fTree[idx].fFlags |= f;
+            IUpdateFlat(idx);
             idx = fTree[idx].fParent;
         }
     }
@@ -190,6 +377,7 @@ void plSpaceTree::ClearLeafFlag(int16_t idx, uint16_t f)
         else
         {
             fTree[idx].fFlags &= ~f;
+            IUpdateFlat(idx);
             idx = fTree[idx].fParent;
         }
     }
@@ -239,7 +427,7 @@ void plSpaceTree::IHarvestAndCullEnabledLeaves(int16_t subIdx, const hsBitVector
 
     const plSpaceTreeNode& subRoot = fTree[subIdx];
 
-    plVolumeCullResult res = fCullFunc->Test(subRoot.fWorldBounds);
+    plVolumeCullResult res = ITestNode(subRoot);
     if( res == kVolumeCulled )
         return;
 
@@ -288,7 +476,16 @@ void plSpaceTree::HarvestEnabledLeaves(plVolumeIsect* cull, const hsBitVector& c
 
     fCullFunc = cull;
     if (fCullFunc)
+    {
+        // The list has to come out in the recursive harvest's order, so the
+        // levels just work out the results for it to use.
+        fPreCulled = ICullLevels(
+            [this, &cache](int16_t flat) { return cache.IsBitSet(fFlatToNode[flat]); },
+            [](int16_t, plVolumeCullResult) {}
+        );
         IHarvestAndCullEnabledLeaves(fRoot, cache, list);
+        fPreCulled = false;
+    }
     else
         IHarvestEnabledLeaves(fRoot, cache, list);
 }
@@ -321,6 +518,7 @@ void plSpaceTree::MoveLeaf(int16_t idx, const hsBounds3Ext& bnd)
     hsAssert(idx == fTree[idx].fLeafIndex, "Some scrambling of indices");
 
     fTree[idx].fWorldBounds = bnd;
+    IUpdateFlat(idx);
 
     while( idx != kRootParent )
     {
@@ -370,7 +568,38 @@ void plSpaceTree::HarvestLeaves(plVolumeIsect* cull, hsBitVector& list) const
     {
         fCullFunc = cull;
         if (fCullFunc)
-            IHarvestAndCullLeaves(fTree[fRoot], scratchTotVec, list);
+        {
+            // Same as IHarvestAndCullLeaves, just breadth first.
+            bool culled = ICullLevels(
+                [this](int16_t flat) {
+                    return !(fFlatFlags[flat] & plSpaceTreeNode::kDisabled)
+                        && !scratchTotVec.IsBitSet(fFlatToNode[flat]);
+                },
+                [this, &list](int16_t flat, plVolumeCullResult res) {
+                    if (res == kVolumeCulled)
+                        return;
+
+                    const int16_t idx = fFlatToNode[flat];
+                    const plSpaceTreeNode& subRoot = fTree[idx];
+                    if (subRoot.fFlags & plSpaceTreeNode::kIsLeaf)
+                    {
+                        scratchTotVec.SetBit(idx);
+
+                        plProfile_Inc(HarvestLeaves);
+                        list.SetBit(subRoot.fLeafIndex);
+                    }
+                    else if (res == kVolumeClear)
+                    {
+                        scratchTotVec.SetBit(idx);
+
+                        IHarvestLeaves(fTree[subRoot.fChildren[0]], scratchTotVec, list);
+                        IHarvestLeaves(fTree[subRoot.fChildren[1]], scratchTotVec, list);
+                    }
+                }
+            );
+            if (!culled)
+                IHarvestAndCullLeaves(fTree[fRoot], scratchTotVec, list);
+        }
         else
             IHarvestLeaves(fTree[fRoot], scratchTotVec, list);
     }
@@ -455,36 +684,6 @@ void plSpaceTree::IHarvestAndCullLeaves(const plSpaceTreeNode& subRoot, hsBitVec
     }
 }
 
-void plSpaceTree::IHarvestAndCullLeaves(const plSpaceTreeNode& subRoot, std::vector<int16_t>& list) const
-{
-    if( subRoot.fFlags & plSpaceTreeNode::kDisabled )
-        return;
-
-    hsAssert(fCullFunc, "Oops");
-    plVolumeCullResult res = fCullFunc->Test(subRoot.fWorldBounds);
-    if( res == kVolumeCulled )
-        return;
-
-    if( subRoot.fFlags & plSpaceTreeNode::kIsLeaf )
-    {
-        plProfile_Inc(HarvestLeaves);
-        list.emplace_back(subRoot.fLeafIndex);
-    }
-    else
-    {
-        if( res == kVolumeClear )
-        {
-            IHarvestLeaves(fTree[subRoot.fChildren[0]], list);
-            IHarvestLeaves(fTree[subRoot.fChildren[1]], list);
-        }
-        else
-        {
-            IHarvestAndCullLeaves(fTree[subRoot.fChildren[0]], list);
-            IHarvestAndCullLeaves(fTree[subRoot.fChildren[1]], list);
-        }
-    }
-}
-
 void plSpaceTree::IHarvestLeaves(const plSpaceTreeNode& subRoot, hsBitVector& totList, hsBitVector& list) const
 {
     if( subRoot.fFlags & plSpaceTreeNode::kDisabled )
@@ -508,22 +707,6 @@ void plSpaceTree::IHarvestLeaves(const plSpaceTreeNode& subRoot, hsBitVector& to
     }
 }
 
-void plSpaceTree::IHarvestLeaves(const plSpaceTreeNode& subRoot, std::vector<int16_t>& list) const
-{
-    if( subRoot.fFlags & plSpaceTreeNode::kDisabled )
-        return;
-    if( subRoot.fFlags & plSpaceTreeNode::kIsLeaf )
-    {
-        plProfile_Inc(HarvestLeaves);
-        list.emplace_back(subRoot.fLeafIndex);
-    }
-    else
-    {
-        IHarvestLeaves(fTree[subRoot.fChildren[0]], list);
-        IHarvestLeaves(fTree[subRoot.fChildren[1]], list);
-    }
-}
-
 void plSpaceTree::Read(hsStream* s, hsResMgr* mgr)
 {
     plCreatable::Read(s, mgr);
@@ -533,6 +716,7 @@ void plSpaceTree::Read(hsStream* s, hsResMgr* mgr)
     fNumLeaves = s->ReadLE32();
 
     uint32_t n = s->ReadLE32();
+    fFlatFlags.clear();
     fTree.resize(n);
     for (uint32_t i = 0; i < n; i++)
         fTree[i].Read(s);
@@ -577,3 +761,128 @@ void plSpaceTree::IHarvestLevel(int16_t subRoot, int level, int currLevel, std::
     IHarvestLevel(GetNode(subRoot).GetChild(1), level, currLevel+1, list);
 }
 
+// Same sums as hsBounds3::TestPlane, in the same order, and the same
+// comparisons as the slab volumes' Test().
+void plSpaceTree::cull_bounds_fpu(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                                  const plVolumeSlab* slabs, size_t numSlabs, uint8_t* results)
+{
+    for (size_t k = 0; k < count; k++)
+    {
+        const int16_t idx = nodes[k];
+        float mins[3], maxs[3];
+        for (int i = 0; i < 3; i++)
+        {
+            mins[i] = bounds[i * stride + idx];
+            maxs[i] = bounds[(i + 3) * stride + idx];
+        }
+
+        uint8_t res = kVolumeClear;
+        for (size_t j = 0; j < numSlabs; j++)
+        {
+            const plVolumeSlab& slab = slabs[j];
+            const float norm[3] = { slab.fNorm.fX, slab.fNorm.fY, slab.fNorm.fZ };
+
+            float dmax = mins[0] * norm[0];
+            dmax += mins[1] * norm[1];
+            dmax += mins[2] * norm[2];
+            float dmin = dmax;
+            for (int i = 0; i < 3; i++)
+            {
+                float dd = maxs[i] - mins[i];
+                dd *= norm[i];
+                if (dd < 0)
+                    dmin += dd;
+                else
+                    dmax += dd;
+            }
+
+            if (dmin > slab.fMax || dmax < slab.fMin)
+            {
+                res = kVolumeCulled;
+                break;
+            }
+            if (dmax > slab.fMax || dmin < slab.fMin)
+                res = kVolumeSplit;
+        }
+        results[idx] = res;
+    }
+}
+
+// Same sums as hsScalarTriple::InnerProduct and hsBounds3::TestPlane, in the
+// same order, and the same comparisons as plCullNode::TestBounds().
+void plSpaceTree::cull_plane_fpu(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                                 const hsVector3& norm, float dist, float safetyDist, uint8_t* results)
+{
+    const float n[3] = { norm.fX, norm.fY, norm.fZ };
+    for (size_t k = 0; k < count; k++)
+    {
+        const int16_t idx = nodes[k];
+
+        float d = n[0] * bounds[6 * stride + idx];
+        d += n[1] * bounds[7 * stride + idx];
+        d += n[2] * bounds[8 * stride + idx];
+        d += dist;
+        const float rad = bounds[9 * stride + idx];
+        if (d < -rad)
+        {
+            results[idx] = kVolumeCulled;
+            continue;
+        }
+        if (d > rad)
+        {
+            results[idx] = kVolumeClear;
+            continue;
+        }
+
+        float mins[3], maxs[3];
+        for (int i = 0; i < 3; i++)
+        {
+            mins[i] = bounds[i * stride + idx];
+            maxs[i] = bounds[(i + 3) * stride + idx];
+        }
+
+        float dmax = mins[0] * n[0];
+        dmax += mins[1] * n[1];
+        dmax += mins[2] * n[2];
+        float dmin = dmax;
+        for (int i = 0; i < 3; i++)
+        {
+            float dd = maxs[i] - mins[i];
+            dd *= n[i];
+            if (dd < 0)
+                dmin += dd;
+            else
+                dmax += dd;
+        }
+
+        if (dmax + dist < safetyDist)
+            results[idx] = kVolumeCulled;
+        else if (dmin + dist >= 0)
+            results[idx] = kVolumeClear;
+        else
+            results[idx] = kVolumeSplit;
+    }
+}
+
+// CPU-optimized functions requiring dispatch
+hsCpuFunctionDispatcher<plSpaceTree::cull_bounds_ptr> plSpaceTree::cull_bounds {
+    &plSpaceTree::cull_bounds_fpu,
+    nullptr,                                // SSE1
+    &plSpaceTree::cull_bounds_sse2,
+    nullptr,                                // SSE3
+    nullptr,                                // SSSE3
+    nullptr,                                // SSE41
+    nullptr,                                // SSE42
+    &plSpaceTree::cull_bounds_avx
+};
+
+hsCpuFunctionDispatcher<plSpaceTree::cull_plane_ptr> plSpaceTree::cull_plane {
+    &plSpaceTree::cull_plane_fpu,
+    nullptr,                                // SSE1
+    &plSpaceTree::cull_plane_sse2,
+    nullptr,                                // SSE3
+    nullptr,                                // SSSE3
+    nullptr,                                // SSE41
+    nullptr,                                // SSE42
+    &plSpaceTree::cull_plane_avx
+};
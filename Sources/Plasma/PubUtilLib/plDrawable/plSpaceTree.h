@@ -46,12 +46,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include <vector>
 
 #include "hsBounds.h"
+#include "hsCpuID.h"
 #include "pnFactory/plCreatable.h"
 #include "hsBitVector.h"
 
+#include "plIntersect/plVolumeIsect.h"
+
 class hsStream;
 class hsResMgr;
-class plVolumeIsect;
 
 class plSpaceTreeNode 
 {
@@ -111,11 +113,35 @@ private:
 
     hsPoint3                        fViewPos;
 
+    // The tree again, flattened out breadth first for ILevelPass, so that
+    // siblings sit side by side and each level's nodes are close together.
+    // The bounds are ten rows of floats, one column per node: the mins' x, y
+    // and z, then the maxs', then the center's, then the radius. Built on
+    // first use, kept up to date after that.
+    enum {
+        kFlatNeedsTest  = 0x8000,   // Bounds the kernels can't do, use the real Test()
+        kFlatUntested   = 0xff      // Result for a node CullPlaneLevels left to the caller
+    };
+    mutable std::vector<float>      fFlatBounds;
+    mutable std::vector<uint16_t>   fFlatFlags;     // Just kIsLeaf and kDisabled, plus kFlatNeedsTest
+    mutable std::vector<int16_t>    fFlatChild;     // Flat index of the first child, the second follows
+    mutable std::vector<int16_t>    fFlatToNode;
+    mutable std::vector<int16_t>    fNodeToFlat;
+
+    // Set while a harvest is reading back results ICullLevels worked out.
+    mutable bool                    fPreCulled;
+
     void        IRefreshRecur(int16_t which);
-    
-    void        IHarvestAndCullLeaves(const plSpaceTreeNode& subRoot, std::vector<int16_t>& list) const;
-    void        IHarvestLeaves(const plSpaceTreeNode& subRoot, std::vector<int16_t>& list) const;
-    
+
+    void        IFlatten() const;
+    void        IUpdateFlat(int16_t which) const;
+
+    template <typename T, typename U, typename V>
+    void        ILevelPass(int16_t subRoot, T eligible, U test, V visit) const;
+    template <typename T, typename V>
+    bool        ICullLevels(T eligible, V visit) const;
+    plVolumeCullResult ITestNode(const plSpaceTreeNode& node) const;
+
     void        IHarvestAndCullLeaves(const plSpaceTreeNode& subRoot, hsBitVector& totList, hsBitVector& list) const;
     void        IHarvestLeaves(const plSpaceTreeNode& subRoot, hsBitVector& totList, hsBitVector& list) const;
 
@@ -127,7 +153,37 @@ private:
 
     void        IEnableLeaf(int16_t idx, hsBitVector& cache) const;
 
+    typedef void(*cull_bounds_ptr)(const float*, size_t, const int16_t*, size_t,
+                                   const plVolumeSlab*, size_t, uint8_t*);
+    typedef void(*cull_plane_ptr)(const float*, size_t, const int16_t*, size_t,
+                                  const hsVector3&, float, float, uint8_t*);
+
+    static hsCpuFunctionDispatcher<cull_bounds_ptr> cull_bounds;
+    static hsCpuFunctionDispatcher<cull_plane_ptr> cull_plane;
+
 public:
+    // The individual implementations, for testing them against each other.
+    // Don't call the SIMD ones unless hsCpuId says the CPU has them.
+
+    // For each flat index n in nodes, tests n's flattened bounds against the
+    // slabs the same way the slab volume's Test() would, and puts the
+    // plVolumeCullResult in results[n].
+    static void cull_bounds_fpu(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                                const plVolumeSlab* slabs, size_t numSlabs, uint8_t* results);
+    static void cull_bounds_sse2(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                                 const plVolumeSlab* slabs, size_t numSlabs, uint8_t* results);
+    static void cull_bounds_avx(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                                const plVolumeSlab* slabs, size_t numSlabs, uint8_t* results);
+
+    // Same again against a single plane, the way plCullNode::TestBounds()
+    // does it: the sphere first, then the box with the safety distance.
+    static void cull_plane_fpu(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                               const hsVector3& norm, float dist, float safetyDist, uint8_t* results);
+    static void cull_plane_sse2(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                                const hsVector3& norm, float dist, float safetyDist, uint8_t* results);
+    static void cull_plane_avx(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                               const hsVector3& norm, float dist, float safetyDist, uint8_t* results);
+
     plSpaceTree();
     virtual ~plSpaceTree();
 
@@ -155,6 +211,16 @@ public:
     void EnableLeaf(int16_t idx, hsBitVector& cache) const;
     void EnableLeaves(const std::vector<int16_t>& list, hsBitVector& cache) const;
     void HarvestEnabledLeaves(plVolumeIsect* cullFunc, const hsBitVector& cache, std::vector<int16_t>& list) const;
+
+    // For plCullTree, which culls against one plane at a time. Tests subRoot,
+    // and the children of whatever comes out split, a level at a time.
+    // Disabled nodes and ones without normal bounds are skipped, as in
+    // plCullNode's harvest. GetPlaneResult() then hands back the result for
+    // a node from the last pass, or returns false if it needs testing the
+    // slow way.
+    void CullPlaneLevels(int16_t subRoot, const hsVector3& norm, float dist, float safetyDist) const;
+    bool GetPlaneResult(int16_t idx, plVolumeCullResult& res) const;
+
     void SetCache(const hsBitVector* cache) { fCache = cache; }
 
     void SetHarvestFlags(plHarvestFlags f) { fHarvestFlags = f; }
@@ -0,0 +1,183 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plSpaceTree.h"
+
+#ifdef HAVE_AVX
+#   include <immintrin.h>
+#endif
+
+// Eight nodes at a time. Otherwise these are the SSE2 versions, and give the
+// same results.
+
+void plSpaceTree::cull_bounds_avx(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                                  const plVolumeSlab* slabs, size_t numSlabs, uint8_t* results)
+{
+#ifdef HAVE_AVX
+    const __m256 zero = _mm256_setzero_ps();
+    for (; count >= 8; count -= 8, nodes += 8)
+    {
+        __m256 mins[3], maxs[3];
+        for (int i = 0; i < 3; i++)
+        {
+            const float* lo = bounds + i * stride;
+            const float* hi = bounds + (i + 3) * stride;
+            mins[i] = _mm256_setr_ps(lo[nodes[0]], lo[nodes[1]], lo[nodes[2]], lo[nodes[3]],
+                                     lo[nodes[4]], lo[nodes[5]], lo[nodes[6]], lo[nodes[7]]);
+            maxs[i] = _mm256_setr_ps(hi[nodes[0]], hi[nodes[1]], hi[nodes[2]], hi[nodes[3]],
+                                     hi[nodes[4]], hi[nodes[5]], hi[nodes[6]], hi[nodes[7]]);
+        }
+
+        __m256 culled = _mm256_setzero_ps();
+        __m256 split = _mm256_setzero_ps();
+        for (size_t j = 0; j < numSlabs; j++)
+        {
+            const plVolumeSlab& slab = slabs[j];
+            const __m256 norm[3] = {
+                _mm256_set1_ps(slab.fNorm.fX),
+                _mm256_set1_ps(slab.fNorm.fY),
+                _mm256_set1_ps(slab.fNorm.fZ)
+            };
+
+            __m256 dmax = _mm256_mul_ps(mins[0], norm[0]);
+            dmax = _mm256_add_ps(dmax, _mm256_mul_ps(mins[1], norm[1]));
+            dmax = _mm256_add_ps(dmax, _mm256_mul_ps(mins[2], norm[2]));
+            __m256 dmin = dmax;
+            for (int i = 0; i < 3; i++)
+            {
+                __m256 dd = _mm256_mul_ps(_mm256_sub_ps(maxs[i], mins[i]), norm[i]);
+                __m256 neg = _mm256_cmp_ps(dd, zero, _CMP_LT_OQ);
+                dmin = _mm256_add_ps(dmin, _mm256_and_ps(neg, dd));
+                dmax = _mm256_add_ps(dmax, _mm256_andnot_ps(neg, dd));
+            }
+
+            const __m256 slabMin = _mm256_set1_ps(slab.fMin);
+            const __m256 slabMax = _mm256_set1_ps(slab.fMax);
+            culled = _mm256_or_ps(culled, _mm256_or_ps(_mm256_cmp_ps(dmin, slabMax, _CMP_GT_OQ),
+                                                       _mm256_cmp_ps(dmax, slabMin, _CMP_LT_OQ)));
+            split = _mm256_or_ps(split, _mm256_or_ps(_mm256_cmp_ps(dmax, slabMax, _CMP_GT_OQ),
+                                                     _mm256_cmp_ps(dmin, slabMin, _CMP_LT_OQ)));
+            if (_mm256_movemask_ps(culled) == 0xff)
+                break;
+        }
+
+        const int culledMask = _mm256_movemask_ps(culled);
+        const int splitMask = _mm256_movemask_ps(split);
+        for (int k = 0; k < 8; k++)
+        {
+            if (culledMask & (1 << k))
+                results[nodes[k]] = kVolumeCulled;
+            else if (splitMask & (1 << k))
+                results[nodes[k]] = kVolumeSplit;
+            else
+                results[nodes[k]] = kVolumeClear;
+        }
+    }
+#endif
+
+    // Leftovers
+    cull_bounds_sse2(bounds, stride, nodes, count, slabs, numSlabs, results);
+}
+
+void plSpaceTree::cull_plane_avx(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                                 const hsVector3& norm, float dist, float safetyDist, uint8_t* results)
+{
+#ifdef HAVE_AVX
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 n[3] = {
+        _mm256_set1_ps(norm.fX),
+        _mm256_set1_ps(norm.fY),
+        _mm256_set1_ps(norm.fZ)
+    };
+    const __m256 planeDist = _mm256_set1_ps(dist);
+    const __m256 safety = _mm256_set1_ps(safetyDist);
+    for (; count >= 8; count -= 8, nodes += 8)
+    {
+        __m256 rows[10];
+        for (int i = 0; i < 10; i++)
+        {
+            const float* row = bounds + i * stride;
+            rows[i] = _mm256_setr_ps(row[nodes[0]], row[nodes[1]], row[nodes[2]], row[nodes[3]],
+                                     row[nodes[4]], row[nodes[5]], row[nodes[6]], row[nodes[7]]);
+        }
+
+        __m256 d = _mm256_mul_ps(n[0], rows[6]);
+        d = _mm256_add_ps(d, _mm256_mul_ps(n[1], rows[7]));
+        d = _mm256_add_ps(d, _mm256_mul_ps(n[2], rows[8]));
+        d = _mm256_add_ps(d, planeDist);
+        const int sphereCulled = _mm256_movemask_ps(_mm256_cmp_ps(d, _mm256_sub_ps(zero, rows[9]), _CMP_LT_OQ));
+        const int sphereClear = _mm256_movemask_ps(_mm256_cmp_ps(d, rows[9], _CMP_GT_OQ));
+
+        __m256 dmax = _mm256_mul_ps(rows[0], n[0]);
+        dmax = _mm256_add_ps(dmax, _mm256_mul_ps(rows[1], n[1]));
+        dmax = _mm256_add_ps(dmax, _mm256_mul_ps(rows[2], n[2]));
+        __m256 dmin = dmax;
+        for (int i = 0; i < 3; i++)
+        {
+            __m256 dd = _mm256_mul_ps(_mm256_sub_ps(rows[i + 3], rows[i]), n[i]);
+            __m256 neg = _mm256_cmp_ps(dd, zero, _CMP_LT_OQ);
+            dmin = _mm256_add_ps(dmin, _mm256_and_ps(neg, dd));
+            dmax = _mm256_add_ps(dmax, _mm256_andnot_ps(neg, dd));
+        }
+        const int boxCulled = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(dmax, planeDist), safety, _CMP_LT_OQ));
+        const int boxClear = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(dmin, planeDist), zero, _CMP_GE_OQ));
+
+        for (int k = 0; k < 8; k++)
+        {
+            const int bit = 1 << k;
+            if (sphereCulled & bit)
+                results[nodes[k]] = kVolumeCulled;
+            else if (sphereClear & bit)
+                results[nodes[k]] = kVolumeClear;
+            else if (boxCulled & bit)
+                results[nodes[k]] = kVolumeCulled;
+            else if (boxClear & bit)
+                results[nodes[k]] = kVolumeClear;
+            else
+                results[nodes[k]] = kVolumeSplit;
+        }
+    }
+#endif
+
+    // Leftovers
+    cull_plane_sse2(bounds, stride, nodes, count, norm, dist, safetyDist, results);
+}
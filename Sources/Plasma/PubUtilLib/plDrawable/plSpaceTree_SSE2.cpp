@@ -0,0 +1,179 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plSpaceTree.h"
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+#endif
+
+// Four nodes at a time, one per lane, against each slab in turn or against
+// the one plane. Same math as the FPU versions, in the same order, so the
+// results match them exactly.
+
+void plSpaceTree::cull_bounds_sse2(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                                   const plVolumeSlab* slabs, size_t numSlabs, uint8_t* results)
+{
+#ifdef HAVE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    for (; count >= 4; count -= 4, nodes += 4)
+    {
+        __m128 mins[3], maxs[3];
+        for (int i = 0; i < 3; i++)
+        {
+            const float* lo = bounds + i * stride;
+            const float* hi = bounds + (i + 3) * stride;
+            mins[i] = _mm_setr_ps(lo[nodes[0]], lo[nodes[1]], lo[nodes[2]], lo[nodes[3]]);
+            maxs[i] = _mm_setr_ps(hi[nodes[0]], hi[nodes[1]], hi[nodes[2]], hi[nodes[3]]);
+        }
+
+        __m128 culled = _mm_setzero_ps();
+        __m128 split = _mm_setzero_ps();
+        for (size_t j = 0; j < numSlabs; j++)
+        {
+            const plVolumeSlab& slab = slabs[j];
+            const __m128 norm[3] = {
+                _mm_set1_ps(slab.fNorm.fX),
+                _mm_set1_ps(slab.fNorm.fY),
+                _mm_set1_ps(slab.fNorm.fZ)
+            };
+
+            __m128 dmax = _mm_mul_ps(mins[0], norm[0]);
+            dmax = _mm_add_ps(dmax, _mm_mul_ps(mins[1], norm[1]));
+            dmax = _mm_add_ps(dmax, _mm_mul_ps(mins[2], norm[2]));
+            __m128 dmin = dmax;
+            for (int i = 0; i < 3; i++)
+            {
+                __m128 dd = _mm_mul_ps(_mm_sub_ps(maxs[i], mins[i]), norm[i]);
+                __m128 neg = _mm_cmplt_ps(dd, zero);
+                dmin = _mm_add_ps(dmin, _mm_and_ps(neg, dd));
+                dmax = _mm_add_ps(dmax, _mm_andnot_ps(neg, dd));
+            }
+
+            const __m128 slabMin = _mm_set1_ps(slab.fMin);
+            const __m128 slabMax = _mm_set1_ps(slab.fMax);
+            culled = _mm_or_ps(culled, _mm_or_ps(_mm_cmpgt_ps(dmin, slabMax), _mm_cmplt_ps(dmax, slabMin)));
+            split = _mm_or_ps(split, _mm_or_ps(_mm_cmpgt_ps(dmax, slabMax), _mm_cmplt_ps(dmin, slabMin)));
+            if (_mm_movemask_ps(culled) == 0xf)
+                break;
+        }
+
+        const int culledMask = _mm_movemask_ps(culled);
+        const int splitMask = _mm_movemask_ps(split);
+        for (int k = 0; k < 4; k++)
+        {
+            if (culledMask & (1 << k))
+                results[nodes[k]] = kVolumeCulled;
+            else if (splitMask & (1 << k))
+                results[nodes[k]] = kVolumeSplit;
+            else
+                results[nodes[k]] = kVolumeClear;
+        }
+    }
+#endif
+
+    // Leftovers
+    cull_bounds_fpu(bounds, stride, nodes, count, slabs, numSlabs, results);
+}
+
+void plSpaceTree::cull_plane_sse2(const float* bounds, size_t stride, const int16_t* nodes, size_t count,
+                                  const hsVector3& norm, float dist, float safetyDist, uint8_t* results)
+{
+#ifdef HAVE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 n[3] = {
+        _mm_set1_ps(norm.fX),
+        _mm_set1_ps(norm.fY),
+        _mm_set1_ps(norm.fZ)
+    };
+    const __m128 planeDist = _mm_set1_ps(dist);
+    const __m128 safety = _mm_set1_ps(safetyDist);
+    for (; count >= 4; count -= 4, nodes += 4)
+    {
+        __m128 rows[10];
+        for (int i = 0; i < 10; i++)
+        {
+            const float* row = bounds + i * stride;
+            rows[i] = _mm_setr_ps(row[nodes[0]], row[nodes[1]], row[nodes[2]], row[nodes[3]]);
+        }
+
+        __m128 d = _mm_mul_ps(n[0], rows[6]);
+        d = _mm_add_ps(d, _mm_mul_ps(n[1], rows[7]));
+        d = _mm_add_ps(d, _mm_mul_ps(n[2], rows[8]));
+        d = _mm_add_ps(d, planeDist);
+        const int sphereCulled = _mm_movemask_ps(_mm_cmplt_ps(d, _mm_sub_ps(zero, rows[9])));
+        const int sphereClear = _mm_movemask_ps(_mm_cmpgt_ps(d, rows[9]));
+
+        __m128 dmax = _mm_mul_ps(rows[0], n[0]);
+        dmax = _mm_add_ps(dmax, _mm_mul_ps(rows[1], n[1]));
+        dmax = _mm_add_ps(dmax, _mm_mul_ps(rows[2], n[2]));
+        __m128 dmin = dmax;
+        for (int i = 0; i < 3; i++)
+        {
+            __m128 dd = _mm_mul_ps(_mm_sub_ps(rows[i + 3], rows[i]), n[i]);
+            __m128 neg = _mm_cmplt_ps(dd, zero);
+            dmin = _mm_add_ps(dmin, _mm_and_ps(neg, dd));
+            dmax = _mm_add_ps(dmax, _mm_andnot_ps(neg, dd));
+        }
+        const int boxCulled = _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(dmax, planeDist), safety));
+        const int boxClear = _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(dmin, planeDist), zero));
+
+        for (int k = 0; k < 4; k++)
+        {
+            const int bit = 1 << k;
+            if (sphereCulled & bit)
+                results[nodes[k]] = kVolumeCulled;
+            else if (sphereClear & bit)
+                results[nodes[k]] = kVolumeClear;
+            else if (boxCulled & bit)
+                results[nodes[k]] = kVolumeCulled;
+            else if (boxClear & bit)
+                results[nodes[k]] = kVolumeClear;
+            else
+                results[nodes[k]] = kVolumeSplit;
+        }
+    }
+#endif
+
+    // Leftovers
+    cull_plane_fpu(bounds, stride, nodes, count, norm, dist, safetyDist, results);
+}
@@ -0,0 +1,121 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plBlockCipher.h"
+
+static const uint32_t kDelta = 0x9E3779B9;
+
+// 6 + 52/n rounds, with n = 2 words per block
+static const uint32_t kXXTeaRounds = 32;
+static const uint32_t kTeaRounds = 32;
+
+//
+// XXTEA
+// http://www-users.cs.york.ac.uk/~matthew/TEA/
+//
+#define MX(k) (((z>>5 ^ y<<2) + (y>>3 ^ z<<4)) ^ ((sum^y) + ((k)^z)))
+
+void plBlockCipher::xxtea_decipher_fpu(const uint32_t* key, uint32_t* data, size_t numBlocks)
+{
+    for (size_t i = 0; i < numBlocks; ++i, data += 2)
+    {
+        uint32_t y = data[0], z, sum = kXXTeaRounds * kDelta;
+        while (sum != 0)
+        {
+            uint32_t e = (sum >> 2) & 3;
+            z = data[0];
+            data[1] -= MX(key[1 ^ e]);
+            y = data[1];
+            z = data[1];
+            data[0] -= MX(key[0 ^ e]);
+            y = data[0];
+            sum -= kDelta;
+        }
+    }
+}
+
+#undef MX
+
+//
+// Tiny Encryption Algorithm
+// http://vader.brad.ac.uk/tea/tea.shtml
+//
+void plBlockCipher::tea_decipher_fpu(const uint32_t* key, uint32_t* data, size_t numBlocks)
+{
+    for (size_t i = 0; i < numBlocks; ++i, data += 2)
+    {
+        uint32_t y = data[0], z = data[1], sum = kTeaRounds * kDelta;
+        for (uint32_t n = 0; n < kTeaRounds; ++n)
+        {
+            z -= ((y << 4 ^ y >> 5) + y) ^ (sum + key[sum>>11 & 3]);
+            sum -= kDelta;
+            y -= ((z << 4 ^ z >> 5) + z) ^ (sum + key[sum&3]);
+        }
+        data[0] = y;
+        data[1] = z;
+    }
+}
+
+// CPU-optimized functions requiring dispatch
+hsCpuFunctionDispatcher<plBlockCipher::decipher_ptr> plBlockCipher::xxtea_decipher {
+    &plBlockCipher::xxtea_decipher_fpu,
+    nullptr,                                // SSE1
+    &plBlockCipher::xxtea_decipher_sse2,
+    nullptr,                                // SSE3
+    nullptr,                                // SSSE3
+    nullptr,                                // SSE41
+    nullptr,                                // SSE42
+    nullptr,                                // AVX
+    &plBlockCipher::xxtea_decipher_avx2
+};
+
+hsCpuFunctionDispatcher<plBlockCipher::decipher_ptr> plBlockCipher::tea_decipher {
+    &plBlockCipher::tea_decipher_fpu,
+    nullptr,                                // SSE1
+    &plBlockCipher::tea_decipher_sse2,
+    nullptr,                                // SSE3
+    nullptr,                                // SSSE3
+    nullptr,                                // SSE41
+    nullptr,                                // SSE42
+    nullptr,                                // AVX
+    &plBlockCipher::tea_decipher_avx2
+};
@@ -0,0 +1,87 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef plBlockCipher_h_inc
+#define plBlockCipher_h_inc
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+
+//
+// Bulk decryption for the 64-bit block ciphers used by our file streams.
+// Every 8-byte chunk of an encrypted file is enciphered on its own, so runs
+// of chunks can be deciphered side by side in SIMD lanes.  Data is in place,
+// as pairs of little-endian words, and the key is always 4 words.
+//
+class plBlockCipher
+{
+public:
+    // XXTEA (plSecureStream)
+    static void XXTeaDecipher(const uint32_t* key, uint32_t* data, size_t numBlocks)
+    {
+        xxtea_decipher.call(key, data, numBlocks);
+    }
+
+    // TEA (plEncryptedStream)
+    static void TeaDecipher(const uint32_t* key, uint32_t* data, size_t numBlocks)
+    {
+        tea_decipher.call(key, data, numBlocks);
+    }
+
+    // The individual implementations, for testing them against each other.
+    // Don't call the SIMD ones unless hsCpuId says the CPU has them.
+    static void xxtea_decipher_fpu(const uint32_t* key, uint32_t* data, size_t numBlocks);
+    static void xxtea_decipher_sse2(const uint32_t* key, uint32_t* data, size_t numBlocks);
+    static void xxtea_decipher_avx2(const uint32_t* key, uint32_t* data, size_t numBlocks);
+
+    static void tea_decipher_fpu(const uint32_t* key, uint32_t* data, size_t numBlocks);
+    static void tea_decipher_sse2(const uint32_t* key, uint32_t* data, size_t numBlocks);
+    static void tea_decipher_avx2(const uint32_t* key, uint32_t* data, size_t numBlocks);
+
+private:
+    typedef void(*decipher_ptr)(const uint32_t*, uint32_t*, size_t);
+
+    static hsCpuFunctionDispatcher<decipher_ptr> xxtea_decipher;
+    static hsCpuFunctionDispatcher<decipher_ptr> tea_decipher;
+};
+
+#endif // plBlockCipher_h_inc
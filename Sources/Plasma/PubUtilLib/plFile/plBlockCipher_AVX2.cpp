@@ -0,0 +1,132 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plBlockCipher.h"
+
+#ifdef HAVE_AVX2
+#   include <immintrin.h>
+
+// Each register holds one word from each of 8 blocks.  Splitting the blocks'
+// first and second words apart (and putting them back) is done in 64-bit
+// pairs, so the block order within the registers gets shuffled about, but
+// the same way for both halves, which is all that matters.
+static inline void ILoadBlocks(const uint32_t* data, __m256i& y, __m256i& z)
+{
+    __m256i a = _mm256_shuffle_epi32(_mm256_loadu_si256((const __m256i*)data), _MM_SHUFFLE(3, 1, 2, 0));
+    __m256i b = _mm256_shuffle_epi32(_mm256_loadu_si256((const __m256i*)(data + 8)), _MM_SHUFFLE(3, 1, 2, 0));
+    y = _mm256_unpacklo_epi64(a, b);
+    z = _mm256_unpackhi_epi64(a, b);
+}
+
+static inline void IStoreBlocks(uint32_t* data, __m256i y, __m256i z)
+{
+    _mm256_storeu_si256((__m256i*)data, _mm256_shuffle_epi32(_mm256_unpacklo_epi64(y, z), _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm256_storeu_si256((__m256i*)(data + 8), _mm256_shuffle_epi32(_mm256_unpackhi_epi64(y, z), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+static inline __m256i IXXTeaMX(__m256i y, __m256i z, __m256i sum, __m256i k)
+{
+    __m256i left = _mm256_add_epi32(_mm256_xor_si256(_mm256_srli_epi32(z, 5), _mm256_slli_epi32(y, 2)),
+                                    _mm256_xor_si256(_mm256_srli_epi32(y, 3), _mm256_slli_epi32(z, 4)));
+    __m256i right = _mm256_add_epi32(_mm256_xor_si256(sum, y), _mm256_xor_si256(k, z));
+    return _mm256_xor_si256(left, right);
+}
+
+static inline __m256i ITeaF(__m256i v, __m256i sumKey)
+{
+    return _mm256_xor_si256(_mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(v, 4), _mm256_srli_epi32(v, 5)), v), sumKey);
+}
+#endif
+
+void plBlockCipher::xxtea_decipher_avx2(const uint32_t* key, uint32_t* data, size_t numBlocks)
+{
+#ifdef HAVE_AVX2
+    for (; numBlocks >= 8; numBlocks -= 8, data += 8 * 2)
+    {
+        __m256i v0, v1;
+        ILoadBlocks(data, v0, v1);
+
+        __m256i y = v0, z;
+        for (uint32_t sum = 32 * 0x9E3779B9; sum != 0; sum -= 0x9E3779B9)
+        {
+            uint32_t e = (sum >> 2) & 3;
+            __m256i vsum = _mm256_set1_epi32(sum);
+
+            z = v0;
+            v1 = _mm256_sub_epi32(v1, IXXTeaMX(y, z, vsum, _mm256_set1_epi32(key[1 ^ e])));
+            y = v1;
+            z = v1;
+            v0 = _mm256_sub_epi32(v0, IXXTeaMX(y, z, vsum, _mm256_set1_epi32(key[0 ^ e])));
+            y = v0;
+        }
+
+        IStoreBlocks(data, v0, v1);
+    }
+#endif
+
+    // Leftovers
+    xxtea_decipher_fpu(key, data, numBlocks);
+}
+
+void plBlockCipher::tea_decipher_avx2(const uint32_t* key, uint32_t* data, size_t numBlocks)
+{
+#ifdef HAVE_AVX2
+    for (; numBlocks >= 8; numBlocks -= 8, data += 8 * 2)
+    {
+        __m256i y, z;
+        ILoadBlocks(data, y, z);
+
+        uint32_t sum = 32 * 0x9E3779B9;
+        for (uint32_t n = 0; n < 32; ++n)
+        {
+            z = _mm256_sub_epi32(z, ITeaF(y, _mm256_set1_epi32(sum + key[sum>>11 & 3])));
+            sum -= 0x9E3779B9;
+            y = _mm256_sub_epi32(y, ITeaF(z, _mm256_set1_epi32(sum + key[sum&3])));
+        }
+
+        IStoreBlocks(data, y, z);
+    }
+#endif
+
+    // Leftovers
+    tea_decipher_fpu(key, data, numBlocks);
+}
@@ -0,0 +1,132 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plBlockCipher.h"
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+
+// Each register holds one word from each of 4 blocks.  Splitting the blocks'
+// first and second words apart (and putting them back) is done in 64-bit
+// pairs, so the block order within the registers gets shuffled about, but
+// the same way for both halves, which is all that matters.
+static inline void ILoadBlocks(const uint32_t* data, __m128i& y, __m128i& z)
+{
+    __m128i a = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)data), _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i b = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(data + 4)), _MM_SHUFFLE(3, 1, 2, 0));
+    y = _mm_unpacklo_epi64(a, b);
+    z = _mm_unpackhi_epi64(a, b);
+}
+
+static inline void IStoreBlocks(uint32_t* data, __m128i y, __m128i z)
+{
+    _mm_storeu_si128((__m128i*)data, _mm_shuffle_epi32(_mm_unpacklo_epi64(y, z), _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm_storeu_si128((__m128i*)(data + 4), _mm_shuffle_epi32(_mm_unpackhi_epi64(y, z), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+static inline __m128i IXXTeaMX(__m128i y, __m128i z, __m128i sum, __m128i k)
+{
+    __m128i left = _mm_add_epi32(_mm_xor_si128(_mm_srli_epi32(z, 5), _mm_slli_epi32(y, 2)),
+                                 _mm_xor_si128(_mm_srli_epi32(y, 3), _mm_slli_epi32(z, 4)));
+    __m128i right = _mm_add_epi32(_mm_xor_si128(sum, y), _mm_xor_si128(k, z));
+    return _mm_xor_si128(left, right);
+}
+
+static inline __m128i ITeaF(__m128i v, __m128i sumKey)
+{
+    return _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v, 4), _mm_srli_epi32(v, 5)), v), sumKey);
+}
+#endif
+
+void plBlockCipher::xxtea_decipher_sse2(const uint32_t* key, uint32_t* data, size_t numBlocks)
+{
+#ifdef HAVE_SSE2
+    for (; numBlocks >= 4; numBlocks -= 4, data += 4 * 2)
+    {
+        __m128i v0, v1;
+        ILoadBlocks(data, v0, v1);
+
+        __m128i y = v0, z;
+        for (uint32_t sum = 32 * 0x9E3779B9; sum != 0; sum -= 0x9E3779B9)
+        {
+            uint32_t e = (sum >> 2) & 3;
+            __m128i vsum = _mm_set1_epi32(sum);
+
+            z = v0;
+            v1 = _mm_sub_epi32(v1, IXXTeaMX(y, z, vsum, _mm_set1_epi32(key[1 ^ e])));
+            y = v1;
+            z = v1;
+            v0 = _mm_sub_epi32(v0, IXXTeaMX(y, z, vsum, _mm_set1_epi32(key[0 ^ e])));
+            y = v0;
+        }
+
+        IStoreBlocks(data, v0, v1);
+    }
+#endif
+
+    // Leftovers
+    xxtea_decipher_fpu(key, data, numBlocks);
+}
+
+void plBlockCipher::tea_decipher_sse2(const uint32_t* key, uint32_t* data, size_t numBlocks)
+{
+#ifdef HAVE_SSE2
+    for (; numBlocks >= 4; numBlocks -= 4, data += 4 * 2)
+    {
+        __m128i y, z;
+        ILoadBlocks(data, y, z);
+
+        uint32_t sum = 32 * 0x9E3779B9;
+        for (uint32_t n = 0; n < 32; ++n)
+        {
+            z = _mm_sub_epi32(z, ITeaF(y, _mm_set1_epi32(sum + key[sum>>11 & 3])));
+            sum -= 0x9E3779B9;
+            y = _mm_sub_epi32(y, ITeaF(z, _mm_set1_epi32(sum + key[sum&3])));
+        }
+
+        IStoreBlocks(data, y, z);
+    }
+#endif
+
+    // Leftovers
+    tea_decipher_fpu(key, data, numBlocks);
+}
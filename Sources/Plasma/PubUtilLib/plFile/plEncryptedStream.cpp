@@ -40,12 +40,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 *==LICENSE==*/
 #include "plEncryptedStream.h"
+#include "plBlockCipher.h"
 
 #include "hsSTLStream.h"
 
 #include <ctime>
 #include <wchar.h>
 #include <algorithm>
+#include <vector>
 
 static const uint32_t kDefaultKey[4] = { 0x6c0a5452, 0x3827d0f, 0x3a170b92, 0x16db7fc2 };
 static const int kEncryptChunkSize = 8;
@@ -100,22 +102,6 @@ void plEncryptedStream::IEncipher(uint32_t* const v)
    v[0]=y; v[1]=z;
 }
 
-void plEncryptedStream::IDecipher(uint32_t* const v)
-{
-    uint32_t y=v[0], z=v[1], sum=0xC6EF3720, delta=0x9E3779B9, n=32;
-
-    // sum = delta<<5, in general sum = delta * n
-
-    while (n-- > 0)
-    {
-        z -= (y << 4 ^ y >> 5) + y ^ sum + fKey[sum>>11 & 3];
-        sum -= delta;
-        y -= (z << 4 ^ z >> 5) + z ^ sum + fKey[sum&3];
-    }
-   
-    v[0]=y; v[1]=z;
-}
-
 bool plEncryptedStream::Open(const plFileName& name, const char* mode)
 {
     if (strcmp(mode, "rb") == 0)
@@ -216,13 +202,14 @@ uint32_t plEncryptedStream::IRead(uint32_t bytes, void* buffer)
 
 void plEncryptedStream::IBufferFile()
 {
-    fRAMStream = new hsVectorStream;
-    char buf[1024];
-    while (!AtEnd())
-    {
-        uint32_t numRead = Read(1024, buf);
-        fRAMStream->Write(numRead, buf);
-    }
+    // Read the whole file at once and decrypt it in bulk
+    uint32_t numBlocks = (fActualFileSize + kEncryptChunkSize - 1) / kEncryptChunkSize;
+    std::vector<uint32_t> buf(numBlocks * kEncryptChunkSize / sizeof(uint32_t));
+    uint32_t numRead = IRead(numBlocks * kEncryptChunkSize, buf.data());
+    plBlockCipher::TeaDecipher(fKey, buf.data(), numRead / kEncryptChunkSize);
+
+    fRAMStream = new hsVectorStream(fActualFileSize);
+    fRAMStream->Write(std::min(numRead, fActualFileSize), buf.data());
     fRAMStream->Rewind();
 
     fBufferedStream = true;
@@ -319,7 +306,7 @@ uint32_t plEncryptedStream::Read(uint32_t bytes, void* buffer)
         // Read in the chunk and decrypt it
         char buf[kEncryptChunkSize];
         (void)IRead(kEncryptChunkSize, &buf);   // numRead
-        IDecipher((uint32_t*)&buf);
+        plBlockCipher::TeaDecipher(fKey, (uint32_t*)&buf, 1);
 
         // Copy the relevant portion to the output buffer
         memcpy(buffer, &buf[startChunkPos], startAmt);
@@ -329,13 +316,9 @@ uint32_t plEncryptedStream::Read(uint32_t bytes, void* buffer)
 
     if (numMidChunks != 0)
     {
+        // Decrypt all the whole chunks at once
         uint32_t* bufferPos = (uint32_t*)(((char*)buffer)+startAmt);
-        for (int i = 0; i < numMidChunks; i++)
-        {
-            // Decrypt chunk
-            IDecipher(bufferPos);
-            bufferPos += (kEncryptChunkSize / sizeof(uint32_t));
-        }
+        plBlockCipher::TeaDecipher(fKey, bufferPos, numMidChunks);
     }
 
     if (endAmt != 0)
@@ -344,7 +327,7 @@ uint32_t plEncryptedStream::Read(uint32_t bytes, void* buffer)
         char buf[kEncryptChunkSize];
         SetPosition(startPos + startAmt + numMidChunks*kEncryptChunkSize);
         (void)IRead(kEncryptChunkSize, &buf);   // numRead
-        IDecipher((uint32_t*)&buf);
+        plBlockCipher::TeaDecipher(fKey, (uint32_t*)&buf, 1);
 
         memcpy(((char*)buffer)+totalNumRead-endAmt, &buf, endAmt);
         
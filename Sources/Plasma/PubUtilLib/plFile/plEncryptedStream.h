@@ -71,7 +71,6 @@ protected:
     uint32_t IRead(uint32_t bytes, void* buffer);
 
     void IEncipher(uint32_t* const v);
-    void IDecipher(uint32_t* const v);
 
     bool IWriteEncypted(hsStream* sourceStream, const plFileName& outputFile);
 
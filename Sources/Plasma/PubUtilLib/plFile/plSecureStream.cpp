@@ -43,10 +43,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include <ctime>
 
 #include "plSecureStream.h"
+#include "plBlockCipher.h"
 #include "hsWindows.h"
 
 #include "hsSTLStream.h"
 
+#include <algorithm>
+#include <vector>
+
 #if !HS_BUILD_FOR_WIN32
 #include <errno.h>
 #define INVALID_HANDLE_VALUE nullptr
@@ -130,27 +134,6 @@ void plSecureStream::IEncipher(uint32_t* const v, uint32_t n)
     }
 }
 
-void plSecureStream::IDecipher(uint32_t* const v, uint32_t n)
-{
-    unsigned long y=v[0], z=v[n-1], e, delta=0x9E3779B9;
-    unsigned long q = 6 + 52/n, p, sum = q * delta;
-
-    while (sum > 0)
-    {
-        e = (sum >> 2) & 3;
-        for (p = n - 1; p > 0; p--)
-        {
-            z = v[p - 1];
-            v[p] -= MX;
-            y = v[p];
-        }
-        z = v[n - 1];
-        v[0] -= MX;
-        y = v[0];
-        sum -= delta;
-    }
-}
-
 bool plSecureStream::Open(const plFileName& name, const char* mode)
 {
     if (strcmp(mode, "rb") == 0)
@@ -205,6 +188,8 @@ bool plSecureStream::Open(const plFileName& name, const char* mode)
             fRef = INVALID_HANDLE_VALUE;
             return false;
         }
+
+        fread(&fActualFileSize, sizeof(uint32_t), 1, fRef);
 #endif
 
         // The encrypted stream is inefficient if you do reads smaller than
@@ -244,22 +229,17 @@ bool plSecureStream::Open(hsStream* stream)
         return false;
 
     fActualFileSize = stream->ReadLE32();
-    uint32_t trimSize = kMagicStringLen + sizeof(uint32_t) + fActualFileSize;
-    fRAMStream = new hsRAMStream;
-    while (!stream->AtEnd())
-    {
-        // Don't write out any garbage
-        uint32_t size;
-        if ((trimSize - stream->GetPosition()) < kEncryptChunkSize)
-            size = (trimSize - stream->GetPosition());
-        else
-            size = kEncryptChunkSize;
 
-        uint8_t buf[kEncryptChunkSize];
-        stream->Read(kEncryptChunkSize, &buf);
-        IDecipher((uint32_t*)&buf, kEncryptChunkSize / sizeof(uint32_t));
-        fRAMStream->Write(size, &buf);
-    }
+    // Pull in every whole chunk there is and decrypt them all in one go
+    uint32_t numBlocks = (fActualFileSize + kEncryptChunkSize - 1) / kEncryptChunkSize;
+    numBlocks = std::min(numBlocks, (stream->GetEOF() - stream->GetPosition()) / kEncryptChunkSize);
+    std::vector<uint32_t> buf(numBlocks * kEncryptChunkSize / sizeof(uint32_t));
+    stream->Read(numBlocks * kEncryptChunkSize, buf.data());
+    plBlockCipher::XXTeaDecipher(fKey, buf.data(), numBlocks);
+
+    // Don't write out any garbage
+    fRAMStream = new hsRAMStream;
+    fRAMStream->Write(std::min(numBlocks * kEncryptChunkSize, fActualFileSize), buf.data());
 
     stream->SetPosition(pos);
     fRAMStream->Rewind();
@@ -310,8 +290,8 @@ uint32_t plSecureStream::IRead(uint32_t bytes, void* buffer)
 #if HS_BUILD_FOR_WIN32
     bool success = (ReadFile(fRef, buffer, bytes, (LPDWORD)&numItems, nullptr) != 0);
 #elif HS_BUILD_FOR_UNIX
-    numItems = fread(buffer, bytes, 1, fRef);
-    bool success = numItems != 0;
+    numItems = fread(buffer, 1, bytes, fRef);
+    bool success = ferror(fRef) == 0;
 #endif
     fBytesRead += numItems;
     fPosition += numItems;
@@ -338,13 +318,14 @@ uint32_t plSecureStream::IRead(uint32_t bytes, void* buffer)
 
 void plSecureStream::IBufferFile()
 {
-    fRAMStream = new hsVectorStream;
-    char buf[1024];
-    while (!AtEnd())
-    {
-        uint32_t numRead = Read(1024, buf);
-        fRAMStream->Write(numRead, buf);
-    }
+    // Read the whole file at once and decrypt it in bulk
+    uint32_t numBlocks = (fActualFileSize + kEncryptChunkSize - 1) / kEncryptChunkSize;
+    std::vector<uint32_t> buf(numBlocks * kEncryptChunkSize / sizeof(uint32_t));
+    uint32_t numRead = IRead(numBlocks * kEncryptChunkSize, buf.data());
+    plBlockCipher::XXTeaDecipher(fKey, buf.data(), numRead / kEncryptChunkSize);
+
+    fRAMStream = new hsVectorStream(fActualFileSize);
+    fRAMStream->Write(std::min(numRead, fActualFileSize), buf.data());
     fRAMStream->Rewind();
 
     fBufferedStream = true;
@@ -456,7 +437,7 @@ uint32_t plSecureStream::Read(uint32_t bytes, void* buffer)
         // Read in the chunk and decrypt it
         char buf[kEncryptChunkSize];
         (void)IRead(kEncryptChunkSize, &buf);   // numRead
-        IDecipher((uint32_t*)&buf, kEncryptChunkSize / sizeof(uint32_t));
+        plBlockCipher::XXTeaDecipher(fKey, (uint32_t*)&buf, 1);
 
         // Copy the relevant portion to the output buffer
         memcpy(buffer, &buf[startChunkPos], startAmt);
@@ -466,13 +447,9 @@ uint32_t plSecureStream::Read(uint32_t bytes, void* buffer)
 
     if (numMidChunks != 0)
     {
+        // Decrypt all the whole chunks at once
         uint32_t* bufferPos = (uint32_t*)(((char*)buffer)+startAmt);
-        for (int i = 0; i < numMidChunks; i++)
-        {
-            // Decrypt chunk
-            IDecipher(bufferPos, kEncryptChunkSize / sizeof(uint32_t));
-            bufferPos += (kEncryptChunkSize / sizeof(uint32_t));
-        }
+        plBlockCipher::XXTeaDecipher(fKey, bufferPos, numMidChunks);
     }
 
     if (endAmt != 0)
@@ -481,7 +458,7 @@ uint32_t plSecureStream::Read(uint32_t bytes, void* buffer)
         char buf[kEncryptChunkSize];
         SetPosition(startPos + startAmt + numMidChunks*kEncryptChunkSize);
         (void)IRead(kEncryptChunkSize, &buf);   // numRead
-        IDecipher((uint32_t*)&buf, kEncryptChunkSize / sizeof(uint32_t));
+        plBlockCipher::XXTeaDecipher(fKey, (uint32_t*)&buf, 1);
 
         memcpy(((char*)buffer)+totalNumRead-endAmt, &buf, endAmt);
 
@@ -81,7 +81,6 @@ protected:
     uint32_t IRead(uint32_t bytes, void* buffer);
 
     void IEncipher(uint32_t* const v, uint32_t n);
-    void IDecipher(uint32_t* const v, uint32_t n);
 
     bool IWriteEncrypted(hsStream* sourceStream, const plFileName& outputFile);
 
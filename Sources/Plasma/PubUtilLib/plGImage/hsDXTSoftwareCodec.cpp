@@ -43,9 +43,16 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "HeadSpin.h"
 #include "hsColorRGBA.h"
 #include "hsDXTSoftwareCodec.h"
+#include "hsJobPool.h"
 #include "plMipmap.h"
 #include "hsCodecManager.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <vector>
+
 #define SWAPVARS( x, y, t ) { t = x; x = y; y = t; }
 
 // This is the color depth that we decompress to by default if we're not told otherwise
@@ -53,6 +60,55 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 
 bool hsDXTSoftwareCodec::fRegistered = false;
+hsDXTSoftwareCodec::CompressionQuality hsDXTSoftwareCodec::fQuality = hsDXTSoftwareCodec::kNormal;
+uint32_t hsDXTSoftwareCodec::fMinThreadedBlocks = 1024;
+
+// A run of block rows from one level of a mipmap, and where its pixels are
+// in the uncompressed one.
+struct hsDXTBlockRows
+{
+    uint8_t     *fPixels;       // top left pixel of the first row
+    uint32_t    fRowBytes;      // from one row of pixels to the next
+    uint8_t     *fBlocks;       // first block of the first row
+    uint32_t    fBlockSize;
+    uint32_t    fBlocksWide;
+    uint32_t    fNumRows;
+};
+
+// Splits the levels into runs of about minBlocks blocks and hands them to
+// func, on the pool if there are enough of them to be worth it.
+static void IRunBlockRows(const std::vector<hsDXTBlockRows>& levels, uint32_t minBlocks,
+                          const std::function<void(const hsDXTBlockRows&)>& func)
+{
+    minBlocks = std::max(minBlocks, 1U);
+
+    std::vector<hsDXTBlockRows> jobs;
+    size_t totalBlocks = 0;
+    for (const hsDXTBlockRows& level : levels)
+    {
+        if (!level.fBlocksWide || !level.fNumRows)
+            continue;
+
+        uint32_t rowsPerJob = std::max(minBlocks / level.fBlocksWide, 1U);
+        for (uint32_t row = 0; row < level.fNumRows; row += rowsPerJob)
+        {
+            hsDXTBlockRows job = level;
+            job.fPixels += row * 4 * level.fRowBytes;
+            job.fBlocks += row * level.fBlocksWide * level.fBlockSize;
+            job.fNumRows = std::min(rowsPerJob, level.fNumRows - row);
+            jobs.push_back(job);
+        }
+        totalBlocks += level.fBlocksWide * level.fNumRows;
+    }
+
+    if (jobs.size() < 2 || totalBlocks < 2 * minBlocks)
+    {
+        for (const hsDXTBlockRows& job : jobs)
+            func(job);
+    }
+    else
+        hsJobPool::Instance().Run(jobs.size(), [&jobs, &func](size_t i) { func(jobs[i]); });
+}
 
 hsDXTSoftwareCodec& hsDXTSoftwareCodec::Instance()
 {
@@ -99,17 +155,16 @@ plMipmap *hsDXTSoftwareCodec::CreateCompressedMipmap( plMipmap *uncompressed )
                                 uncompressed->GetNumLevels(), plMipmap::kDirectXCompression, format );
 
     {
-        /// Now loop through and compress each one (that is a valid size!)
+        /// Find the levels that are a valid size, and compress them all
         for( i = 0; i < compressed->GetNumLevels(); i++ )
         {
-            uncompressed->SetCurrLevel( i );
             compressed->SetCurrLevel( i );
             if( ( compressed->GetCurrWidth() | compressed->GetCurrHeight() ) & 0x03 )
                 break;
-
-            CompressMipmapLevel( uncompressed, compressed );
         }
 
+        ICompressLevels( uncompressed, compressed, i );
+
         /// Now copy the rest straight over
         for( ; i < compressed->GetNumLevels(); i++ )
             memcpy( compressed->GetLevelPtr( i ), uncompressed->GetLevelPtr( i ), uncompressed->GetLevelSize( i ) );
@@ -137,7 +192,7 @@ plMipmap *hsDXTSoftwareCodec::CreateUncompressedMipmap( plMipmap *compressed, ui
     plMipmap    *uncompressed = nullptr;
     int32_t       totalSize;
     int32_t       width, height;
-    uint8_t       i;
+    uint8_t       i, numCompLevels;
 
 
     /// Sanity checks
@@ -166,24 +221,35 @@ plMipmap *hsDXTSoftwareCodec::CreateUncompressedMipmap( plMipmap *compressed, ui
             height >>= 1;
         }
 
-        /// Loop through and decompress!
+        /// Find the levels that are really compressed
         width = compressed->GetWidth();
         height = compressed->GetHeight();
         for( i = 0; i < uncompressed->GetNumLevels(); i++ )
         {
-            uncompressed->SetCurrLevel( i );
-            compressed->SetCurrLevel( i );
-
             if( ( width | height ) & 0x03 )
                 break;
 
-            UncompressMipmap( uncompressed, compressed, flags );
-
             if( width > 1 )
                 width >>= 1;
             if( height > 1 )
                 height >>= 1;
         }
+        numCompLevels = i;
+
+        /// Loop through and decompress! 32-bit output does them all in one
+        /// go, so that it can spread them across threads
+        if( uncompressed->fUncompressedInfo.fType == plMipmap::UncompressedInfo::kRGB8888 )
+            IUncompressLevelsTo32( uncompressed, compressed, 0, numCompLevels );
+        else
+        {
+            for( i = 0; i < numCompLevels; i++ )
+            {
+                uncompressed->SetCurrLevel( i );
+                compressed->SetCurrLevel( i );
+
+                UncompressMipmap( uncompressed, compressed, flags );
+            }
+        }
 
         /// Now loop through the *rest* and just copy (they won't be compressed)
         for( ; i < uncompressed->GetNumLevels(); i++ )
@@ -520,10 +586,7 @@ void    hsDXTSoftwareCodec::UncompressMipmap( plMipmap *destBMap, plMipmap *srcB
     if( destBMap->fUncompressedInfo.fType == plMipmap::UncompressedInfo::kRGB8888 )
     {
         /// 32-bit ARGB - Can be either DXT5 or DXT1
-        if( srcBMap->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT5 )
-            IUncompressMipmapDXT5To32( destBMap, srcBMap );
-        else if( srcBMap->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT1 )
-            IUncompressMipmapDXT1To32( destBMap, srcBMap );
+        IUncompressLevelsTo32( destBMap, srcBMap, srcBMap->GetCurrLevel(), 1 );
     }
     else if( destBMap->fUncompressedInfo.fType == plMipmap::UncompressedInfo::kRGB1555 )
     {
@@ -873,169 +936,172 @@ void    hsDXTSoftwareCodec::IUncompressMipmapDXT5To16Weird( plMipmap *destBMap,
     }
 }
 
-//// IUncompressMipmapDXT5To32 ////////////////////////////////////////////////
-//
-//  UncompressBitmap internal call for DXT5 compression. DXT5 is 3-bit linear
-//  interpolated alpha channel compression. Output is a 32-bit ARGB 8888 bitmap.
+//// IUncompressLevelsTo32 ////////////////////////////////////////////////////
 //
-//  7.31.2000 - M.Burrack - Created, based on old code (uncredited)
+//  UncompressBitmap internal call for DXT1 and DXT5 compression. Output is a
+//  32-bit ARGB 8888 bitmap. Does a run of levels at once, so that big mipmaps
+//  can be split up across threads by rows of blocks.
 //
-//  8.14.2000 - M.Burrack - Optimized on the alpha blending. Now we precalc
-//                          the divided values and run a for loop. This gets
-//                          us only about 10% :(
+//  Replaces IUncompressMipmapDXT1To32 and IUncompressMipmapDXT5To32, which
+//  did one level at a time. The palettes are built the same way they did it,
+//  so the output is unchanged.
 
-void    hsDXTSoftwareCodec::IUncompressMipmapDXT5To32( plMipmap *destBMap, plMipmap *srcBMap )
+void    hsDXTSoftwareCodec::IUncompressLevelsTo32( plMipmap *destBMap, plMipmap *srcBMap,
+                                                   uint8_t firstLevel, uint8_t numLevels )
 {
-    uint16_t      *srcData;
-    uint32_t      *destData, destBlock[ 16 ];
-    uint32_t      blockSize;
-    uint32_t      x, y, bMapStride;
-    uint32_t      colors[ 4 ];
-    int32_t       numBlocks, i, j;
-    uint8_t       *bytePtr;
-    uint32_t      alphas[ 8 ], aTemp, a0, a1;
-
-    uint32_t      aBitSrc1, aBitSrc2;
-    uint16_t      cBitSrc1, cBitSrc2;
-
-
-    /// Setup some nifty stuff
-    hsAssert( ( srcBMap->GetCurrWidth() & 3 ) == 0, "Bitmap width must be multiple of 4" );
-    hsAssert( ( srcBMap->GetCurrHeight() & 3 ) == 0, "Bitmap height must be multiple of 4" );
-    numBlocks = ( srcBMap->GetCurrWidth() * srcBMap->GetCurrHeight() ) >> 4;
-
-    blockSize = srcBMap->fDirectXInfo.fBlockSize >> 1; // In 16-bit words
-    srcData = (uint16_t *)srcBMap->GetCurrLevelPtr();
-    // Note our trick here to make sure nothing breaks if GetAddr32's 
-    // formula changes
-    bMapStride = (uint32_t)( destBMap->GetAddr32( 0, 1 ) - destBMap->GetAddr32( 0, 0 ) );
-    x = y = 0;
+    hsAssert( ( srcBMap->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT1 ) ||
+              ( srcBMap->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT5 ),
+              "Unsupported directX compression format." );
 
+    bool dxt1 = ( srcBMap->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT1 );
 
-    /// Loop through the # of blocks (width*height / 16-pixel-blocks)
-    for( i = 0; i < numBlocks; i++ )
+    std::vector<hsDXTBlockRows> levels;
+    for( uint8_t i = firstLevel; i < firstLevel + numLevels; i++ )
     {
-        /// Per block--determine alpha compression type first
-        bytePtr = (uint8_t *)srcData;
-        alphas[ 0 ] = bytePtr[ 0 ];
-        alphas[ 1 ] = bytePtr[ 1 ];
+        uint32_t width, height, rowBytes;
+        hsDXTBlockRows level;
+        level.fPixels = destBMap->GetLevelPtr( i, &width, &height, &rowBytes );
+        level.fRowBytes = rowBytes;
+        level.fBlocks = srcBMap->GetLevelPtr( i );
+        level.fBlockSize = srcBMap->fDirectXInfo.fBlockSize;
+        level.fBlocksWide = width >> 2;
+        level.fNumRows = height >> 2;
+
+        hsAssert( ( ( width | height ) & 3 ) == 0, "Bitmap dimensions must be multiples of 4" );
+        levels.push_back( level );
+    }
 
-        /// Note that we use the preshifted alphas really as fixed point.
-        /// The result: more accuracy, and no need to shift the alphas afterwards
-        if( alphas[ 0 ] > alphas[ 1 ] )
+    IRunBlockRows( levels, fMinThreadedBlocks, [this, dxt1]( const hsDXTBlockRows &rows )
+    {
+        const uint8_t *block = rows.fBlocks;
+        for( uint32_t y = 0; y < rows.fNumRows; y++ )
         {
-            /// 8-alpha block: interpolate 6 others
-/*          //// Here's the old code, for reference ////
-            alphas[ 2 ] = ( 6 * alphas[ 0 ] +     alphas[ 1 ] ) / 7;
-            alphas[ 3 ] = ( 5 * alphas[ 0 ] + 2 * alphas[ 1 ] ) / 7;
-            alphas[ 4 ] = ( 4 * alphas[ 0 ] + 3 * alphas[ 1 ] ) / 7;
-            alphas[ 5 ] = ( 3 * alphas[ 0 ] + 4 * alphas[ 1 ] ) / 7;
-            alphas[ 6 ] = ( 2 * alphas[ 0 ] + 5 * alphas[ 1 ] ) / 7;
-            alphas[ 7 ] = (     alphas[ 0 ] + 6 * alphas[ 1 ] ) / 7;
-*/
-            alphas[ 0 ] <<= 24;
-            alphas[ 1 ] <<= 24;
-
-            /// Note that, unlike below, we can't combine a0 and a1 into
-            /// one value, because that would give us a negative value,
-            /// and we're using unsigned values here. (i.e. we need all the bits)
-            aTemp = alphas[ 0 ];
-            a0 = ( aTemp / 7 ) & 0xff000000;
-            a1 = ( alphas[ 1 ] / 7 ) & 0xff000000;          
-            for( j = 2; j < 8; j++ )
+            uint32_t *destRow = (uint32_t *)( rows.fPixels + y * 4 * rows.fRowBytes );
+            for( uint32_t x = 0; x < rows.fBlocksWide; x++, block += rows.fBlockSize )
             {
-                aTemp += a1 - a0;
-                alphas[ j ] = aTemp;
-            }
-        }
-        else
-        {
-            /// 6-alpha block: interpolate 4 others, then assume last 2 are 0 and 255
-/*          //// Here's the old code, for reference ////
-            alphas[ 2 ] = ( 4 * alphas[ 0 ] +     alphas[ 1 ] ) / 5;
-            alphas[ 3 ] = ( 3 * alphas[ 0 ] + 2 * alphas[ 1 ] ) / 5;
-            alphas[ 4 ] = ( 2 * alphas[ 0 ] + 3 * alphas[ 1 ] ) / 5;
-            alphas[ 5 ] = (     alphas[ 0 ] + 4 * alphas[ 1 ] ) / 5;
-*/
-            alphas[ 0 ] <<= 24;
-            alphas[ 1 ] <<= 24;
+                uint32_t    colors[ 4 ];
+                uint32_t    alphas[ 8 ];
+                uint64_t    alphaBits = 0;
 
-            aTemp = alphas[ 0 ];
-            a0 = ( alphas[ 1 ] - aTemp ) / 5;
-            for( j = 2; j < 6; j++ )
-            {
-                aTemp += a0;
-                alphas[ j ] = aTemp & 0xff000000;
-            }
+                const uint16_t *colorBlock = (const uint16_t *)( dxt1 ? block : block + 8 );
+                IBuildColors32( colorBlock, dxt1, colors );
+                uint32_t colorBits = hsToLE16( colorBlock[ 2 ] ) | ( (uint32_t)hsToLE16( colorBlock[ 3 ] ) << 16 );
 
-            alphas[ 6 ] = 0;
-            alphas[ 7 ] = 255 << 24;
+                if( !dxt1 )
+                {
+                    IBuildAlphas( block, alphas );
+                    memcpy( &alphaBits, block, sizeof( alphaBits ) );
+                    alphaBits = hsToLE64( alphaBits ) >> 16;
+                }
+
+                decode_block.call( colors, colorBits, dxt1 ? nullptr : alphas, alphaBits,
+                                   destRow + x * 4, rows.fRowBytes >> 2 );
+            }
         }
+    } );
+}
 
-        /// Now do the 16 pixels in 2 blocks, decompressing 3-bit lookups
-        aBitSrc1 = ( (uint32_t)bytePtr[ 4 ] << 16 ) + 
-                    ( (uint32_t)bytePtr[ 3 ] << 8 ) + 
-                    ( (uint32_t)bytePtr[ 2 ] );
-        aBitSrc2 = ( (uint32_t)bytePtr[ 7 ] << 16 ) + 
-                    ( (uint32_t)bytePtr[ 6 ] << 8 ) + 
-                    ( (uint32_t)bytePtr[ 5 ] );
+//// IBuildColors32 ///////////////////////////////////////////////////////////
+//  Builds the four ARGB 8888 colors a DXT color block's indices pick from.
+//  DXT1 colors are opaque, and DXT1 blocks whose first color isn't the
+//  bigger one only have three, plus transparent black. DXT5 colors have no
+//  alpha; it comes from the alpha block.
 
-        /// Now decompress color data
-        srcData += 4;       // Alpha was 4 16-bit words worth
-        //hsAssert( srcData[ 0 ] > srcData[ 1 ], "Invalid block compression for DX5 method" );  /// If not, then it's one-bit
-                                                /// alpha, but this is DX5!
-        colors[ 0 ] = IRGB16To32Bit( srcData[ 0 ] );
-        colors[ 1 ] = IRGB16To32Bit( srcData[ 1 ] );
+void    hsDXTSoftwareCodec::IBuildColors32( const uint16_t *colorBlock, bool dxt1, uint32_t *colors )
+{
+    colors[ 0 ] = IRGB16To32Bit( colorBlock[ 0 ] );
+    colors[ 1 ] = IRGB16To32Bit( colorBlock[ 1 ] );
+
+    if( !dxt1 )
+    {
         colors[ 2 ] = IMixTwoThirdsRGB32( colors[ 0 ], colors[ 1 ] );
         colors[ 3 ] = IMixTwoThirdsRGB32( colors[ 1 ], colors[ 0 ] );
-        
-        cBitSrc1 = hsToLE16( srcData[ 2 ] );
-        cBitSrc2 = hsToLE16( srcData[ 3 ] );
-        
-        for( j = 0; j < 8; j++ )
-        {
-            destBlock[ j ] = alphas[ aBitSrc1 & 0x07 ] | colors[ cBitSrc1 & 0x03 ];
-            aBitSrc1 >>= 3;
-            cBitSrc1 >>= 2;
-            destBlock[ j + 8 ] = alphas[ aBitSrc2 & 0x07 ] | colors[ cBitSrc2 & 0x03 ];
-            aBitSrc2 >>= 3;
-            cBitSrc2 >>= 2;
+    }
+    else if( hsToLE16( colorBlock[ 0 ] ) > hsToLE16( colorBlock[ 1 ] ) )
+    {
+        /// Four-color block--mix the other two
+        colors[ 2 ] = IMixTwoThirdsRGB32( colors[ 0 ], colors[ 1 ] ) | 0xff000000;
+        colors[ 3 ] = IMixTwoThirdsRGB32( colors[ 1 ], colors[ 0 ] ) | 0xff000000;
+        colors[ 0 ] |= 0xff000000;
+        colors[ 1 ] |= 0xff000000;
+    }
+    else
+    {
+        /// Three-color block and transparent
+        colors[ 2 ] = IMixEqualRGB32( colors[ 0 ], colors[ 1 ] ) | 0xff000000;
+        colors[ 3 ] = 0;
+        colors[ 0 ] |= 0xff000000;
+        colors[ 1 ] |= 0xff000000;
+    }
+}
+
+//// IBuildAlphas /////////////////////////////////////////////////////////////
+//  Builds the eight alphas a DXT5 alpha block's indices pick from, already
+//  shifted up into place.
+//
+//  8.14.2000 - M.Burrack - Optimized on the alpha blending. Now we precalc
+//                          the divided values and run a for loop. This gets
+//                          us only about 10% :(
+
+void    hsDXTSoftwareCodec::IBuildAlphas( const uint8_t *alphaBlock, uint32_t *alphas )
+{
+    uint32_t    aTemp, a0, a1;
+    int32_t     j;
+
 
-            destBlock[ j ] = hsToLE32( destBlock[ j ] );
-            destBlock[ j + 8 ] = hsToLE32( destBlock[ j + 8 ] );
+    alphas[ 0 ] = alphaBlock[ 0 ];
+    alphas[ 1 ] = alphaBlock[ 1 ];
+
+    /// Note that we use the preshifted alphas really as fixed point.
+    /// The result: more accuracy, and no need to shift the alphas afterwards
+    if( alphas[ 0 ] > alphas[ 1 ] )
+    {
+        /// 8-alpha block: interpolate 6 others
+/*      //// Here's the old code, for reference ////
+        alphas[ 2 ] = ( 6 * alphas[ 0 ] +     alphas[ 1 ] ) / 7;
+        alphas[ 3 ] = ( 5 * alphas[ 0 ] + 2 * alphas[ 1 ] ) / 7;
+        alphas[ 4 ] = ( 4 * alphas[ 0 ] + 3 * alphas[ 1 ] ) / 7;
+        alphas[ 5 ] = ( 3 * alphas[ 0 ] + 4 * alphas[ 1 ] ) / 7;
+        alphas[ 6 ] = ( 2 * alphas[ 0 ] + 5 * alphas[ 1 ] ) / 7;
+        alphas[ 7 ] = (     alphas[ 0 ] + 6 * alphas[ 1 ] ) / 7;
+*/
+        alphas[ 0 ] <<= 24;
+        alphas[ 1 ] <<= 24;
+
+        /// Note that, unlike below, we can't combine a0 and a1 into
+        /// one value, because that would give us a negative value,
+        /// and we're using unsigned values here. (i.e. we need all the bits)
+        aTemp = alphas[ 0 ];
+        a0 = ( aTemp / 7 ) & 0xff000000;
+        a1 = ( alphas[ 1 ] / 7 ) & 0xff000000;
+        for( j = 2; j < 8; j++ )
+        {
+            aTemp += a1 - a0;
+            alphas[ j ] = aTemp;
         }
-        
-        /// Now copy the block to the destination bitmap
-        /// (Trust me, this is actually *faster* than memcpy for some reason
-        destData = destBMap->GetAddr32( x, y );
-        destData[ 0 ] = destBlock[ 0 ];
-        destData[ 1 ] = destBlock[ 1 ];
-        destData[ 2 ] = destBlock[ 2 ];
-        destData[ 3 ] = destBlock[ 3 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 4 ];
-        destData[ 1 ] = destBlock[ 5 ];
-        destData[ 2 ] = destBlock[ 6 ];
-        destData[ 3 ] = destBlock[ 7 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 8 ];
-        destData[ 1 ] = destBlock[ 9 ];
-        destData[ 2 ] = destBlock[ 10 ];
-        destData[ 3 ] = destBlock[ 11 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 12 ];
-        destData[ 1 ] = destBlock[ 13 ];
-        destData[ 2 ] = destBlock[ 14 ];
-        destData[ 3 ] = destBlock[ 15 ];
+    }
+    else
+    {
+        /// 6-alpha block: interpolate 4 others, then assume last 2 are 0 and 255
+/*      //// Here's the old code, for reference ////
+        alphas[ 2 ] = ( 4 * alphas[ 0 ] +     alphas[ 1 ] ) / 5;
+        alphas[ 3 ] = ( 3 * alphas[ 0 ] + 2 * alphas[ 1 ] ) / 5;
+        alphas[ 4 ] = ( 2 * alphas[ 0 ] + 3 * alphas[ 1 ] ) / 5;
+        alphas[ 5 ] = (     alphas[ 0 ] + 4 * alphas[ 1 ] ) / 5;
+*/
+        alphas[ 0 ] <<= 24;
+        alphas[ 1 ] <<= 24;
 
-        /// Increment and loop!
-        srcData += blockSize - 4;       /// JUUUST in case our block size is diff
-        x += 4;
-        if( x == srcBMap->GetCurrWidth() )
+        aTemp = alphas[ 0 ];
+        a0 = ( alphas[ 1 ] - aTemp ) / 5;
+        for( j = 2; j < 6; j++ )
         {
-            x = 0;
-            y += 4;
+            aTemp += a0;
+            alphas[ j ] = aTemp & 0xff000000;
         }
+
+        alphas[ 6 ] = 0;
+        alphas[ 7 ] = 0xff000000;
     }
 }
 
@@ -1389,21 +1455,20 @@ void    hsDXTSoftwareCodec::IUncompressMipmapDXT1To16Weird( plMipmap *destBMap,
     }
 }
 
-//// IUncompressMipmapDXT1To32 ////////////////////////////////////////////////
+//// IUncompressMipmapDXT1ToInten /////////////////////////////////////////////
 //
 //  UncompressBitmap internal call for DXT1 compression. DXT1 is a simple on/off
-//  or all-on alpha 'compression'. Output is a 32-bit ARGB 8888 bitmap.
-//
-//  7.31.2000 - M.Burrack - Created, based on old code (uncredited)
+//  or all-on alpha 'compression'. Output is an 8-bit intensity bitmap, 
+//  constructed from the blue-color channel of the DXT1 output.
 
-void    hsDXTSoftwareCodec::IUncompressMipmapDXT1To32( plMipmap *destBMap, 
+void    hsDXTSoftwareCodec::IUncompressMipmapDXT1ToInten( plMipmap *destBMap, 
                                                    plMipmap *srcBMap )
 {
     uint16_t      *srcData, tempW1, tempW2;
-    uint32_t      *destData, destBlock[ 16 ];
+    uint8_t       *destData, destBlock[ 16 ];
     uint32_t      blockSize;
     uint32_t      bitSource, bitSource2, x, y, bMapStride;
-    uint32_t      colors[ 4 ];
+    uint8_t       colors[ 4 ];
     int32_t       numBlocks, i, j;
 
 
@@ -1414,18 +1479,17 @@ void    hsDXTSoftwareCodec::IUncompressMipmapDXT1To32( plMipmap *destBMap,
 
     blockSize = srcBMap->fDirectXInfo.fBlockSize >> 1; // In 16-bit words
     srcData = (uint16_t *)srcBMap->GetCurrLevelPtr();
-    // Note our trick here to make sure nothing breaks if GetAddr32's 
+    // Note our trick here to make sure nothing breaks if GetAddr8's 
     // formula changes
-    bMapStride = (uint32_t)( destBMap->GetAddr32( 0, 1 ) - destBMap->GetAddr32( 0, 0 ) );
+    bMapStride = (uint32_t)( destBMap->GetAddr8( 0, 1 ) - destBMap->GetAddr8( 0, 0 ) );
     x = y = 0;
 
-
     /// Loop through the # of blocks (width*height / 16-pixel-blocks)
     for( i = 0; i < numBlocks; i++ )
     {
-        /// Decompress color data block
-        colors[ 0 ] = IRGB16To32Bit( srcData[ 0 ] ) | 0xff000000;
-        colors[ 1 ] = IRGB16To32Bit( srcData[ 1 ] ) | 0xff000000;
+        /// Decompress color data block (cast will automatically truncate to blue)
+        colors[ 0 ] = (uint8_t)IRGB16To32Bit( srcData[ 0 ] );
+        colors[ 1 ] = (uint8_t)IRGB16To32Bit( srcData[ 1 ] );
 
         tempW1 = hsToLE16( srcData[ 0 ] );
         tempW2 = hsToLE16( srcData[ 1 ] );
@@ -1433,13 +1497,13 @@ void    hsDXTSoftwareCodec::IUncompressMipmapDXT1To32( plMipmap *destBMap,
         if( tempW1 > tempW2 )
         {
             /// Four-color block--mix the other two
-            colors[ 2 ] = IMixTwoThirdsRGB32( colors[ 0 ], colors[ 1 ] ) | 0xff000000;
-            colors[ 3 ] = IMixTwoThirdsRGB32( colors[ 1 ], colors[ 0 ] ) | 0xff000000;
+            colors[ 2 ] = IMixTwoThirdsInten( colors[ 0 ], colors[ 1 ] );
+            colors[ 3 ] = IMixTwoThirdsInten( colors[ 1 ], colors[ 0 ] );
         }
         else
         {
             /// Three-color block and transparent
-            colors[ 2 ] = IMixEqualRGB32( colors[ 0 ], colors[ 1 ] ) | 0xff000000;
+            colors[ 2 ] = IMixEqualInten( colors[ 0 ], colors[ 1 ] );
             colors[ 3 ] = 0;
         }
 
@@ -1452,14 +1516,11 @@ void    hsDXTSoftwareCodec::IUncompressMipmapDXT1To32( plMipmap *destBMap,
             bitSource >>= 2;
             destBlock[ j + 8 ] = colors[ bitSource2 & 0x03 ];
             bitSource2 >>= 2;
-
-            destBlock[ j ] = hsToLE32( destBlock[ j ] );
-            destBlock[ j + 8 ] = hsToLE32( destBlock[ j + 8 ] );
         }
         
         /// Now copy the block to the destination bitmap
         /// (Trust me, this is actually *faster* than memcpy for some reason
-        destData = destBMap->GetAddr32( x, y );
+        destData = destBMap->GetAddr8( x, y );
         destData[ 0 ] = destBlock[ 0 ];
         destData[ 1 ] = destBlock[ 1 ];
         destData[ 2 ] = destBlock[ 2 ];
@@ -1491,135 +1552,38 @@ void    hsDXTSoftwareCodec::IUncompressMipmapDXT1To32( plMipmap *destBMap,
     }
 }
 
-//// IUncompressMipmapDXT1ToInten /////////////////////////////////////////////
+//// IRGB16To32Bit ////////////////////////////////////////////////////////////
+//
+//  Converts a RGB565 16-bit color into a RGB888 32-bit color. Alpha (upper 8
+//  bits) is 0. Will be optimized LATER.
 //
-//  UncompressBitmap internal call for DXT1 compression. DXT1 is a simple on/off
-//  or all-on alpha 'compression'. Output is an 8-bit intensity bitmap, 
-//  constructed from the blue-color channel of the DXT1 output.
 
-void    hsDXTSoftwareCodec::IUncompressMipmapDXT1ToInten( plMipmap *destBMap, 
-                                                   plMipmap *srcBMap )
+uint32_t  hsDXTSoftwareCodec::IRGB16To32Bit( uint16_t color )
 {
-    uint16_t      *srcData, tempW1, tempW2;
-    uint8_t       *destData, destBlock[ 16 ];
-    uint32_t      blockSize;
-    uint32_t      bitSource, bitSource2, x, y, bMapStride;
-    uint8_t       colors[ 4 ];
-    int32_t       numBlocks, i, j;
+    uint32_t      r, g, b;
 
+    color = hsToLE16(color);
+    
+    b = ( color & 31 ) << 3;
+    color >>= 5;
 
-    /// Setup some nifty stuff
-    hsAssert( ( srcBMap->GetCurrWidth() & 3 ) == 0, "Bitmap width must be multiple of 4" );
-    hsAssert( ( srcBMap->GetCurrHeight() & 3 ) == 0, "Bitmap height must be multiple of 4" );
-    numBlocks = ( srcBMap->GetCurrWidth() * srcBMap->GetCurrHeight() ) >> 4;
+    g = ( color & 63 ) << ( 2 + 8 );
+    color >>= 6;
+    
+    r = ( color & 31 ) << ( 3 + 16 );
 
-    blockSize = srcBMap->fDirectXInfo.fBlockSize >> 1; // In 16-bit words
-    srcData = (uint16_t *)srcBMap->GetCurrLevelPtr();
-    // Note our trick here to make sure nothing breaks if GetAddr8's 
-    // formula changes
-    bMapStride = (uint32_t)( destBMap->GetAddr8( 0, 1 ) - destBMap->GetAddr8( 0, 0 ) );
-    x = y = 0;
+    return( r + g + b );
+}
 
-    /// Loop through the # of blocks (width*height / 16-pixel-blocks)
-    for( i = 0; i < numBlocks; i++ )
-    {
-        /// Decompress color data block (cast will automatically truncate to blue)
-        colors[ 0 ] = (uint8_t)IRGB16To32Bit( srcData[ 0 ] );
-        colors[ 1 ] = (uint8_t)IRGB16To32Bit( srcData[ 1 ] );
+//// IRGB565To4444 ////////////////////////////////////////////////////////////
+//
+//  Converts a RGB565 16-bit color into a RGB4444 16-bit color. Alpha (upper 8
+//  bits) is 0.
+//
 
-        tempW1 = hsToLE16( srcData[ 0 ] );
-        tempW2 = hsToLE16( srcData[ 1 ] );
-
-        if( tempW1 > tempW2 )
-        {
-            /// Four-color block--mix the other two
-            colors[ 2 ] = IMixTwoThirdsInten( colors[ 0 ], colors[ 1 ] );
-            colors[ 3 ] = IMixTwoThirdsInten( colors[ 1 ], colors[ 0 ] );
-        }
-        else
-        {
-            /// Three-color block and transparent
-            colors[ 2 ] = IMixEqualInten( colors[ 0 ], colors[ 1 ] );
-            colors[ 3 ] = 0;
-        }
-
-        bitSource = hsToLE16( srcData[ 2 ] );
-        bitSource2 = hsToLE16( srcData[ 3 ] );
-
-        for( j = 0; j < 8; j++ )
-        {
-            destBlock[ j ] = colors[ bitSource & 0x03 ];
-            bitSource >>= 2;
-            destBlock[ j + 8 ] = colors[ bitSource2 & 0x03 ];
-            bitSource2 >>= 2;
-        }
-        
-        /// Now copy the block to the destination bitmap
-        /// (Trust me, this is actually *faster* than memcpy for some reason
-        destData = destBMap->GetAddr8( x, y );
-        destData[ 0 ] = destBlock[ 0 ];
-        destData[ 1 ] = destBlock[ 1 ];
-        destData[ 2 ] = destBlock[ 2 ];
-        destData[ 3 ] = destBlock[ 3 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 4 ];
-        destData[ 1 ] = destBlock[ 5 ];
-        destData[ 2 ] = destBlock[ 6 ];
-        destData[ 3 ] = destBlock[ 7 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 8 ];
-        destData[ 1 ] = destBlock[ 9 ];
-        destData[ 2 ] = destBlock[ 10 ];
-        destData[ 3 ] = destBlock[ 11 ];
-        destData += bMapStride;
-        destData[ 0 ] = destBlock[ 12 ];
-        destData[ 1 ] = destBlock[ 13 ];
-        destData[ 2 ] = destBlock[ 14 ];
-        destData[ 3 ] = destBlock[ 15 ];
-
-        /// Increment and loop!
-        srcData += blockSize;
-        x += 4;
-        if( x == srcBMap->GetCurrWidth() )
-        {
-            x = 0;
-            y += 4;
-        }
-    }
-}
-
-//// IRGB16To32Bit ////////////////////////////////////////////////////////////
-//
-//  Converts a RGB565 16-bit color into a RGB888 32-bit color. Alpha (upper 8
-//  bits) is 0. Will be optimized LATER.
-//
-
-uint32_t  hsDXTSoftwareCodec::IRGB16To32Bit( uint16_t color )
-{
-    uint32_t      r, g, b;
-
-    color = hsToLE16(color);
-    
-    b = ( color & 31 ) << 3;
-    color >>= 5;
-
-    g = ( color & 63 ) << ( 2 + 8 );
-    color >>= 6;
-    
-    r = ( color & 31 ) << ( 3 + 16 );
-
-    return( r + g + b );
-}
-
-//// IRGB565To4444 ////////////////////////////////////////////////////////////
-//
-//  Converts a RGB565 16-bit color into a RGB4444 16-bit color. Alpha (upper 8
-//  bits) is 0.
-//
-
-uint16_t  hsDXTSoftwareCodec::IRGB565To4444( uint16_t color )
-{
-    uint16_t      r, g, b;
+uint16_t  hsDXTSoftwareCodec::IRGB565To4444( uint16_t color )
+{
+    uint16_t      r, g, b;
 
     color = hsToLE16( color );
     
@@ -1925,354 +1889,561 @@ uint8_t   hsDXTSoftwareCodec::IMixEqualInten( uint8_t color1, uint8_t color2 )
 
 
 
-void hsDXTSoftwareCodec::CompressMipmapLevel( plMipmap *uncompressed, plMipmap *compressed )
+//// ICompressLevels //////////////////////////////////////////////////////////
+//  Compresses the first numLevels levels of the mipmap, splitting big ones
+//  up across threads by rows of blocks.
+
+void hsDXTSoftwareCodec::ICompressLevels( plMipmap *uncompressed, plMipmap *compressed, uint8_t numLevels )
 {
-    uint32_t *compressedImage = (uint32_t *)compressed->GetCurrLevelPtr();
-    int32_t x, y;
-    int32_t xMax = uncompressed->GetCurrWidth() >> 2;
-    int32_t yMax = uncompressed->GetCurrHeight() >> 2;
-    for (x = 0; x < xMax; ++x)
+    uint8_t format = compressed->fDirectXInfo.fCompressionType;
+    CompressionQuality quality = fQuality;
+
+    hsAssert( ( format == plMipmap::DirectXInfo::kDXT1 ) || ( format == plMipmap::DirectXInfo::kDXT5 ),
+              "Unrecognized compression scheme." );
+
+    std::vector<hsDXTBlockRows> levels;
+    for( uint8_t i = 0; i < numLevels; i++ )
     {
-        for (y = 0; y < yMax; ++y)
-        {
-            uint8_t maxAlpha = 0;
-            uint8_t minAlpha = 255;
-            uint8_t oldMaxAlpha = 0;
-            uint8_t oldMinAlpha = 255;
-            uint8_t alpha[8];
-            int32_t maxDistance = 0;
-            hsRGBAColor32 color[4];
-            bool hasTransparency = false;
+        uint32_t width, height, rowBytes;
+        hsDXTBlockRows level;
+        level.fPixels = uncompressed->GetLevelPtr( i, &width, &height, &rowBytes );
+        level.fRowBytes = rowBytes;
+        level.fBlocks = compressed->GetLevelPtr( i );
+        level.fBlockSize = compressed->fDirectXInfo.fBlockSize;
+        level.fBlocksWide = width >> 2;
+        level.fNumRows = height >> 2;
+        levels.push_back( level );
+    }
 
-            int32_t xx, yy;
-            for (xx = 0; xx < 4; ++xx)
+    IRunBlockRows( levels, fMinThreadedBlocks, [format, quality]( const hsDXTBlockRows &rows )
+    {
+        uint8_t *block = rows.fBlocks;
+        for( uint32_t y = 0; y < rows.fNumRows; y++ )
+        {
+            const uint8_t *srcRow = rows.fPixels + y * 4 * rows.fRowBytes;
+            for( uint32_t x = 0; x < rows.fBlocksWide; x++, block += rows.fBlockSize )
             {
-                for (yy = 0; yy < 4; ++yy)
-                {
-                    hsRGBAColor32* pixel = (hsRGBAColor32*)uncompressed->GetAddr32(4 * x + xx, 4 * y + yy);
-                    uint8_t pixelAlpha = pixel->a;
-                    if (pixelAlpha != 255)
-                    {
-                        hasTransparency = true;
-                    }
+                uint32_t pixels[ 16 ];
+                for( uint32_t yy = 0; yy < 4; yy++ )
+                    memcpy( &pixels[ yy * 4 ], srcRow + yy * rows.fRowBytes + x * 16, 16 );
+                for( uint32_t i = 0; i < 16; i++ )
+                    pixels[ i ] = hsToLE32( pixels[ i ] );
 
-                    if (compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT5)
-                    {
-                        if (pixelAlpha > maxAlpha)
-                        {
-                            maxAlpha = pixelAlpha;
-                        }
-                        
-                        if ((pixelAlpha > oldMaxAlpha) && (pixelAlpha < 255))
-                        {
-                            oldMaxAlpha = pixelAlpha;
-                        }
+                IEncodeBlock( pixels, block, format, quality );
+            }
+        }
+    } );
+}
 
-                        if (pixelAlpha < minAlpha)
-                        {
-                            minAlpha = pixelAlpha;
-                        }
+//// Encoding Helpers /////////////////////////////////////////////////////////
+//  The encoder targets the palettes the hardware builds, which expand 565
+//  colors by replicating their top bits, and round the mixed colors and
+//  alphas rather than truncating them.
 
-                        if ((pixelAlpha < oldMinAlpha) && (pixelAlpha > 0))
-                        {
-                            oldMinAlpha = minAlpha;
-                        }
-                    }
-                    
-                    int32_t xx2, yy2;
-                    for (xx2 = 0; xx2 < 4; ++xx2)
-                    {
-                        for (yy2 = 0; yy2 < 4; ++yy2)
-                        {
-                            hsRGBAColor32* pixel1 = (hsRGBAColor32*)uncompressed->GetAddr32(4 * x + xx, 4 * y + yy);
-                            hsRGBAColor32* pixel2 = (hsRGBAColor32*)uncompressed->GetAddr32(4 * x + xx2, 4 * y + yy2);
-                            
-                            int32_t distance = ColorDistanceARGBSquared(*pixel1, *pixel2);
-                            if (distance >= maxDistance)
-                            {
-                                maxDistance = distance;
-                                color[0] = *pixel1;
-                                color[1] = *pixel2;
-                            }
-                        } // for yy2
-                    } // for xx2
-                } // for yy
-            } // for xx
-            
-            if (oldMinAlpha == 255)
-            {
-                hsAssert(oldMaxAlpha == 0, "Weirdness in oldMaxAlpha hsDXTSoftwareCodec::CompressBitmap.");
-                oldMinAlpha = 0;
-                oldMaxAlpha = 255;
-            }
+static inline uint32_t IExpand565( uint16_t color )
+{
+    uint32_t r = ( color >> 11 ) & 0x1f;
+    uint32_t g = ( color >> 5 ) & 0x3f;
+    uint32_t b = color & 0x1f;
 
-            if (compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT5)
-            {
-                if ((maxAlpha == 255) && (minAlpha == 0))
-                {
-                    hsAssert(oldMinAlpha <= oldMaxAlpha, "Min > Max in hsDXTSoftwareCodec::CompressBitmap 1.");
-                    alpha[0] = oldMinAlpha;
-                    alpha[1] = oldMaxAlpha;
-                    alpha[2] = (4 * alpha[0] + alpha[1]) / 5;      // Bit code 010
-                    alpha[3] = (3 * alpha[0] + 2 * alpha[1]) / 5;  // Bit code 011    
-                    alpha[4] = (2 * alpha[0] + 3 * alpha[1]) / 5;  // Bit code 100    
-                    alpha[5] = (alpha[0] + 4 * alpha[1]) / 5;      // Bit code 101
-                    alpha[6] = 0;                                // Bit code 110
-                    alpha[7] = 255;                              // Bit code 111
-                }
-                else if (maxAlpha == minAlpha)
-                {
-                    alpha[0] = minAlpha;
-                    alpha[1] = maxAlpha;
-                    alpha[2] = (4 * alpha[0] + alpha[1]) / 5;      // Bit code 010
-                    alpha[3] = (3 * alpha[0] + 2 * alpha[1]) / 5;  // Bit code 011    
-                    alpha[4] = (2 * alpha[0] + 3 * alpha[1]) / 5;  // Bit code 100    
-                    alpha[5] = (alpha[0] + 4 * alpha[1]) / 5;      // Bit code 101
-                    alpha[6] = 0;                                // Bit code 110
-                    alpha[7] = 255;                              // Bit code 111
-                }
-                else
-                {
-                    hsAssert(minAlpha < maxAlpha, "Min => Max in hsDXTSoftwareCodec::CompressBitmap 3.");
-                    alpha[0] = maxAlpha;
-                    alpha[1] = minAlpha;
-                    alpha[2] = (6 * alpha[0] + alpha[1]) / 7;      // bit code 010
-                    alpha[3] = (5 * alpha[0] + 2 * alpha[1]) / 7;  // Bit code 011    
-                    alpha[4] = (4 * alpha[0] + 3 * alpha[1]) / 7;  // Bit code 100    
-                    alpha[5] = (3 * alpha[0] + 4 * alpha[1]) / 7;  // Bit code 101
-                    alpha[6] = (2 * alpha[0] + 5 * alpha[1]) / 7;  // Bit code 110    
-                    alpha[7] = (alpha[0] + 6 * alpha[1]) / 7;      // Bit code 111
-                }
-            }
-            
-            uint32_t encoding;
-            uint16_t shortColor[2];
-            shortColor[0] = Color32To16(color[0]);
-            shortColor[1] = Color32To16(color[1]);
-            if ((shortColor[0] == shortColor[1]) ||
-                ((compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT1) &&
-                hasTransparency))
-            {
-                encoding = kThreeColorEncoding;
+    r = ( r << 3 ) | ( r >> 2 );
+    g = ( g << 2 ) | ( g >> 4 );
+    b = ( b << 3 ) | ( b >> 2 );
 
-                if (shortColor[0] > shortColor[1])
-                {
-                    uint16_t temp = shortColor[1];
-                    shortColor[1] = shortColor[0];
-                    shortColor[0] = temp;
-                    
-                    hsRGBAColor32 temp32 = color[1];
-                    color[1] = color[0];
-                    color[0] = temp32;
-                }
+    return ( r << 16 ) | ( g << 8 ) | b;
+}
 
-                color[2] = BlendColors32(1, color[0], 1, color[1]);
+static inline uint16_t IQuantize565( const float *rgb )
+{
+    int r = (int)( std::min( std::max( rgb[ 0 ], 0.f ), 255.f ) * ( 31.f / 255.f ) + 0.5f );
+    int g = (int)( std::min( std::max( rgb[ 1 ], 0.f ), 255.f ) * ( 63.f / 255.f ) + 0.5f );
+    int b = (int)( std::min( std::max( rgb[ 2 ], 0.f ), 255.f ) * ( 31.f / 255.f ) + 0.5f );
 
-                hsRGBAColor32 black;
-                black.Set(0, 0, 0, 0);
+    return (uint16_t)( ( r << 11 ) | ( g << 5 ) | b );
+}
 
-                color[3] = black;
-            }
-            else
-            {
-                encoding = kFourColorEncoding;
+static inline uint32_t IMixColors( uint32_t color1, uint32_t weight1, uint32_t color2, uint32_t weight2 )
+{
+    uint32_t total = weight1 + weight2;
+    uint32_t result = 0;
+    for( int shift = 0; shift < 24; shift += 8 )
+    {
+        uint32_t c = ( ( ( color1 >> shift ) & 0xff ) * weight1 + ( ( color2 >> shift ) & 0xff ) * weight2
+                       + total / 2 ) / total;
+        result |= c << shift;
+    }
+    return result;
+}
 
-                if (shortColor[0] < shortColor[1])
-                {
-                    uint16_t temp = shortColor[1];
-                    shortColor[1] = shortColor[0];
-                    shortColor[0] = temp;
-                    
-                    hsRGBAColor32 temp32 = color[1];
-                    color[1] = color[0];
-                    color[0] = temp32;
-                }
+static inline void IUnpackRGB( uint32_t pixel, float *rgb )
+{
+    rgb[ 0 ] = (float)( ( pixel >> 16 ) & 0xff );
+    rgb[ 1 ] = (float)( ( pixel >> 8 ) & 0xff );
+    rgb[ 2 ] = (float)( pixel & 0xff );
+}
 
-                color[2] = BlendColors32(2, color[0], 1, color[1]);
-                color[3] = BlendColors32(1, color[0], 2, color[1]);
-            }
-            
-            // Process each pixel in block
-            uint32_t blockSize = compressed->fDirectXInfo.fBlockSize;
-            uint32_t *block = &compressedImage[(x + xMax * y) * (blockSize >> 2)];
-            uint8_t *byteBlock = (uint8_t *)block;
-            uint8_t *alphaBlock = nullptr;
-            uint16_t *colorBlock = nullptr;
-            if (compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT5)
-            {
-                alphaBlock = byteBlock;
-                colorBlock = (uint16_t *)(byteBlock + 8);
-                alphaBlock[0] = 0;
-                alphaBlock[1] = 0;
-                alphaBlock[2] = 0;
-                alphaBlock[3] = 0;
-                alphaBlock[4] = 0;
-                alphaBlock[5] = 0;
-                alphaBlock[6] = 0;
-                alphaBlock[7] = 0;
-            }
-            else if (compressed->fDirectXInfo.fCompressionType == plMipmap::DirectXInfo::kDXT1)
-            {
-                alphaBlock = nullptr;
-                colorBlock = (uint16_t *)(byteBlock);
-            }
-            else
+//// IBoxEndpoints ////////////////////////////////////////////////////////////
+//  Cheapest endpoints: the corners of the colors' bounding box, inset a bit,
+//  with the red and blue ends swapped if they run against green.
+
+static void IBoxEndpoints( const float (*colors)[ 3 ], uint32_t numColors, float *end0, float *end1 )
+{
+    float lo[ 3 ] = { 255.f, 255.f, 255.f };
+    float hi[ 3 ] = { 0.f, 0.f, 0.f };
+    float sum[ 3 ] = { 0.f, 0.f, 0.f };
+    float sumRG = 0.f, sumBG = 0.f;
+
+    for( uint32_t i = 0; i < numColors; i++ )
+    {
+        for( int c = 0; c < 3; c++ )
+        {
+            lo[ c ] = std::min( lo[ c ], colors[ i ][ c ] );
+            hi[ c ] = std::max( hi[ c ], colors[ i ][ c ] );
+            sum[ c ] += colors[ i ][ c ];
+        }
+        sumRG += colors[ i ][ 0 ] * colors[ i ][ 1 ];
+        sumBG += colors[ i ][ 2 ] * colors[ i ][ 1 ];
+    }
+
+    for( int c = 0; c < 3; c++ )
+    {
+        float inset = ( hi[ c ] - lo[ c ] ) / 16.f;
+        end0[ c ] = hi[ c ] - inset;
+        end1[ c ] = lo[ c ] + inset;
+    }
+
+    if( sumRG * numColors < sum[ 0 ] * sum[ 1 ] )
+        std::swap( end0[ 0 ], end1[ 0 ] );
+    if( sumBG * numColors < sum[ 2 ] * sum[ 1 ] )
+        std::swap( end0[ 2 ], end1[ 2 ] );
+}
+
+//// IAxisEndpoints ///////////////////////////////////////////////////////////
+//  Finds the direction the colors vary the most in (by power iteration on
+//  their covariance), and puts the endpoints on the line through their mean
+//  in that direction.
+
+static void IAxisEndpoints( const float (*colors)[ 3 ], uint32_t numColors, float *end0, float *end1 )
+{
+    float mean[ 3 ] = { 0.f, 0.f, 0.f };
+    for( uint32_t i = 0; i < numColors; i++ )
+    {
+        for( int c = 0; c < 3; c++ )
+            mean[ c ] += colors[ i ][ c ];
+    }
+    for( int c = 0; c < 3; c++ )
+        mean[ c ] /= numColors;
+
+    float cov[ 3 ][ 3 ] = {};
+    for( uint32_t i = 0; i < numColors; i++ )
+    {
+        float d[ 3 ] = { colors[ i ][ 0 ] - mean[ 0 ], colors[ i ][ 1 ] - mean[ 1 ], colors[ i ][ 2 ] - mean[ 2 ] };
+        for( int r = 0; r < 3; r++ )
+        {
+            for( int c = 0; c < 3; c++ )
+                cov[ r ][ c ] += d[ r ] * d[ c ];
+        }
+    }
+
+    /// Start from the channel that varies the most, so we can't start out
+    /// perpendicular to the axis
+    int start = 0;
+    if( cov[ 1 ][ 1 ] > cov[ start ][ start ] )
+        start = 1;
+    if( cov[ 2 ][ 2 ] > cov[ start ][ start ] )
+        start = 2;
+    if( cov[ start ][ start ] <= 0.f )
+    {
+        /// All one color
+        for( int c = 0; c < 3; c++ )
+            end0[ c ] = end1[ c ] = mean[ c ];
+        return;
+    }
+
+    float axis[ 3 ] = { cov[ 0 ][ start ], cov[ 1 ][ start ], cov[ 2 ][ start ] };
+    for( int iter = 0; iter < 4; iter++ )
+    {
+        float next[ 3 ];
+        for( int r = 0; r < 3; r++ )
+            next[ r ] = cov[ r ][ 0 ] * axis[ 0 ] + cov[ r ][ 1 ] * axis[ 1 ] + cov[ r ][ 2 ] * axis[ 2 ];
+
+        float len = std::max( std::max( fabsf( next[ 0 ] ), fabsf( next[ 1 ] ) ), fabsf( next[ 2 ] ) );
+        if( len <= 0.f )
+            break;
+        for( int r = 0; r < 3; r++ )
+            axis[ r ] = next[ r ] / len;
+    }
+
+    float len = sqrtf( axis[ 0 ] * axis[ 0 ] + axis[ 1 ] * axis[ 1 ] + axis[ 2 ] * axis[ 2 ] );
+    for( int c = 0; c < 3; c++ )
+        axis[ c ] /= len;
+
+    /// Endpoints on the axis at the ends of the colors, inset a bit like the
+    /// bounding box's
+    float lo = FLT_MAX, hi = -FLT_MAX;
+    for( uint32_t i = 0; i < numColors; i++ )
+    {
+        float t = ( colors[ i ][ 0 ] - mean[ 0 ] ) * axis[ 0 ] + ( colors[ i ][ 1 ] - mean[ 1 ] ) * axis[ 1 ]
+                  + ( colors[ i ][ 2 ] - mean[ 2 ] ) * axis[ 2 ];
+        lo = std::min( lo, t );
+        hi = std::max( hi, t );
+    }
+
+    float inset = ( hi - lo ) / 16.f;
+    for( int c = 0; c < 3; c++ )
+    {
+        end0[ c ] = mean[ c ] + axis[ c ] * ( hi - inset );
+        end1[ c ] = mean[ c ] + axis[ c ] * ( lo + inset );
+    }
+}
+
+//// IEncodeBlock /////////////////////////////////////////////////////////////
+
+void hsDXTSoftwareCodec::IEncodeBlock( const uint32_t *pixels, uint8_t *block, uint8_t format, CompressionQuality quality )
+{
+    if( format == plMipmap::DirectXInfo::kDXT5 )
+    {
+        IEncodeAlphaBlock( pixels, block, quality );
+        IEncodeColorBlock( pixels, (uint16_t *)( block + 8 ), false, quality );
+    }
+    else
+        IEncodeColorBlock( pixels, (uint16_t *)block, true, quality );
+}
+
+//// IEncodeColorBlock ////////////////////////////////////////////////////////
+//  Picks two endpoints for the block, then the closest of the colors they
+//  make for each pixel. DXT1 blocks with any fully transparent pixels use
+//  the three-color encoding, where index 3 is transparent black.
+
+void hsDXTSoftwareCodec::IEncodeColorBlock( const uint32_t *pixels, uint16_t *block, bool oneBitAlpha,
+                                            CompressionQuality quality )
+{
+    float       colors[ 16 ][ 3 ];
+    uint32_t    numColors = 0;
+    uint32_t    transparent = 0;
+
+
+    for( uint32_t i = 0; i < 16; i++ )
+    {
+        if( oneBitAlpha && ( pixels[ i ] >> 24 ) == 0 )
+            transparent |= 1 << i;
+        else
+            IUnpackRGB( pixels[ i ], colors[ numColors++ ] );
+    }
+
+    if( numColors == 0 )
+    {
+        /// All transparent
+        block[ 0 ] = block[ 1 ] = 0;
+        block[ 2 ] = block[ 3 ] = 0xffff;
+        return;
+    }
+
+    /// Orders the endpoints for the encoding we need, and fits the pixels
+    /// to the palette they make
+    auto fit = [pixels, oneBitAlpha, transparent]( uint16_t &c0, uint16_t &c1, bool &threeColor, uint32_t &indices )
+    {
+        threeColor = false;
+        if( oneBitAlpha )
+        {
+            if( transparent || c0 == c1 )
             {
-                hsAssert(false, "Unrecognized compression scheme.");
+                threeColor = true;
+                if( c0 > c1 )
+                    std::swap( c0, c1 );
             }
-            
-            colorBlock[0] = 0;
-            colorBlock[1] = 0;
-            colorBlock[2] = 0;
-            colorBlock[3] = 0;
-            for (xx = 0; xx < 4; ++xx)
-            {
-                for (yy = 0; yy < 4; ++yy)
-                {
-                    hsRGBAColor32* pixel = (hsRGBAColor32*)uncompressed->GetAddr32(4 * x + xx, 4 * y + yy);
-                    uint8_t pixelAlpha = pixel->a;
-                    if (alphaBlock)
-                    {
-                        uint32_t alphaIndex = 0;
-                        uint32_t alphaDistance = abs(pixelAlpha - alpha[0]);
-                        
-                        int32_t i;
-                        for (i = 1; i < 8; i++)
-                        {
-                            uint32_t distance = abs(pixelAlpha - alpha[i]);
-                            if (distance < alphaDistance)
-                            {
-                                alphaIndex = i;
-                                alphaDistance = distance;
-                            }
-                        }
-                        
-                        if (yy < 2)
-                        {
-                            uint32_t alphaShift = 3 * (4 * yy + xx);
-                            uint32_t threeAlphaBytes = alphaIndex << alphaShift;
-                            alphaBlock[2] |= (threeAlphaBytes & 0xff);
-                            alphaBlock[3] |= ((threeAlphaBytes >> 8) & 0xff);
-                            alphaBlock[4] |= ((threeAlphaBytes >> 16) & 0xff);
-                        }
-                        else
-                        {
-                            uint32_t alphaShift = 3 * (4 * (yy - 2) + xx);
-                            uint32_t threeAlphaBytes = alphaIndex << alphaShift;
-                            alphaBlock[5] |= (threeAlphaBytes & 0xff);
-                            alphaBlock[6] |= ((threeAlphaBytes >> 8) & 0xff);
-                            alphaBlock[7] |= ((threeAlphaBytes >> 16) & 0xff);
-                        }
-                    }
-                    
-                    uint32_t colorIndex = 0;
-                    uint32_t colorDistance = ColorDistanceARGBSquared(*pixel, color[0]);
-                    
-                    if ((encoding == kThreeColorEncoding) &&
-                        (pixelAlpha == 0))
-                    {
-                        colorIndex = 3;
-                    }
-                    else
-                    {
-                        int32_t i;
-                        int32_t colorMax = (encoding == kThreeColorEncoding) ? 3 : 4;
-                        for (i = 1; i < colorMax; i++)
-                        {
-                            uint32_t distance = ColorDistanceARGBSquared(*pixel, color[i]);
-                            if (distance < colorDistance)
-                            {
-                                colorIndex = i;
-                                colorDistance = distance;
-                            }
-                        }
-                    }
+            else if( c0 < c1 )
+                std::swap( c0, c1 );
+        }
 
-                    if (yy < 2)
-                    {
-                        uint32_t colorShift = 2 * (4 * yy + xx);
-                        uint16_t colorWord = (uint16_t)(colorIndex << colorShift);
-                        colorBlock[2] |= colorWord;
-                    }
-                    else
-                    {
-                        uint32_t colorShift = 2 * (4 * (yy - 2) + xx);
-                        uint16_t colorWord = (uint16_t)(colorIndex << colorShift);
-                        colorBlock[3] |= colorWord;
-                    }
-                } // for yy
-            } // for xx
-            
-            if (alphaBlock)
+        uint32_t palette[ 4 ];
+        palette[ 0 ] = IExpand565( c0 );
+        palette[ 1 ] = IExpand565( c1 );
+        if( threeColor )
+        {
+            palette[ 2 ] = IMixColors( palette[ 0 ], 1, palette[ 1 ], 1 );
+            palette[ 3 ] = 0;
+        }
+        else
+        {
+            palette[ 2 ] = IMixColors( palette[ 0 ], 2, palette[ 1 ], 1 );
+            palette[ 3 ] = IMixColors( palette[ 0 ], 1, palette[ 1 ], 2 );
+        }
+
+        return fit_colors.call( pixels, palette, threeColor ? 3 : 4, transparent, indices );
+    };
+
+    float end0[ 3 ], end1[ 3 ];
+    if( quality == kFastest )
+        IBoxEndpoints( colors, numColors, end0, end1 );
+    else
+        IAxisEndpoints( colors, numColors, end0, end1 );
+
+    uint16_t    c0 = IQuantize565( end0 );
+    uint16_t    c1 = IQuantize565( end1 );
+    bool        threeColor;
+    uint32_t    indices;
+    uint32_t    error = fit( c0, c1, threeColor, indices );
+
+    /// Refine: given the indices, solve for the endpoints that minimize the
+    /// squared error, and keep them if they're an improvement once quantized
+    for( int iter = 0; quality == kHighest && error > 0 && iter < 2; iter++ )
+    {
+        static const float kWeights[ 2 ][ 4 ] = { { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f },
+                                                  { 1.f, 0.f, 1.f / 2.f, 0.f } };
+
+        float aa = 0.f, ab = 0.f, bb = 0.f;
+        float ax[ 3 ] = { 0.f, 0.f, 0.f }, bx[ 3 ] = { 0.f, 0.f, 0.f };
+        for( uint32_t i = 0; i < 16; i++ )
+        {
+            if( transparent & ( 1 << i ) )
+                continue;
+
+            float a = kWeights[ threeColor ][ ( indices >> ( 2 * i ) ) & 3 ];
+            float b = 1.f - a;
+            float rgb[ 3 ];
+            IUnpackRGB( pixels[ i ], rgb );
+
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for( int c = 0; c < 3; c++ )
             {
-                alphaBlock[0] = alpha[0];
-                alphaBlock[1] = alpha[1];
+                ax[ c ] += a * rgb[ c ];
+                bx[ c ] += b * rgb[ c ];
             }
-            
-            colorBlock[0] = shortColor[0];
-            colorBlock[1] = shortColor[1];
-        } // for y
-    } // for x
+        }
+
+        float det = aa * bb - ab * ab;
+        if( fabsf( det ) < 1e-6f )
+            break;
+
+        for( int c = 0; c < 3; c++ )
+        {
+            end0[ c ] = ( bb * ax[ c ] - ab * bx[ c ] ) / det;
+            end1[ c ] = ( aa * bx[ c ] - ab * ax[ c ] ) / det;
+        }
+
+        uint16_t    n0 = IQuantize565( end0 );
+        uint16_t    n1 = IQuantize565( end1 );
+        bool        nThreeColor;
+        uint32_t    nIndices;
+        uint32_t    nError = fit( n0, n1, nThreeColor, nIndices );
+        if( nError >= error )
+            break;
+
+        c0 = n0;
+        c1 = n1;
+        threeColor = nThreeColor;
+        indices = nIndices;
+        error = nError;
+    }
+
+    block[ 0 ] = hsToLE16( c0 );
+    block[ 1 ] = hsToLE16( c1 );
+    block[ 2 ] = hsToLE16( (uint16_t)( indices & 0xffff ) );
+    block[ 3 ] = hsToLE16( (uint16_t)( indices >> 16 ) );
 }
 
-uint16_t hsDXTSoftwareCodec::BlendColors16(uint16_t weight1, uint16_t color1, uint16_t weight2, uint16_t color2)
+//// IEncodeAlphaBlock ////////////////////////////////////////////////////////
+//  DXT5 alpha blocks either interpolate eight alphas between the endpoints,
+//  or six plus 0 and 255. The eight-alpha encoding is the obvious choice,
+//  but unless we're in a hurry, try both and keep whichever fits better.
+
+void hsDXTSoftwareCodec::IEncodeAlphaBlock( const uint32_t *pixels, uint8_t *block, CompressionQuality quality )
 {
-    uint16_t r1, r2, g1, g2, b1, b2;
-    uint16_t r, g, b;
+    uint8_t lo = 255, hi = 0;
+    uint8_t innerLo = 255, innerHi = 0;
 
-    r1 = (color1 >> 8) & 0xf8;
-    g1 = (color1 >> 3) & 0xfc;
-    b1 = (color1 << 3) & 0xf8;
-    
-    r2 = (color2 >> 8) & 0xf8;
-    g2 = (color2 >> 3) & 0xfc;
-    b2 = (color2 << 3) & 0xf8;
-    
-    r = ((uint16_t)r1 * weight1 + (uint16_t)r2 * weight2)/(weight1 + weight2);
-    g = ((uint16_t)g1 * weight1 + (uint16_t)g2 * weight2)/(weight1 + weight2);
-    b = ((uint16_t)b1 * weight1 + (uint16_t)b2 * weight2)/(weight1 + weight2);
+    for( uint32_t i = 0; i < 16; i++ )
+    {
+        uint8_t a = (uint8_t)( pixels[ i ] >> 24 );
+        lo = std::min( lo, a );
+        hi = std::max( hi, a );
+        if( a != 0 && a != 255 )
+        {
+            innerLo = std::min( innerLo, a );
+            innerHi = std::max( innerHi, a );
+        }
+    }
+
+    uint8_t     alphas[ 8 ];
+    uint64_t    indices = 0;
+    uint32_t    error = UINT32_MAX;
 
-    return ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | ((b & 0xf8) >> 3);
+    if( hi > lo )
+    {
+        alphas[ 0 ] = hi;
+        alphas[ 1 ] = lo;
+        for( int j = 2; j < 8; j++ )
+            alphas[ j ] = (uint8_t)( ( ( 8 - j ) * hi + ( j - 1 ) * lo + 3 ) / 7 );
+
+        error = fit_alphas.call( pixels, alphas, indices );
+        block[ 0 ] = hi;
+        block[ 1 ] = lo;
+    }
+
+    if( error > 0 && ( quality != kFastest || hi == lo ) )
+    {
+        if( innerLo > innerHi )
+            innerLo = innerHi = ( hi == lo ) ? hi : 0;
+
+        alphas[ 0 ] = innerLo;
+        alphas[ 1 ] = innerHi;
+        for( int j = 2; j < 6; j++ )
+            alphas[ j ] = (uint8_t)( ( ( 6 - j ) * innerLo + ( j - 1 ) * innerHi + 2 ) / 5 );
+        alphas[ 6 ] = 0;
+        alphas[ 7 ] = 255;
+
+        uint64_t    sixIndices;
+        uint32_t    sixError = fit_alphas.call( pixels, alphas, sixIndices );
+        if( sixError < error )
+        {
+            indices = sixIndices;
+            block[ 0 ] = innerLo;
+            block[ 1 ] = innerHi;
+        }
+    }
+
+    for( int i = 0; i < 6; i++ )
+        block[ 2 + i ] = (uint8_t)( indices >> ( 8 * i ) );
 }
 
+//// Fitting and Decoding Kernels /////////////////////////////////////////////
 
-hsRGBAColor32 hsDXTSoftwareCodec::BlendColors32(uint32_t weight1, hsRGBAColor32 color1, 
-                                         uint32_t weight2, hsRGBAColor32 color2)
+static inline uint32_t IColorDistance( uint32_t color1, uint32_t color2 )
 {
-    hsRGBAColor32 result;
-
-    result.r = static_cast<uint8_t>((color1.r * weight1 + color2.r * weight2)/(weight1 + weight2));
-    result.g = static_cast<uint8_t>((color1.g * weight1 + color2.g * weight2)/(weight1 + weight2));
-    result.b = static_cast<uint8_t>((color1.b * weight1 + color2.b * weight2)/(weight1 + weight2));
+    int32_t r = (int32_t)( ( color1 >> 16 ) & 0xff ) - (int32_t)( ( color2 >> 16 ) & 0xff );
+    int32_t g = (int32_t)( ( color1 >> 8 ) & 0xff ) - (int32_t)( ( color2 >> 8 ) & 0xff );
+    int32_t b = (int32_t)( color1 & 0xff ) - (int32_t)( color2 & 0xff );
 
-    return result;
+    return (uint32_t)( r * r + g * g + b * b );
 }
 
+uint32_t hsDXTSoftwareCodec::fit_colors_fpu( const uint32_t *pixels, const uint32_t *palette, uint32_t numColors,
+                                             uint32_t transparent, uint32_t &indices )
+{
+    uint32_t error = 0;
+
+    indices = 0;
+    for( uint32_t i = 0; i < 16; i++ )
+    {
+        if( transparent & ( 1 << i ) )
+        {
+            indices |= 3 << ( 2 * i );
+            continue;
+        }
+
+        uint32_t best = IColorDistance( pixels[ i ], palette[ 0 ] );
+        uint32_t bestIdx = 0;
+        for( uint32_t j = 1; j < numColors; j++ )
+        {
+            uint32_t distance = IColorDistance( pixels[ i ], palette[ j ] );
+            if( distance < best )
+            {
+                best = distance;
+                bestIdx = j;
+            }
+        }
+
+        indices |= bestIdx << ( 2 * i );
+        error += best;
+    }
+
+    return error;
+}
 
-int32_t hsDXTSoftwareCodec::ColorDistanceARGBSquared(hsRGBAColor32 color1, hsRGBAColor32 color2)
+uint32_t hsDXTSoftwareCodec::fit_alphas_fpu( const uint32_t *pixels, const uint8_t *alphas, uint64_t &indices )
 {
-    int32_t r1, g1, b1;
-    int32_t r2, g2, b2;
+    uint32_t error = 0;
 
-    r1 = color1.r;
-    r2 = color2.r;
-    g1 = color1.g;
-    g2 = color2.g;
-    b1 = color1.b;
-    b2 = color2.b;
+    indices = 0;
+    for( uint32_t i = 0; i < 16; i++ )
+    {
+        int32_t a = (int32_t)( pixels[ i ] >> 24 );
+        uint32_t best = abs( a - alphas[ 0 ] );
+        uint32_t bestIdx = 0;
+        for( uint32_t j = 1; j < 8; j++ )
+        {
+            uint32_t distance = abs( a - alphas[ j ] );
+            if( distance < best )
+            {
+                best = distance;
+                bestIdx = j;
+            }
+        }
 
-    return (r1 - r2) * (r1 - r2) + (g1 - g2) * (g1 - g2) + (b1 - b2) * (b1 - b2);
+        indices |= (uint64_t)bestIdx << ( 3 * i );
+        error += best;
+    }
+
+    return error;
 }
 
-uint16_t hsDXTSoftwareCodec::Color32To16(hsRGBAColor32 color)
+void hsDXTSoftwareCodec::decode_block_fpu( const uint32_t *colors, uint32_t colorBits, const uint32_t *alphas,
+                                           uint64_t alphaBits, uint32_t *dest, uint32_t destStride )
 {
-    uint8_t r = (uint8_t)(color.r & 0xf8);
-    uint8_t g = (uint8_t)(color.g & 0xfc);
-    uint8_t b = (uint8_t)(color.b & 0xf8);
+    uint32_t    destBlock[ 16 ];
+    uint32_t    cBitSrc1 = colorBits & 0xffff, cBitSrc2 = colorBits >> 16;
+    int         j;
+
 
-    return (r << 8) | (g << 3) | (b >> 3);
+    /// Two rows at a time, so the two halves don't wait on each other
+    if( alphas )
+    {
+        uint32_t aBitSrc1 = (uint32_t)( alphaBits & 0xffffff );
+        uint32_t aBitSrc2 = (uint32_t)( alphaBits >> 24 );
+        for( j = 0; j < 8; j++ )
+        {
+            destBlock[ j ] = alphas[ aBitSrc1 & 0x07 ] | colors[ cBitSrc1 & 0x03 ];
+            destBlock[ j + 8 ] = alphas[ aBitSrc2 & 0x07 ] | colors[ cBitSrc2 & 0x03 ];
+            aBitSrc1 >>= 3;
+            aBitSrc2 >>= 3;
+            cBitSrc1 >>= 2;
+            cBitSrc2 >>= 2;
+        }
+    }
+    else
+    {
+        for( j = 0; j < 8; j++ )
+        {
+            destBlock[ j ] = colors[ cBitSrc1 & 0x03 ];
+            destBlock[ j + 8 ] = colors[ cBitSrc2 & 0x03 ];
+            cBitSrc1 >>= 2;
+            cBitSrc2 >>= 2;
+        }
+    }
+
+    for( j = 0; j < 16; j += 4, dest += destStride )
+    {
+        dest[ 0 ] = hsToLE32( destBlock[ j ] );
+        dest[ 1 ] = hsToLE32( destBlock[ j + 1 ] );
+        dest[ 2 ] = hsToLE32( destBlock[ j + 2 ] );
+        dest[ 3 ] = hsToLE32( destBlock[ j + 3 ] );
+    }
 }
 
+// CPU-optimized functions requiring dispatch
+hsCpuFunctionDispatcher<hsDXTSoftwareCodec::fit_colors_ptr> hsDXTSoftwareCodec::fit_colors {
+    &hsDXTSoftwareCodec::fit_colors_fpu,
+    nullptr,                                // SSE1
+    &hsDXTSoftwareCodec::fit_colors_sse2
+};
+
+hsCpuFunctionDispatcher<hsDXTSoftwareCodec::fit_alphas_ptr> hsDXTSoftwareCodec::fit_alphas {
+    &hsDXTSoftwareCodec::fit_alphas_fpu,
+    nullptr,                                // SSE1
+    &hsDXTSoftwareCodec::fit_alphas_sse2
+};
+
+hsCpuFunctionDispatcher<hsDXTSoftwareCodec::decode_block_ptr> hsDXTSoftwareCodec::decode_block {
+    &hsDXTSoftwareCodec::decode_block_fpu,
+    nullptr,                                // SSE1
+    nullptr,                                // SSE2
+    nullptr,                                // SSE3
+    &hsDXTSoftwareCodec::decode_block_ssse3
+};
+
 bool hsDXTSoftwareCodec::Register()
 {
     return hsCodecManager::Instance().Register(&(Instance()), plMipmap::kDirectXCompression, 100);
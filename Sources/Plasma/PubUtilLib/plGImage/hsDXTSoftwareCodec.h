@@ -44,6 +44,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "HeadSpin.h"
 #include "hsCodec.h"
+#include "hsCpuID.h"
 
 class plMipmap;
 typedef struct hsColor32 hsRGBAColor32;
@@ -66,18 +67,58 @@ public:
     // Colorize a compressed mipmap
     bool    ColorizeCompMipmap(plMipmap *bMap, const uint8_t *colorMask) override;
 
+    enum CompressionQuality
+    {
+        kFastest,   // Endpoints from the block's bounding box
+        kNormal,    // Endpoints along the block's principal axis
+        kHighest    // Principal axis, refined by least squares
+    };
+
+    static void SetCompressionQuality(CompressionQuality q) { fQuality = q; }
+    static CompressionQuality GetCompressionQuality() { return fQuality; }
+
+    // Mipmaps with fewer blocks than this are (de)compressed on the calling
+    // thread. Bigger ones are split up by rows of blocks.
+    static void SetMinThreadedBlocks(uint32_t n) { fMinThreadedBlocks = n; }
+    static uint32_t GetMinThreadedBlocks() { return fMinThreadedBlocks; }
+
+    // The individual implementations, for testing them against each other.
+    // Don't call the SIMD ones unless hsCpuId says the CPU has them.
+
+    // Picks the closest of numColors palette colors (RGB only) for each of
+    // 16 ARGB8888 pixels, and returns the total squared error. Pixels with
+    // their bit set in transparent get index 3 and don't count.
+    static uint32_t fit_colors_fpu(const uint32_t* pixels, const uint32_t* palette, uint32_t numColors,
+                                   uint32_t transparent, uint32_t& indices);
+    static uint32_t fit_colors_sse2(const uint32_t* pixels, const uint32_t* palette, uint32_t numColors,
+                                    uint32_t transparent, uint32_t& indices);
+
+    // Picks the closest of 8 alphas for each of 16 ARGB8888 pixels, and
+    // returns the total absolute error.
+    static uint32_t fit_alphas_fpu(const uint32_t* pixels, const uint8_t* alphas, uint64_t& indices);
+    static uint32_t fit_alphas_sse2(const uint32_t* pixels, const uint8_t* alphas, uint64_t& indices);
+
+    // Writes out a 4x4 block from its palettes and indices. The alphas are
+    // already in the top byte, and are nullptr for DXT1 blocks, whose colors
+    // carry their own.
+    static void decode_block_fpu(const uint32_t* colors, uint32_t colorBits, const uint32_t* alphas,
+                                 uint64_t alphaBits, uint32_t* dest, uint32_t destStride);
+    static void decode_block_ssse3(const uint32_t* colors, uint32_t colorBits, const uint32_t* alphas,
+                                   uint64_t alphaBits, uint32_t* dest, uint32_t destStride);
+
 private:
     enum {
         kFourColorEncoding,
         kThreeColorEncoding
     };
 
-    void    CompressMipmapLevel( plMipmap *uncompressed, plMipmap *compressed );
+    // Compresses the first numLevels levels, which must all be whole blocks
+    void    ICompressLevels( plMipmap *uncompressed, plMipmap *compressed, uint8_t numLevels );
 
-    uint16_t BlendColors16(uint16_t weight1, uint16_t color1, uint16_t weight2, uint16_t color2);
-    hsRGBAColor32 BlendColors32(uint32_t weight1, hsRGBAColor32 color1, uint32_t weight2, hsRGBAColor32 color2);
-    int32_t ColorDistanceARGBSquared(hsRGBAColor32 color1, hsRGBAColor32 color2);
-    uint16_t Color32To16(hsRGBAColor32 color);
+    // Encodes the 4x4 ARGB8888 pixels into a DXT1 or DXT5 block
+    static void IEncodeBlock( const uint32_t *pixels, uint8_t *block, uint8_t format, CompressionQuality quality );
+    static void IEncodeColorBlock( const uint32_t *pixels, uint16_t *block, bool oneBitAlpha, CompressionQuality quality );
+    static void IEncodeAlphaBlock( const uint32_t *pixels, uint8_t *block, CompressionQuality quality );
 
     // Calculates the DXT format based on a mipmap
     uint8_t   ICalcCompressedFormat( plMipmap *bMap );
@@ -96,15 +137,14 @@ private:
     void    IUncompressMipmapDXT5To16( plMipmap *destBMap, plMipmap *srcBMap );
     // Decompresses a DXT5 compressed mipmap into a RGB4444 reversed mipmap
     void    IUncompressMipmapDXT5To16Weird( plMipmap *destBMap, plMipmap *srcBMap );
-    // Decompresses a DXT5 compressed mipmap into a RGB8888 mipmap
-    void    IUncompressMipmapDXT5To32( plMipmap *destBMap, plMipmap *srcBMap );
+    // Decompresses levels [firstLevel, firstLevel + numLevels) of a DXT1 or
+    // DXT5 compressed mipmap into a RGB8888 mipmap
+    void    IUncompressLevelsTo32( plMipmap *destBMap, plMipmap *srcBMap, uint8_t firstLevel, uint8_t numLevels );
 
     // Decompresses a DXT1 compressed mipmap into a RGB1555 mipmap
     void    IUncompressMipmapDXT1To16( plMipmap *destBMap, plMipmap *srcBMap );
     // Decompresses a DXT1 compressed mipmap into a RGB5551 mipmap
     void    IUncompressMipmapDXT1To16Weird( plMipmap *destBMap, plMipmap *srcBMap );
-    // Decompresses a DXT1 compressed mipmap into a RGB8888 mipmap
-    void    IUncompressMipmapDXT1To32( plMipmap *destBMap, plMipmap *srcBMap );
 
     // Decompresses a DXT1 compressed mipmap into an intensity map
     void    IUncompressMipmapDXT1ToInten( plMipmap *destBMap, plMipmap *srcBMap );
@@ -147,8 +187,23 @@ private:
     // Converts a color from RGB565 to RGB4444 reversed format, with alpha=0
     uint16_t inline IRGB565To4444Rev( uint16_t color );
 
+    // Builds the palettes IUncompressLevelsTo32 decodes blocks with
+    void    IBuildColors32( const uint16_t *colorBlock, bool dxt1, uint32_t *colors );
+    void    IBuildAlphas( const uint8_t *alphaBlock, uint32_t *alphas );
+
+    typedef uint32_t(*fit_colors_ptr)(const uint32_t*, const uint32_t*, uint32_t, uint32_t, uint32_t&);
+    typedef uint32_t(*fit_alphas_ptr)(const uint32_t*, const uint8_t*, uint64_t&);
+    typedef void(*decode_block_ptr)(const uint32_t*, uint32_t, const uint32_t*, uint64_t, uint32_t*, uint32_t);
+
+    static hsCpuFunctionDispatcher<fit_colors_ptr> fit_colors;
+    static hsCpuFunctionDispatcher<fit_alphas_ptr> fit_alphas;
+    static hsCpuFunctionDispatcher<decode_block_ptr> decode_block;
+
     static bool Register();
     static bool fRegistered;
+
+    static CompressionQuality fQuality;
+    static uint32_t fMinThreadedBlocks;
 };
 
 #endif // __HSDXTSOFTWARECODEC_H
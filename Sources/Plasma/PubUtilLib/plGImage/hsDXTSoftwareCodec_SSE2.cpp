@@ -0,0 +1,167 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "hsDXTSoftwareCodec.h"
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+#endif
+
+// Four pixels at a time, with the same strictly-closer test as the FPU
+// versions, so the results match them exactly.
+
+uint32_t hsDXTSoftwareCodec::fit_colors_sse2(const uint32_t* pixels, const uint32_t* palette, uint32_t numColors,
+                                             uint32_t transparent, uint32_t& indices)
+{
+#ifdef HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+
+    // Each palette color's channels as 16-bit values, twice over, to line up
+    // with two unpacked pixels
+    __m128i colors[4];
+    for (uint32_t j = 0; j < numColors; ++j)
+        colors[j] = _mm_unpacklo_epi8(_mm_and_si128(_mm_set1_epi32((int)palette[j]), rgbMask), zero);
+
+    alignas(16) uint32_t bestDist[16];
+    alignas(16) uint32_t bestIdx[16];
+    for (uint32_t q = 0; q < 4; ++q)
+    {
+        __m128i px = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 4 * q)), rgbMask);
+        __m128i lo = _mm_unpacklo_epi8(px, zero);
+        __m128i hi = _mm_unpackhi_epi8(px, zero);
+
+        __m128i best = zero;
+        __m128i idx = zero;
+        for (uint32_t j = 0; j < numColors; ++j)
+        {
+            __m128i dlo = _mm_sub_epi16(lo, colors[j]);
+            __m128i dhi = _mm_sub_epi16(hi, colors[j]);
+            dlo = _mm_madd_epi16(dlo, dlo);
+            dhi = _mm_madd_epi16(dhi, dhi);
+
+            // madd leaves each pixel's distance split across two lanes
+            __m128 a = _mm_castsi128_ps(dlo);
+            __m128 b = _mm_castsi128_ps(dhi);
+            __m128i dist = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))),
+                                         _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+            if (j == 0)
+            {
+                best = dist;
+                continue;
+            }
+
+            __m128i closer = _mm_cmplt_epi32(dist, best);
+            best = _mm_or_si128(_mm_and_si128(closer, dist), _mm_andnot_si128(closer, best));
+            idx = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32((int)j)), _mm_andnot_si128(closer, idx));
+        }
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(bestDist + 4 * q), best);
+        _mm_store_si128(reinterpret_cast<__m128i*>(bestIdx + 4 * q), idx);
+    }
+
+    uint32_t error = 0;
+    indices = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        if (transparent & (1 << i))
+        {
+            indices |= 3 << (2 * i);
+            continue;
+        }
+        indices |= bestIdx[i] << (2 * i);
+        error += bestDist[i];
+    }
+    return error;
+#else
+    return 0;
+#endif
+}
+
+uint32_t hsDXTSoftwareCodec::fit_alphas_sse2(const uint32_t* pixels, const uint8_t* alphas, uint64_t& indices)
+{
+#ifdef HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_cmpeq_epi8(zero, zero);
+
+    // All 16 alphas, one per byte
+    const __m128i* src = reinterpret_cast<const __m128i*>(pixels);
+    __m128i a01 = _mm_packs_epi32(_mm_srli_epi32(_mm_loadu_si128(src), 24),
+                                  _mm_srli_epi32(_mm_loadu_si128(src + 1), 24));
+    __m128i a23 = _mm_packs_epi32(_mm_srli_epi32(_mm_loadu_si128(src + 2), 24),
+                                  _mm_srli_epi32(_mm_loadu_si128(src + 3), 24));
+    __m128i a = _mm_packus_epi16(a01, a23);
+
+    __m128i best = zero;
+    __m128i idx = zero;
+    for (uint32_t j = 0; j < 8; ++j)
+    {
+        __m128i alpha = _mm_set1_epi8((char)alphas[j]);
+        __m128i dist = _mm_or_si128(_mm_subs_epu8(a, alpha), _mm_subs_epu8(alpha, a));
+        if (j == 0)
+        {
+            best = dist;
+            continue;
+        }
+
+        // No unsigned byte compare, but if the min isn't the old best, the
+        // new one is closer
+        __m128i nearest = _mm_min_epu8(dist, best);
+        __m128i closer = _mm_xor_si128(_mm_cmpeq_epi8(nearest, best), ones);
+        best = nearest;
+        idx = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi8((char)j)), _mm_andnot_si128(closer, idx));
+    }
+
+    __m128i sum = _mm_sad_epu8(best, zero);
+    uint32_t error = (uint32_t)(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+
+    alignas(16) uint8_t bestIdx[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(bestIdx), idx);
+
+    indices = 0;
+    for (uint32_t i = 0; i < 16; ++i)
+        indices |= (uint64_t)bestIdx[i] << (3 * i);
+    return error;
+#else
+    return 0;
+#endif
+}
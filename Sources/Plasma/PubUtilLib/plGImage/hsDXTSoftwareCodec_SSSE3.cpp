@@ -0,0 +1,135 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "hsDXTSoftwareCodec.h"
+
+#ifdef HAVE_SSSE3
+#   include <tmmintrin.h>
+#endif
+
+#ifdef HAVE_SSSE3
+// For each byte of color indices, the offset of each of its four pixels'
+// color in the palette, one per byte.
+static const struct hsDXTColorOffsets
+{
+    uint32_t fOffsets[256];
+
+    hsDXTColorOffsets()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            fOffsets[i] = 0;
+            for (uint32_t k = 0; k < 4; ++k)
+                fOffsets[i] |= (((i >> (2 * k)) & 0x03) * 4) << (8 * k);
+        }
+    }
+} sColorOffsets;
+#endif
+
+// Looks the pixels up in the palettes with byte shuffles, a row at a time.
+
+void hsDXTSoftwareCodec::decode_block_ssse3(const uint32_t* colors, uint32_t colorBits, const uint32_t* alphas,
+                                            uint64_t alphaBits, uint32_t* dest, uint32_t destStride)
+{
+#ifdef HAVE_SSSE3
+    // Spreads each row's four palette offsets out to all four bytes of their
+    // pixels, and moves a row's alphas up into the top byte of theirs
+    alignas(16) static const int8_t kSpread[4][16] = {
+        {  0,  0,  0,  0,  1,  1,  1,  1,  2,  2,  2,  2,  3,  3,  3,  3 },
+        {  4,  4,  4,  4,  5,  5,  5,  5,  6,  6,  6,  6,  7,  7,  7,  7 },
+        {  8,  8,  8,  8,  9,  9,  9,  9, 10, 10, 10, 10, 11, 11, 11, 11 },
+        { 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15 }
+    };
+    alignas(16) static const int8_t kToAlpha[4][16] = {
+        { -1, -1, -1,  0, -1, -1, -1,  1, -1, -1, -1,  2, -1, -1, -1,  3 },
+        { -1, -1, -1,  4, -1, -1, -1,  5, -1, -1, -1,  6, -1, -1, -1,  7 },
+        { -1, -1, -1,  8, -1, -1, -1,  9, -1, -1, -1, 10, -1, -1, -1, 11 },
+        { -1, -1, -1, 12, -1, -1, -1, 13, -1, -1, -1, 14, -1, -1, -1, 15 }
+    };
+    const __m128i channels = _mm_setr_epi8(0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3);
+    const uint32_t* offsets = sColorOffsets.fOffsets;
+
+    __m128i palette = _mm_loadu_si128(reinterpret_cast<const __m128i*>(colors));
+    __m128i rowOffsets = _mm_set_epi32((int)offsets[colorBits >> 24], (int)offsets[(colorBits >> 16) & 0xFF],
+                                       (int)offsets[(colorBits >> 8) & 0xFF], (int)offsets[colorBits & 0xFF]);
+
+    if (alphas)
+    {
+        // Spread the 3-bit indices out into bytes, eight pixels (24 bits)
+        // at a time
+        alignas(16) uint64_t idx[2];
+        for (int half = 0; half < 2; ++half, alphaBits >>= 24)
+        {
+            uint64_t bits = alphaBits & 0xFFFFFF;
+            bits = (bits & 0xFFF) | ((bits & 0xFFF000) << 20);
+            bits = (bits & 0x0000003F0000003FULL) | ((bits & 0x00000FC000000FC0ULL) << 10);
+            bits = (bits & 0x0007000700070007ULL) | ((bits & 0x0038003800380038ULL) << 5);
+            idx[half] = bits;
+        }
+        __m128i alphaIdx = _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&idx[0])),
+                                              _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&idx[1])));
+
+        // Pull the alphas back down out of the top bytes
+        const __m128i topBytes = _mm_setr_epi8(3, 7, 11, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        __m128i alphaTable = _mm_unpacklo_epi32(
+            _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(alphas)), topBytes),
+            _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(alphas + 4)), topBytes));
+
+        __m128i alphaBytes = _mm_shuffle_epi8(alphaTable, alphaIdx);
+        for (int y = 0; y < 4; ++y, dest += destStride)
+        {
+            __m128i ctrl = _mm_add_epi8(_mm_shuffle_epi8(rowOffsets, _mm_load_si128(reinterpret_cast<const __m128i*>(kSpread[y]))), channels);
+            __m128i row = _mm_shuffle_epi8(palette, ctrl);
+            row = _mm_or_si128(row, _mm_shuffle_epi8(alphaBytes, _mm_load_si128(reinterpret_cast<const __m128i*>(kToAlpha[y]))));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), row);
+        }
+    }
+    else
+    {
+        for (int y = 0; y < 4; ++y, dest += destStride)
+        {
+            __m128i ctrl = _mm_add_epi8(_mm_shuffle_epi8(rowOffsets, _mm_load_si128(reinterpret_cast<const __m128i*>(kSpread[y]))), channels);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_shuffle_epi8(palette, ctrl));
+        }
+    }
+#endif
+}
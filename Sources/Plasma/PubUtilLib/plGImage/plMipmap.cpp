@@ -62,8 +62,11 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plProfile.h"
 #include "plJPEG.h"
 #include "plPNG.h"
+#include "hsJobPool.h"
+#include "plMipmapKernels.h"
 #include <cmath>
 #include <algorithm>
+#include <vector>
 
 plProfile_CreateMemCounter("Mipmaps", "Memory", MemMipmaps);
 
@@ -72,7 +75,8 @@ plProfile_CreateMemCounter("Mipmaps", "Memory", MemMipmaps);
 plMipmap::plMipmap()
     : fImage(), fLevelSizes(), fCurrLevelPtr(),
       fCurrLevel(), fTotalSize(), fWidth(), fHeight(), fRowBytes(),
-      fNumLevels(), fCurrLevelWidth(), fCurrLevelHeight(), fCurrLevelRowBytes()
+      fNumLevels(), fCurrLevelWidth(), fCurrLevelHeight(), fCurrLevelRowBytes(),
+      fCreateFlags(), fCreateSig(), fDetailDropoffStart(), fDetailDropoffStop(), fDetailMax(), fDetailMin()
 {
     SetConfig(kARGB32Config);
     fCompressionType = kUncompressed;
@@ -115,6 +119,8 @@ void    plMipmap::Create( uint32_t width, uint32_t height, unsigned config, uint
     fWidth = width;
     fHeight = height;
     fRowBytes = fWidth * fPixelSize >> 3;
+    fCreateFlags = 0;
+    fCreateSig = fDetailDropoffStart = fDetailDropoffStop = fDetailMax = fDetailMin = 0.f;
     if( numLevels > 0 )
         fNumLevels = numLevels;
     else
@@ -844,6 +850,9 @@ namespace {
     const float kDefaultSigma    = 1.f;
     const uint32_t kDefaultDetailBias = 5;
 
+    // Filtering is split up by rows into jobs of about this many pixels
+    const uint32_t kMinThreadedPixels = 16384;
+
     // Color masks (out of 0-2)
     const uint8_t fColorMasks[ 10 ][ 3 ] = { { 2, 0, 0 }, { 0, 2, 2 }, { 2, 0, 2 }, { 0, 2, 0 },          
                 { 0, 0, 2 }, { 2, 2, 0 }, { 2, 2, 2 }, { 2, 0, 1 }, { 0, 2, 1 }, { 1, 0, 2 } };
@@ -870,6 +879,7 @@ class plFilterMask
     protected:
         int             fExt;
         float        **fMask;
+        float         *fWeights;
 
     public:
 
@@ -880,6 +890,10 @@ class plFilterMask
         int     End() const { return fExt; }
 
         float    Mask( int i, int j ) const { return fMask[ i ][ j ]; }
+
+        // The mask is separable: Mask(i, j) == Weight(i) * Weight(j)
+        float    Weight( int i ) const { return fWeights[ i ]; }
+        const float *Weights( int i ) const { return fWeights + i; }
 };
 
 plFilterMask::plFilterMask( float sig )
@@ -902,6 +916,10 @@ plFilterMask::plFilterMask( float sig )
         }
     }
     fMask = m;
+
+    fWeights = ( new float[ ( fExt << 1 ) + 1 ] ) + fExt;
+    for( i = -fExt; i <= fExt; i++ )
+        fWeights[ i ] = expf( -( i*i ) * ooSigSq );
 }
 
 plFilterMask::~plFilterMask()
@@ -910,6 +928,67 @@ plFilterMask::~plFilterMask()
     for( i = -fExt; i <= fExt; i++ )
         delete [] ( fMask[ i ] - fExt );
     delete [] ( fMask - fExt );
+    delete [] ( fWeights - fExt );
+}
+
+//// FilterRect ///////////////////////////////////////////////////////////////
+//  Filters a 32 bit image with the mask into the rect [x0,x1) x [y0,y1) of
+//  another. Destination pixel (x,y) is centered on source pixel
+//  (x * stepX, y * stepY), so a step of 2 makes the next mip level down and
+//  a step of 1 just blurs. The mask is applied separably, down the source
+//  rows and then across, and the rows are spread over the job pool.
+
+static void FilterRect( const uint8_t *src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcRowBytes,
+                        uint8_t *dst, uint32_t dstRowBytes, uint32_t stepX, uint32_t stepY,
+                        const plFilterMask &mask, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1 )
+{
+    if( x0 >= x1 || y0 >= y1 )
+        return;
+
+    // Source columns any pixel in the rect can see
+    int32_t colBegin = std::max( int32_t( x0 * stepX ) + mask.Begin(), 0 );
+    int32_t colEnd = std::min( int32_t( ( x1 - 1 ) * stepX ) + mask.End() + 1, int32_t( srcWidth ) );
+
+    uint32_t rowsPerJob = std::max( kMinThreadedPixels / ( x1 - x0 ), 1U );
+    hsJobPool::Instance().RunRanges( y1 - y0, rowsPerJob, [&]( uint32_t firstRow, uint32_t endRow )
+    {
+        std::vector<float> sums( ( colEnd - colBegin ) * 4 );
+
+        for( uint32_t i = y0 + firstRow; i < y0 + endRow; i++ )
+        {
+            int32_t center = i * stepY;
+            int32_t iiBegin = std::max( mask.Begin(), -center );
+            int32_t iiEnd = std::min( mask.End(), int32_t( srcHeight ) - 1 - center );
+
+            std::fill( sums.begin(), sums.end(), 0.f );
+            float wy = 0.f;
+            for( int32_t ii = iiBegin; ii <= iiEnd; ii++ )
+            {
+                plMipmapKernels::AccumulateRow( sums.data(), src + ( center + ii ) * srcRowBytes + colBegin * 4,
+                                                sums.size(), mask.Weight( ii ), 0.5f );
+                wy += mask.Weight( ii );
+            }
+
+            uint8_t *dstPtr = dst + i * dstRowBytes + x0 * 4;
+            for( uint32_t j = x0; j < x1; j++, dstPtr += 4 )
+            {
+                int32_t centerX = j * stepX;
+                int32_t jjBegin = std::max( mask.Begin(), -centerX );
+                int32_t jjEnd = std::min( mask.End(), int32_t( srcWidth ) - 1 - centerX );
+
+                float a[ 4 ];
+                plMipmapKernels::SumPixels( &sums[ ( centerX + jjBegin - colBegin ) * 4 ], mask.Weights( jjBegin ),
+                                            jjEnd - jjBegin + 1, a );
+                float wx = 0.f;
+                for( int32_t jj = jjBegin; jj <= jjEnd; jj++ )
+                    wx += mask.Weight( jj );
+
+                float w = wx * wy;
+                for( int chan = 0; chan < 4; chan++ )
+                    dstPtr[ chan ] = (uint8_t)( a[ chan ] / w );
+            }
+        }
+    } );
 }
 
 
@@ -961,6 +1040,14 @@ plMipmap::plMipmap( plMipmap *bm, float sig, uint32_t createFlags,
     for( i = 1; i < fNumLevels; i++ )
         ICreateLevelNoDetail(i, mask);
 
+    // Remembered for regenerating levels after a Composite()
+    fCreateFlags = createFlags;
+    fCreateSig = sig;
+    fDetailDropoffStart = detailDropoffStart * fNumLevels;
+    fDetailDropoffStop = detailDropoffStop * fNumLevels;
+    fDetailMax = detailMax;
+    fDetailMin = detailMin;
+
     if (createFlags & kCreateDetailMask) 
     {
         // Fill in the detail levels afterwards, so we can just grab the current level's texture
@@ -1085,47 +1172,145 @@ void    plMipmap::ICreateLevelNoDetail( uint8_t iDst, const plFilterMask& mask )
     hsAssert(fPixelSize == 32, "Only 32 bit implemented");
     ASSERT_UNCOMPRESSED();
 
-    int32_t i, j, ii, jj;
-
     if( 32 == fPixelSize )
     {
         SetCurrLevel(iDst);
 
-        uint8_t *src = (uint8_t *)GetLevelPtr( iDst-1 );
+        uint32_t srcWidth, srcHeight, srcRowBytes;
+        uint8_t *src = (uint8_t *)GetLevelPtr( iDst-1, &srcWidth, &srcHeight, &srcRowBytes );
         uint8_t *dst = (uint8_t *)GetLevelPtr(iDst);
 
-        int32_t srcRowBytes = fCurrLevelRowBytes << 1;
-        int32_t srcHeight = fCurrLevelHeight << 1;
-        int32_t srcWidth = fCurrLevelWidth << 1;
+        FilterRect( src, srcWidth, srcHeight, srcRowBytes, dst, fCurrLevelRowBytes,
+                    srcWidth > fCurrLevelWidth ? 2 : 1, srcHeight > fCurrLevelHeight ? 2 : 1,
+                    mask, 0, 0, fCurrLevelWidth, fCurrLevelHeight );
+    }
+}
 
-        for( i = 0; i < fCurrLevelHeight; i++ )
+//// RegenerateLevels /////////////////////////////////////////////////////////
+//  Rebuilds the levels below a given one by filtering down from it, like the
+//  mipmap-creating constructor does. The rect version only redoes the pixels
+//  whose filter can see the given rect (in srcLevel's pixels), for when just
+//  part of the image has changed. srcLevel is taken to already have any
+//  detail and carry options the mipmap was made with.
+
+void    plMipmap::RegenerateLevels( float sig )
+{
+    RegenerateLevels( 0, 0, 0, fWidth, fHeight, sig );
+}
+
+void    plMipmap::RegenerateLevels( uint8_t srcLevel, uint32_t x, uint32_t y, uint32_t width, uint32_t height, float sig )
+{
+    if( fPixelSize != 32 || fCompressionType != kUncompressed )
+    {
+        hsAssert( false, "Can only regenerate levels of uncompressed 32 bit mipmaps" );
+        return;
+    }
+
+    if( sig <= 0 )
+        sig = fCreateSig > 0 ? fCreateSig : kDefaultSigma;
+    plFilterMask mask( sig );
+
+    int32_t x0 = x, y0 = y, x1 = x + width, y1 = y + height;
+    for( uint8_t level = srcLevel + 1; level < fNumLevels && x0 < x1 && y0 < y1; level++ )
+    {
+        uint32_t srcWidth, srcHeight, srcRowBytes, dstWidth, dstHeight, dstRowBytes;
+        uint8_t *src = GetLevelPtr( level - 1, &srcWidth, &srcHeight, &srcRowBytes );
+        uint8_t *dst = GetLevelPtr( level, &dstWidth, &dstHeight, &dstRowBytes );
+        int32_t stepX = srcWidth > dstWidth ? 2 : 1;
+        int32_t stepY = srcHeight > dstHeight ? 2 : 1;
+
+        // Pixel i sees source pixels i * step + [Begin(), End()]
+        x0 = std::max( ( x0 - mask.End() + stepX - 1 ) / stepX, 0 );
+        y0 = std::max( ( y0 - mask.End() + stepY - 1 ) / stepY, 0 );
+        x1 = std::min( ( x1 - 1 - mask.Begin() ) / stepX + 1, (int32_t)dstWidth );
+        y1 = std::min( ( y1 - 1 - mask.Begin() ) / stepY + 1, (int32_t)dstHeight );
+
+        FilterRect( src, srcWidth, srcHeight, srcRowBytes, dst, dstRowBytes, stepX, stepY,
+                    mask, x0, y0, std::max( x0, x1 ), std::max( y0, y1 ) );
+
+        if( x0 < x1 && y0 < y1 )
+            IApplyCreateOptions( level, true, x0, y0, x1, y1 );
+    }
+
+    if (GetDeviceRef() != nullptr)
+        GetDeviceRef()->SetDirty( true );
+}
+
+//// IApplyCreateOptions //////////////////////////////////////////////////////
+//  Redoes the detail and carry options the mipmap was made with on a rect of
+//  one level. Filtered pixels came down from the level above, so they carry
+//  its detail blend; that gets swapped for this level's. Otherwise they're
+//  fresh (composited) pixels without any. Carrying reads the level above, so
+//  it has to be done already.
+
+void    plMipmap::IApplyCreateOptions( uint8_t level, bool filtered, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1 )
+{
+    if( !( fCreateFlags & ( kCreateDetailMask | kCreateCarryMask ) ) )
+        return;
+
+    uint32_t width, height, rowBytes;
+    uint8_t *dst = GetLevelPtr( level, &width, &height, &rowBytes );
+    x1 = std::min( x1, width );
+    y1 = std::min( y1, height );
+
+    // Every detail blend is v * detail + base, on some of the channels
+    uint32_t detailMode = fCreateFlags & kCreateDetailMask;
+    if( detailMode != 0 )
+    {
+        auto base = [detailMode]( float detail ) { return detailMode == kCreateDetailMult ? ( 1.f - detail ) * 255.f : 0.f; };
+
+        float detail = IGetDetailLevelAlpha( level, fDetailDropoffStart, fDetailDropoffStop, fDetailMin, fDetailMax );
+        float scale = detail, offset = base( detail );
+        if( filtered && level > 0 )
         {
-            for( j = 0; j < fCurrLevelWidth; j++ )
-            {
-                uint8_t *center = src + (i << 1) * srcRowBytes + (j << 3);
+            float prevDetail = IGetDetailLevelAlpha( level - 1, fDetailDropoffStart, fDetailDropoffStop, fDetailMin, fDetailMax );
+            scale = prevDetail > 0.f ? detail / prevDetail : 0.f;
+            offset -= base( prevDetail ) * scale;
+        }
 
-                int32_t chan;
-                for( chan = 0; chan < 4; chan++ )
+        uint32_t firstChan = detailMode == kCreateDetailAlpha ? 3 : 0;
+        uint32_t endChan = detailMode == kCreateDetailAdd ? 3 : 4;
+        for( uint32_t i = y0; i < y1; i++ )
+        {
+            uint8_t *row = dst + i * rowBytes;
+            for( uint32_t j = x0; j < x1; j++ )
+            {
+                for( uint32_t chan = firstChan; chan < endChan; chan++ )
                 {
-                    float w = 0;
-                    float a = 0;
+                    float v = (float)row[ ( j << 2 ) + chan ] * scale + offset;
+                    row[ ( j << 2 ) + chan ] = (uint8_t)std::min( std::max( v, 0.f ), 255.f );
+                }
+            }
+        }
+    }
 
-                    for( ii = mask.Begin(); ii <= mask.End(); ii++ )
-                    {
-                        for( jj = mask.Begin(); jj <= mask.End(); jj++ )
-                        {
-                            if( (ii + (i << 1) >= 0)&&(ii + (i << 1) < srcHeight)
-                              &&(jj + (j << 1) >= 0)&&(jj + (j << 1) < srcWidth) )
-                            {
-                                w += mask.Mask(ii, jj);
-                                a += (float(center[ii*srcRowBytes + (jj<<2) + chan]) + 0.5f) * mask.Mask(ii, jj);
-                            }
-                        }
-                    }
-                    a /= w;
+    if( level == 0 || !( fCreateFlags & kCreateCarryMask ) )
+        return;
 
-                    dst[i * fCurrLevelRowBytes + (j << 2) + chan] = (uint8_t)a;
-                }
+    // Like ICarryZeroAlpha() and ICarryColor(): any of the four source pixels
+    // having the carried value passes it down
+    uint32_t srcWidth, srcHeight, srcRowBytes;
+    const uint8_t *src = GetLevelPtr( level - 1, &srcWidth, &srcHeight, &srcRowBytes );
+    uint32_t stepX = srcWidth > width ? 2 : 1;
+    uint32_t stepY = srcHeight > height ? 2 : 1;
+    uint32_t carryColor = fCreateFlags & kCreateCarryWhite ? 0x00ffffff : 0x00000000;
+
+    for( uint32_t i = y0; i < y1; i++ )
+    {
+        uint32_t *dstRow = (uint32_t *)( dst + i * rowBytes );
+        const uint32_t *srcRow0 = (const uint32_t *)( src + i * stepY * srcRowBytes );
+        const uint32_t *srcRow1 = (const uint32_t *)( src + ( i * stepY + stepY - 1 ) * srcRowBytes );
+        for( uint32_t j = x0; j < x1; j++ )
+        {
+            uint32_t sx = j * stepX;
+            uint32_t corners[ 4 ] = { srcRow0[ sx ], srcRow0[ sx + stepX - 1 ], srcRow1[ sx ], srcRow1[ sx + stepX - 1 ] };
+
+            for( uint32_t corner : corners )
+            {
+                if( ( fCreateFlags & kCreateCarryAlpha ) && !( corner >> 24 ) )
+                    dstRow[ j ] &= 0x00ffffff;
+                if( ( fCreateFlags & ( kCreateCarryWhite | kCreateCarryBlack ) ) && ( corner & 0x00ffffff ) == carryColor )
+                    dstRow[ j ] = ( dstRow[ j ] & 0xff000000 ) | carryColor;
             }
         }
     }
@@ -1213,8 +1398,7 @@ void    plMipmap::IBlendLevelDetailAlpha( uint8_t iDst, const plFilterMask& mask
     hsAssert(fPixelSize == 32, "Only 32 bit implemented");
     ASSERT_UNCOMPRESSED();
 
-    int     i, j;
-    uint32_t  offset;
+    uint32_t  i, j;
 
 
     SetCurrLevel(iDst);
@@ -1225,14 +1409,9 @@ void    plMipmap::IBlendLevelDetailAlpha( uint8_t iDst, const plFilterMask& mask
 
     for( i = 0; i < fCurrLevelHeight; i++ )
     {
+        uint8_t *row = dst + i * fCurrLevelRowBytes + 3;    // Alpha channel only
         for( j = 0; j < fCurrLevelWidth; j++ )
-        {
-            uint32_t chan = 3;    // Alpha channel only
-            offset = i * fCurrLevelRowBytes + (j << 2) + chan;
-
-            float a = (float)dst[ offset ] * detailAlpha;
-            dst[ offset ] = (uint8_t)a;
-        }
+            row[ j << 2 ] = (uint8_t)( (float)row[ j << 2 ] * detailAlpha );
     }
 }
 
@@ -1247,8 +1426,7 @@ void    plMipmap::IBlendLevelDetailAdd( uint8_t iDst, const plFilterMask& mask,
     hsAssert(fPixelSize == 32, "Only 32 bit implemented");
     ASSERT_UNCOMPRESSED();
 
-    int     i, j;
-    uint32_t  offset;
+    uint32_t  i, j;
 
 
     SetCurrLevel(iDst);
@@ -1259,18 +1437,13 @@ void    plMipmap::IBlendLevelDetailAdd( uint8_t iDst, const plFilterMask& mask,
 
     for( i = 0; i < fCurrLevelHeight; i++ )
     {
-        for( j = 0; j < fCurrLevelWidth; j++ )
+        uint8_t *row = dst + i * fCurrLevelRowBytes;
+        for( j = 0; j < fCurrLevelWidth; j++, row += 4 )
         {
-            uint32_t chan;
-
             /// Blend all but the alpha channel, since we're doing additive blending
-            for( chan = 0; chan < 3; chan++ )
-            {
-                offset = i * fCurrLevelRowBytes + (j << 2) + chan;
-
-                float a = (float)dst[ offset ] * detailAlpha;
-                dst[ offset ] = (uint8_t)a;
-            }
+            row[ 0 ] = (uint8_t)( (float)row[ 0 ] * detailAlpha );
+            row[ 1 ] = (uint8_t)( (float)row[ 1 ] * detailAlpha );
+            row[ 2 ] = (uint8_t)( (float)row[ 2 ] * detailAlpha );
         }
     }
 }
@@ -1286,8 +1459,7 @@ void    plMipmap::IBlendLevelDetailMult( uint8_t iDst, const plFilterMask& mask,
     hsAssert(fPixelSize == 32, "Only 32 bit implemented");
     ASSERT_UNCOMPRESSED();
 
-    int     i, j;
-    uint32_t  offset;
+    uint32_t  i, j;
 
 
     SetCurrLevel(iDst);
@@ -1299,21 +1471,12 @@ void    plMipmap::IBlendLevelDetailMult( uint8_t iDst, const plFilterMask& mask,
 
     for( i = 0; i < fCurrLevelHeight; i++ )
     {
-        for( j = 0; j < fCurrLevelWidth; j++ )
+        // All four channels get the same treatment, so just run along the row
+        uint8_t *row = dst + i * fCurrLevelRowBytes;
+        for( j = 0; j < fCurrLevelWidth << 2; j++ )
         {
-            uint32_t chan;
-
-            for( chan = 0; chan < 4; chan++ )
-            {
-                offset = i * fCurrLevelRowBytes + (j << 2) + chan;
-
-                float a = (float)dst[ offset ];
-
-                // Mult should fade to white, not black like with additive blending
-                a = invDetailAlpha + a * detailAlpha;
-
-                dst[ offset ] = (uint8_t)a;
-            }
+            // Mult should fade to white, not black like with additive blending
+            row[ j ] = (uint8_t)( invDetailAlpha + (float)row[ j ] * detailAlpha );
         }
     }
 }
@@ -1442,8 +1605,6 @@ void plMipmap::Filter(float sig)
     hsAssert(fPixelSize == 32, "Only 32 bit implemented");
     ASSERT_UNCOMPRESSED();
 
-    int i, j, ii, jj;
-
     if( 32 == fPixelSize )
     {
         uint8_t *dst = (uint8_t *)(fImage);
@@ -1456,40 +1617,7 @@ void plMipmap::Filter(float sig)
 
         plFilterMask mask(sig);
 
-        int32_t srcRowBytes = fRowBytes;
-        int32_t srcHeight = fHeight;
-        int32_t srcWidth = fWidth;
-
-        for( i = 0; i < fHeight; i++ )
-        {
-            for( j = 0; j < fWidth; j++ )
-            {
-                uint8_t *center = src + i * srcRowBytes + (j << 2);
-
-                int32_t chan;
-                for( chan = 0; chan < 4; chan++ )
-                {
-                    float w = 0;
-                    float a = 0;
-
-                    for( ii = mask.Begin(); ii <= mask.End(); ii++ )
-                    {
-                        for( jj = mask.Begin(); jj <= mask.End(); jj++ )
-                        {
-                            if( (ii + i >= 0)&&(ii + i < srcHeight)
-                              &&(jj + j >= 0)&&(jj + j < srcWidth) )
-                            {
-                                w += mask.Mask(ii, jj);
-                                a += (float(center[ii*srcRowBytes + (jj<<2) + chan]) + 0.5f) * mask.Mask(ii, jj);
-                            }
-                        }
-                    }
-                    a /= w;
-
-                    dst[i * fRowBytes + (j << 2) + chan] = (uint8_t)(a);
-                }
-            }
-        }
+        FilterRect( src, fWidth, fHeight, fRowBytes, dst, fRowBytes, 1, 1, mask, 0, 0, fWidth, fHeight );
 
         HSMemory::Delete(src);
     }
@@ -1587,6 +1715,12 @@ void    plMipmap::CopyFrom( const plMipmap *source )
     fSpace = source->fSpace;
     fCompressionType = source->fCompressionType;
     fTotalSize = source->fTotalSize;
+    fCreateFlags = source->fCreateFlags;
+    fCreateSig = source->fCreateSig;
+    fDetailDropoffStart = source->fDetailDropoffStart;
+    fDetailDropoffStop = source->fDetailDropoffStop;
+    fDetailMax = source->fDetailMax;
+    fDetailMin = source->fDetailMin;
 
     fImage = (void *)new uint8_t[ fTotalSize ];
     memcpy( fImage, source->fImage, fTotalSize );
@@ -1713,6 +1847,10 @@ void    plMipmap::Composite( plMipmap *source, uint16_t x, uint16_t y, plMipmap:
         return;
     }
 
+    // Where we're compositing to on the top level, for regenerating below
+    uint16_t    dirtyX = x, dirtyY = y;
+    uint32_t    dirtyWidth = srcWidth, dirtyHeight = srcHeight;
+
     // Do the composite on each level
     numLevels = fNumLevels;
     if( numLevels > srcNumLevels )
@@ -1908,6 +2046,27 @@ void    plMipmap::Composite( plMipmap *source, uint16_t x, uint16_t y, plMipmap:
         }   
     }
 
+    // The composited pixels don't have the detail and carry options we were
+    // made with, if any
+    for( level = 0; level < numLevels; level++ )
+    {
+        uint32_t levelX = dirtyX >> level, levelY = dirtyY >> level;
+        uint32_t levelEndX = ( dirtyX + dirtyWidth + ( 1 << level ) - 1 ) >> level;
+        uint32_t levelEndY = ( dirtyY + dirtyHeight + ( 1 << level ) - 1 ) >> level;
+        IApplyCreateOptions( level, false, levelX, levelY, levelEndX, levelEndY );
+    }
+
+    // If the source ran out of levels before we did, filter the rest of ours
+    // down from the last one it covered, rather than leaving them stale
+    if( numLevels > 0 && numLevels < fNumLevels )
+    {
+        uint8_t last = numLevels - 1;
+        uint32_t lastX = dirtyX >> last, lastY = dirtyY >> last;
+        uint32_t lastEndX = ( dirtyX + dirtyWidth + ( 1 << last ) - 1 ) >> last;
+        uint32_t lastEndY = ( dirtyY + dirtyHeight + ( 1 << last ) - 1 ) >> last;
+        RegenerateLevels( last, lastX, lastY, lastEndX - lastX, lastEndY - lastY );
+    }
+
     // All done!
     if (GetDeviceRef() != nullptr)
         GetDeviceRef()->SetDirty( true );
@@ -2018,13 +2177,7 @@ void    plMipmap::IColorLevel( uint8_t level, const uint8_t *colorMask )
 void    plMipmap::ScaleNicely( uint32_t *destPtr, uint16_t destWidth, uint16_t destHeight,
                                 uint16_t destStride, plMipmap::ScaleFilter filter ) const
 {
-    uint16_t      destX, destY, srcX, srcY;
-    int16_t       srcStartX, srcEndX, srcStartY, srcEndY;
-    float       srcPosX, srcPosY, destToSrcXScale, destToSrcYScale, filterWidth, filterHeight, weight;
-    float       totalWeight;
-    hsColorRGBA color, accumColor;
-    float       whyWaits[ 16 ], whyWait, xWeights[ 16 ];
-    uint32_t      *srcPtr;
+    float       destToSrcXScale, destToSrcYScale, filterWidth, filterHeight;
 
 
     // Init
@@ -2045,81 +2198,77 @@ void    plMipmap::ScaleNicely( uint32_t *destPtr, uint16_t destWidth, uint16_t d
     if( filterHeight < 1.f )
         filterHeight = 1.f;
 
-    // Process
-    for( destY = 0; destY < destHeight; destY++ )
-    {
-        // Calculate the span across this row
-        srcPosY = destY * destToSrcYScale;
+    // The filter is separable, and the x weights are the same for every row, so
+    // work those out up front. Weights that fall off the filter are zeroed.
+    std::vector<uint16_t>   xStarts( destWidth ), xCounts( destWidth );
+    std::vector<uint32_t>   xOffsets( destWidth );
+    std::vector<float>      xWeights, xTotals( destWidth );
+    for( uint16_t destX = 0; destX < destWidth; destX++ )
+    {
+        // For this pixel in the destination, figure out where in the source image we virtually are
+        float srcPosX = destX * destToSrcXScale;
+
+        // Range of pixels that the filter covers
+        int32_t srcStartX = std::max( (int32_t)(int16_t)( srcPosX - filterWidth ), 0 );
+        int32_t srcEndX = std::min( (int32_t)(int16_t)( srcPosX + filterWidth ), (int32_t)fWidth - 1 );
+
+        xStarts[ destX ] = (uint16_t)srcStartX;
+        xCounts[ destX ] = (uint16_t)( srcEndX - srcStartX + 1 );
+        xOffsets[ destX ] = (uint32_t)xWeights.size();
+        xTotals[ destX ] = 0.f;
+        for( int32_t srcX = srcStartX; srcX <= srcEndX; srcX++ )
+        {
+            float weight = 1.f - ( fabs( (float)srcX - srcPosX ) / filterWidth );
+            if( weight < 0.f )
+                weight = 0.f;
+            xWeights.push_back( weight );
+            xTotals[ destX ] += weight;
+        }
+    }
 
-        srcStartY = (int16_t)( srcPosY - filterHeight );
-        if( srcStartY < 0 ) 
-            srcStartY = 0;
+    // Process. Each row gets the weighted sum of the source rows under it,
+    // then each pixel is a weighted sum along that.
+    uint32_t rowCost = fWidth * ( (uint32_t)( filterHeight * 2.f ) + 1 );
+    hsJobPool::Instance().RunRanges( destHeight, std::max( kMinThreadedPixels / rowCost, 1U ),
+                                     [&]( uint32_t firstRow, uint32_t endRow )
+    {
+        std::vector<float> sums( fWidth * 4 );
 
-        srcEndY = (int16_t)( srcPosY + filterHeight );
-        if( srcEndY >= fHeight ) 
-            srcEndY = (int16_t)(fHeight - 1);
+        for( uint32_t destY = firstRow; destY < endRow; destY++ )
+        {
+            // Calculate the span across this row
+            float srcPosY = destY * destToSrcYScale;
 
-        // Precalc the y weights
-        for( srcY = srcStartY; srcY <= srcEndY && ( srcY - srcStartY ) < 16; srcY++ )
-            whyWaits[ srcY - srcStartY ] = 1.f - ( fabs( (float)srcY - srcPosY ) / filterHeight );
+            int32_t srcStartY = std::max( (int32_t)(int16_t)( srcPosY - filterHeight ), 0 );
+            int32_t srcEndY = std::min( (int32_t)(int16_t)( srcPosY + filterHeight ), (int32_t)fHeight - 1 );
 
-        for( destX = 0; destX < destWidth; destX++ )
-        {
-            // For this pixel in the destination, figure out where in the source image we virtually are
-            srcPosX = destX * destToSrcXScale;
-
-            // Range of pixels that the filter covers
-            srcStartX = (int16_t)( srcPosX - filterWidth );
-            if( srcStartX < 0 ) 
-                srcStartX = 0;
-            
-            srcEndX = (int16_t)( srcPosX + filterWidth );
-            if( srcEndX >= fWidth ) 
-                srcEndX = (int16_t)(fWidth - 1);
-
-            // Precalc the x weights
-            for( srcX = srcStartX; srcX <= srcEndX && ( srcX - srcStartX ) < 16; srcX++ )
-                xWeights[ srcX - srcStartX ] = 1.f - ( fabs( (float)srcX - srcPosX ) / filterWidth );
-
-            // Sum up all the weighted colors in the filter area
-            accumColor.Set( 0.f, 0.f, 0.f, 0.f );
-            totalWeight = 0.f;
-            for( srcY = srcStartY; srcY <= srcEndY; srcY++ )
+            std::fill( sums.begin(), sums.end(), 0.f );
+            float totalY = 0.f;
+            for( int32_t srcY = srcStartY; srcY <= srcEndY; srcY++ )
             {
-                if( srcY - srcStartY < 16 )
-                    whyWait = whyWaits[ srcY - srcStartY ];
-                else
-                    whyWait = 1.f - ( fabs( (float)srcY - srcPosY ) / filterHeight );
-
+                float whyWait = 1.f - ( fabs( (float)srcY - srcPosY ) / filterHeight );
                 if( whyWait <= 0.f )
                     continue;
 
-                srcPtr = GetAddr32( srcStartX, srcY );
-                for( srcX = srcStartX; srcX <= srcEndX; srcX++, srcPtr++ )
-                {
-                    // Our weight...
-                    weight = ( srcX - srcStartX < 16 ) ? xWeights[ srcX - srcStartX ] : 
-                                ( 1.f - ( fabs( (float)srcX - srcPosX ) / filterWidth ) );
-                    weight *= whyWait;
-
-                    if( weight > 0.f )
-                    {
-                        // Grab pixel values from us...
-                        color.FromARGB32( *srcPtr );
-                        color *= weight;
-                        accumColor += color;
-                        totalWeight += weight;
-                    }
-                }
+                plMipmapKernels::AccumulateRow( sums.data(), (const uint8_t *)GetAddr32( 0, srcY ),
+                                                sums.size(), whyWait, 0.f );
+                totalY += whyWait;
             }
-            accumColor *= 1.f / totalWeight;
 
-            // Set the final value
-            *destPtr = accumColor.ToARGB32();
-            destPtr++;
+            uint8_t *dest = (uint8_t *)( destPtr + destY * destStride );
+            for( uint16_t destX = 0; destX < destWidth; destX++, dest += 4 )
+            {
+                float accum[ 4 ];
+                plMipmapKernels::SumPixels( &sums[ xStarts[ destX ] * 4 ], &xWeights[ xOffsets[ destX ] ],
+                                            xCounts[ destX ], accum );
+
+                // Same scaling hsColorRGBA::ToARGB32() would do
+                float scale = 255.99f / 255.f / ( xTotals[ destX ] * totalY );
+                for( int chan = 0; chan < 4; chan++ )
+                    dest[ chan ] = (uint8_t)( accum[ chan ] * scale );
+            }
         }
-        destPtr += destStride - destWidth;
-    }
+    } );
 }
 
 //// ResizeNicely /////////////////////////////////////////////////////////////
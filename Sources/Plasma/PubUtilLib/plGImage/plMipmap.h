@@ -224,6 +224,13 @@ class plMipmap : public plBitmap
                                           float detailDropoffStart, float detailDropoffStop, 
                                           float detailMax, float detailMin);
         void    Filter(float sig);
+
+        // Rebuilds the levels below srcLevel by filtering down from it, with
+        // sig <= 0 meaning the default. The rect version only redoes what can
+        // see the given rect (in srcLevel's pixels) of srcLevel. Mipmaps made
+        // with detail or carry options get them again on the rebuilt levels.
+        void    RegenerateLevels(float sig = 0.f);
+        void    RegenerateLevels(uint8_t srcLevel, uint32_t x, uint32_t y, uint32_t width, uint32_t height, float sig = 0.f);
         uint32_t  CopyOutPixels(uint32_t destXSize, uint32_t destYSize, uint32_t dstFormat, void *destPixels, uint32_t copyOptions);
 
         void    ClipToMaxSize( uint32_t maxDimension );
@@ -302,6 +309,11 @@ class plMipmap : public plBitmap
         uint8_t     fCurrLevel;
         uint32_t    fCurrLevelWidth, fCurrLevelHeight, fCurrLevelRowBytes;
 
+        // What the detail map constructor was given, for RegenerateLevels
+        uint32_t    fCreateFlags;
+        float       fCreateSig;
+        float       fDetailDropoffStart, fDetailDropoffStop, fDetailMax, fDetailMin;
+
         void    IReadRawImage( hsStream *stream );
         void    IWriteRawImage( hsStream *stream );
         plMipmap *ISplitAlpha();
@@ -317,6 +329,7 @@ class plMipmap : public plBitmap
         void    IColorLevel( uint8_t level, const uint8_t *colorMask );
 
         float    IGetDetailLevelAlpha( uint8_t level, float dropStart, float dropStop, float min, float max );
+        void     IApplyCreateOptions( uint8_t level, bool filtered, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1 );
 
         void        ICarryZeroAlpha(uint8_t iDst);
         void        ICarryColor(uint8_t iDst, uint32_t col);
@@ -0,0 +1,83 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef plMipmapKernels_inc
+#define plMipmapKernels_inc
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+
+//
+// The inner loops of plMipmap's filtering. Filters there are separable, so
+// they're done as a pass down the source rows into a row of floats, then a
+// pass across that row for each output pixel.
+//
+class plMipmapKernels
+{
+public:
+    // sums[i] += weight * (row[i] + bias), over count bytes
+    static void AccumulateRow(float* sums, const uint8_t* row, size_t count, float weight, float bias)
+    {
+        accumulate_row.call(sums, row, count, weight, bias);
+    }
+
+    // result[c] = sum of weights[i] * sums[i * 4 + c], over count ARGB pixels
+    static void SumPixels(const float* sums, const float* weights, size_t count, float* result)
+    {
+        sum_pixels.call(sums, weights, count, result);
+    }
+
+private:
+    typedef void(*accumulate_row_ptr)(float*, const uint8_t*, size_t, float, float);
+    typedef void(*sum_pixels_ptr)(const float*, const float*, size_t, float*);
+
+    static hsCpuFunctionDispatcher<accumulate_row_ptr> accumulate_row;
+    static hsCpuFunctionDispatcher<sum_pixels_ptr> sum_pixels;
+
+    static void accumulate_row_fpu(float* sums, const uint8_t* row, size_t count, float weight, float bias);
+    static void accumulate_row_sse2(float* sums, const uint8_t* row, size_t count, float weight, float bias);
+
+    static void sum_pixels_fpu(const float* sums, const float* weights, size_t count, float* result);
+    static void sum_pixels_sse2(const float* sums, const float* weights, size_t count, float* result);
+};
+
+#endif // plMipmapKernels_inc
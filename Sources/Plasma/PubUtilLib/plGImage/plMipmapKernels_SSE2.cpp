@@ -0,0 +1,90 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plMipmapKernels.h"
+
+#ifdef HAVE_SSE2
+#   include <emmintrin.h>
+#endif
+
+// Same operations in the same order as the FPU versions, one channel per
+// lane, so the results match them exactly.
+
+void plMipmapKernels::accumulate_row_sse2(float* sums, const uint8_t* row, size_t count, float weight, float bias)
+{
+#ifdef HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 w = _mm_set1_ps(weight);
+    const __m128 b = _mm_set1_ps(bias);
+    for (; count >= 16; count -= 16, row += 16, sums += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)row);
+        __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+
+        __m128 v0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+        __m128 v1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+        __m128 v2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+        __m128 v3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+
+        _mm_storeu_ps(sums,      _mm_add_ps(_mm_loadu_ps(sums),      _mm_mul_ps(w, _mm_add_ps(v0, b))));
+        _mm_storeu_ps(sums + 4,  _mm_add_ps(_mm_loadu_ps(sums + 4),  _mm_mul_ps(w, _mm_add_ps(v1, b))));
+        _mm_storeu_ps(sums + 8,  _mm_add_ps(_mm_loadu_ps(sums + 8),  _mm_mul_ps(w, _mm_add_ps(v2, b))));
+        _mm_storeu_ps(sums + 12, _mm_add_ps(_mm_loadu_ps(sums + 12), _mm_mul_ps(w, _mm_add_ps(v3, b))));
+    }
+#endif
+
+    // Leftovers
+    accumulate_row_fpu(sums, row, count, weight, bias);
+}
+
+void plMipmapKernels::sum_pixels_sse2(const float* sums, const float* weights, size_t count, float* result)
+{
+#ifdef HAVE_SSE2
+    __m128 acc = _mm_setzero_ps();
+    for (size_t i = 0; i < count; ++i, sums += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[i]), _mm_loadu_ps(sums)));
+    _mm_storeu_ps(result, acc);
+#else
+    sum_pixels_fpu(sums, weights, count, result);
+#endif
+}
@@ -45,6 +45,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsColorRGBA.h"
 #include "hsPoint2.h"
 
+#include <algorithm>
+
 //
 ///////////////////////////////////////////////////////
 // linear interpolation
@@ -392,6 +394,14 @@ static inline hsKeyFrame* GetKey(int32_t i, void *keys, int32_t size)
     return (hsKeyFrame*) ((char*)keys + size * i);
 }
 
+//
+// Returns true if frame lies within the pair of keys starting at index i.
+//
+static inline bool IsInKeyPair(float frame, uint32_t i, void *keys, int32_t size)
+{
+    return frame >= GetKey(i, keys, size)->fFrame && frame <= GetKey(i + 1, keys, size)->fFrame;
+}
+
 //
 // STATIC
 // Given a list of keys, and a time, fills in the 2 boundary keys and 
@@ -399,105 +409,80 @@ static inline hsKeyFrame* GetKey(int32_t i, void *keys, int32_t size)
 // Returns the index of the first key which can be passed in as a hint (lastKeyIdx)
 // for the next search.
 //
+// The hint and its neighbor in the direction of play are tried first, so
+// normal playback costs O(1). Anything else (scrubbing, time jumps) falls
+// back to a binary search. If the keys are known to be evenly spaced,
+// uniformStep is the spacing in frames and the pair is computed directly.
+//
 void hsInterp::GetBoundaryKeyFrames(float time, uint32_t numKeys, void *keys, uint32_t size,
-                                    hsKeyFrame **kF1, hsKeyFrame **kF2, uint32_t *lastKeyIdx, float *p, bool forwards)
+                                    hsKeyFrame **kF1, hsKeyFrame **kF2, uint32_t *lastKeyIdx, float *p, bool forwards,
+                                    uint32_t uniformStep)
 {
     hsAssert(numKeys>1, "Must have more than 1 keyframe");
-    int k1 = 0, k2 = 0;
     float frame = time * MAX_FRAMES_PER_SEC;
 
     // boundary case, past end
     if (frame > GetKey(numKeys-1, keys, size)->fFrame)
     {
-        k1=k2=numKeys-1;
-        (*kF2) = GetKey(k1, keys, size);
+        *lastKeyIdx = numKeys-1;
+        (*kF2) = GetKey(numKeys-1, keys, size);
         (*kF1) = (*kF2);
         *p = 0.0;
-        goto ret;
+        return;
     }
 
-    hsKeyFrame *key1, *key2;
     // boundary case, before start
-    if (frame < (key1=GetKey(0, keys, size))->fFrame)
+    hsKeyFrame *first = GetKey(0, keys, size);
+    if (frame < first->fFrame)
     {
-        k1=k2=0;
-        (*kF1) = GetKey(k1, keys, size);
+        *lastKeyIdx = 0;
+        (*kF1) = first;
         (*kF2) = (*kF1);
         *p = 0.0;
-        goto ret;
+        return;
     }
 
-    // prime loop
-    int i;
-    i = 1;
-    if (*lastKeyIdx > 0 && *lastKeyIdx < numKeys - 1)
+    uint32_t k1 = *lastKeyIdx;
+    if (k1 < numKeys - 1 && IsInKeyPair(frame, k1, keys, size))
     {
-        // new starting point for search
-        if (forwards)
-            key1 = GetKey(*lastKeyIdx, keys, size);
-        else
-            key2 = GetKey(*lastKeyIdx + 1, keys, size);
-
-        i = *lastKeyIdx + 1;
+        // still between the same keys
     }
-    else if (!forwards)
+    else if (forwards && k1 + 1 < numKeys - 1 && IsInKeyPair(frame, k1 + 1, keys, size))
     {
-        key2 = GetKey(1, keys, size);
+        k1++;
     }
-
-    // search pairs of keys
-    int count;
-    if (forwards)
+    else if (!forwards && k1 > 0 && k1 - 1 < numKeys - 1 && IsInKeyPair(frame, k1 - 1, keys, size))
     {
-        for (count = 1; count <= numKeys; count++, i++)
-        {
-            if (i >= numKeys)
-            {
-                key1 = GetKey(0, keys, size);
-                i = 1;
-                count++;
-            }
-                
-            key2 = GetKey(i, keys, size);
-            if (frame <= key2->fFrame && frame >= key1->fFrame)
-            {
-                k2=i;
-                k1=i-1;
-                (*kF2) = key2;
-                (*kF1) = key1;
-                *p = (time - (*kF1)->fFrame / MAX_FRAMES_PER_SEC) / (((*kF2)->fFrame - (*kF1)->fFrame) / MAX_FRAMES_PER_SEC);
-                goto ret;
-            }
-            key1=key2;
-        }
+        k1--;
+    }
+    else if (uniformStep)
+    {
+        // Evenly spaced keys, so the pair can be computed directly. Nudge
+        // the result in case float rounding put us one pair off.
+        k1 = std::min(uint32_t((frame - first->fFrame) / uniformStep), numKeys - 2);
+        while (k1 > 0 && frame < GetKey(k1, keys, size)->fFrame)
+            k1--;
+        while (k1 < numKeys - 2 && frame > GetKey(k1 + 1, keys, size)->fFrame)
+            k1++;
     }
     else
     {
-        for (count = 1; count <= numKeys; count++, i--)
+        // Find the first key at or past our frame
+        uint32_t lo = 1, hi = numKeys - 1;
+        while (lo < hi)
         {
-            if (i < 1)
-            {
-                i = numKeys - 1;
-                key2 = GetKey(i, keys, size);
-                count++;
-            }
-            
-            key1 = GetKey(i - 1, keys, size);
-            if (frame <= key2->fFrame && frame >= key1->fFrame)
-            {
-                k2 = i;
-                k1 = i - 1;
-                (*kF2) = key2;
-                (*kF1) = key1;
-                *p = (time - (*kF1)->fFrame / MAX_FRAMES_PER_SEC) / (((*kF2)->fFrame - (*kF1)->fFrame) / MAX_FRAMES_PER_SEC);
-                goto ret;
-            }
-            key2=key1;
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (GetKey(mid, keys, size)->fFrame < frame)
+                lo = mid + 1;
+            else
+                hi = mid;
         }
-    }       
+        k1 = lo - 1;
+    }
 
-ret:
-;
+    (*kF1) = GetKey(k1, keys, size);
+    (*kF2) = GetKey(k1 + 1, keys, size);
+    *p = (time - (*kF1)->fFrame / MAX_FRAMES_PER_SEC) / (((*kF2)->fFrame - (*kF1)->fFrame) / MAX_FRAMES_PER_SEC);
     *lastKeyIdx = k1;
 }
 
@@ -59,6 +59,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plCreatableIndex.h"
 
 
+thread_local std::vector<std::function<void()>>* plAnimTimeConvert::fDeferredSends = nullptr;
+
 plAnimTimeConvert::~plAnimTimeConvert()
 {
     for (plEventCallbackMsg* msg : fCallbackMsgs)
@@ -238,7 +240,11 @@ void plAnimTimeConvert::ISendCallback(hsSsize_t i)
         fCallbackMsgs[i]->SetSender(fOwner ? fOwner->GetKey() : nullptr);
 
         hsRefCnt_SafeRef(fCallbackMsgs[i]);
-        plgDispatch::MsgSend(fCallbackMsgs[i]);
+        if (fDeferredSends) {
+            plEventCallbackMsg* msg = fCallbackMsgs[i];
+            fDeferredSends->emplace_back([msg] { plgDispatch::MsgSend(msg); });
+        } else
+            plgDispatch::MsgSend(fCallbackMsgs[i]);
 
         // No more repeats, remove this callback from our list
         if (fCallbackMsgs[i]->fRepeats == 0)
@@ -309,7 +315,11 @@ plAnimTimeConvert& plAnimTimeConvert::IProcessStateChange(double worldTime, floa
     {
         hsAssert(false, "unknown sdl owner");
     }
-    fOwner->DirtySynchState(sdlName, 0);        // Send SDL state update to server
+    if (fDeferredSends) {
+        plSynchedObject* owner = fOwner;
+        fDeferredSends->emplace_back([owner, sdlName] { owner->DirtySynchState(sdlName, 0); });
+    } else
+        fOwner->DirtySynchState(sdlName, 0);        // Send SDL state update to server
 
     return *this;
 }
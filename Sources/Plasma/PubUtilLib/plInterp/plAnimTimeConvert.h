@@ -42,6 +42,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #ifndef plAnimTimeConvert_inc
 #define plAnimTimeConvert_inc
 
+#include <functional>
 #include <list>
 #include <vector>
 
@@ -96,6 +97,8 @@ protected:
     float fInitialBegin;
     float fInitialEnd;
 
+    static thread_local std::vector<std::function<void()>>* fDeferredSends;
+
     static float ICalcEaseTime(const plATCEaseCurve *curve, double start, double end);
     void            IClearSpeedEase();
 
@@ -198,7 +201,12 @@ public:
     void RemoveCallback(plEventCallbackMsg* pMsg);
     void ClearCallbacks();
     void EnableCallbacks(bool val);
-    
+
+    // While set on the calling thread, callback messages and SDL dirtying are
+    // queued here instead of being dispatched. Used by the parallel animation
+    // update, which flushes the queue on the main thread afterwards.
+    static void SetDeferredSends(std::vector<std::function<void()>>* sends) { fDeferredSends = sends; }
+
     enum plAnimTimeFlags {
         kNone           = 0x0,
         kStopped        = 0x1,
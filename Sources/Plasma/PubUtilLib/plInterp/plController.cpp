@@ -94,7 +94,7 @@ void plLeafController::Interp(float time, float* result, plControllerCacheInfo *
         hsScalarKey *k1, *k2;
         float t;
         uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsScalarKey), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsScalarKey), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
         hsInterp::LinInterp(k1->fValue, k2->fValue, t, result);
     }
     else
@@ -102,7 +102,7 @@ void plLeafController::Interp(float time, float* result, plControllerCacheInfo *
         hsBezScalarKey *k1, *k2;
         float t;
         uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsBezScalarKey), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsBezScalarKey), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
         hsInterp::BezInterp(k1, k2, t, result);
     }
 }
@@ -117,7 +117,7 @@ void plLeafController::Interp(float time, hsScalarTriple* result, plControllerCa
         hsPoint3Key *k1, *k2;
         float t;
         uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsPoint3Key), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsPoint3Key), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
         hsInterp::LinInterp(&k1->fValue, &k2->fValue, t, result);
     }
     else
@@ -125,7 +125,7 @@ void plLeafController::Interp(float time, hsScalarTriple* result, plControllerCa
         hsBezPoint3Key *k1, *k2;
         float t;
         uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsBezPoint3Key), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsBezPoint3Key), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
         hsInterp::BezInterp(k1, k2, t, result);
     }
 }
@@ -140,7 +140,7 @@ void plLeafController::Interp(float time, hsScaleValue* result, plControllerCach
         hsScaleKey *k1, *k2;
         float t;
         uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsScaleKey), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsScaleKey), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
         hsInterp::LinInterp(&k1->fValue, &k2->fValue, t, result);
     }
     else
@@ -148,7 +148,7 @@ void plLeafController::Interp(float time, hsScaleValue* result, plControllerCach
         hsBezScaleKey *k1, *k2;
         float t;
         uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsBezScaleKey), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsBezScaleKey), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
         hsInterp::BezInterp(k1, k2, t, result);
     }
 }
@@ -165,7 +165,7 @@ void plLeafController::Interp(float time, hsQuat* result, plControllerCacheInfo
         hsQuatKey *k1, *k2;
         float t;
         uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsQuatKey), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsQuatKey), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
         hsInterp::LinInterp(&k1->fValue, &k2->fValue, t, result);
     }
     else if (fType == hsKeyFrame::kCompressedQuatKeyFrame32)
@@ -173,7 +173,7 @@ void plLeafController::Interp(float time, hsQuat* result, plControllerCacheInfo
         hsCompressedQuatKey32 *k1, *k2;
         float t;
         uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsCompressedQuatKey32), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsCompressedQuatKey32), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
 
         hsQuat q1, q2;
         k1->GetQuat(q1);
@@ -185,7 +185,7 @@ void plLeafController::Interp(float time, hsQuat* result, plControllerCacheInfo
         hsCompressedQuatKey64 *k1, *k2;
         float t;
         uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsCompressedQuatKey64), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+        hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsCompressedQuatKey64), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
 
         hsQuat q1, q2;
         k1->GetQuat(q1);
@@ -202,7 +202,7 @@ void plLeafController::Interp(float time, hsMatrix33* result, plControllerCacheI
     hsMatrix33Key *k1, *k2;
     float t;
     uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-    hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsMatrix33Key), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+    hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsMatrix33Key), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
     hsInterp::LinInterp(&k1->fValue, &k2->fValue, t, result);
 }
 
@@ -214,7 +214,7 @@ void plLeafController::Interp(float time, hsMatrix44* result, plControllerCacheI
     hsMatrix44Key *k1, *k2;
     float t;
     uint32_t *idxStore = (cache ? &cache->fKeyIndex : &fLastKeyIdx);
-    hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsMatrix44Key), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward);
+    hsInterp::GetBoundaryKeyFrames(time, fNumKeys, fKeys, sizeof(hsMatrix44Key), (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, idxStore, &t, tryForward, fUniformStep);
     hsInterp::LinInterp(&k1->fValue, &k2->fValue, t, result);
 }
 
@@ -414,6 +414,8 @@ void plLeafController::AllocKeys(uint32_t numKeys, uint8_t type)
     delete[] reinterpret_cast<hsKeyFrame *>(fKeys);
     fNumKeys = numKeys;
     fType = type;
+    fLastKeyIdx = 0;
+    fUniformStep = 0;
 
     switch (fType)
     {
@@ -506,6 +508,32 @@ void plLeafController::QuickScalarController(int numKeys, float* times, float* v
         ((hsScalarKey*)fKeys)[i].fValue = *values;
         values = (float *)((uint8_t *)values + valueStrides);
     }
+    ICheckUniformKeys();
+}
+
+// Keys exported from sampled animations (bipeds, baked paths) are usually
+// evenly spaced. Finding that out once lets Interp jump straight to the
+// right pair instead of searching for it.
+void plLeafController::ICheckUniformKeys()
+{
+    fUniformStep = 0;
+
+    uint32_t stride = GetStride();
+    if (stride == 0 || fNumKeys < 3)
+        return;
+
+    uint8_t *keyPtr = (uint8_t *)fKeys;
+    uint16_t first = ((hsKeyFrame *)keyPtr)->fFrame;
+    uint16_t step = ((hsKeyFrame *)(keyPtr + stride))->fFrame - first;
+    if (step == 0)
+        return;
+
+    for (uint32_t i = 2; i < fNumKeys; i++)
+    {
+        if (((hsKeyFrame *)(keyPtr + i * stride))->fFrame != first + i * step)
+            return;
+    }
+    fUniformStep = step;
 }
 
 // If all the keys are the same, this controller is pretty useless.
@@ -705,6 +733,8 @@ void plLeafController::Read(hsStream* s, hsResMgr *mgr)
         hsAssert(false, "Reading in controller with unknown key data");
         break;
     }
+
+    ICheckUniformKeys();
 }
 
 void plLeafController::Write(hsStream* s, hsResMgr *mgr)
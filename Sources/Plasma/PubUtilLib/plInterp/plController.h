@@ -131,9 +131,12 @@ protected:
     void *fKeys; // Need to pay attend to fType to determine what these actually are
     uint32_t fNumKeys;
     mutable uint32_t fLastKeyIdx;
+    uint16_t fUniformStep; // Frames between keys if they're evenly spaced, otherwise 0
+
+    void ICheckUniformKeys();
 
 public:
-    plLeafController() : fType(hsKeyFrame::kUnknownKeyFrame), fKeys(), fNumKeys(), fLastKeyIdx() { }
+    plLeafController() : fType(hsKeyFrame::kUnknownKeyFrame), fKeys(), fNumKeys(), fLastKeyIdx(), fUniformStep() { }
     virtual ~plLeafController();
 
     CLASSNAME_REGISTER( plLeafController );
@@ -59,6 +59,15 @@ enum plVolumeCullResult
     kVolumeSplit        = 0x2
 };
 
+// A pair of parallel planes, bounding the points where fMin <= fNorm.p <= fMax.
+// Either end may be infinite.
+struct plVolumeSlab
+{
+    hsVector3   fNorm;
+    float       fMin;
+    float       fMax;
+};
+
 
 class plVolumeIsect : public plCreatable
 {
@@ -70,6 +79,12 @@ public:
     virtual plVolumeCullResult  Test(const hsBounds3Ext& bnd) const = 0;    
     virtual float            Test(const hsPoint3& pos) const = 0;
 
+    // Volumes that are nothing but a set of slabs can hand them out, so that
+    // lots of bounds can be tested at once (see plSpaceTree). Test(bnd) must
+    // then be exactly: culled if bnd is wholly outside any slab, else split
+    // if it pokes out of any, else clear. Returns false for anything else.
+    virtual bool GetSlabs(std::vector<plVolumeSlab>& slabs) const { return false; }
+
     void Read(hsStream* s, hsResMgr* mgr) override = 0;
     void Write(hsStream* s, hsResMgr* mgr) override = 0;
 };
@@ -204,6 +219,7 @@ public:
 
     plVolumeCullResult  Test(const hsBounds3Ext& bnd) const override;
     float            Test(const hsPoint3& pos) const override;
+    bool GetSlabs(std::vector<plVolumeSlab>& slabs) const override;
 
     void Read(hsStream* s, hsResMgr* mgr) override;
     void Write(hsStream* s, hsResMgr* mgr) override;
@@ -238,6 +254,7 @@ public:
 
     plVolumeCullResult  Test(const hsBounds3Ext& bnd) const override;
     float            Test(const hsPoint3& pos) const override;
+    bool GetSlabs(std::vector<plVolumeSlab>& slabs) const override;
 
     void Read(hsStream* s, hsResMgr* mgr) override;
     void Write(hsStream* s, hsResMgr* mgr) override;
@@ -99,6 +99,9 @@ void plSDLModifier::ISendNetMsg(plStateDataRecord*& state, const plKey& senderKe
 
     writeOptions |= plSDL::kTimeStampOnRead;
 
+    if (plSDLMgr::GetInstance()->AllowCompactDelta())
+        writeOptions |= plSDL::kCompactDelta;
+
 
     // send to server
     plNetMsgSDLState* msg = state->PrepNetMsg(0, writeOptions);
@@ -194,11 +194,11 @@ enum ETransType {
     kBuildIdRequestTrans,
     kManifestRequestTrans,
     kDownloadRequestTrans,
-    kFileRcvdFileDownloadChunkTrans,
 
     //========================================================================
     // NglCore.cpp transactions
     kReportNetErrorTrans,
+    kPostProcTrans,
 
     //========================================================================
     // NglGateKeeper.cpp transactions
@@ -263,10 +263,10 @@ static const char * s_transTypes[] = {
     "BuildIdRequestTrans",
     "ManifestRequestTrans",
     "DownloadRequestTrans",
-    "FileRcvdFileDownloadChunkTrans",
     
     // NglCore.cpp
     "ReportNetErrorTrans",
+    "PostProcTrans",
 
     // NglGateKeeper.cpp
     "GkFileSrvIpAddress",
@@ -68,6 +68,18 @@ struct ReportNetErrorTrans : NetNotifyTrans {
     void Post() override;
 };
 
+struct PostProcTrans : NetNotifyTrans {
+    FNetClientPostProc  m_proc;
+    void *              m_param;
+
+    PostProcTrans (
+        FNetClientPostProc  proc,
+        void *              param
+    );
+
+    void Post() override;
+};
+
 
 /*****************************************************************************
 *
@@ -117,6 +129,22 @@ void ReportNetErrorTrans::Post () {
         s_errorProc(m_errProtocol, m_errError);
 }
 
+//============================================================================
+// PostProcTrans
+//============================================================================
+PostProcTrans::PostProcTrans (
+    FNetClientPostProc  proc,
+    void *              param
+) : NetNotifyTrans(kPostProcTrans)
+,   m_proc(proc)
+,   m_param(param)
+{ }
+
+//============================================================================
+void PostProcTrans::Post () {
+    m_proc(m_param);
+}
+
 
 /*****************************************************************************
 *
@@ -197,3 +225,9 @@ void NetClientPingEnable (bool enable) {
 void NetClientSetErrorHandler (FNetClientErrorProc errorProc) {
     s_errorProc = errorProc;
 }
+
+//============================================================================
+void NetClientPost (FNetClientPostProc proc, void * param) {
+    PostProcTrans * trans = new PostProcTrans(proc, param);
+    NetTransSend(trans);
+}
@@ -72,3 +72,8 @@ typedef void (*FNetClientErrorProc)(
     ENetError       error
 );
 void NetClientSetErrorHandler (FNetClientErrorProc errorProc);
+
+// Calls proc from NetClientUpdate, like the net callbacks, so that other
+// threads can get back to the one that pumps them.
+typedef void (*FNetClientPostProc)(void * param);
+void NetClientPost (FNetClientPostProc proc, void * param);
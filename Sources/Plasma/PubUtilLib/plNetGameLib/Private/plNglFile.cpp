@@ -47,6 +47,11 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "../Pch.h"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 // Define this if the file servers are running behind load-balancing hardware.
 // It changes the logic by which the decision to attempt a reconnect is made.
 #define LOAD_BALANCER_HARDWARE
@@ -69,6 +74,9 @@ struct CliFileConn : hsRefCnt {
     std::vector<uint8_t> recvBuffer;
     AsyncCancelId       cancelId;
     bool                abandoned;
+    bool                connected;
+    unsigned            group;      // sibling connections to the same server share a group
+    unsigned            downloads;  // DownloadRequestTrans using this connection
     unsigned            buildId;
     unsigned            serverType;
 
@@ -177,6 +185,8 @@ struct DownloadRequestTrans : NetFileTrans {
     unsigned                            m_buildId;
     
     unsigned                            m_totalBytesReceived;
+    unsigned                            m_pendingChunks;    // guarded by s_chunkLock
+    bool                                m_chunksFlushed;    // guarded by s_chunkLock
 
     DownloadRequestTrans (
         FNetCliFileDownloadRequestCallback  callback,
@@ -185,6 +195,7 @@ struct DownloadRequestTrans : NetFileTrans {
         hsStream *                          writer,
         unsigned                            buildId
     );
+    ~DownloadRequestTrans ();
 
     bool Send() override;
     void Post() override;
@@ -195,20 +206,11 @@ struct DownloadRequestTrans : NetFileTrans {
 };
 
 //============================================================================
-// RcvdFileDownloadChunkTrans
+// DownloadChunk
 //============================================================================
-struct RcvdFileDownloadChunkTrans : NetNotifyTrans {
-
-    unsigned    bytes;
-    uint8_t *      data;
-    hsStream *  writer;
-
-    RcvdFileDownloadChunkTrans()
-        : NetNotifyTrans(kFileRcvdFileDownloadChunkTrans),
-          bytes(), data(), writer()
-    { }
-    ~RcvdFileDownloadChunkTrans ();
-    void Post() override;
+struct DownloadChunk {
+    DownloadRequestTrans *  trans;
+    std::vector<uint8_t>    data;
 };
 
 
@@ -230,11 +232,32 @@ static CliFileConn *                s_active;
 static std::atomic<long>            s_perf[kNumPerf];
 static unsigned                     s_connectBuildId;
 static unsigned                     s_serverType;
+static unsigned                     s_connGroup;
 
 static FNetCliFileBuildIdUpdateCallback s_buildIdCallback = nullptr;
 
+// Received download chunks are copied into pooled buffers on the net thread
+// and written out by s_chunkWriter, so big downloads don't allocate or bounce
+// through the main thread once per chunk.
+static std::mutex                   s_chunkLock;
+static std::condition_variable      s_chunkQueued;
+static std::condition_variable      s_chunkWritten;
+static std::deque<DownloadChunk *>  s_chunkQueue;
+static std::vector<DownloadChunk *> s_chunkPool;
+static unsigned                     s_chunkCount;
+static std::thread                  s_chunkWriter;
+static bool                         s_chunkWriterStop;
+
 const unsigned kMinValidConnectionMs                = 25 * 1000;
 
+// Once this many chunks are waiting on the disk, the net thread stops reading
+// (and acking) until the writer catches up.
+const unsigned kMaxDownloadChunks                   = 32;
+
+// Each download is paced by its chunk acks, so a few connections to the same
+// server keep the pipe full when many files are in flight at once.
+const unsigned kNumFileConns                        = 3;
+
 
 
 /*****************************************************************************
@@ -250,6 +273,96 @@ static unsigned GetNonZeroTimeMs () {
     return 1;
 }
 
+//============================================================================
+static void ChunkWriterProc () {
+    std::unique_lock<std::mutex> lock(s_chunkLock);
+    for (;;) {
+        s_chunkQueued.wait(lock, [] { return s_chunkWriterStop || !s_chunkQueue.empty(); });
+        if (s_chunkQueue.empty())
+            break;
+
+        DownloadChunk * chunk = s_chunkQueue.front();
+        s_chunkQueue.pop_front();
+        lock.unlock();
+
+        chunk->trans->m_writer->Write((uint32_t)chunk->data.size(), chunk->data.data());
+
+        lock.lock();
+        --chunk->trans->m_pendingChunks;
+        chunk->trans = nullptr;
+        s_chunkPool.push_back(chunk);
+        s_chunkWritten.notify_all();
+    }
+}
+
+//============================================================================
+static void QueueChunk (DownloadRequestTrans * trans, const uint8_t data[], unsigned bytes) {
+    DownloadChunk * chunk;
+    {
+        std::unique_lock<std::mutex> lock(s_chunkLock);
+        if (s_chunkWriterStop)
+            return;
+        if (!s_chunkWriter.joinable())
+            s_chunkWriter = std::thread(ChunkWriterProc);
+
+        s_chunkWritten.wait(lock, [] {
+            return s_chunkWriterStop || !s_chunkPool.empty() || s_chunkCount < kMaxDownloadChunks;
+        });
+        // A cancelled download may already have been posted while this
+        // chunk was on its way in, so its writer might be gone.
+        if (s_chunkWriterStop || trans->m_chunksFlushed)
+            return;
+
+        if (s_chunkPool.empty()) {
+            chunk = new DownloadChunk;
+            ++s_chunkCount;
+        } else {
+            chunk = s_chunkPool.back();
+            s_chunkPool.pop_back();
+        }
+        ++trans->m_pendingChunks;
+    }
+
+    // The pooled buffer keeps its capacity, so after the first few chunks
+    // this is just a copy.
+    chunk->trans = trans;
+    chunk->data.assign(data, data + bytes);
+
+    {
+        hsLockGuard(s_chunkLock);
+        s_chunkQueue.push_back(chunk);
+    }
+    s_chunkQueued.notify_one();
+}
+
+//============================================================================
+static void FlushChunks (DownloadRequestTrans * trans) {
+    std::unique_lock<std::mutex> lock(s_chunkLock);
+    s_chunkWritten.wait(lock, [trans] { return trans->m_pendingChunks == 0; });
+    trans->m_chunksFlushed = true;
+}
+
+//============================================================================
+static void DestroyChunkWriter () {
+    {
+        hsLockGuard(s_chunkLock);
+        s_chunkWriterStop = true;
+    }
+    s_chunkQueued.notify_all();
+    s_chunkWritten.notify_all();
+
+    // The writer drains its queue before exiting, which releases anything
+    // still waiting in FlushChunks.
+    if (s_chunkWriter.joinable())
+        s_chunkWriter.join();
+
+    hsLockGuard(s_chunkLock);
+    for (DownloadChunk * chunk : s_chunkPool)
+        delete chunk;
+    s_chunkPool.clear();
+    s_chunkCount = 0;
+}
+
 //============================================================================
 static CliFileConn * GetConnIncRef_CS (const char tag[]) {
     if (CliFileConn * conn = s_active) {
@@ -265,6 +378,30 @@ static CliFileConn * GetConnIncRef (const char tag[]) {
     return GetConnIncRef_CS(tag);
 }
 
+//============================================================================
+// Picks the connected sibling with the fewest downloads on it
+static CliFileConn * GetDownloadConnIncRef_CS (const char tag[]) {
+    CliFileConn * best = nullptr;
+    for (CliFileConn * conn = s_conns.Head(); conn; conn = s_conns.Next(conn)) {
+        if (conn->connected && (!best || conn->downloads < best->downloads))
+            best = conn;
+    }
+    if (best) {
+        best->Ref(tag);
+        ++best->downloads;
+    }
+    return best;
+}
+
+//============================================================================
+static CliFileConn * FindConnectedConn_CS () {
+    for (CliFileConn * conn = s_conns.Head(); conn; conn = s_conns.Next(conn)) {
+        if (conn->connected)
+            return conn;
+    }
+    return nullptr;
+}
+
 //============================================================================
 static void UnlinkAndAbandonConn_CS (CliFileConn * conn) {
     s_conns.Unlink(conn);
@@ -302,6 +439,7 @@ static void NotifyConnSocketConnect (CliFileConn * conn) {
     hsLockGuard(s_critsect);
     if (!conn->abandoned) {
         conn->AutoPing();
+        conn->connected = true;
         s_active = conn;
     }
     else
@@ -316,10 +454,12 @@ static void NotifyConnSocketConnectFailed (CliFileConn * conn) {
     {
         hsLockGuard(s_critsect);
         conn->cancelId = nullptr;
+        conn->connected = false;
         s_conns.Unlink(conn);
 
+        // Fall back on a sibling connection if there is one
         if (conn == s_active)
-            s_active = nullptr;
+            s_active = FindConnectedConn_CS();
     }
     
     // Cancel all transactions in progress on this connection.
@@ -346,10 +486,12 @@ static void NotifyConnSocketDisconnect (CliFileConn * conn) {
     {
         hsLockGuard(s_critsect);
         conn->cancelId = nullptr;
+        conn->connected = false;
         s_conns.Unlink(conn);
 
+        // Fall back on a sibling connection if there is one
         if (conn == s_active)
-            s_active = nullptr;
+            s_active = FindConnectedConn_CS();
     }
 
     // Cancel all transactions in progress on this connection.
@@ -484,11 +626,13 @@ static void Connect (CliFileConn * conn) {
 
     {
         hsLockGuard(s_critsect);
-        while (CliFileConn * oldConn = s_conns.Head()) {
-            if (oldConn != conn)
-                UnlinkAndAbandonConn_CS(oldConn);
-            else
+        CliFileConn * next;
+        for (CliFileConn * oldConn = s_conns.Head(); oldConn; oldConn = next) {
+            next = s_conns.Next(oldConn);
+            if (oldConn == conn)
                 s_conns.Unlink(oldConn);
+            else if (oldConn->group != conn->group)
+                UnlinkAndAbandonConn_CS(oldConn);
         }
         s_conns.Link(conn);
     }
@@ -520,17 +664,21 @@ static void Connect (
     const plNetAddress& addr
 ) {
     ASSERT(s_running);
-    
-    CliFileConn * conn = new CliFileConn;
-    conn->name            = name;
-    conn->addr            = addr;
-    conn->buildId         = s_connectBuildId;
-    conn->serverType      = s_serverType;
-    conn->seq             = ConnNextSequence();
-    conn->lastHeardTimeMs = GetNonZeroTimeMs();   // used in connect timeout, and ping timeout
 
-    conn->Ref("Lifetime");
-    conn->AutoReconnect();
+    unsigned group = ++s_connGroup;
+    for (unsigned i = 0; i < kNumFileConns; ++i) {
+        CliFileConn * conn = new CliFileConn;
+        conn->name            = name;
+        conn->addr            = addr;
+        conn->group           = group;
+        conn->buildId         = s_connectBuildId;
+        conn->serverType      = s_serverType;
+        conn->seq             = ConnNextSequence();
+        conn->lastHeardTimeMs = GetNonZeroTimeMs();   // used in connect timeout, and ping timeout
+
+        conn->Ref("Lifetime");
+        conn->AutoReconnect();
+    }
 }
 
 //============================================================================
@@ -555,6 +703,7 @@ static void AsyncLookupCallback(void* param, const ST::string& name,
 //============================================================================
 CliFileConn::CliFileConn ()
     : hsRefCnt(0), sock(), seq(), cancelId(), abandoned()
+    , connected(), group(), downloads()
     , buildId(), serverType()
     , reconnectTimer(), reconnectStartMs(), connectStartMs()
     , numImmediateDisconnects(), numFailedConnects()
@@ -1099,17 +1248,31 @@ DownloadRequestTrans::DownloadRequestTrans (
 ,   m_filename(filename)
 ,   m_writer(writer)
 ,   m_totalBytesReceived(0)
+,   m_pendingChunks(0)
+,   m_chunksFlushed(false)
 ,   m_buildId(buildId)
 {
-    // This transaction issues "sub transactions" which must complete
-    // before this one even though they were issued after us.
-    m_hasSubTrans = true;
+}
+
+//============================================================================
+DownloadRequestTrans::~DownloadRequestTrans () {
+    if (m_conn) {
+        hsLockGuard(s_critsect);
+        --m_conn->downloads;
+    }
 }
 
 //============================================================================
 bool DownloadRequestTrans::Send () {
-    if (!AcquireConn())
+    // Downloads are spread over all of the connections rather than just the
+    // active one, so make sure a disconnect cancels the right transactions.
+    if (!m_conn) {
+        hsLockGuard(s_critsect);
+        m_conn = GetDownloadConnIncRef_CS("AcquireConn");
+    }
+    if (!m_conn)
         return false;
+    m_connId = m_conn->seq;
 
     Cli2File_FileDownloadRequest filedownloadReq;
     StrCopy(filedownloadReq.filename, m_filename.WideString().data(), std::size(filedownloadReq.filename));
@@ -1125,6 +1288,10 @@ bool DownloadRequestTrans::Send () {
 
 //============================================================================
 void DownloadRequestTrans::Post () {
+    // The callback usually closes the writer, so everything we received
+    // has to be on disk first. Normally the writer is at most a chunk or
+    // two behind by now.
+    FlushChunks(this);
     m_callback(m_result, m_param, m_filename, m_writer);
 }
 
@@ -1156,16 +1323,10 @@ bool DownloadRequestTrans::Recv (
         return true;
     }
 
-    // we have data to write, so queue it for write in the main thread (we're
+    // we have data to write, so hand it to the chunk writer thread (we're
     // currently in a net recv thread)
-    if (byteCount > 0) {
-        RcvdFileDownloadChunkTrans * writeTrans = new RcvdFileDownloadChunkTrans;
-        writeTrans->writer  = m_writer;
-        writeTrans->bytes   = byteCount;
-        writeTrans->data    = (uint8_t *)malloc(byteCount);
-        memcpy(writeTrans->data, data, byteCount);
-        NetTransSend(writeTrans);
-    }
+    if (byteCount > 0)
+        QueueChunk(this, data, byteCount);
     m_totalBytesReceived += byteCount;
 
     if (m_totalBytesReceived >= reply.totalFileSize) {
@@ -1176,25 +1337,6 @@ bool DownloadRequestTrans::Recv (
     return true;
 }
 
-/*****************************************************************************
-*
-*   RcvdFileDownloadChunkTrans
-*
-***/
-
-//============================================================================
-RcvdFileDownloadChunkTrans::~RcvdFileDownloadChunkTrans () {
-    free(data);
-}
-
-//============================================================================
-void RcvdFileDownloadChunkTrans::Post () {
-    writer->Write(bytes, data);
-    m_result = kNetSuccess;
-    m_state  = kTransStateComplete;
-}
-
-
 } using namespace File;
 
 
@@ -1241,6 +1383,9 @@ void NetFileTrans::ReleaseConn () {
 //============================================================================
 void FileInitialize () {
     s_running = true;
+
+    hsLockGuard(s_chunkLock);
+    s_chunkWriterStop = false;
 }
 
 //============================================================================
@@ -1263,6 +1408,8 @@ void FileDestroy (bool wait) {
         s_active = nullptr;
     }
 
+    DestroyChunkWriter();
+
     if (!wait)
         return;
 
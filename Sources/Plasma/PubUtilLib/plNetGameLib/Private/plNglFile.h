@@ -122,6 +122,8 @@ typedef void (*FNetCliFileDownloadRequestCallback)(
     const plFileName &  filename,
     hsStream *          writer
 );
+// The writer is fed from a background thread as chunks arrive. All writes have
+// finished by the time the callback runs on the main thread.
 void NetCliFileDownloadRequest (
     const plFileName &                  filename,
     hsStream *                          writer,
@@ -120,6 +120,32 @@ void plConvexVolume::SetPlane(const hsPlane3 &plane, const uint32_t index)
     fLocalPlanes[index] = plane;
 }
 
+void plConvexVolume::CopyFrom(const plConvexVolume &other)
+{
+    if (fNumPlanes == other.fNumPlanes)
+    {
+        uint32_t i;
+        for (i = 0; i < fNumPlanes; i++)
+        {
+            if (!(fWorldPlanes[i].fN == other.fWorldPlanes[i].fN) || fWorldPlanes[i].fD != other.fWorldPlanes[i].fD ||
+                !(fLocalPlanes[i].fN == other.fLocalPlanes[i].fN) || fLocalPlanes[i].fD != other.fLocalPlanes[i].fD)
+                break;
+        }
+        if (i == fNumPlanes)
+            return;
+    }
+    else
+    {
+        SetNumPlanesAndClear(other.fNumPlanes);
+    }
+
+    for (uint32_t i = 0; i < fNumPlanes; i++)
+    {
+        fLocalPlanes[i] = other.fLocalPlanes[i];
+        fWorldPlanes[i] = other.fWorldPlanes[i];
+    }
+}
+
 bool plConvexVolume::IsInside(const hsPoint3 &pos) const
 {
     int i;
@@ -67,6 +67,10 @@ public:
     void SetNumPlanesAndClear(const uint32_t num);
     void SetPlane(const hsPlane3 &plane, const uint32_t index);
 
+    // Copies another volume's planes (local and world). Nothing is written if
+    // they already match, so an unchanged copy stays safe to read meanwhile.
+    void CopyFrom(const plConvexVolume &other);
+
     // If you only care about the test, call this. Otherwise call ResolvePoint.
     bool IsInside(const hsPoint3 &pos) const;
 
@@ -43,8 +43,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define plEffectTargetInfo_inc
 
 #include "HeadSpin.h"
+#include "hsGeometry3.h"
 
-struct hsPoint3;
 class plPipeline;
 class plParticleSystem;
 
@@ -59,6 +59,11 @@ public:
     plParticleSystem*   fSystem;
     double              fSecs;
     float            fDelSecs;
+
+    // The camera when the update was queued. Updates run on worker threads,
+    // so effects use these instead of asking the pipeline.
+    hsPoint3            fViewPos;
+    hsVector3           fViewDir;
 };
 
 
@@ -45,6 +45,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsGeometry3.h"
 #include "hsColorRGBA.h"
 
+#include <algorithm>
+
 // The meat of the particle. These classes, in combination with the plParticleEmitter that spawned it,
 // should contain everything specific to a particle, necessary to build a renderable poly to represent a 
 // particular particle. (The emitter is necessary for properties (like texture) that are common among all
@@ -71,8 +73,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 // The class plParticleCore should ONLY contain data necessary for the Drawable to create renderable polys
 // Everything else goes into plParticleExt.
 
-// plParticleEmitter is depending on the order that member variables appear in these classes, so
-// DON'T MODIFY THEM WITHOUT MAKING SURE THE CONSTRUCTOR TO plParticleEmitter PROPERLY COMPUTES
+// plParticleEmitter is depending on the order that member variables appear in plParticleCore, so
+// DON'T MODIFY IT WITHOUT MAKING SURE THE CONSTRUCTOR TO plParticleEmitter PROPERLY COMPUTES
 // BASE ADDRESSES AND STRIDES!
 
 // No initialization on construct. In nearly all cases, a default value won't be appropriate
@@ -89,26 +91,84 @@ public:
     hsPoint3 fUVCoords[4];
 };
 
+// plParticleExt keeps one array per member, all indexed the same as the Core pool, so the
+// emitter's update can stream through each of them on its own. It also keeps the working copy
+// of the particle positions (copied back into the Cores once the update is done).
 class plParticleExt
 {
 public:
-    //hsPoint3 fOldPos;
-    hsVector3 fVelocity;
-    float fInvMass; // The inverse (1 / mass) is what we actually need for calculations. Storing it this
-                       // way allows us to make an object immovable with an inverse mass of 0 (and save a divide).
-    hsVector3 fAcceleration; // Accumulated from multiple forces.
-    float fLife; // how many seconds before we recycle this? (My particle has more of a life than I do...)
-    float fStartLife;
-    float fScale;
-    float fRadsPerSec;
-    //uint32_t fOrigColor;
+    hsPoint3 *fPos;
+    hsVector3 *fVelocity;
+    float *fInvMass; // The inverse (1 / mass) is what we actually need for calculations. Storing it this
+                     // way allows us to make an object immovable with an inverse mass of 0 (and save a divide).
+    hsVector3 *fAcceleration; // Accumulated from multiple forces.
+    float *fLife; // how many seconds before we recycle this? (My particle has more of a life than I do...)
+    float *fStartLife;
+    float *fScale;
+    float *fRadsPerSec;
+    uint32_t *fMiscFlags;
 
     enum // Miscellaneous flags for particles
     {
         kImmortal                   = 0x00000001,
+        kDead                       = 0x00000002, // Removed at the end of the emitter's update
     };
-    uint32_t fMiscFlags;  // I know... 32 bits for a single flag...
-                        // Feel free to change this if you've got something to pack it against.
+
+    plParticleExt()
+        : fPos(), fVelocity(), fInvMass(), fAcceleration(), fLife(),
+          fStartLife(), fScale(), fRadsPerSec(), fMiscFlags()
+    { }
+    ~plParticleExt() { Free(); }
+
+    plParticleExt(const plParticleExt&) = delete;
+    plParticleExt& operator=(const plParticleExt&) = delete;
+
+    void Alloc(uint32_t num)
+    {
+        Free();
+        fPos = new hsPoint3[num];
+        fVelocity = new hsVector3[num];
+        fInvMass = new float[num];
+        fAcceleration = new hsVector3[num];
+        fLife = new float[num];
+        fStartLife = new float[num];
+        fScale = new float[num];
+        fRadsPerSec = new float[num];
+        fMiscFlags = new uint32_t[num];
+    }
+
+    void Free()
+    {
+        delete [] fPos;
+        delete [] fVelocity;
+        delete [] fInvMass;
+        delete [] fAcceleration;
+        delete [] fLife;
+        delete [] fStartLife;
+        delete [] fScale;
+        delete [] fRadsPerSec;
+        delete [] fMiscFlags;
+        fPos = nullptr;
+        fVelocity = nullptr;
+        fInvMass = nullptr;
+        fAcceleration = nullptr;
+        fLife = fStartLife = fScale = fRadsPerSec = nullptr;
+        fMiscFlags = nullptr;
+    }
+
+    // Copies num particles starting at src's srcIdx into our dstIdx.
+    void Copy(uint32_t dstIdx, const plParticleExt& src, uint32_t srcIdx, uint32_t num)
+    {
+        std::copy_n(src.fPos + srcIdx, num, fPos + dstIdx);
+        std::copy_n(src.fVelocity + srcIdx, num, fVelocity + dstIdx);
+        std::copy_n(src.fInvMass + srcIdx, num, fInvMass + dstIdx);
+        std::copy_n(src.fAcceleration + srcIdx, num, fAcceleration + dstIdx);
+        std::copy_n(src.fLife + srcIdx, num, fLife + dstIdx);
+        std::copy_n(src.fStartLife + srcIdx, num, fStartLife + dstIdx);
+        std::copy_n(src.fScale + srcIdx, num, fScale + dstIdx);
+        std::copy_n(src.fRadsPerSec + srcIdx, num, fRadsPerSec + dstIdx);
+        std::copy_n(src.fMiscFlags + srcIdx, num, fMiscFlags + dstIdx);
+    }
 };
 
 #endif
@@ -60,26 +60,34 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include <algorithm>
 
+void plParticleEffect::ApplyEffectBatch(const plEffectTargetInfo& target, uint32_t first, uint32_t last)
+{
+    for (uint32_t i = first; i < last; i++)
+        ApplyEffect(target, i);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 plParticleCollisionEffect::plParticleCollisionEffect()
 {
-    fBounds = nullptr;
     fSceneObj = nullptr;
+    fHasBounds = false;
 }
 
 plParticleCollisionEffect::~plParticleCollisionEffect()
 {
 }
 
-void plParticleCollisionEffect::PrepareEffect(const plEffectTargetInfo &target)
+void plParticleCollisionEffect::PrepareUpdate()
 {
-    if (fBounds == nullptr)
-    {
-        plBoundInterface *bi = plBoundInterface::ConvertNoRef(fSceneObj->GetGenericInterface(plBoundInterface::Index()));
-        if (bi == nullptr)
-            return;
-        fBounds = bi->GetVolume();
-    }
+    plBoundInterface *bi = nullptr;
+    if (fSceneObj != nullptr)
+        bi = plBoundInterface::ConvertNoRef(fSceneObj->GetGenericInterface(plBoundInterface::Index()));
+
+    // No updates run while this is called (they're all queued until the next
+    // batch), so the copy is safe to write even if other systems share us.
+    fHasBounds = bi != nullptr && bi->GetVolume() != nullptr;
+    if (fHasBounds)
+        fBounds.CopyFrom(*bi->GetVolume());
 }
 
 bool plParticleCollisionEffect::MsgReceive(plMessage* msg)
@@ -107,7 +115,7 @@ void plParticleCollisionEffect::Read(hsStream *s, hsResMgr *mgr)
     plGenRefMsg* msg;
     msg = new plGenRefMsg(GetKey(), plRefMsg::kOnCreate, 0, 0); // SceneObject
     mgr->ReadKeyNotifyMe(s, msg, plRefFlags::kActiveRef);
-    fBounds = nullptr;
+    fHasBounds = false;
 }
 
 void plParticleCollisionEffect::Write(hsStream *s, hsResMgr *mgr)
@@ -129,11 +137,11 @@ bool plParticleCollisionEffectBeat::ApplyEffect(const plEffectTargetInfo &target
 {
     hsAssert(i >= 0, "Use of default argument doesn't make sense for plParticleCollisionEffect");
 
-    if( !fBounds )
+    if (!fHasBounds)
         return false;
 
     hsPoint3 *currPos = (hsPoint3 *)(target.fPos + i * target.fPosStride);
-    fBounds->ResolvePoint(*currPos);    
+    fBounds.ResolvePoint(*currPos);    
 
     return false;
 }
@@ -148,11 +156,11 @@ bool plParticleCollisionEffectDie::ApplyEffect(const plEffectTargetInfo &target,
 {
     hsAssert(i >= 0, "Use of default argument doesn't make sense for plParticleCollisionEffect");
 
-    if( !fBounds )
+    if (!fHasBounds)
         return false;
 
     hsPoint3 *currPos = (hsPoint3 *)(target.fPos + i * target.fPosStride);
-    return fBounds->IsInside(*currPos); 
+    return fBounds.IsInside(*currPos); 
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -167,12 +175,12 @@ bool plParticleCollisionEffectBounce::ApplyEffect(const plEffectTargetInfo &targ
 {
     hsAssert(i >= 0, "Use of default argument doesn't make sense for plParticleCollisionEffect");
 
-    if( !fBounds )
+    if (!fHasBounds)
         return false;
 
     hsPoint3* currPos = (hsPoint3 *)(target.fPos + i * target.fPosStride);
     hsVector3* currVel = (hsVector3*)(target.fVelocity + i * target.fVelocityStride);
-    fBounds->BouncePoint(*currPos, *currVel, fBounce, fFriction);   
+    fBounds.BouncePoint(*currPos, *currVel, fBounce, fFriction);   
 
     return false;
 }
@@ -247,8 +255,8 @@ const float kInvFadeFrac = 1.f / (kFadeFrac * 0.5f);
 
 void plParticleFadeVolumeEffect::PrepareEffect(const plEffectTargetInfo &target)
 {
-    hsPoint3 viewLoc = target.fContext.fPipeline->GetViewPositionWorld();
-    hsVector3 viewDir = target.fContext.fPipeline->GetViewDirWorld();
+    hsPoint3 viewLoc = target.fContext.fViewPos;
+    hsVector3 viewDir = target.fContext.fViewDir;
 
     // Nuking out the setting of viewDir.fZ to 0 when we aren't centering
     // about Z (fIgnoreZ == true), because we still want to center our
@@ -413,7 +421,7 @@ void plParticleWindEffect::PrepareEffect(const plEffectTargetInfo& target)
 {
     if( fLastDirSecs != target.fContext.fSecs )
     {
-        static plRandom random;
+        static thread_local plRandom random;
         fRandDir.fX += random.RandMinusOneToOne() * fSwirl;
         fRandDir.fY += random.RandMinusOneToOne() * fSwirl;
         if( !GetHorizontal() )
@@ -583,7 +591,7 @@ void plParticleUniformWind::PrepareEffect(const plEffectTargetInfo& target)
 
     if( fLastFreqSecs != target.fContext.fSecs )
     {
-        static plRandom random;
+        static thread_local plRandom random;
 
         double t0 = fFreqCurr * fLastFreqSecs + fCurrPhase;
         float t1 = (float)std::fmod(t0, hsConstants::two_pi<double>);
@@ -630,6 +638,17 @@ bool plParticleUniformWind::ApplyEffect(const plEffectTargetInfo& target, int32_
     return false;
 }
 
+void plParticleUniformWind::ApplyEffectBatch(const plEffectTargetInfo& target, uint32_t first, uint32_t last)
+{
+    // The wind is the same for everyone, only the mass changes.
+    for (uint32_t i = first; i < last; i++)
+    {
+        hsVector3& vel = *(hsVector3*)(target.fVelocity + i * target.fVelocityStride);
+        const float invMass = *(float*)(target.fInvMass + i * target.fInvMassStride);
+        vel += fWindVec * (invMass * fCurrentStrength);
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////
 // Simplified flocking.
 
@@ -711,7 +730,7 @@ bool plParticleFlockEffect::ApplyEffect(const plEffectTargetInfo& target, int32_
     float curSpeed = vel.Magnitude();
     hsPoint3 goal;
     if (*(uint32_t*)(target.fMiscFlags + i * target.fMiscFlagsStride) & plParticleExt::kImmortal)
-        goal = target.fContext.fSystem->GetTarget(0)->GetLocalToWorld().GetTranslate() + fTargetOffset;
+        goal = target.fContext.fSystem->GetLocalToWorld().GetTranslate() + fTargetOffset;
     else
         goal = fDissenterTarget;
     
@@ -841,7 +860,7 @@ plParticleFollowSystemEffect::plParticleFollowSystemEffect() : fEvalThisFrame(tr
 
 void plParticleFollowSystemEffect::PrepareEffect(const plEffectTargetInfo& target)
 {
-    fEvalThisFrame = (fOldW2L != target.fContext.fSystem->GetTarget(0)->GetWorldToLocal());
+    fEvalThisFrame = (fOldW2L != target.fContext.fSystem->GetWorldToLocal());
 }
 
 bool plParticleFollowSystemEffect::ApplyEffect(const plEffectTargetInfo& target, int32_t i)
@@ -851,7 +870,7 @@ bool plParticleFollowSystemEffect::ApplyEffect(const plEffectTargetInfo& target,
         if (i < target.fFirstNewParticle && !fOldW2L.IsIdentity())
         {
             hsPoint3 &pos = *(hsPoint3*)(target.fPos + i * target.fPosStride);
-            pos = target.fContext.fSystem->GetTarget(0)->GetLocalToWorld() * fOldW2L * pos;
+            pos = target.fContext.fSystem->GetLocalToWorld() * fOldW2L * pos;
         }
     }
     return true;
@@ -860,7 +879,7 @@ bool plParticleFollowSystemEffect::ApplyEffect(const plEffectTargetInfo& target,
 void plParticleFollowSystemEffect::EndEffect(const plEffectTargetInfo& target)
 {
     if (fEvalThisFrame)
-        fOldW2L = target.fContext.fSystem->GetTarget(0)->GetWorldToLocal();
+        fOldW2L = target.fContext.fSystem->GetWorldToLocal();
 }
 
 
@@ -45,8 +45,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pnKeyedObject/hsKeyedObject.h"
 #include "hsMatrix44.h"
 
+#include "plConvexVolume.h"
+
 class plEffectTargetInfo;
-class plConvexVolume;
 class hsResMgr;
 class plSceneObject;
 
@@ -66,8 +67,19 @@ public:
     //  EndEffect marks no more particles will be processed with the above
     //      context (invalidating anything cached).
     // Defaults for Prepare and End are no-ops.
+    // Forces and effects are run through ApplyEffectBatch, once for the
+    //      particles [first, last), which by default just calls ApplyEffect
+    //      on each of them (ignoring the result). Override it if the effect
+    //      can do the whole run in a tighter loop.
+    // All of the above may run on a worker thread, but never for two
+    //      systems at once, since systems that share an effect are updated
+    //      in the same job. PrepareUpdate is called on the main thread when
+    //      each update is queued, while no updates are running, so effects
+    //      that depend on other objects should copy what they need there.
+    virtual void PrepareUpdate() {}
     virtual void PrepareEffect(const plEffectTargetInfo& target) {}
     virtual bool ApplyEffect(const plEffectTargetInfo& target, int32_t i) = 0;
+    virtual void ApplyEffectBatch(const plEffectTargetInfo& target, uint32_t first, uint32_t last);
     virtual void EndEffect(const plEffectTargetInfo& target) {}
 };
 
@@ -80,7 +92,7 @@ public:
     CLASSNAME_REGISTER( plParticleCollisionEffect );
     GETINTERFACE_ANY( plParticleCollisionEffect, plParticleEffect );
 
-    void PrepareEffect(const plEffectTargetInfo& target) override;
+    void PrepareUpdate() override;
 
     void Read(hsStream *s, hsResMgr *mgr) override;
     void Write(hsStream *s, hsResMgr *mgr) override;
@@ -88,7 +100,10 @@ public:
 
 protected:
     plSceneObject *fSceneObj;
-    plConvexVolume *fBounds;
+
+    // Copy of fSceneObj's bounds, which is all the update is allowed to look at
+    plConvexVolume fBounds;
+    bool fHasBounds;
 };
 
 // Default particle blocker. Doesn't affect particle's velocity,
@@ -275,6 +290,7 @@ public:
 
     void PrepareEffect(const plEffectTargetInfo& target) override;
     bool ApplyEffect(const plEffectTargetInfo& target, int32_t i) override;
+    void ApplyEffectBatch(const plEffectTargetInfo& target, uint32_t first, uint32_t last) override;
 
     void        SetFrequencyRange(float minSecsPerCycle, float maxSecsPerCycle);
     void        SetFrequencyRate(float secsPerCycle);
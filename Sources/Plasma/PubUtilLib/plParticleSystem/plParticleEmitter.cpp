@@ -45,11 +45,11 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plParticle.h"
 #include "plParticleEffect.h"
 #include "plParticleGenerator.h"
+#include "plParticleKernels.h"
 #include "plParticleSystem.h"
 
 #include "hsColorRGBA.h"
 #include "hsFastMath.h"
-#include "plProfile.h"
 #include "hsResMgr.h"
 
 #include "pnMessage/plRefMsg.h"
@@ -61,9 +61,6 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 
 
-plProfile_CreateTimer("Update", "Particles", ParticleUpdate);
-plProfile_CreateTimer("Generate", "Particles", ParticleGenerate);
-
 plParticleEmitter::plParticleEmitter()
     : fParticleCores(), fParticleExts(), fGenerator(),
       fTimeToLive(), fSystem(), fSpanIndex(), fNumValidParticles(),
@@ -124,8 +121,7 @@ void plParticleEmitter::IClear()
 {
     delete [] fParticleCores;
     fParticleCores = nullptr;
-    delete [] fParticleExts;
-    fParticleExts = nullptr;
+    fParticleExts.Free();
     if( !(fMiscFlags & kBorrowedGenerator) )
         delete fGenerator;
     fGenerator = nullptr;
@@ -136,23 +132,24 @@ void plParticleEmitter::ISetupParticleMem()
     fNumValidParticles = 0;
 
     fParticleCores = new plParticleCore[fMaxParticles];
-    fParticleExts = new plParticleExt[fMaxParticles];
+    fParticleExts.Alloc(fMaxParticles);
 
-    fTargetInfo.fPos = (uint8_t *)fParticleCores;
     fTargetInfo.fColor = (uint8_t *)fParticleCores + sizeof(hsPoint3);
-    fTargetInfo.fPosStride = fTargetInfo.fColorStride = sizeof(plParticleCore);
-
-    fTargetInfo.fVelocity = (uint8_t *)fParticleExts;
-    fTargetInfo.fInvMass = fTargetInfo.fVelocity + sizeof(hsVector3);
-    fTargetInfo.fAcceleration = fTargetInfo.fInvMass + sizeof(float);
-    fTargetInfo.fMiscFlags = (uint8_t *)&(fParticleExts[0].fMiscFlags);   
-    fTargetInfo.fRadsPerSec = (uint8_t *)&(fParticleExts[0].fRadsPerSec);
-    fTargetInfo.fVelocityStride 
-        = fTargetInfo.fInvMassStride 
-        = fTargetInfo.fAccelerationStride 
-        = fTargetInfo.fRadsPerSecStride
-        = fTargetInfo.fMiscFlagsStride 
-        = sizeof(plParticleExt);
+    fTargetInfo.fColorStride = sizeof(plParticleCore);
+
+    // Effects work on the Ext copy of the positions, which goes back into the Cores after the update.
+    fTargetInfo.fPos = (uint8_t *)fParticleExts.fPos;
+    fTargetInfo.fVelocity = (uint8_t *)fParticleExts.fVelocity;
+    fTargetInfo.fInvMass = (uint8_t *)fParticleExts.fInvMass;
+    fTargetInfo.fAcceleration = (uint8_t *)fParticleExts.fAcceleration;
+    fTargetInfo.fMiscFlags = (uint8_t *)fParticleExts.fMiscFlags;
+    fTargetInfo.fRadsPerSec = (uint8_t *)fParticleExts.fRadsPerSec;
+    fTargetInfo.fPosStride = sizeof(hsPoint3);
+    fTargetInfo.fVelocityStride = sizeof(hsVector3);
+    fTargetInfo.fInvMassStride = sizeof(float);
+    fTargetInfo.fAccelerationStride = sizeof(hsVector3);
+    fTargetInfo.fMiscFlagsStride = sizeof(uint32_t);
+    fTargetInfo.fRadsPerSecStride = sizeof(float);
 }
 
 uint32_t plParticleEmitter::GetNumTiles() const
@@ -170,7 +167,6 @@ void plParticleEmitter::AddParticle(hsPoint3 &pos, hsVector3 &velocity, uint32_t
                                     hsPoint3 &orientation, uint32_t miscFlags, float radsPerSec)
 {
     plParticleCore *core;
-    plParticleExt *ext;
     uint32_t currParticle;
 
     if (fNumValidParticles == fMaxParticles)
@@ -205,17 +201,17 @@ void plParticleEmitter::AddParticle(hsPoint3 &pos, hsVector3 &velocity, uint32_t
     core->fUVCoords[3].fY = yOff;
     core->fUVCoords[3].fZ = 1.0f;
 
-    ext = &fParticleExts[currParticle];
-    ext->fVelocity = velocity;
-    ext->fInvMass = invMass;
-    ext->fLife = ext->fStartLife = life;
-    ext->fMiscFlags = miscFlags; // Is this ever NOT zero?
+    fParticleExts.fPos[currParticle] = pos;
+    fParticleExts.fVelocity[currParticle] = velocity;
+    fParticleExts.fInvMass[currParticle] = invMass;
+    fParticleExts.fLife[currParticle] = fParticleExts.fStartLife[currParticle] = life;
+    fParticleExts.fMiscFlags[currParticle] = miscFlags & ~plParticleExt::kDead; // Is this ever NOT zero?
     if (life <= 0) 
-        ext->fMiscFlags |= plParticleExt::kImmortal;
+        fParticleExts.fMiscFlags[currParticle] |= plParticleExt::kImmortal;
 
-    ext->fRadsPerSec = radsPerSec;
-    ext->fAcceleration.Set(0, 0, 0);
-    ext->fScale = scale;
+    fParticleExts.fRadsPerSec[currParticle] = radsPerSec;
+    fParticleExts.fAcceleration[currParticle].Set(0, 0, 0);
+    fParticleExts.fScale[currParticle] = scale;
 }
 
 void plParticleEmitter::WipeExistingParticles()
@@ -247,11 +243,11 @@ void plParticleEmitter::KillParticles(float num, float timeToDie, uint8_t flags)
     int i;
     for (i = 0; i < fNumValidParticles && num > 0; i++)
     {
-        if ((flags & plParticleKillMsg::kParticleKillImmortalOnly) && !(fParticleExts[i].fMiscFlags & plParticleExt::kImmortal))
+        if ((flags & plParticleKillMsg::kParticleKillImmortalOnly) && !(fParticleExts.fMiscFlags[i] & plParticleExt::kImmortal))
             continue;
 
-        fParticleExts[i].fLife = fParticleExts[i].fStartLife = timeToDie;
-        fParticleExts[i].fMiscFlags &= ~plParticleExt::kImmortal;
+        fParticleExts.fLife[i] = fParticleExts.fStartLife[i] = timeToDie;
+        fParticleExts.fMiscFlags[i] &= ~plParticleExt::kImmortal;
         num--;
     }
 }
@@ -273,7 +269,7 @@ uint16_t plParticleEmitter::StealParticlesFrom(plParticleEmitter *victim, uint16
     {
         // copy them over
         memcpy(&(fParticleCores[fNumValidParticles]), &(victim->fParticleCores[victim->fNumValidParticles - numToCopy]), numToCopy * sizeof(plParticleCore));
-        memcpy(&(fParticleExts[fNumValidParticles]), &(victim->fParticleExts[victim->fNumValidParticles- numToCopy]), numToCopy * sizeof(plParticleExt));
+        fParticleExts.Copy(fNumValidParticles, victim->fParticleExts, victim->fNumValidParticles - numToCopy, numToCopy);
 
         fNumValidParticles += numToCopy;
         victim->fNumValidParticles -= numToCopy;
@@ -286,19 +282,19 @@ void plParticleEmitter::TranslateAllParticles(hsPoint3 &amount)
 {
     int i;
     for (i = 0; i < fNumValidParticles; i++)
+    {
         fParticleCores[i].fPos += amount;
+        fParticleExts.fPos[i] += amount;
+    }
 }
 
 bool plParticleEmitter::IUpdate(float delta)
 {
+    // This can run on one of plParticleSystem's job threads, so there's no profiling in here.
     if (fMiscFlags & kNeedsUpdate)
     {
-        plProfile_BeginTiming(ParticleUpdate);
-
         IUpdateParticles(delta);
         IUpdateBoundsAndNormals(delta);
-
-        plProfile_EndTiming(ParticleUpdate);
     }
 
     if (fGenerator == nullptr && fNumValidParticles <= 0)
@@ -310,22 +306,13 @@ bool plParticleEmitter::IUpdate(float delta)
 void plParticleEmitter::IUpdateParticles(float delta)
 {
     // Have to remove particles before adding new ones, or we can run out of room.
-    for (uint32_t i = 0; i < fNumValidParticles; i++)
-    {
-        fParticleExts[i].fLife -= delta;
-        if (fParticleExts[i].fLife <= 0 && !(fParticleExts[i].fMiscFlags & plParticleExt::kImmortal))
-        {
-            IRemoveParticle(i);
-            i--; // so that we hit this index again on the next iteration
-            continue;
-        }
-    }
+    plParticleKernels::DecayLife(fParticleExts.fLife, fNumValidParticles, delta);
+    IKillExpiredParticles();
 
     fTargetInfo.fFirstNewParticle = fNumValidParticles;
     
     if ((fGenerator != nullptr) && (fTimeToLive >= 0))
     {
-        plProfile_BeginLap(ParticleGenerate, fSystem->GetKeyName().c_str());
         if (!fGenerator->AddAutoParticles(this, delta))
         {
             delete fGenerator;
@@ -333,19 +320,13 @@ void plParticleEmitter::IUpdateParticles(float delta)
         }
         if( (fTimeToLive > 0) && ((fTimeToLive -= delta) <= 0) )
             fTimeToLive = -1.f;
-        plProfile_EndLap(ParticleGenerate, fSystem->GetKeyName().c_str());
     }
 
     fTargetInfo.fContext = fSystem->fContext;
     fTargetInfo.fNumValidParticles = fNumValidParticles;
-    const hsVector3 up(0.f, 0.f, 1.0f);
-    hsVector3 currDirection;
-    hsPoint3 *currPos;
-    hsVector3 *currVelocity;
-    hsVector3 *currAccel;
     hsPoint3 color(fColor.r, fColor.g, fColor.b);
     float alpha = fColor.a;
-    plController *colorCtl;
+    plController *colorCtl = (fMiscFlags & kMatIsEmissive ? fSystem->fAmbientCtl : fSystem->fDiffuseCtl);
 
     // Allow effects a chance to cache any upfront calculations
     // that will apply to all particles.
@@ -362,12 +343,15 @@ void plParticleEmitter::IUpdateParticles(float delta)
         constraint->PrepareEffect(fTargetInfo);
     }
 
-    for (uint32_t i = 0; i < fNumValidParticles; i++)
+    // Everything from here on is done a step at a time over all of the particles,
+    // so each step is one tight loop over just the arrays it needs.
+    const uint32_t numParticles = fNumValidParticles;
+
+    for (uint32_t i = 0; i < numParticles; i++)
     {
-        if (!( fParticleExts[i].fMiscFlags & plParticleExt::kImmortal ))
+        if (!( fParticleExts.fMiscFlags[i] & plParticleExt::kImmortal ))
         {           
-            float percent = (1.0f - fParticleExts[i].fLife / fParticleExts[i].fStartLife);
-            colorCtl = (fMiscFlags & kMatIsEmissive ? fSystem->fAmbientCtl : fSystem->fDiffuseCtl);
+            float percent = (1.0f - fParticleExts.fLife[i] / fParticleExts.fStartLife[i]);
             if (colorCtl != nullptr)
                 colorCtl->Interp(colorCtl->GetLength() * percent, &color);
 
@@ -385,81 +369,85 @@ void plParticleEmitter::IUpdateParticles(float delta)
             {
                 fSystem->fWidthCtl->Interp(fSystem->fWidthCtl->GetLength() * percent,
                                            &fParticleCores[i].fHSize);
-                fParticleCores[i].fHSize *= fParticleExts[i].fScale;
+                fParticleCores[i].fHSize *= fParticleExts.fScale[i];
             }
             if (fSystem->fHeightCtl != nullptr)
             {
                 fSystem->fHeightCtl->Interp(fSystem->fHeightCtl->GetLength() * percent,
                                             &fParticleCores[i].fVSize);
-                fParticleCores[i].fVSize *= fParticleExts[i].fScale;
+                fParticleCores[i].fVSize *= fParticleExts.fScale[i];
             }
 
             fParticleCores[i].fColor = CreateHexColor(color.fX, color.fY, color.fZ, alpha);                     
         }
+    }
 
-        for (plParticleEffect* forceEffect : fSystem->fForces)
-        {
-            forceEffect->ApplyEffect(fTargetInfo, i);
-        }
-        
-        currPos = (hsPoint3 *)(fTargetInfo.fPos + i * fTargetInfo.fPosStride);
-        currVelocity = (hsVector3 *)(fTargetInfo.fVelocity + i * fTargetInfo.fVelocityStride);
-        //currAccel = (hsVector3 *)(fTargetInfo.fAcceleration + i * fTargetInfo.fAccelerationStride);
-        currAccel = &fSystem->fAccel; // Nothing accellerates on a per-particle basis (yet)
+    for (plParticleEffect* forceEffect : fSystem->fForces)
+    {
+        forceEffect->ApplyEffectBatch(fTargetInfo, 0, numParticles);
+    }
 
-        *currPos += *currVelocity * delta;
+    plParticleKernels::Integrate(fParticleExts.fPos, fParticleExts.fVelocity, numParticles, delta);
 
-        // This is the only orientation option (so far) that requires an update here
-        if (fMiscFlags & (kOrientationVelocityBased | kOrientationVelocityStretch | kOrientationVelocityFlow))
+    // This is the only orientation option (so far) that requires an update here
+    if (fMiscFlags & (kOrientationVelocityBased | kOrientationVelocityStretch | kOrientationVelocityFlow))
+    {
+        for (uint32_t i = 0; i < numParticles; i++)
         {
             // mf - want the orientation to be a delposition
-            hsVector3 tmp = *currVelocity * delta;
+            hsVector3 tmp = fParticleExts.fVelocity[i] * delta;
             fParticleCores[i].fOrientation.Set(&tmp);
         }
-        else if( fParticleExts[i].fRadsPerSec != 0 )
+    }
+    else
+    {
+        for (uint32_t i = 0; i < numParticles; i++)
         {
-            float sinX, cosX;
-            hsFastMath::SinCos(fParticleExts[i].fLife * fParticleExts[i].fRadsPerSec * hsConstants::two_pi<float>, sinX, cosX);
-            fParticleCores[i].fOrientation.Set(sinX, -cosX, 0);
+            if( fParticleExts.fRadsPerSec[i] != 0 )
+            {
+                float sinX, cosX;
+                hsFastMath::SinCos(fParticleExts.fLife[i] * fParticleExts.fRadsPerSec[i] * hsConstants::two_pi<float>, sinX, cosX);
+                fParticleCores[i].fOrientation.Set(sinX, -cosX, 0);
+            }
         }
+    }
 
-        // Viscous force F(t) = -k V(t)
-        // Integral S from t0 to t1 of F(t) is
-        // = S(-kV(t))[t1..t0]
-        // = -k(P(t1) - P(t0))
-        // = -k*(currVelocity * delta)
-        // or
-        // V = V + -k*(V * delta)
-        // V *= (1 + -k * delta)
-        // Giving the change in velocity.
-        float drag = 1.f + fSystem->fDrag * delta;
-        // Clamp it at 0. Drag should never cause a reversal in velocity direction.
-        if( drag < 0.f )
-            drag = 0.f;
-        *currVelocity *= drag;
-
-        *currVelocity += *currAccel * delta;
-
-        for (plParticleEffect* effect : fSystem->fEffects)
-        {
-            effect->ApplyEffect(fTargetInfo, i);
-        }
+    // Viscous force F(t) = -k V(t)
+    // Integral S from t0 to t1 of F(t) is
+    // = S(-kV(t))[t1..t0]
+    // = -k(P(t1) - P(t0))
+    // = -k*(currVelocity * delta)
+    // or
+    // V = V + -k*(V * delta)
+    // V *= (1 + -k * delta)
+    // Giving the change in velocity.
+    float drag = 1.f + fSystem->fDrag * delta;
+    // Clamp it at 0. Drag should never cause a reversal in velocity direction.
+    if( drag < 0.f )
+        drag = 0.f;
+    // Nothing accellerates on a per-particle basis (yet)
+    plParticleKernels::ApplyDrag(fParticleExts.fVelocity, numParticles, drag, fSystem->fAccel * delta);
+
+    for (plParticleEffect* effect : fSystem->fEffects)
+    {
+        effect->ApplyEffectBatch(fTargetInfo, 0, numParticles);
+    }
 
-        // We may need to do more than one iteration through the constraints. It's a trade-off
-        // between accurracy and speed (what's new?) but I'm going to go with just one
-        // for now until we decide things don't "look right"
-        for (plParticleEffect* constraint : fSystem->fConstraints)
+    // We may need to do more than one iteration through the constraints. It's a trade-off
+    // between accurracy and speed (what's new?) but I'm going to go with just one
+    // for now until we decide things don't "look right"
+    for (plParticleEffect* constraint : fSystem->fConstraints)
+    {
+        for (uint32_t i = 0; i < numParticles; i++)
         {
+            // Once a particle is dead, the rest of the constraints don't need to see it.
+            if (fParticleExts.fMiscFlags[i] & plParticleExt::kDead)
+                continue;
             if (constraint->ApplyEffect(fTargetInfo, i))
-            {
-                IRemoveParticle(i);
-                i--; // so that we hit this index again on the next iteration
-                break; 
-                // break will break us out of loop over constraints,
-                // and since we're last, we move onto next particle.
-            }
+                fParticleExts.fMiscFlags[i] |= plParticleExt::kDead;
         }
     }
+    IRemoveDeadParticles();
 
     // Notify the effects that they are done for now.
     for (plParticleEffect* forceEffect : fSystem->fForces)
@@ -476,34 +464,35 @@ void plParticleEmitter::IUpdateParticles(float delta)
     }
 }
 
-plProfile_CreateTimer("Bound", "Particles", ParticleBound);
-plProfile_CreateTimer("Normal", "Particles", ParticleNormal);
-
 void plParticleEmitter::IUpdateBoundsAndNormals(float delta)
 {
-    plProfile_BeginTiming(ParticleBound);
     fBoundBox.MakeEmpty();
-    int i;
-    for (i = 0; i < fNumValidParticles; i++)
-        fBoundBox.Union(&fParticleCores[i].fPos);
-    
     hsPoint3 center;
     if (fNumValidParticles > 0)
+    {
+        hsPoint3 minPos, maxPos;
+        plParticleKernels::ComputeBounds(fParticleExts.fPos, fNumValidParticles, minPos, maxPos);
+        fBoundBox.Union(&minPos);
+        fBoundBox.Union(&maxPos);
         center = fBoundBox.GetCenter();
-    plProfile_EndTiming(ParticleBound);
+    }
+
+    // The renderer only ever looks at the Cores.
+    int i;
+    for (i = 0; i < fNumValidParticles; i++)
+        fParticleCores[i].fPos = fParticleExts.fPos[i];
 
-    plProfile_BeginTiming(ParticleNormal);
     hsVector3 normal;
     if (fMiscFlags & kNormalVelUpVel)
     {
         for (i = fNumValidParticles - 1; i >=0; i--) 
         {
+            const hsVector3& vel = fParticleExts.fVelocity[i];
             //currDirection.Set(&fParticleCores[i].fPos, &fParticleExts[i].fOldPos);
             //normal = (currDirection % up % currDirection);
-            normal.Set(-fParticleExts[i].fVelocity.fX * fParticleExts[i].fVelocity.fZ,
-                       -fParticleExts[i].fVelocity.fY * fParticleExts[i].fVelocity.fZ,
-                       (fParticleExts[i].fVelocity.fX * fParticleExts[i].fVelocity.fX + 
-                        fParticleExts[i].fVelocity.fY * fParticleExts[i].fVelocity.fY));
+            normal.Set(-vel.fX * vel.fZ,
+                       -vel.fY * vel.fZ,
+                       (vel.fX * vel.fX + vel.fY * vel.fY));
             if (!normal.IsEmpty()) // zero length check
             {
                 normal.Normalize();
@@ -515,7 +504,7 @@ void plParticleEmitter::IUpdateBoundsAndNormals(float delta)
     {
         for (i = fNumValidParticles - 1; i >=0; i--) 
         {
-            normal.Set(&fParticleCores[i].fPos, &center);
+            normal.Set(&fParticleExts.fPos[i], &center);
             if (!normal.IsEmpty()) // zero length check
             {
                 normal.Normalize();
@@ -524,22 +513,45 @@ void plParticleEmitter::IUpdateBoundsAndNormals(float delta)
         }
     }
     // otherwise we just keep the last normal.
-    plProfile_EndTiming(ParticleNormal);
 }
 
-void plParticleEmitter::IRemoveParticle(uint32_t index)
+void plParticleEmitter::IKillExpiredParticles()
 {
-    hsAssert(index < fNumValidParticles, "Trying to remove an invalid particle");
-
-    fNumValidParticles--;
-    if (fNumValidParticles <= 0)
+    for (uint32_t i = 0; i < fNumValidParticles; i++)
     {
-        fNumValidParticles = 0;
-        return;
+        if (fParticleExts.fLife[i] <= 0 && !(fParticleExts.fMiscFlags[i] & plParticleExt::kImmortal))
+            fParticleExts.fMiscFlags[i] |= plParticleExt::kDead;
     }
+    IRemoveDeadParticles();
+}
+
+// Slides the survivors down over anything flagged kDead, a run at a time, keeping their order.
+void plParticleEmitter::IRemoveDeadParticles()
+{
+    const uint32_t* flags = fParticleExts.fMiscFlags;
+    uint32_t numLive = 0;
+    uint32_t i = 0;
+    while (i < fNumValidParticles)
+    {
+        if (flags[i] & plParticleExt::kDead)
+        {
+            i++;
+            continue;
+        }
+
+        uint32_t runEnd = i + 1;
+        while (runEnd < fNumValidParticles && !(flags[runEnd] & plParticleExt::kDead))
+            runEnd++;
 
-    fParticleCores[index] = fParticleCores[fNumValidParticles];
-    fParticleExts[index] = fParticleExts[fNumValidParticles];
+        if (numLive != i)
+        {
+            std::copy(fParticleCores + i, fParticleCores + runEnd, fParticleCores + numLive);
+            fParticleExts.Copy(numLive, fParticleExts, i, runEnd - i);
+        }
+        numLive += runEnd - i;
+        i = runEnd;
+    }
+    fNumValidParticles = numLive;
 }
 
 // Reading and writing doesn't transfer individual particle info. We assume those are expendable.
@@ -47,13 +47,12 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsColorRGBA.h"
 
 #include "plEffectTargetInfo.h"
+#include "plParticle.h"
 
 #include "pnFactory/plCreatable.h"
 
 class hsBounds3Ext;
 class plParticleSystem;
-class plParticleCore;
-class plParticleExt;
 class plParticleGenerator;
 class plSimpleParticleGenerator;
 class hsResMgr;
@@ -134,7 +133,7 @@ protected:
 
     plParticleSystem *fSystem;          // The particle system this belongs to.
     plParticleCore *fParticleCores;     // The particle pool, created on init, initialized as needed, and recycled. 
-    plParticleExt *fParticleExts;       // Same mapping as the Core pool. Contains extra info the render pipeline
+    plParticleExt fParticleExts;        // Same mapping as the Core pool. Contains extra info the render pipeline
                                         // doesn't need.
 
     plParticleGenerator *fGenerator;    // Optional auto generator (have this be nil if you don't want auto-generation)
@@ -154,7 +153,8 @@ protected:
     bool IUpdate(float delta);
     void IUpdateParticles(float delta);
     void IUpdateBoundsAndNormals(float delta);
-    void IRemoveParticle(uint32_t index);
+    void IKillExpiredParticles();
+    void IRemoveDeadParticles();
 };
 
 #endif
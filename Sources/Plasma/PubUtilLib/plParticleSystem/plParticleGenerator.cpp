@@ -58,7 +58,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 static const float DEFAULT_INVERSE_MASS = 1.f;
 
-static plRandom sRandom;
+static thread_local plRandom sRandom;
 
 void plParticleGenerator::ComputeDirection(float pitch, float yaw, hsVector3 &direction)
 {
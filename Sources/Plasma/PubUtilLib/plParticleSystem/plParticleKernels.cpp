@@ -0,0 +1,131 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plParticleKernels.h"
+
+static_assert(sizeof(hsPoint3) == 3 * sizeof(float), "plParticleKernels needs packed points");
+static_assert(sizeof(hsVector3) == 3 * sizeof(float), "plParticleKernels needs packed vectors");
+
+void plParticleKernels::decay_life_fpu(float* life, size_t count, float delta)
+{
+    for (size_t i = 0; i < count; ++i)
+        life[i] -= delta;
+}
+
+void plParticleKernels::integrate_fpu(float* pos, const float* vel, size_t count, float delta)
+{
+    for (size_t i = 0; i < count * 3; ++i)
+        pos[i] += vel[i] * delta;
+}
+
+void plParticleKernels::apply_drag_fpu(float* vel, size_t count, float drag, float ax, float ay, float az)
+{
+    for (size_t i = 0; i < count; ++i, vel += 3)
+    {
+        vel[0] = vel[0] * drag + ax;
+        vel[1] = vel[1] * drag + ay;
+        vel[2] = vel[2] * drag + az;
+    }
+}
+
+void plParticleKernels::compute_bounds_fpu(const float* pos, size_t count, float* min, float* max)
+{
+    min[0] = max[0] = pos[0];
+    min[1] = max[1] = pos[1];
+    min[2] = max[2] = pos[2];
+    for (size_t i = 1; i < count; ++i)
+    {
+        pos += 3;
+        for (size_t j = 0; j < 3; ++j)
+        {
+            if (pos[j] < min[j])
+                min[j] = pos[j];
+            if (pos[j] > max[j])
+                max[j] = pos[j];
+        }
+    }
+}
+
+// CPU-optimized functions requiring dispatch
+hsCpuFunctionDispatcher<plParticleKernels::decay_life_ptr> plParticleKernels::decay_life {
+    &plParticleKernels::decay_life_fpu,
+    nullptr,                                // SSE1
+    &plParticleKernels::decay_life_sse2,
+    nullptr,                                // SSE3
+    nullptr,                                // SSSE3
+    nullptr,                                // SSE41
+    nullptr,                                // SSE42
+    &plParticleKernels::decay_life_avx
+};
+
+hsCpuFunctionDispatcher<plParticleKernels::integrate_ptr> plParticleKernels::integrate {
+    &plParticleKernels::integrate_fpu,
+    nullptr,                                // SSE1
+    &plParticleKernels::integrate_sse2,
+    nullptr,                                // SSE3
+    nullptr,                                // SSSE3
+    nullptr,                                // SSE41
+    nullptr,                                // SSE42
+    &plParticleKernels::integrate_avx
+};
+
+hsCpuFunctionDispatcher<plParticleKernels::apply_drag_ptr> plParticleKernels::apply_drag {
+    &plParticleKernels::apply_drag_fpu,
+    nullptr,                                // SSE1
+    &plParticleKernels::apply_drag_sse2,
+    nullptr,                                // SSE3
+    nullptr,                                // SSSE3
+    nullptr,                                // SSE41
+    nullptr,                                // SSE42
+    &plParticleKernels::apply_drag_avx
+};
+
+hsCpuFunctionDispatcher<plParticleKernels::compute_bounds_ptr> plParticleKernels::compute_bounds {
+    &plParticleKernels::compute_bounds_fpu,
+    nullptr,                                // SSE1
+    &plParticleKernels::compute_bounds_sse2,
+    nullptr,                                // SSE3
+    nullptr,                                // SSSE3
+    nullptr,                                // SSE41
+    nullptr,                                // SSE42
+    &plParticleKernels::compute_bounds_avx
+};
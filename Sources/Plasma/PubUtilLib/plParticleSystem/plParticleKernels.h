@@ -0,0 +1,112 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef plParticleKernels_inc
+#define plParticleKernels_inc
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+#include "hsGeometry3.h"
+
+//
+// The bulk per-particle math of plParticleEmitter's update.  Points and
+// vectors come in as packed arrays (see plParticleExt), so each of these
+// is really just a loop over a flat run of floats.
+//
+class plParticleKernels
+{
+public:
+    // life[i] -= delta
+    static void DecayLife(float* life, size_t count, float delta)
+    {
+        decay_life.call(life, count, delta);
+    }
+
+    // pos[i] += vel[i] * delta
+    static void Integrate(hsPoint3* pos, const hsVector3* vel, size_t count, float delta)
+    {
+        integrate.call((float*)pos, (const float*)vel, count, delta);
+    }
+
+    // vel[i] = vel[i] * drag + accel
+    static void ApplyDrag(hsVector3* vel, size_t count, float drag, const hsVector3& accel)
+    {
+        apply_drag.call((float*)vel, count, drag, accel.fX, accel.fY, accel.fZ);
+    }
+
+    // Component-wise min and max of count (> 0) points
+    static void ComputeBounds(const hsPoint3* pos, size_t count, hsPoint3& min, hsPoint3& max)
+    {
+        compute_bounds.call((const float*)pos, count, (float*)&min, (float*)&max);
+    }
+
+    // The individual implementations, for testing them against each other.
+    // Don't call the SIMD ones unless hsCpuId says the CPU has them.
+    static void decay_life_fpu(float* life, size_t count, float delta);
+    static void decay_life_sse2(float* life, size_t count, float delta);
+    static void decay_life_avx(float* life, size_t count, float delta);
+
+    static void integrate_fpu(float* pos, const float* vel, size_t count, float delta);
+    static void integrate_sse2(float* pos, const float* vel, size_t count, float delta);
+    static void integrate_avx(float* pos, const float* vel, size_t count, float delta);
+
+    static void apply_drag_fpu(float* vel, size_t count, float drag, float ax, float ay, float az);
+    static void apply_drag_sse2(float* vel, size_t count, float drag, float ax, float ay, float az);
+    static void apply_drag_avx(float* vel, size_t count, float drag, float ax, float ay, float az);
+
+    static void compute_bounds_fpu(const float* pos, size_t count, float* min, float* max);
+    static void compute_bounds_sse2(const float* pos, size_t count, float* min, float* max);
+    static void compute_bounds_avx(const float* pos, size_t count, float* min, float* max);
+
+private:
+    typedef void(*decay_life_ptr)(float*, size_t, float);
+    typedef void(*integrate_ptr)(float*, const float*, size_t, float);
+    typedef void(*apply_drag_ptr)(float*, size_t, float, float, float, float);
+    typedef void(*compute_bounds_ptr)(const float*, size_t, float*, float*);
+
+    static hsCpuFunctionDispatcher<decay_life_ptr> decay_life;
+    static hsCpuFunctionDispatcher<integrate_ptr> integrate;
+    static hsCpuFunctionDispatcher<apply_drag_ptr> apply_drag;
+    static hsCpuFunctionDispatcher<compute_bounds_ptr> compute_bounds;
+};
+
+#endif // plParticleKernels_inc
@@ -0,0 +1,149 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plParticleKernels.h"
+
+#include <algorithm>
+
+#ifdef HAVE_AVX
+#   include <immintrin.h>
+#endif
+
+// Eight particles' worth of xyz is exactly three registers, so anything that
+// needs to know which component a lane holds works on groups of eight.  Only
+// float math is used here, so plain AVX is enough.
+
+void plParticleKernels::decay_life_avx(float* life, size_t count, float delta)
+{
+#ifdef HAVE_AVX
+    __m256 d = _mm256_set1_ps(delta);
+    for (; count >= 8; count -= 8, life += 8)
+        _mm256_storeu_ps(life, _mm256_sub_ps(_mm256_loadu_ps(life), d));
+#endif
+
+    // Leftovers
+    decay_life_fpu(life, count, delta);
+}
+
+void plParticleKernels::integrate_avx(float* pos, const float* vel, size_t count, float delta)
+{
+#ifdef HAVE_AVX
+    __m256 d = _mm256_set1_ps(delta);
+    for (; count >= 8; count -= 8, pos += 24, vel += 24)
+    {
+        _mm256_storeu_ps(pos,      _mm256_add_ps(_mm256_loadu_ps(pos),      _mm256_mul_ps(_mm256_loadu_ps(vel),      d)));
+        _mm256_storeu_ps(pos + 8,  _mm256_add_ps(_mm256_loadu_ps(pos + 8),  _mm256_mul_ps(_mm256_loadu_ps(vel + 8),  d)));
+        _mm256_storeu_ps(pos + 16, _mm256_add_ps(_mm256_loadu_ps(pos + 16), _mm256_mul_ps(_mm256_loadu_ps(vel + 16), d)));
+    }
+#endif
+
+    // Leftovers
+    integrate_fpu(pos, vel, count, delta);
+}
+
+void plParticleKernels::apply_drag_avx(float* vel, size_t count, float drag, float ax, float ay, float az)
+{
+#ifdef HAVE_AVX
+    __m256 k = _mm256_set1_ps(drag);
+    __m256 a0 = _mm256_setr_ps(ax, ay, az, ax, ay, az, ax, ay);
+    __m256 a1 = _mm256_setr_ps(az, ax, ay, az, ax, ay, az, ax);
+    __m256 a2 = _mm256_setr_ps(ay, az, ax, ay, az, ax, ay, az);
+    for (; count >= 8; count -= 8, vel += 24)
+    {
+        _mm256_storeu_ps(vel,      _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(vel),      k), a0));
+        _mm256_storeu_ps(vel + 8,  _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(vel + 8),  k), a1));
+        _mm256_storeu_ps(vel + 16, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(vel + 16), k), a2));
+    }
+#endif
+
+    // Leftovers
+    apply_drag_fpu(vel, count, drag, ax, ay, az);
+}
+
+void plParticleKernels::compute_bounds_avx(const float* pos, size_t count, float* min, float* max)
+{
+#ifdef HAVE_AVX
+    if (count >= 8)
+    {
+        __m256 lo0 = _mm256_loadu_ps(pos), lo1 = _mm256_loadu_ps(pos + 8), lo2 = _mm256_loadu_ps(pos + 16);
+        __m256 hi0 = lo0, hi1 = lo1, hi2 = lo2;
+        for (count -= 8, pos += 24; count >= 8; count -= 8, pos += 24)
+        {
+            __m256 p0 = _mm256_loadu_ps(pos), p1 = _mm256_loadu_ps(pos + 8), p2 = _mm256_loadu_ps(pos + 16);
+            lo0 = _mm256_min_ps(lo0, p0);
+            lo1 = _mm256_min_ps(lo1, p1);
+            lo2 = _mm256_min_ps(lo2, p2);
+            hi0 = _mm256_max_ps(hi0, p0);
+            hi1 = _mm256_max_ps(hi1, p1);
+            hi2 = _mm256_max_ps(hi2, p2);
+        }
+
+        float lo[24], hi[24];
+        _mm256_storeu_ps(lo, lo0);
+        _mm256_storeu_ps(lo + 8, lo1);
+        _mm256_storeu_ps(lo + 16, lo2);
+        _mm256_storeu_ps(hi, hi0);
+        _mm256_storeu_ps(hi + 8, hi1);
+        _mm256_storeu_ps(hi + 16, hi2);
+
+        // Lane i holds component i % 3, and the leftovers fold in as one more point.
+        float restMin[3], restMax[3];
+        if (count > 0)
+            compute_bounds_fpu(pos, count, restMin, restMax);
+        else
+            compute_bounds_fpu(lo, 1, restMin, restMax);
+        for (size_t i = 0; i < 3; ++i)
+        {
+            min[i] = restMin[i];
+            max[i] = restMax[i];
+        }
+        for (size_t i = 0; i < 24; ++i)
+        {
+            min[i % 3] = std::min(min[i % 3], lo[i]);
+            max[i % 3] = std::max(max[i % 3], hi[i]);
+        }
+        return;
+    }
+#endif
+
+    compute_bounds_fpu(pos, count, min, max);
+}
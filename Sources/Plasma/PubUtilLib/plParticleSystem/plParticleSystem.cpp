@@ -52,10 +52,15 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plgDispatch.h"
 #include "plPipeline.h"
 #include "plProfile.h"
+#include "hsJobPool.h"
 #include "hsResMgr.h"
 #include "hsTimer.h"
 #include "plTweak.h"
 
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
 #include "pnMessage/plRefMsg.h"
 #include "pnMessage/plTimeMsg.h"
 #include "pnNetCommon/plSDLTypes.h"
@@ -71,11 +76,18 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plMessage/plRenderMsg.h"
 
 plProfile_CreateCounter("Num Particles", "Particles", NumParticles);
+plProfile_CreateTimer("Update", "Particles", ParticleUpdate);
+
+bool plParticleSystem::fThreadedUpdates = true;
+std::vector<plParticleSystem*> plParticleSystem::fPendingSystems;
+
 
 const float plParticleSystem::GRAVITY_ACCEL_FEET_PER_SEC2 = 32.0f;
 
 plParticleSystem::~plParticleSystem()
 {
+    IWaitForUpdate();
+
     int i;
     for (i = 0; i < fNumValidEmitters; i++)
     {
@@ -128,6 +140,8 @@ void plParticleSystem::Init(uint32_t xTiles, uint32_t yTiles, uint32_t maxTotalP
 
 void plParticleSystem::IAddEffect(plParticleEffect *effect, uint32_t type)
 {
+    IWaitForUpdate();
+
     switch(type)
     {
     case kEffectForce:
@@ -145,6 +159,8 @@ void plParticleSystem::IAddEffect(plParticleEffect *effect, uint32_t type)
 
 plParticleEmitter* plParticleSystem::GetAvailEmitter()
 {
+    IWaitForUpdate();
+
     if( !fNumValidEmitters ) // got to start with at least one.
         return nullptr;
 
@@ -181,6 +197,8 @@ plParticleEmitter* plParticleSystem::GetAvailEmitter()
 
 uint32_t plParticleSystem::AddEmitter(uint32_t maxParticles, plParticleGenerator *gen, uint32_t emitterFlags)
 {
+    IWaitForUpdate();
+
     if (fMaxEmitters == 0) // silly rabbit, Trix are for kids!
         return 0;
     uint32_t currEmitter;
@@ -224,11 +242,15 @@ void plParticleSystem::AddParticle(hsPoint3 &pos, hsVector3 &velocity, uint32_t
     if (fNumValidEmitters == 0)
         return;
 
+    IWaitForUpdate();
+
     fEmitters[0]->AddParticle(pos, velocity, tileIndex, hSize, vSize, scale, invMass, life, orientation, miscFlags, radsPerSec);
 }
 
 void plParticleSystem::GenerateParticles(uint32_t num, float dt /* = 0.f */)
 {
+    IWaitForUpdate();
+
     if (num <= 0)
         return;
 
@@ -240,6 +262,8 @@ void plParticleSystem::GenerateParticles(uint32_t num, float dt /* = 0.f */)
 
 void plParticleSystem::WipeExistingParticles()
 {
+    IWaitForUpdate();
+
     int i;
     for (i = 0; i < fNumValidEmitters; i++)
         fEmitters[i]->WipeExistingParticles();
@@ -247,6 +271,8 @@ void plParticleSystem::WipeExistingParticles()
 
 void plParticleSystem::KillParticles(float num, float timeToDie, uint8_t flags)
 {
+    IWaitForUpdate();
+
     if (fEmitters[0])
         fEmitters[0]->KillParticles(num, timeToDie, flags);
 
@@ -255,6 +281,8 @@ void plParticleSystem::KillParticles(float num, float timeToDie, uint8_t flags)
 
 void plParticleSystem::TranslateAllParticles(hsPoint3 &amount)
 {
+    IWaitForUpdate();
+
     int i;
     for (i = 0; i < fNumValidEmitters; i++)
         fEmitters[i]->TranslateAllParticles(amount);
@@ -262,6 +290,8 @@ void plParticleSystem::TranslateAllParticles(hsPoint3 &amount)
 
 void plParticleSystem::DisableGenerators()
 {
+    IWaitForUpdate();
+
     int i;
     for (i = 0; i < fNumValidEmitters; i++)
         fEmitters[i]->UpdateGenerator(plParticleUpdateMsg::kParamEnabled, 0.f);
@@ -274,6 +304,9 @@ uint16_t plParticleSystem::StealParticlesFrom(plParticleSystem *victim, uint16_t
 
     if (victim)
     {
+        IWaitForUpdate();
+        victim->IWaitForUpdate();
+
         uint16_t numStolen = fEmitters[0]->StealParticlesFrom(victim->fNumValidEmitters > 0 ? victim->fEmitters[0] : nullptr, num);
         GetTarget(0)->DirtySynchState(kSDLParticleSystem, 0);   
         victim->GetTarget(0)->DirtySynchState(kSDLParticleSystem, 0);   
@@ -307,6 +340,8 @@ plParticleEffect *plParticleSystem::GetEffect(uint16_t type) const
 
 uint32_t plParticleSystem::GetNumValidParticles(bool immortalOnly /* = false */) const
 {
+    IWaitForUpdate();
+
     uint32_t count = 0;
     int i, j;
     for (i = 0; i < fNumValidEmitters; i++)
@@ -315,7 +350,7 @@ uint32_t plParticleSystem::GetNumValidParticles(bool immortalOnly /* = false */)
         {
             for (j = 0; j < fEmitters[i]->fNumValidParticles; j++)
             {
-                if (fEmitters[i]->fParticleExts[j].fMiscFlags & plParticleExt::kImmortal)
+                if (fEmitters[i]->fParticleExts.fMiscFlags[j] & plParticleExt::kImmortal)
                     count++;
             }
         }
@@ -328,7 +363,12 @@ uint32_t plParticleSystem::GetNumValidParticles(bool immortalOnly /* = false */)
 
 const hsMatrix44 &plParticleSystem::GetLocalToWorld() const
 { 
-    return fTarget->GetCoordinateInterface()->GetLocalToWorld(); 
+    return fSimPending ? fSimLocalToWorld : fTarget->GetCoordinateInterface()->GetLocalToWorld(); 
+}
+
+const hsMatrix44 &plParticleSystem::GetWorldToLocal() const
+{ 
+    return fSimPending ? fSimWorldToLocal : fTarget->GetCoordinateInterface()->GetWorldToLocal(); 
 }
 
 bool plParticleSystem::IEval(double secs, float del, uint32_t dirty)
@@ -417,6 +457,10 @@ plDrawInterface* plParticleSystem::ICheckDrawInterface()
 
 void plParticleSystem::IHandleRenderMsg(plPipeline* pipe)
 {   
+    // If last frame's update never got collected, do that now.
+    if (fSimPending)
+        IFinishUpdate();
+
     fCurrTime = hsTimer::GetSysSeconds(); 
     float delta = float(fCurrTime - fLastTime);
     if (delta == 0)
@@ -430,6 +474,7 @@ void plParticleSystem::IHandleRenderMsg(plPipeline* pipe)
         return;
 
     bool disabled = di->GetProperty(plDrawInterface::kDisable);
+
     if (!IShouldUpdate(pipe))
     {
         if (disabled)
@@ -444,30 +489,153 @@ void plParticleSystem::IHandleRenderMsg(plPipeline* pipe)
     fContext.fSystem = this;
     fContext.fSecs = fCurrTime;
     fContext.fDelSecs = delta;
+    fContext.fViewPos = pipe->GetViewPositionWorld();
+    fContext.fViewDir = pipe->GetViewDirWorld();
 
     di->ResetParticleSystem();
 
+    fPendingDisabled = disabled;
+    ISubmitUpdate([this, delta]() { IUpdateEmitters(delta); });
+    if (!fThreadedUpdates)
+        IFinishUpdate();
+}
+
+void plParticleSystem::IUpdateEmitters(float delta)
+{
     if (fPreSim > 0)
         IPreSim();
-    
-    int i;
-    for (i = 0; i < fNumValidEmitters; i++)
-    {
+
+    for (uint32_t i = 0; i < fNumValidEmitters; i++)
         fEmitters[i]->IUpdate(delta);
+}
+
+void plParticleSystem::ISubmitUpdate(std::function<void()> job)
+{
+    hsAssert(!fSimPending, "Particle system update submitted twice");
+
+    // Transforms can change under us (plFollowMod and friends move things during
+    // plRenderMsg too), so the job gets the ones from right now, and the effects
+    // get to take copies of whatever else they look at.
+    fSimLocalToWorld = fTarget->GetLocalToWorld();
+    fSimWorldToLocal = fTarget->GetWorldToLocal();
+    for (plParticleEffect* forceEffect : fForces)
+        forceEffect->PrepareUpdate();
+    for (plParticleEffect* effect : fEffects)
+        effect->PrepareUpdate();
+    for (plParticleEffect* constraint : fConstraints)
+        constraint->PrepareUpdate();
+    fSimPending = true;
+
+    if (fThreadedUpdates)
+    {
+        fPendingJob = std::move(job);
+        fPendingSystems.push_back(this);
+    }
+    else
+    {
+        plProfile_BeginTiming(ParticleUpdate);
+        job();
+        plProfile_EndTiming(ParticleUpdate);
+    }
+}
+
+void plParticleSystem::IWaitForUpdate() const
+{
+    if (fPendingJob)
+        IRunPendingUpdates();
+}
+
+//
+// Runs every update queued since the last batch on the shared job pool, and
+// waits for them.  Everything else that touches particle systems and their
+// effects happens on the main thread, which is stuck in here for the whole
+// batch, so the jobs only have to stay out of each other's way.  Effects can
+// be shared between systems, and they keep per-update state between their
+// PrepareEffect() and EndEffect() calls, so systems that share any effect go
+// into the same job and update one after the other, just like the emitters
+// of a single system do.
+//
+void plParticleSystem::IRunPendingUpdates()
+{
+    std::vector<plParticleSystem*> systems;
+    systems.swap(fPendingSystems);
+    if (systems.empty())
+        return;
+
+    // Union the systems that share effects
+    std::vector<size_t> parent(systems.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto findRoot = [&parent](size_t i)
+    {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+
+    std::unordered_map<plParticleEffect*, size_t> effectOwners;
+    auto claimEffects = [&](const std::vector<plParticleEffect*>& effects, size_t i)
+    {
+        for (plParticleEffect* effect : effects)
+        {
+            auto result = effectOwners.emplace(effect, i);
+            if (!result.second)
+                parent[findRoot(i)] = findRoot(result.first->second);
+        }
+    };
+    for (size_t i = 0; i < systems.size(); i++)
+    {
+        claimEffects(systems[i]->fForces, i);
+        claimEffects(systems[i]->fEffects, i);
+        claimEffects(systems[i]->fConstraints, i);
+    }
+
+    // One job per group, with its systems in the order they were queued
+    std::vector<std::vector<plParticleSystem*>> groups;
+    std::vector<size_t> groupOf(systems.size(), size_t(-1));
+    for (size_t i = 0; i < systems.size(); i++)
+    {
+        size_t root = findRoot(i);
+        if (groupOf[root] == size_t(-1))
+        {
+            groupOf[root] = groups.size();
+            groups.emplace_back();
+        }
+        groups[groupOf[root]].push_back(systems[i]);
+    }
+
+    plProfile_BeginTiming(ParticleUpdate);
+    hsJobPool::Instance().Run(groups.size(), [&groups](size_t i)
+    {
+        plProfile_TraceScope("Particle Job");
+        for (plParticleSystem* sys : groups[i])
+            sys->fPendingJob();
+    });
+    plProfile_EndTiming(ParticleUpdate);
+
+    for (plParticleSystem* sys : systems)
+        sys->fPendingJob = nullptr;
+}
+
+void plParticleSystem::IFinishUpdate()
+{
+    IWaitForUpdate();
+    fSimPending = false;
+
+    // Hand the emitters over to the drawable in order, same as if they'd been updated right here.
+    plDrawInterface* di = IGetTargetDrawInterface(0);
+    for (uint32_t i = 0; i < fNumValidEmitters; i++)
+    {
         plProfile_IncCount(NumParticles, fEmitters[i]->fNumValidParticles);
-        if (!disabled)
+        if (di && !fPendingDisabled)
         {
             if( fEmitters[ i ]->GetParticleCount() > 0 )
                 di->AssignEmitterToParticleSystem( fEmitters[ i ] ); // Go make those polys!
         }
     }
-    
-//  plParticleFiller::FillParticlePolys(pipe, di);
 
     fLastTime = fCurrTime;
 }
 
-
 #include "plProfile.h"
 plProfile_CreateTimer("ParticleSys", "RenderSetup", ParticleSys);
 
@@ -490,6 +658,12 @@ bool plParticleSystem::MsgReceive(plMessage* msg)
         plProfile_EndLap(ParticleSys, this->GetKey()->GetUoid().GetObjectName().c_str());
         return true;
     }
+    else if (plPreResourceMsg::ConvertNoRef(msg))
+    {
+        if (fSimPending)
+            IFinishUpdate();
+        return true;
+    }
     else if ((refMsg = plGenRefMsg::ConvertNoRef(msg)))
     {
         if ((scene = plSceneObject::ConvertNoRef(refMsg->GetRef())))
@@ -537,6 +711,8 @@ bool plParticleSystem::MsgReceive(plMessage* msg)
 
 void plParticleSystem::UpdateGenerator(uint32_t paramID, float value)
 {
+    IWaitForUpdate();
+
     int i;
     for (i = 0; i < fNumValidEmitters; i++)
         fEmitters[i]->UpdateGenerator(paramID, value);
@@ -550,6 +726,7 @@ void plParticleSystem::AddTarget(plSceneObject *so)
     fTarget = so;
     plgDispatch::Dispatch()->RegisterForExactType(plTimeMsg::Index(), GetKey());
     plgDispatch::Dispatch()->RegisterForExactType(plRenderMsg::Index(), GetKey());
+    plgDispatch::Dispatch()->RegisterForExactType(plPreResourceMsg::Index(), GetKey());
     plgDispatch::Dispatch()->RegisterForExactType(plAgeLoadedMsg::Index(), GetKey());
 
     delete fParticleSDLMod;
@@ -573,7 +750,7 @@ void plParticleSystem::RemoveTarget(plSceneObject *so)
 }
 
 // This can be done much faster, but it's only done on load, and very very clean as is. Saving optimization for
-// when we observe that it's too slow.
+// when we observe that it's too slow. (It runs as a background job, so it doesn't hold up the frame.)
 void plParticleSystem::IPreSim()
 {
     const double PRESIM_UPDATE_TICK = 0.1;
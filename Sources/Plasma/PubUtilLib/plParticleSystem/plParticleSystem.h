@@ -42,6 +42,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #ifndef plParticleSystem_inc
 #define plParticleSystem_inc
 
+#include <functional>
 #include <vector>
 
 #include "hsGeometry3.h"
@@ -112,6 +113,19 @@ protected:
 
     plParticleSDLMod *fParticleSDLMod;
 
+    // Updates are queued on plRenderMsg and run as one batch on the shared job pool
+    // when the first of them is needed, normally on plPreResourceMsg (see IFinishUpdate).
+    // Until one is collected, the target's transforms are read from the snapshots here
+    // rather than from the live scene object.
+    std::function<void()> fPendingJob;
+    hsMatrix44 fSimLocalToWorld;
+    hsMatrix44 fSimWorldToLocal;
+    bool fSimPending;
+    bool fPendingDisabled;
+
+    static bool fThreadedUpdates;
+    static std::vector<plParticleSystem*> fPendingSystems;
+
     bool IShouldUpdate(plPipeline* pipe) const;
     bool IEval(double secs, float del, uint32_t dirty) override; // required by plModifier
     void IHandleRenderMsg(plPipeline* pipe);
@@ -119,6 +133,11 @@ protected:
     void IAddEffect(plParticleEffect *effect, uint32_t type);
     void IReadEffectsArray(std::vector<plParticleEffect *> &effects, uint32_t type, hsStream *s, hsResMgr *mgr);
     void IPreSim();
+    void IUpdateEmitters(float delta);
+    void ISubmitUpdate(std::function<void()> job);
+    void IWaitForUpdate() const;
+    void IFinishUpdate();
+    static void IRunPendingUpdates();
 
 public:
     plParticleSystem()
@@ -127,7 +146,8 @@ public:
           fWindMult(), fMaxTotalParticles(), fMaxTotalParticlesLeft(),
           fNumValidEmitters(), fMaxEmitters(), fNextEmitterToGo(), fEmitters(),
           fContext(), fAmbientCtl(), fDiffuseCtl(), fOpacityCtl(),
-          fWidthCtl(), fHeightCtl(), fMiscFlags()      
+          fWidthCtl(), fHeightCtl(), fSimPending(), fPendingDisabled(),
+          fMiscFlags()
     { }
     virtual ~plParticleSystem();
     void Init(uint32_t xTiles, uint32_t yTiles, uint32_t maxTotalParticles, uint32_t numEmitters, 
@@ -174,11 +194,16 @@ public:
     uint32_t GetMaxTotalParticles() const { return fMaxTotalParticles; }
     
     const hsMatrix44 &GetLocalToWorld() const;
+    const hsMatrix44 &GetWorldToLocal() const;
     void SetAccel(const hsVector3& a) { fAccel = GRAVITY_ACCEL_FEET_PER_SEC2 * a; }
     void SetGravity(float pct) { fAccel.Set(0, 0, -GRAVITY_ACCEL_FEET_PER_SEC2 * pct); }
     void SetDrag(float d) { fDrag = -d; }
     void SetWindMult(float m) { fWindMult = m; }
     void SetPreSim(float time) { fPreSim = time; }
+
+    // Whether systems update on the job pool (true) or inline in their plRenderMsg.
+    static void SetThreadedUpdates(bool on) { fThreadedUpdates = on; }
+    static bool GetThreadedUpdates() { return fThreadedUpdates; }
     void UpdateGenerator(uint32_t paramID, float value);
     plParticleGenerator *GetExportedGenerator() const;
     
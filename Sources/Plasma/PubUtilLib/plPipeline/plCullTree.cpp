@@ -67,6 +67,9 @@ static const float kTolerance = 1.e-3f;
 static const float kTolerance = 1.e-1f;
 #endif // CULL_SMALL_TOLERANCE
 
+// How far behind a plane a box has to be before it's culled
+static const float kSafetyDist = -0.1f;
+
 plProfile_CreateCounter("Harvest Nodes", "Draw", HarvestNodes);
 
 //////////////////////////////////////////////////////////////////////
@@ -140,7 +143,6 @@ plCullNode::plCullStatus plCullNode::TestBounds(const hsBounds3Ext& bnd) const
     hsPoint2 depth;
     bnd.TestPlane(fNorm, depth);
 
-    const float kSafetyDist = -0.1f;
     if( depth.fY + fDist < kSafetyDist )
         return kCulled;
 
@@ -221,8 +223,14 @@ plCullNode::plCullStatus plCullNode::ITestNode(const plSpaceTree* space, int16_t
         return kCulled;
     }
 
+    // CullPlaneLevels() has usually done it already
     plCullStatus retVal = kClear;
-    plCullStatus stat = TestBounds(space->GetNode(who).fWorldBounds);
+    plCullStatus stat;
+    plVolumeCullResult res;
+    if( space->GetPlaneResult(who, res) )
+        stat = res == kVolumeCulled ? kCulled : (res == kVolumeSplit ? kSplit : kClear);
+    else
+        stat = TestBounds(space->GetNode(who).fWorldBounds);
 
     switch( stat )
     {
@@ -276,6 +284,9 @@ void plCullNode::ITestNode(const plSpaceTree* space, int16_t who, hsBitVector& t
     size_t mySplitStart = ScratchSplit().size();
     size_t myCullStart = ScratchCulled().size();
 
+    // Test everything the recursion below will get to against our plane
+    // first, a level of the space tree at a time.
+    space->CullPlaneLevels(who, fNorm, fDist, kSafetyDist);
     if( kPureSplit == ITestNode(space, who, ScratchClear(), ScratchSplit(), ScratchCulled()) )
         ScratchSplit().emplace_back(who);
 
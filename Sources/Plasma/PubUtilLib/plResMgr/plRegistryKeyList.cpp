@@ -61,13 +61,27 @@ plRegistryKeyList::~plRegistryKeyList()
     );
 }
 
+void plRegistryKeyList::IBuildNameIndex() const
+{
+    fNameIndex.clear();
+    fNameIndex.reserve(fKeys.size());
+
+    // Keep the first key of any given name, same as a linear search would
+    for (plKeyImp* key : fKeys) {
+        if (key)
+            fNameIndex.emplace(key->GetName(), key);
+    }
+    fNameIndexValid = true;
+}
+
 plKeyImp* plRegistryKeyList::FindKey(const ST::string& keyName) const
 {
-    auto it = std::find_if(fKeys.begin(), fKeys.end(),
-        [&] (plKeyImp* key) { return key && key->GetName().compare_i(keyName) == 0; }
-    );
-    if (it != fKeys.end())
-        return *it;
+    if (!fNameIndexValid)
+        IBuildNameIndex();
+
+    auto it = fNameIndex.find(keyName);
+    if (it != fNameIndex.end())
+        return it->second;
     else
         return nullptr;
 }
@@ -146,6 +160,10 @@ void plRegistryKeyList::AddKey(plKeyImp* key, LoadStatus& loadStatusChange)
         {
             fKeys.push_back(key);
             key->SetObjectID(fKeys.size());
+
+            // Appended keys can't shadow an earlier key of the same name
+            if (fNameIndexValid)
+                fNameIndex.emplace(key->GetName(), key);
         }
         else
         {
@@ -153,6 +171,10 @@ void plRegistryKeyList::AddKey(plKeyImp* key, LoadStatus& loadStatusChange)
             if (fKeys.size() < id)
                 fKeys.resize(id);
             fKeys[id - 1] = key;
+
+            // This may have replaced a key or changed which of several
+            // same-named keys comes first, so just start over
+            fNameIndexValid = false;
         }
         ++fReffedKeys;
     }
@@ -224,6 +246,9 @@ void plRegistryKeyList::Read(hsStream* s)
         fKeys[id - 1] = newKey;
     }
     fKeys.shrink_to_fit();
+
+    fNameIndex.clear();
+    fNameIndexValid = false;
 }
 
 void plRegistryKeyList::Write(hsStream* s)
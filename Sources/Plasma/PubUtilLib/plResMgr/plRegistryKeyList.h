@@ -44,6 +44,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "HeadSpin.h"
 
+#include <string_theory/string>
+#include <unordered_map>
 #include <vector>
 
 class plKeyImp;
@@ -51,8 +53,6 @@ class plRegistryKeyIterator;
 class hsStream;
 class plUoid;
 
-namespace ST { class string; }
-
 //
 //  List of keys for a single class type.
 //
@@ -67,9 +67,16 @@ protected:
 
     std::vector<plKeyImp*> fKeys;
 
-    plRegistryKeyList() {}
+    // Case-insensitive name lookup for fKeys.  Built on the first name
+    // lookup after the keys are read, and rebuilt whenever it goes stale.
+    typedef std::unordered_map<ST::string, plKeyImp*, ST::hash_i, ST::equal_i> NameIndex;
+    mutable NameIndex fNameIndex;
+    mutable bool fNameIndexValid;
+
+    plRegistryKeyList() : fNameIndexValid(false) {}
 
     void IRepack();
+    void IBuildNameIndex() const;
     void ILock() { ++fLocked; }
     void IUnlock() { --fLocked; }
 
@@ -82,7 +89,7 @@ public:
     };
 
     plRegistryKeyList(uint16_t classType)
-        : fClassType(classType), fReffedKeys(0), fLocked(0)
+        : fClassType(classType), fReffedKeys(0), fLocked(0), fNameIndexValid(false)
     { }
     ~plRegistryKeyList();
 
@@ -54,12 +54,13 @@ plRegistryPageNode::plRegistryPageNode(const plFileName& path)
     , fPath(path)
     , fLoadedTypes(0)
     , fOpenRequests(0)
+    , fOpenStream()
     , fIsNewPage(false)
 {
     hsStream* stream = OpenStream();
     if (stream)
     {
-        fPageInfo.Read(&fStream);
+        fPageInfo.Read(stream);
         fValid = IVerify();
         CloseStream();
     }
@@ -71,6 +72,7 @@ plRegistryPageNode::plRegistryPageNode(const plLocation& location, const ST::str
     , fPageInfo(location)
     , fLoadedTypes(0)
     , fOpenRequests(0)
+    , fOpenStream()
     , fIsNewPage(true)
 {
     fPageInfo.SetStrings(age, page);
@@ -125,11 +127,35 @@ hsStream* plRegistryPageNode::OpenStream()
 {
     if (fOpenRequests == 0)
     {
-        if (!fStream.Open(fPath, "rb"))
-            return nullptr;
+        if (fPrefetch.valid())
+        {
+            try {
+                fPrefetchData = fPrefetch.get();
+            } catch (const std::exception&) {
+                // Prefetch failed or was abandoned, fall back to the disk
+                fPrefetchData.clear();
+            }
+        }
+
+        if (!fPrefetchData.empty())
+        {
+            fPrefetchStream.Init((int)fPrefetchData.size(), fPrefetchData.data());
+            fPrefetchStream.Rewind();
+            fOpenStream = &fPrefetchStream;
+        }
+        else if (fMappedStream.Open(fPath, "rb"))
+        {
+            fOpenStream = &fMappedStream;
+        }
+        else
+        {
+            if (!fStream.Open(fPath, "rb"))
+                return nullptr;
+            fOpenStream = &fStream;
+        }
     }
     fOpenRequests++;
-    return &fStream;
+    return fOpenStream;
 }
 
 void plRegistryPageNode::CloseStream()
@@ -137,8 +163,16 @@ void plRegistryPageNode::CloseStream()
     if (fOpenRequests > 0)
         fOpenRequests--;
 
-    if (fOpenRequests == 0)
-        fStream.Close();
+    if (fOpenRequests == 0 && fOpenStream)
+    {
+        if (fOpenStream == &fStream)
+            fStream.Close();
+        else if (fOpenStream == &fMappedStream)
+            fMappedStream.Close();
+        else
+            std::vector<uint8_t>().swap(fPrefetchData);
+        fOpenStream = nullptr;
+    }
 }
 
 void plRegistryPageNode::LoadKeys()
@@ -43,10 +43,13 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define plRegistryNode_h_inc
 
 #include "HeadSpin.h"
+#include "hsMappedStream.h"
 #include "hsStream.h"
 #include "plPageInfo.h"
 
+#include <future>
 #include <map>
+#include <vector>
 
 class plRegistryKeyList;
 class plKeyImp;
@@ -79,8 +82,16 @@ protected:
     plPageInfo  fPageInfo;      // Info about this page
 
     hsBufferedStream fStream;   // Stream for reading/writing our page
+    hsMappedStream fMappedStream; // Preferred stream for reading our page
     uint8_t fOpenRequests;        // How many handles there are to fStream (or
                                 // zero if it's closed)
+
+    // Page contents read ahead of time by the prefetcher.  When available,
+    // the next OpenStream reads from memory instead of from fStream.
+    std::future<std::vector<uint8_t>> fPrefetch;
+    std::vector<uint8_t> fPrefetchData;
+    hsReadOnlyStream fPrefetchStream;
+    hsStream* fOpenStream;      // Whichever of the streams is open
     bool fIsNewPage;          // True if this page is new (not read off disk)
 
     plRegistryPageNode() {}
@@ -137,6 +148,16 @@ public:
     hsStream*   OpenStream();
     void        CloseStream();
 
+    // Hands the page a pending read of its file contents.  The data is used
+    // (waiting on it if need be) the next time the stream is opened, and
+    // freed once it's closed again.
+    void SetPrefetch(std::future<std::vector<uint8_t>> prefetch) { fPrefetch = std::move(prefetch); }
+    bool HasPrefetch() const { return fPrefetch.valid() || !fPrefetchData.empty(); }
+
+    // Forgets a prefetch that nobody has opened the stream for.  The read
+    // itself may still be running, but its data is freed once it finishes.
+    void DropPrefetch() { if (fOpenRequests == 0) fPrefetch = std::future<std::vector<uint8_t>>(); }
+
     // Takes care of everything involved in writing this page to disk
     void Write();
     void DeleteSource();
@@ -45,6 +45,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plRegistryNode.h"
 #include "plResManagerHelper.h"
 #include "plResMgrSettings.h"
+#include "plResPrefetcher.h"
 
 #include "hsSTLStream.h"
 #include "hsTimer.h"
@@ -67,6 +68,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 bool gDataServerLocal = false;
 
+// Most page data the prefetcher may have queued or waiting to be read
+static const uint64_t kMaxPrefetchBytes = 64 * 1024 * 1024;
+
 /// Logging #define for easier use
 #define kResMgrLog(level, log) if (plResMgrSettings::Get().GetLoggingLevel() >= level) log
 
@@ -101,6 +105,8 @@ plResManager::plResManager():
     fCloningCounter(),
     fProgressProc(),
     fMyHelper(),
+    fPrefetcher(),
+    fPrefetchBytes(),
     fLogReadTimes(),
     fPageListLock(),
     fPagesNeedCleanup(),
@@ -198,6 +204,12 @@ void plResManager::IShutdown()
     fMyHelper->Shutdown();  // This will call UnregisterAs(), which will delete itself
     fMyHelper = nullptr;
 
+    // Stop any outstanding page reads; pages waiting on them will go to disk
+    delete fPrefetcher;
+    fPrefetcher = nullptr;
+    fPrefetchPages.clear();
+    fPrefetchBytes = 0;
+
     // TimerCallbackMgr is a fixed-keyed object, so needs to shut down before the registry
     plgTimerCallbackMgr::Shutdown(); 
 
@@ -1167,6 +1179,7 @@ void plResManager::PageInRoom(const plLocation& page, uint16_t objClassToRef, pl
             pageNode->GetPageInfo().GetAge(), pageNode->GetPageInfo().GetPage(), condStr);
         hsMessageBox(msg.c_str(), "Error", hsMessageBoxNormal, hsMessageBoxIconError);
 
+        pageNode->DropPrefetch();
         hsRefCnt_SafeUnRef(refMsg);
         return;
     }
@@ -1227,6 +1240,66 @@ void plResManager::PageInRoom(const plLocation& page, uint16_t objClassToRef, pl
     }
 }
 
+void plResManager::PrefetchPage(const plLocation& page)
+{
+    if (!plResMgrSettings::Get().GetAsyncPaging())
+        return;
+
+    plRegistryPageNode* pageNode = FindPage(page);
+    if (!pageNode || !pageNode->IsValid() || pageNode->IsNewPage() || pageNode->HasPrefetch())
+        return;
+
+    // Queued reads count against the budget too, so this also bounds the
+    // prefetcher's queue.  Pages over budget are just read from disk later.
+    IPrunePrefetches();
+    uint64_t size = std::max<int64_t>(plFileInfo(pageNode->GetPagePath()).FileSize(), 0);
+    if (!fPrefetchPages.empty() && fPrefetchBytes + size > kMaxPrefetchBytes)
+    {
+        kResMgrLog(2, ILog(2, "Not prefetching page {}>{}, {} bytes already prefetched",
+            pageNode->GetPageInfo().GetAge(), pageNode->GetPageInfo().GetPage(), fPrefetchBytes));
+        return;
+    }
+
+    if (!fPrefetcher)
+        fPrefetcher = new plResPrefetcher(std::min(std::max(std::thread::hardware_concurrency(), 2U), 4U));
+
+    kResMgrLog(2, ILog(2, "Prefetching page {}>{}", pageNode->GetPageInfo().GetAge(), pageNode->GetPageInfo().GetPage()));
+    pageNode->SetPrefetch(fPrefetcher->Prefetch(pageNode->GetPagePath()));
+    fPrefetchPages.emplace_back(page, size);
+    fPrefetchBytes += size;
+}
+
+void plResManager::CancelPrefetches()
+{
+    for (const auto& prefetch : fPrefetchPages)
+    {
+        plRegistryPageNode* pageNode = FindPage(prefetch.first);
+        if (pageNode && pageNode->HasPrefetch())
+        {
+            kResMgrLog(2, ILog(2, "Dropping unused prefetch of page {}>{}", pageNode->GetPageInfo().GetAge(), pageNode->GetPageInfo().GetPage()));
+            pageNode->DropPrefetch();
+        }
+    }
+    IPrunePrefetches();
+}
+
+void plResManager::IPrunePrefetches()
+{
+    // Forget pages that have been read and closed, or have gone away
+    auto it = fPrefetchPages.begin();
+    while (it != fPrefetchPages.end())
+    {
+        plRegistryPageNode* pageNode = FindPage(it->first);
+        if (!pageNode || !pageNode->HasPrefetch())
+        {
+            fPrefetchBytes -= it->second;
+            it = fPrefetchPages.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
 class plPageInAgeIter : public plRegistryPageIterator
 {
 private:
@@ -54,6 +54,7 @@ class plRegistryPageIterator;
 class plRegistryDataStream;
 class plResAgeHolder;
 class plResManagerHelper;
+class plResPrefetcher;
 class plDispatch;
 
 // plProgressProc is a proc called every time an object loads, to keep a progress bar for
@@ -138,6 +139,14 @@ public:
     void PageInRoom(const plLocation& page, uint16_t objClassToRef, plRefMsg* refMsg);
     void PageInAge(const ST::string& age);
 
+    // If async paging is enabled, starts reading the page's file in the
+    // background so a later PageInRoom doesn't have to wait on the disk.
+    void PrefetchPage(const plLocation& page);
+
+    // Frees prefetched page data that hasn't been opened yet.  Called once
+    // the load queue is empty, since nothing is going to claim it after that.
+    void CancelPrefetches();
+
     // Usually, a page file is kept open during load because the first keyed object
     // read causes all the other objects to be read before it returns.  In some
     // cases though (mostly just the texture file), this doesn't work.  In that
@@ -201,6 +210,8 @@ protected:
     void ILockPages();
     void IUnlockPages();
 
+    void IPrunePrefetches();
+
     void AddPage(plRegistryPageNode* page);
 
     // Adds a key to the registry. Assumes uoid already set
@@ -227,6 +238,12 @@ protected:
     plProgressProc  fProgressProc;
 
     plResManagerHelper  *fMyHelper;
+    plResPrefetcher     *fPrefetcher;
+
+    // Pages with prefetched data that hasn't been freed yet, and the total
+    // size of their files.  Kept under kMaxPrefetchBytes.
+    std::vector<std::pair<plLocation, uint64_t>> fPrefetchPages;
+    uint64_t            fPrefetchBytes;
 
     bool    fLogReadTimes;
 
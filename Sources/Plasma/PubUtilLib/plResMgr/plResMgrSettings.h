@@ -67,6 +67,7 @@ protected:
 
     bool fPassiveKeyRead;
     bool fLoadPagesOnInit;
+    bool fAsyncPaging;
 
     plResMgrSettings()
     {
@@ -74,6 +75,7 @@ protected:
         fFilterNewerPageVersions = true;
         fPassiveKeyRead = false;
         fLoadPagesOnInit = true;
+        fAsyncPaging = false;
         fLoggingLevel = 0;
     }
 
@@ -102,6 +104,10 @@ public:
     bool GetLoadPagesOnInit() const { return fLoadPagesOnInit; }
     void SetLoadPagesOnInit(bool load) { fLoadPagesOnInit = load; }
 
+    // Read queued pages into memory on worker threads ahead of page-in
+    bool GetAsyncPaging() const { return fAsyncPaging; }
+    void SetAsyncPaging(bool async) { fAsyncPaging = async; }
+
     static plResMgrSettings& Get();
 };
 
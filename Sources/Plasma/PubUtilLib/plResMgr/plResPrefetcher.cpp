@@ -0,0 +1,134 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "plResPrefetcher.h"
+#include "plProfile.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+plResPrefetcher::plResPrefetcher(size_t numThreads)
+    : fShutdown(false)
+{
+    numThreads = std::max<size_t>(numThreads, 1);
+    for (size_t i = 0; i < numThreads; ++i)
+        fThreads.emplace_back(&plResPrefetcher::IRun, this);
+}
+
+plResPrefetcher::~plResPrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(fQueueLock);
+        fShutdown = true;
+
+        // Anything not yet started gets a broken promise; the page will just
+        // be read from disk like it always was.
+        fQueue.clear();
+    }
+    fQueueSignal.notify_all();
+
+    for (std::thread& thread : fThreads)
+        thread.join();
+}
+
+std::future<plResPrefetcher::PageData> plResPrefetcher::Prefetch(const plFileName& path)
+{
+    Request request;
+    request.fPath = path;
+    std::future<PageData> result = request.fResult.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(fQueueLock);
+        fQueue.emplace_back(std::move(request));
+    }
+    fQueueSignal.notify_one();
+
+    return result;
+}
+
+void plResPrefetcher::IRun()
+{
+    plProfile_SetThreadName("Loader");
+
+    for (;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(fQueueLock);
+            fQueueSignal.wait(lock, [this] { return fShutdown || !fQueue.empty(); });
+            if (fShutdown)
+                return;
+
+            request = std::move(fQueue.front());
+            fQueue.pop_front();
+        }
+
+        plProfile_TraceScope("Prefetch Page");
+        try {
+            request.fResult.set_value(IReadFile(request.fPath));
+        } catch (...) {
+            request.fResult.set_exception(std::current_exception());
+        }
+    }
+}
+
+plResPrefetcher::PageData plResPrefetcher::IReadFile(const plFileName& path)
+{
+    FILE* fp = plFileSystem::Open(path, "rb");
+    if (!fp)
+        throw std::runtime_error("Unable to open page file");
+
+    PageData data;
+    if (fseek(fp, 0, SEEK_END) == 0) {
+        long size = ftell(fp);
+        if (size > 0) {
+            data.resize(size);
+            fseek(fp, 0, SEEK_SET);
+            if (fread(data.data(), 1, data.size(), fp) != data.size())
+                data.clear();
+        }
+    }
+    fclose(fp);
+
+    if (data.empty())
+        throw std::runtime_error("Unable to read page file");
+    return data;
+}
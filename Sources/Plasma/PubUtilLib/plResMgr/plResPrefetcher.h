@@ -0,0 +1,92 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#ifndef plResPrefetcher_h_inc
+#define plResPrefetcher_h_inc
+
+#include "HeadSpin.h"
+#include "plFileSystem.h"
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Small pool of worker threads that read whole page files into memory ahead
+// of the main thread asking for them.  Only raw bytes are produced here; key
+// and object construction still happens on the main thread when the page is
+// opened, since neither the key registry nor plCreatable creation is thread
+// safe.
+//
+class plResPrefetcher
+{
+public:
+    typedef std::vector<uint8_t> PageData;
+
+    plResPrefetcher(size_t numThreads);
+    ~plResPrefetcher();
+
+    // Queue a read of the given page file.  If the prefetcher is destroyed
+    // before the read is serviced, the future is abandoned and getting it
+    // throws, in which case the caller should just read from disk.
+    std::future<PageData> Prefetch(const plFileName& path);
+
+private:
+    struct Request
+    {
+        plFileName fPath;
+        std::promise<PageData> fResult;
+    };
+
+    std::vector<std::thread> fThreads;
+    std::deque<Request> fQueue;
+    std::mutex fQueueLock;
+    std::condition_variable fQueueSignal;
+    bool fShutdown;
+
+    void IRun();
+    static PageData IReadFile(const plFileName& path);
+};
+
+#endif // plResPrefetcher_h_inc
@@ -78,6 +78,7 @@ namespace plSDL
         kSameAsDefault  = 0x8,
         kHasDirtyFlag   = 0x10,
         kWantTimeStamp  = 0x20,
+        kQuantized      = 0x40,     // compact IO only: values are packed according to the var type
 
         kAddedVarLengthIO = 0x8000,     // using to establish a new version in the header, can delete in 8/03
         
@@ -97,11 +98,13 @@ namespace plSDL
         kMakeDirty              = 1<< 8,            // read/write: set dirty flag on var read/write. 
         kDirtyNonDefaults       = 1<< 9,            // dirty the var if non default value.
         kForceConvert           = 1<<10,            // always try to convert rec to latest on read
+        kCompactDelta           = 1<<11,            // write option. use the compact wire format, read handles both.
     };
 
     enum BehaviorFlags
     {
         kDisallowTimeStamping = 0x1,
+        kAllowCompactDelta    = 0x2,    // the server understands kCompactDelta records
     };
 
     extern const ST::string kAgeSDLObjectName;
@@ -261,6 +264,12 @@ protected:
     bool IReadData(hsStream* s, float timeConvert, int idx, uint32_t readOptions);    
     bool IWriteData(hsStream* s, float timeConvert, int idx, uint32_t writeOptions) const;
 
+    // compact IO
+    bool IIsSameAsDefaults() const;
+    bool ICanQuantize() const;
+    void IReadQuantized(hsStream* s, int idx);
+    void IWriteQuantized(hsStream* s, int idx) const;
+
 public:
 
     plSimpleStateVariable() { IInit(); }        
@@ -332,6 +341,8 @@ public:
     // IO
     bool ReadData(hsStream* s, float timeConvert, uint32_t readOptions) override;
     bool WriteData(hsStream* s, float timeConvert, uint32_t writeOptions) const override;
+    bool ReadCompactData(hsStream* s, float timeConvert, uint32_t readOptions);
+    bool WriteCompactData(hsStream* s, float timeConvert, uint32_t writeOptions) const;
 };
 
 //
@@ -418,6 +429,7 @@ protected:
     VarsList    fSDVarsList;        // list of nested data records
     uint32_t    fFlags;
     static const uint8_t kIOVersion;  // I/O Version
+    static const uint8_t kCompactIOVersion;   // I/O Version of kCompactDelta records
     
     void IDeleteVarsList(VarsList& vars);
     void IInitDescriptor(const ST::string& name, int version);    // or plSDL::kLatestVersion
@@ -425,6 +437,11 @@ protected:
     
     void IReadHeader(hsStream* s);
     void IWriteHeader(hsStream* s) const;
+    bool IReadCompact(hsStream* s, float timeConvert, uint32_t readOptions);
+    void IWriteCompact(hsStream* s, float timeConvert, uint32_t writeOptions) const;
+    bool IReadVarMask(hsStream* s, const VarsList& vars, std::vector<int>* idxOut) const;
+    void IWriteVarMask(hsStream* s, const VarsList& vars, bool dirtyOnly) const;
+    void IConvertToLatest(uint32_t readOptions);
     bool IConvertVar(plSimpleStateVariable* fromVar, plSimpleStateVariable* toVar, bool force);
 
     plStateVariable* IFindVar(const VarsList& vars, const ST::string& name) const;
@@ -576,6 +593,7 @@ public:
     uint32_t GetBehaviorFlags() const { return fBehaviorFlags; }
     void SetBehaviorFlags(uint32_t v) { fBehaviorFlags=v; }
     bool AllowTimeStamping() const { return ! ( fBehaviorFlags&plSDL::kDisallowTimeStamping ); }
+    bool AllowCompactDelta() const { return ( fBehaviorFlags&plSDL::kAllowCompactDelta ) != 0; }
 
     // I/O - return # of bytes read/written
     int Write(hsStream* s, const plSDL::DescriptorList* dl=nullptr);    // write descriptors to a stream
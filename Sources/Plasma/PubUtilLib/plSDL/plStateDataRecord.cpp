@@ -53,6 +53,7 @@ const ST::string plSDL::kAgeSDLObjectName = ST_LITERAL("AgeSDLHook");
 
 // static 
 const uint8_t plStateDataRecord::kIOVersion=6;
+const uint8_t plStateDataRecord::kCompactIOVersion=7;
 
 //
 // helper 
@@ -239,6 +240,8 @@ bool plStateDataRecord::Read(hsStream* s, float timeConvert, uint32_t readOption
 {
     fFlags = s->ReadLE16();
     uint8_t ioVersion = s->ReadByte();
+    if (ioVersion == kCompactIOVersion)
+        return IReadCompact(s, timeConvert, readOptions);
     if (ioVersion != kIOVersion)
         return false;
 
@@ -330,8 +333,16 @@ bool plStateDataRecord::Read(hsStream* s, float timeConvert, uint32_t readOption
         return false;
     }
 
-    // convert to latest descriptor
-    // Only really need to do this the first time this descriptor is read...
+    IConvertToLatest(readOptions);
+    return true;    // ok
+}
+
+//
+// convert to latest descriptor
+// Only really need to do this the first time this descriptor is read...
+//
+void plStateDataRecord::IConvertToLatest(uint32_t readOptions)
+{
     plStateDescriptor* latestDesc=plSDLMgr::GetInstance()->FindDescriptor(fDescriptor->GetName(), plSDL::kLatestVersion);
     hsAssert(latestDesc, ST::format("Failed to find latest sdl descriptor for: {}", fDescriptor->GetName()).c_str());
     bool forceConvert = (readOptions&plSDL::kForceConvert)!=0;
@@ -341,8 +352,6 @@ bool plStateDataRecord::Read(hsStream* s, float timeConvert, uint32_t readOption
         ConvertTo( latestDesc, forceConvert );
         DumpToObjectDebugger( "PostConvert" );
     }
-
-    return true;    // ok
 }
 
 //
@@ -358,6 +367,12 @@ void plStateDataRecord::Write(hsStream* s, float timeConvert, uint32_t writeOpti
     }
 #endif
 
+    if (writeOptions & plSDL::kCompactDelta)
+    {
+        IWriteCompact(s, timeConvert, writeOptions);
+        return;
+    }
+
     s->WriteLE16((uint16_t)fFlags);
     s->WriteByte(kIOVersion);
 
@@ -404,6 +419,133 @@ void plStateDataRecord::Write(hsStream* s, float timeConvert, uint32_t writeOpti
     }
 }
 
+//
+// Compact IO (plSDL::kCompactDelta)
+// Instead of a count followed by an index per var, the vars being sent are
+// flagged in a bit mask, one bit per var in the descriptor.  Simple vars are
+// written with WriteCompactData, which packs float vectors, quaternions and
+// colors.  Nested vars are written as usual, with their records in compact form.
+//
+bool plStateDataRecord::IReadVarMask(hsStream* s, const VarsList& vars, std::vector<int>* idxOut) const
+{
+    size_t numBytes = (vars.size() + 7) / 8;
+    for (size_t i = 0; i < numBytes; i++)
+    {
+        uint8_t bits = s->ReadByte();
+        for (size_t j = 0; j < 8 && bits != 0; j++, bits >>= 1)
+        {
+            if (bits & 1)
+            {
+                size_t idx = i * 8 + j;
+                if (idx >= vars.size())
+                    return false;
+                idxOut->push_back((int)idx);
+            }
+        }
+    }
+    return true;
+}
+
+void plStateDataRecord::IWriteVarMask(hsStream* s, const VarsList& vars, bool dirtyOnly) const
+{
+    size_t numBytes = (vars.size() + 7) / 8;
+    for (size_t i = 0; i < numBytes; i++)
+    {
+        uint8_t bits = 0;
+        for (size_t j = 0; j < 8 && i * 8 + j < vars.size(); j++)
+        {
+            const plStateVariable* var = vars[i * 8 + j];
+            if (dirtyOnly ? var->IsDirty() : var->IsUsed())
+                bits |= (1 << j);
+        }
+        s->WriteByte(bits);
+    }
+}
+
+bool plStateDataRecord::IReadCompact(hsStream* s, float timeConvert, uint32_t readOptions)
+{
+    hsAssert(fDescriptor, "State Data Record has nil SDL descriptor");
+    if (!fDescriptor)
+        return false;
+
+    std::vector<int> indices;
+    try
+    {
+        //
+        // read simple var data
+        //
+        if (!IReadVarMask(s, fVarsList, &indices))
+            return false;
+        for (int idx : indices)
+        {
+            plSimpleStateVariable* var = static_cast<plSimpleStateVariable*>(fVarsList[idx]);
+            if (!var->ReadCompactData(s, timeConvert, readOptions))
+            {
+                if (plSDLMgr::GetInstance()->GetNetApp())
+                    plSDLMgr::GetInstance()->GetNetApp()->ErrorMsg("Failed reading compact SDL, desc {}",
+                            fDescriptor->GetName());
+                return false;
+            }
+        }
+
+        //
+        // read nested var data
+        //
+        indices.clear();
+        if (!IReadVarMask(s, fSDVarsList, &indices))
+            return false;
+        for (int idx : indices)
+        {
+            if (!fSDVarsList[idx]->ReadData(s, timeConvert, readOptions))  // calls plStateDataRecord::Read recursively
+            {
+                if (plSDLMgr::GetInstance()->GetNetApp())
+                    plSDLMgr::GetInstance()->GetNetApp()->ErrorMsg("Failed reading nested compact SDL, desc {}",
+                            fDescriptor->GetName());
+                return false;
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        hsAssert(false,
+            ST::format("Something bad happened ({}) while reading compact var data, desc:{}",
+                       e.what(), fDescriptor->GetName()).c_str());
+        return false;
+    }
+    catch (...)
+    {
+        hsAssert(false,
+            ST::format("Something bad happened while reading compact var data, desc:{}",
+                       fDescriptor->GetName()).c_str());
+        return false;
+    }
+
+    IConvertToLatest(readOptions);
+    return true;
+}
+
+void plStateDataRecord::IWriteCompact(hsStream* s, float timeConvert, uint32_t writeOptions) const
+{
+    s->WriteLE16((uint16_t)fFlags);
+    s->WriteByte(kCompactIOVersion);
+
+    bool dirtyOnly = (writeOptions & plSDL::kDirtyOnly) != 0;
+
+    IWriteVarMask(s, fVarsList, dirtyOnly);
+    for (const plStateVariable* var : fVarsList)
+    {
+        if (dirtyOnly ? var->IsDirty() : var->IsUsed())
+            static_cast<const plSimpleStateVariable*>(var)->WriteCompactData(s, timeConvert, writeOptions);
+    }
+
+    IWriteVarMask(s, fSDVarsList, dirtyOnly);
+    for (const plStateVariable* var : fSDVarsList)
+    {
+        if (dirtyOnly ? var->IsDirty() : var->IsUsed())
+            var->WriteData(s, timeConvert, writeOptions);   // calls plStateDataRecord::Write recursively
+    }
+}
+
 //
 // STATIC - read prefix header.  returns true on success 
 //
@@ -54,6 +54,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plResMgr/plKeyFinder.h"
 #include "plUnifiedTime/plClientUnifiedTime.h"
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <type_traits>
@@ -1962,15 +1963,7 @@ bool plSimpleStateVariable::WriteData(hsStream* s, float timeConvert, uint32_t w
     plStateVariable::WriteData(s, timeConvert, writeOptions);   
 
     // check if the same as default
-    bool sameAsDefaults=false;
-    if (!GetVarDescriptor()->IsVariableLength())
-    {
-        plSimpleStateVariable def;
-        def.fVar.CopyFrom(&fVar);   // copy descriptor
-        def.Alloc();                // and rest
-        def.SetFromDefaults(false /* timeStamp */);     // may do nothing if nor default
-        sameAsDefaults = (def == *this);
-    }
+    bool sameAsDefaults = IIsSameAsDefaults();
 
     bool writeTimeStamps = (writeOptions & plSDL::kWriteTimeStamps)!=0;
     bool writeDirtyFlags = (writeOptions & plSDL::kDontWriteDirtyFlag)==0;
@@ -2089,6 +2082,328 @@ bool plSimpleStateVariable::ReadData(hsStream* s, float timeConvert, uint32_t re
     return true;
 }
 
+bool plSimpleStateVariable::IIsSameAsDefaults() const
+{
+    if (GetVarDescriptor()->IsVariableLength())
+        return false;
+
+    plSimpleStateVariable def;
+    def.fVar.CopyFrom(&fVar);   // copy descriptor
+    def.Alloc();                // and rest
+    def.SetFromDefaults(false /* timeStamp */);     // may do nothing if nor default
+    return (def == *this);
+}
+
+//
+// Compact IO helpers.
+// Vectors and points are sent as fixed point with kPosScale steps per unit,
+// plain floats only when they fit exactly with kFloatScale steps per unit
+// (there's no range to go by), quaternions as their smallest three components
+// and colors as 16 bit fractions.  Fixed point values are zigzag varints.
+//
+static const float kPosScale = 1024.f;
+static const float kFloatScale = 256.f;
+static const float kMaxFixedPoint = 2147483520.f;     // largest float below 2^31
+static const float kQuatScale = 32767.f;
+static const float kSqrt2 = 1.41421356f;
+
+static void IWriteVarInt(hsStream* s, int32_t val)
+{
+    uint32_t zz = (uint32_t(val) << 1) ^ uint32_t(val >> 31);
+    while (zz >= 0x80)
+    {
+        s->WriteByte(uint8_t(zz) | 0x80);
+        zz >>= 7;
+    }
+    s->WriteByte(uint8_t(zz));
+}
+
+static int32_t IReadVarInt(hsStream* s)
+{
+    uint32_t zz = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        uint8_t b = s->ReadByte();
+        zz |= uint32_t(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    return int32_t(zz >> 1) ^ -int32_t(zz & 1);
+}
+
+bool plSimpleStateVariable::ICanQuantize() const
+{
+    int num = fVar.GetCount() * fVar.GetAtomicCount();
+    int i;
+
+    // careful, every test below must fail for NaN
+    switch (fVar.GetType())
+    {
+    case plVarDescriptor::kFloat:
+        for (i = 0; i < num; i++)
+        {
+            float scaled = fF[i] * kFloatScale;
+            if (!(std::fabs(scaled) <= kMaxFixedPoint) || scaled != std::floor(scaled))
+                return false;
+        }
+        return true;
+    case plVarDescriptor::kVector3:
+    case plVarDescriptor::kPoint3:
+        for (i = 0; i < num; i++)
+            if (!(std::fabs(fF[i] * kPosScale) <= kMaxFixedPoint))
+                return false;
+        return true;
+    case plVarDescriptor::kQuaternion:
+        for (i = 0; i < num; i += 4)
+        {
+            float lenSq = fF[i]*fF[i] + fF[i+1]*fF[i+1] + fF[i+2]*fF[i+2] + fF[i+3]*fF[i+3];
+            if (!(std::fabs(lenSq - 1.f) < 0.001f))
+                return false;
+        }
+        return true;
+    case plVarDescriptor::kRGB:
+    case plVarDescriptor::kRGBA:
+        for (i = 0; i < num; i++)
+            if (!(fF[i] >= 0.f && fF[i] <= 1.f))
+                return false;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void plSimpleStateVariable::IWriteQuantized(hsStream* s, int idx) const
+{
+    const float* f = &fF[idx*fVar.GetAtomicCount()];
+    int i;
+    switch (fVar.GetType())
+    {
+    case plVarDescriptor::kFloat:
+        IWriteVarInt(s, int32_t(f[0] * kFloatScale));
+        break;
+    case plVarDescriptor::kVector3:
+    case plVarDescriptor::kPoint3:
+        for (i = 0; i < 3; i++)
+            IWriteVarInt(s, int32_t(std::round(f[i] * kPosScale)));
+        break;
+    case plVarDescriptor::kQuaternion:
+        {
+            // drop the largest component, the reader rebuilds it from the others
+            int largest = 0;
+            for (i = 1; i < 4; i++)
+                if (std::fabs(f[i]) > std::fabs(f[largest]))
+                    largest = i;
+            float sign = f[largest] < 0.f ? -1.f : 1.f;
+            float invLen = sign / std::sqrt(f[0]*f[0] + f[1]*f[1] + f[2]*f[2] + f[3]*f[3]);
+
+            // the rest are within +/- 1/sqrt(2), 15 bits apiece
+            uint64_t packed = largest;
+            int shift = 2;
+            for (i = 0; i < 4; i++)
+            {
+                if (i == largest)
+                    continue;
+                float c = f[i] * invLen * kSqrt2;
+                uint64_t q = uint64_t(std::round((c * 0.5f + 0.5f) * kQuatScale));
+                packed |= std::min<uint64_t>(q, 0x7fff) << shift;
+                shift += 15;
+            }
+            s->WriteLE32(uint32_t(packed));
+            s->WriteLE16(uint16_t(packed >> 32));
+        }
+        break;
+    case plVarDescriptor::kRGB:
+    case plVarDescriptor::kRGBA:
+        for (i = 0; i < fVar.GetAtomicCount(); i++)
+            s->WriteLE16(uint16_t(std::round(f[i] * 65535.f)));
+        break;
+    default:
+        hsAssert(false, "var type can't be quantized");
+        break;
+    }
+}
+
+void plSimpleStateVariable::IReadQuantized(hsStream* s, int idx)
+{
+    float* f = &fF[idx*fVar.GetAtomicCount()];
+    int i;
+    switch (fVar.GetType())
+    {
+    case plVarDescriptor::kFloat:
+        f[0] = float(IReadVarInt(s)) / kFloatScale;
+        break;
+    case plVarDescriptor::kVector3:
+    case plVarDescriptor::kPoint3:
+        for (i = 0; i < 3; i++)
+            f[i] = float(IReadVarInt(s)) / kPosScale;
+        break;
+    case plVarDescriptor::kQuaternion:
+        {
+            uint64_t packed = s->ReadLE32();
+            packed |= uint64_t(s->ReadLE16()) << 32;
+
+            int largest = int(packed & 3);
+            int shift = 2;
+            float sumSq = 0.f;
+            for (i = 0; i < 4; i++)
+            {
+                if (i == largest)
+                    continue;
+                float q = float((packed >> shift) & 0x7fff) / kQuatScale;
+                f[i] = (q * 2.f - 1.f) / kSqrt2;
+                sumSq += f[i] * f[i];
+                shift += 15;
+            }
+            f[largest] = std::sqrt(std::max(0.f, 1.f - sumSq));
+        }
+        break;
+    case plVarDescriptor::kRGB:
+    case plVarDescriptor::kRGBA:
+        for (i = 0; i < fVar.GetAtomicCount(); i++)
+            f[i] = float(s->ReadLE16()) / 65535.f;
+        break;
+    default:
+        hsAssert(false, "var type can't be quantized");
+        break;
+    }
+}
+
+//
+// Compact counterpart of WriteData, for plSDL::kCompactDelta records.
+// The notification info and save flags share one byte, and the list is
+// quantized when ICanQuantize() says the values allow it.
+//
+bool plSimpleStateVariable::WriteCompactData(hsStream* s, float timeConvert, uint32_t writeOptions) const
+{
+    bool sameAsDefaults = IIsSameAsDefaults();
+    bool quantize = !sameAsDefaults && ICanQuantize();
+
+    ST::string hint = GetNotificationInfo().GetHintString();
+    bool writeHint = !hint.empty() && (writeOptions & plSDL::kSkipNotificationInfo)==0;
+
+    bool writeTimeStamps = (writeOptions & plSDL::kWriteTimeStamps)!=0;
+    bool writeDirtyFlags = (writeOptions & plSDL::kDontWriteDirtyFlag)==0;
+    bool forceDirtyFlags = (writeOptions & plSDL::kMakeDirty)!=0;
+    bool wantTimeStamp   = (writeOptions & plSDL::kTimeStampOnRead)!=0;
+    bool needTimeStamp   = (writeOptions & plSDL::kTimeStampOnWrite)!=0;
+    forceDirtyFlags = forceDirtyFlags || (!sameAsDefaults && (writeOptions & plSDL::kDirtyNonDefaults)!=0);
+
+    // write save flags
+    uint8_t saveFlags = 0;
+    saveFlags |= writeHint ? plSDL::kHasNotificationInfo : 0;
+    saveFlags |= (writeTimeStamps || needTimeStamp) ? plSDL::kHasTimeStamp : 0;
+    saveFlags |= forceDirtyFlags || (writeDirtyFlags && IsDirty()) ? plSDL::kHasDirtyFlag : 0;
+    saveFlags |= wantTimeStamp ? plSDL::kWantTimeStamp : 0;
+    saveFlags |= sameAsDefaults ? plSDL::kSameAsDefault : 0;
+    saveFlags |= quantize ? plSDL::kQuantized : 0;
+    s->WriteByte(saveFlags);
+
+    if (writeHint)
+        s->WriteSafeString(hint);
+
+    if (needTimeStamp)
+        fTimeStamp.ToCurrentTime();
+    if (saveFlags & plSDL::kHasTimeStamp)
+        fTimeStamp.Write(s);
+
+    // write var data
+    if (!sameAsDefaults)
+    {
+        if (GetVarDescriptor()->IsVariableLength())
+            plSDL::VariableLengthWrite(s, plSDL::kMaxListSize, GetVarDescriptor()->GetCount());
+
+        int i;
+        for(i=0;i<fVar.GetCount();i++)
+        {
+            if (quantize)
+                IWriteQuantized(s, i);
+            else if (!IWriteData(s, timeConvert, i, writeOptions))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool plSimpleStateVariable::ReadCompactData(hsStream* s, float timeConvert, uint32_t readOptions)
+{
+    uint8_t saveFlags = s->ReadByte();
+
+    if (saveFlags & plSDL::kHasNotificationInfo)
+    {
+        ST::string hint = s->ReadSafeString();
+        if (!(readOptions & plSDL::kSkipNotificationInfo))
+            GetNotificationInfo().SetHintString(hint);
+    }
+
+    plUnifiedTime ut;
+    ut.ToEpoch();
+
+    bool isDirty = ( saveFlags & plSDL::kHasDirtyFlag )!=0;
+    bool setDirty = ( isDirty && ( readOptions & plSDL::kKeepDirty ) ) || ( readOptions & plSDL::kMakeDirty );
+    bool wantTimestamp = isDirty &&
+        plSDLMgr::GetInstance()->AllowTimeStamping() &&
+        (   ( saveFlags & plSDL::kWantTimeStamp ) ||
+            ( readOptions & plSDL::kTimeStampOnRead )   );
+
+    if (saveFlags & plSDL::kHasTimeStamp)
+        ut.Read(s);
+    else if ( wantTimestamp )
+        ut.ToCurrentTime();
+
+    // Older than what we have? Still have to get past the data, so read it into a scratch var.
+    plSimpleStateVariable scratch;
+    plSimpleStateVariable* dst = this;
+    if (fTimeStamp > ut)
+    {
+        scratch.fVar.CopyFrom(&fVar);
+        scratch.Alloc();
+        dst = &scratch;
+    }
+
+    if (!(saveFlags & plSDL::kSameAsDefault))
+    {
+        setDirty = setDirty || ( readOptions & plSDL::kDirtyNonDefaults )!=0;
+
+        if (dst->GetVarDescriptor()->IsVariableLength())
+        {
+            int cnt;
+            plSDL::VariableLengthRead(s, plSDL::kMaxListSize, &cnt);
+            if (cnt >= plSDL::kMaxListSize)
+                return false;
+            dst->fVar.SetCount(cnt);
+            dst->Alloc();       // alloc after setting count
+        }
+
+        bool quantized = (saveFlags & plSDL::kQuantized) != 0;
+        int i;
+        for(i=0;i<dst->fVar.GetCount();i++)
+        {
+            if (quantized)
+                dst->IReadQuantized(s, i);
+            else if (!dst->IReadData(s, timeConvert, i, readOptions))
+                return false;
+        }
+    }
+
+    if (dst != this)
+        return true;
+
+    if ( (saveFlags & plSDL::kHasTimeStamp) || (readOptions & plSDL::kTimeStampOnRead) )
+        TimeStamp(ut);
+
+    if (saveFlags & plSDL::kSameAsDefault)
+    {
+        Reset();
+        SetFromDefaults(false);
+    }
+
+    SetUsed( true );
+    SetDirty( setDirty );
+
+    return true;
+}
+
 void plSimpleStateVariable::CopyData(const plSimpleStateVariable* other, uint32_t writeOptions/*=0*/)
 {
     // use stream as a medium
@@ -2672,7 +2987,8 @@ bool plSDStateVariable::WriteData(hsStream* s, float timeConvert, uint32_t write
             if (!all)
                 plSDL::VariableLengthWrite(s, 
                     GetVarDescriptor()->IsVariableLength() ? 0xffffffff : GetVarDescriptor()->GetCount(), i);   // idx
-            fDataRecList[i]->Write(s, timeConvert, dirtyOnly);  // item
+            fDataRecList[i]->Write(s, timeConvert,
+                (dirtyOnly ? plSDL::kDirtyOnly : 0) | (writeOptions & plSDL::kCompactDelta));  // item
             written++;
         }
     }
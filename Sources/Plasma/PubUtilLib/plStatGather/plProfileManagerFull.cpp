@@ -42,6 +42,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plProfileManagerFull.h"
 #include "plCalculatedProfiles.h"
 #include "plProfileManager.h"
+#include "plProfileTrace.h"
 
 #include "hsStream.h"
 
@@ -52,6 +53,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 plProfileManagerFull::plProfileManagerFull() :
     fVars(plProfileManager::Instance().fVars),
     fLogStats(),
+    fWriteTrace(),
     fShowLaps(),
     fMinLap(),
     fDetailGraph()
@@ -292,6 +294,8 @@ void plProfileManagerFull::Update()
 {
     if (fLogStats)
         ILogStats();
+    if (fWriteTrace && plProfileTrace::IsCaptureDone())
+        IWriteTrace();
 
     //
     // Print the groups we're showing
@@ -422,6 +426,12 @@ void plProfileManagerFull::LogStats(const ST::string& ageName, const ST::string&
     fLogSpawnName = spawnName;
 }
 
+void plProfileManagerFull::CaptureTrace(uint32_t numFrames)
+{
+    plProfileTrace::StartCapture(numFrames);
+    fWriteTrace = true;
+}
+
 plFileName plProfileManagerFull::GetProfilePath()
 {
     static plFileName profilePath;
@@ -490,6 +500,23 @@ void plProfileManagerFull::ILogStats()
     fLogSpawnName = "";
 }
 
+void plProfileManagerFull::IWriteTrace()
+{
+    plUnifiedTime curTime = plUnifiedTime::GetCurrent(plUnifiedTime::kLocal);
+    plFileName traceFilename = plFileName::Join(GetProfilePath(),
+        ST::format("Trace_{02}-{02}-{02}.json",
+                   curTime.GetHour(), curTime.GetMinute(), curTime.GetSecond()));
+
+    hsUNIXStream s;
+    if (s.Open(traceFilename, "wb"))
+    {
+        plProfileTrace::WriteJson(&s);
+        s.Close();
+    }
+
+    fWriteTrace = false;
+}
+
 
 void plProfileManagerFull::ShowLaps(const char* groupName, const char* varName)
 {
@@ -67,6 +67,8 @@ protected:
     ST::string fLogAgeName;
     ST::string fLogSpawnName;
 
+    bool fWriteTrace; // If true, write out the trace capture once it's done
+
     std::vector<plGraphPlate*> fGraphs;
     plGraphPlate* fDetailGraph;
 
@@ -85,6 +87,7 @@ protected:
 
     void IPrintGroup(hsStream* s, const char* groupName, bool printTitle=false);
     void ILogStats();
+    void IWriteTrace();
 
     plProfileVar* IFindTimer(const char* name);
 
@@ -124,6 +127,10 @@ public:
     void LogStats(const ST::string& ageName, const ST::string& spawnName);
     plFileName GetProfilePath();
 
+    // Traces the next numFrames frames on every thread and writes them to the
+    // profile path as Chrome trace JSON when done
+    void CaptureTrace(uint32_t numFrames);
+
     // If you're going to call LogStats, make sure to call this first so all stats will be evaluated before logging
     void ActivateAllStats();
 
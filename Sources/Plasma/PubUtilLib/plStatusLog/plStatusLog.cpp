@@ -58,16 +58,208 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plStatusLog.h"
 #include "plEncryptLogLine.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdlib>
+#include <thread>
 
 #include "plProduct.h"
+#include "hsLockGuard.h"
+#include "hsMPSCQueue.h"
 #include "hsThread.h"
 #include "hsTimer.h"
 #include "hsWindows.h"
+#include "plProfile.h"
 
 #include "plUnifiedTime/plUnifiedTime.h"
 
+//////////////////////////////////////////////////////////////////////////////
+//// plStatusLogWriter ///////////////////////////////////////////////////////
+//  Background thread that owns file output for all logs when async writes
+//  are on.  Producers push finished lines into a lock-free queue; the writer
+//  wakes up periodically (or when the queue starts filling up), writes
+//  everything that's waiting, then flushes each file it touched once.
+//////////////////////////////////////////////////////////////////////////////
+
+class plStatusLogWriter
+{
+    struct QueuedLine
+    {
+        plStatusLog*    fLog;
+        ST::string      fText;
+    };
+
+    enum
+    {
+        kQueueSize      = 8192,
+        kWakeThreshold  = kQueueSize / 4,
+        kMaxBatchLines  = kQueueSize,
+    };
+
+    hsMPSCQueue<QueuedLine> fQueue;
+
+    std::thread             fThread;
+    std::mutex              fLock;
+    std::condition_variable fWake;
+    std::condition_variable fSpace;
+    bool                    fShutdown;
+
+    // Held while popping lines off the queue and writing them, and while a
+    // log's file is closed, so no file is ever closed in the middle of a write
+    std::mutex              fWriteLock;
+
+    void IRun();
+    bool IWriteBatch();
+
+public:
+    plStatusLogWriter()
+        : fQueue(kQueueSize), fShutdown()
+    {
+        fThread = std::thread(&plStatusLogWriter::IRun, this);
+    }
+
+    ~plStatusLogWriter()
+    {
+        {
+            hsLockGuard(fLock);
+            fShutdown = true;
+        }
+        fWake.notify_one();
+        fThread.join();
+    }
+
+    void Write(plStatusLog* log, ST::string text);
+
+    // Writes out everything queued so far, then closes the log's file, so
+    // nothing is left behind for the writer thread to write to it
+    void CloseFile(plStatusLog* log);
+};
+
+void plStatusLogWriter::Write(plStatusLog* log, ST::string text)
+{
+    QueuedLine line { log, std::move(text) };
+    if (!fQueue.TryPush(line)) {
+        // Full.  Never drop log lines; wake the writer and sleep until it
+        // has made room.
+        std::unique_lock<std::mutex> lock(fLock);
+        fWake.notify_one();
+        fSpace.wait(lock, [this, &line] { return fQueue.TryPush(line) || fShutdown; });
+    }
+
+    if (fQueue.GetSize() >= kWakeThreshold)
+        fWake.notify_one();
+}
+
+void plStatusLogWriter::CloseFile(plStatusLog* log)
+{
+    {
+        hsLockGuard(fWriteLock);
+        while (!IWriteBatch())
+            ;
+
+        fclose(log->fFileHandle);
+        log->fFileHandle = nullptr;
+    }
+
+    hsLockGuard(fLock);
+    fSpace.notify_all();
+}
+
+void plStatusLogWriter::IRun()
+{
+    plProfile_SetThreadName("Status Log");
+
+    std::unique_lock<std::mutex> lock(fLock);
+    for (;;) {
+        fWake.wait_for(lock, std::chrono::milliseconds(50), [this] {
+            return fShutdown || fQueue.GetSize() >= kWakeThreshold;
+        });
+
+        bool shutdown = fShutdown;
+
+        lock.unlock();
+        {
+            hsLockGuard(fWriteLock);
+            bool drained = IWriteBatch();
+            while (shutdown && !drained)
+                drained = IWriteBatch();
+        }
+        lock.lock();
+
+        // Producers wait on this (with fLock held) when the queue is full
+        fSpace.notify_all();
+
+        if (shutdown)
+            break;
+    }
+}
+
+// Must be called with fWriteLock held
+bool plStatusLogWriter::IWriteBatch()
+{
+    plProfile_TraceScope("Write Logs");
+
+    std::vector<plStatusLog*> touched;
+
+    QueuedLine line;
+    uint32_t numLines = 0;
+    for (;;) {
+        if (!fQueue.TryPop(line)) {
+            // A producer may have claimed a slot without having filled it yet
+            if (fQueue.GetSize() == 0)
+                break;
+            std::this_thread::yield();
+            continue;
+        }
+
+        FILE* file = line.fLog->fFileHandle;
+        if (file) {
+            fwrite(line.fText.c_str(), 1, line.fText.size(), file);
+            if (std::find(touched.begin(), touched.end(), line.fLog) == touched.end())
+                touched.push_back(line.fLog);
+        }
+
+        if (++numLines >= kMaxBatchLines)
+            break;
+    }
+
+    for (plStatusLog* log : touched) {
+        if (!(log->fFlags & plStatusLog::kNonFlushedLog))
+            fflush(log->fFileHandle);
+    }
+
+    return numLines < kMaxBatchLines;
+}
+
+//// plStatusLogWriterRef ////////////////////////////////////////////////////
+//  Picks up the manager's writer (if any) and keeps it from being destroyed
+//  while a line is handed to it.
+
+class plStatusLogWriterRef
+{
+    plStatusLogMgr&     fMgr;
+    plStatusLogWriter*  fWriter;
+
+public:
+    plStatusLogWriterRef()
+        : fMgr(plStatusLogMgr::GetInstance())
+    {
+        ++fMgr.fWriterUsers;
+        fWriter = fMgr.fWriter;
+    }
+
+    ~plStatusLogWriterRef() { --fMgr.fWriterUsers; }
+
+    plStatusLogWriterRef(const plStatusLogWriterRef&) = delete;
+    plStatusLogWriterRef& operator=(const plStatusLogWriterRef&) = delete;
+
+    explicit operator bool() const { return fWriter != nullptr; }
+    plStatusLogWriter* operator->() const { return fWriter; }
+};
+
 //////////////////////////////////////////////////////////////////////////////
 //// plStatusLogMgr Stuff ////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
@@ -81,12 +273,29 @@ plFileName plStatusLogMgr::IGetBasePath()
 //// Constructor & Destructor ////////////////////////////////////////////////
 
 plStatusLogMgr::plStatusLogMgr()
-    : fDisplays(), fCurrDisplay(), fDrawer(), fLastLogChangeTime()
+    : fDisplays(), fCurrDisplay(), fDrawer(), fLastLogChangeTime(), fWriter(),
+      fWriterUsers()
 {
 }
 
 plStatusLogMgr::~plStatusLogMgr()
 {
+    // Get everything that's queued onto the disk before the logs go away.
+    // Anyone still handing lines to the writer (even if blocked on a full
+    // queue) gets them in before it shuts down.
+    plStatusLogWriter* writer = fWriter.exchange(nullptr);
+    if (writer)
+    {
+        while (fWriterUsers)
+            std::this_thread::yield();
+        delete writer;
+    }
+
+    {
+        hsLockGuard(fLogIndexLock);
+        fLogIndex.clear();
+    }
+
     // Unlink all the displays, but don't delete them; leave that to whomever owns them
     while (fDisplays != nullptr)
     {
@@ -139,6 +348,13 @@ plStatusLog *plStatusLogMgr::CreateStatusLog( uint8_t numDisplayLines, const plF
 
     log->fDisplayPointer = &fCurrDisplay;
 
+    if (filename.IsValid())
+    {
+        // Newest log wins, same as the alphabetical list above
+        hsLockGuard(fLogIndexLock);
+        fLogIndex[filename.AsString()] = log;
+    }
+
     return log;
 }
 
@@ -199,26 +415,46 @@ void    plStatusLogMgr::PrevStatusLog()
 
 plStatusLog *plStatusLogMgr::FindLog( const plFileName &filename, bool createIfNotFound )
 {
-    plStatusLog *log = fDisplays;
-
-    while (log != nullptr)
     {
-        if (log->GetFileName().AsString().compare_i(filename.AsString()) == 0)
-            return log;
-
-        log = log->fNext;
+        hsLockGuard(fLogIndexLock);
+        auto iter = fLogIndex.find(filename.AsString());
+        if (iter != fLogIndex.end())
+            return iter->second;
     }
 
     if( !createIfNotFound )
         return nullptr;
 
     // Didn't find one, so create one! (make it a nice default one :)
-    log = CreateStatusLog( kDefaultNumLines, filename, plStatusLog::kFilledBackground |
-                                                       plStatusLog::kDeleteForMe );
+    plStatusLog *log = CreateStatusLog( kDefaultNumLines, filename, plStatusLog::kFilledBackground |
+                                                                    plStatusLog::kDeleteForMe );
 
     return log;
 }
 
+//// IRemoveFromIndex ////////////////////////////////////////////////////////
+
+void plStatusLogMgr::IRemoveFromIndex(plStatusLog* log)
+{
+    hsLockGuard(fLogIndexLock);
+
+    auto iter = fLogIndex.find(log->GetFileName().AsString());
+    if (iter == fLogIndex.end() || iter->second != log)
+        return;
+    fLogIndex.erase(iter);
+
+    // If another log shares the name, it takes over (first one in the list,
+    // just like a search of the list would find)
+    for (plStatusLog* other = fDisplays; other != nullptr; other = other->fNext)
+    {
+        if (other != log && other->GetFileName().AsString().compare_i(log->GetFileName().AsString()) == 0)
+        {
+            fLogIndex[other->GetFileName().AsString()] = other;
+            break;
+        }
+    }
+}
+
 //// BounceLogs ///////////////////////////////////////////////////////////////
 
 void plStatusLogMgr::BounceLogs()
@@ -233,6 +469,16 @@ void plStatusLogMgr::BounceLogs()
     }
 }
 
+//// EnableAsyncWrites /////////////////////////////////////////////////////
+
+void plStatusLogMgr::EnableAsyncWrites()
+{
+    plStatusLogWriter* writer = new plStatusLogWriter;
+    plStatusLogWriter* expected = nullptr;
+    if (!fWriter.compare_exchange_strong(expected, writer))
+        delete writer;
+}
+
 //// DumpLogs ////////////////////////////////////////////////////////////////
 
 bool plStatusLogMgr::DumpLogs( const plFileName &newFolderName )
@@ -310,10 +556,7 @@ void    plStatusLog::IInit()
 bool plStatusLog::IReOpen()
 {
     if (fFileHandle != nullptr)
-    {
-        fclose( fFileHandle );
-        fFileHandle = nullptr;
-    }
+        ICloseFile();
 
     // Open the file, clearing it, if necessary
     if(!(fFlags & kDontWriteFile))
@@ -359,16 +602,16 @@ void    plStatusLog::IFini()
     int     i;
 
     if (fFileHandle != nullptr)
-    {
-        fclose( fFileHandle );
-        fFileHandle = nullptr;
-    }
+        ICloseFile();
 
     if( *fDisplayPointer == this )
         *fDisplayPointer = nullptr;
 
     if (fBack != nullptr || fNext != nullptr)
+    {
+        plStatusLogMgr::GetInstance().IRemoveFromIndex(this);
         IUnlink();
+    }
 
     for( i = 0; i < fMaxNumLines; i++ )
         delete [] fLines[ i ];
@@ -401,6 +644,20 @@ plStatusLog* plStatusLog::IFindLog(const plFileName& filename)
     return plStatusLogMgr::GetInstance().FindLog(filename);
 }
 
+void plStatusLog::ICloseFile()
+{
+    // With async writes on, the writer may still have lines for this file
+    // queued, so let it write them and close the file under its lock
+    plStatusLogWriterRef writer;
+    if (writer)
+        writer->CloseFile(this);
+    else
+    {
+        fclose( fFileHandle );
+        fFileHandle = nullptr;
+    }
+}
+
 //// IUnlink /////////////////////////////////////////////////////////////////
 
 void    plStatusLog::IUnlink()
@@ -540,10 +797,7 @@ void    plStatusLog::Bounce( uint32_t flags)
         fOrigFlags=flags;
     Clear();
     if (fFileHandle != nullptr)
-    {
-        fclose( fFileHandle );
-        fFileHandle = nullptr;
-    }
+        ICloseFile();
     AddLine( "--------- Bounced Log ---------" );
 }
 
@@ -611,6 +865,16 @@ bool plStatusLog::IPrintLineToFile( const char *line, uint32_t count )
             buf.append_char('\n');
         }
 
+        plStatusLogWriterRef writer;
+        if (writer)
+        {
+            if (buf.size() > 0)
+            {
+                fSize += buf.size();
+                writer->Write(this, ST::string::from_utf8(buf.raw_buffer(), buf.size(), ST::assume_valid));
+            }
+        }
+        else
         {
             int err;
             err = fwrite(buf.raw_buffer(), 1, buf.size(), fFileHandle);
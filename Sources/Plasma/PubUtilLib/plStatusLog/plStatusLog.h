@@ -61,7 +61,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plFileSystem.h"
 #include "plLoggable.h"
 
+#include <atomic>
+#include <mutex>
 #include <string_theory/format>
+#include <unordered_map>
 
 class plPipeline;
 
@@ -71,12 +74,14 @@ class plPipeline;
 
 class plStatusLogMgr;
 class plStatusLogDrawerStub;
+class plStatusLogWriter;
 
 class plStatusLog : public plLog
 {
     friend class plStatusLogMgr;
     friend class plStatusLogDrawerStub;
     friend class plStatusLogDrawer;
+    friend class plStatusLogWriter;
     
     protected:
 
@@ -104,6 +109,7 @@ class plStatusLog : public plLog
         bool    IPrintLineToFile( const char *line, uint32_t count );
         void    IParseFileName(plFileName &fileNoExt, ST::string &ext) const;
         static plStatusLog* IFindLog(const plFileName& filename);
+        void    ICloseFile();
 
         void    IInit();
         void    IFini();
@@ -243,6 +249,7 @@ class plStatusLog : public plLog
 class plStatusLogMgr
 {
     friend class plStatusLog;
+    friend class plStatusLogWriterRef;
 
     private:
 
@@ -258,8 +265,21 @@ class plStatusLogMgr
 
         double fLastLogChangeTime;
 
+        // Name lookup for FindLog, so the static AddLineS() family doesn't
+        // have to walk the whole display list on every call
+        typedef std::unordered_map<ST::string, plStatusLog*, ST::hash_i, ST::equal_i> LogIndex;
+        LogIndex    fLogIndex;
+        std::mutex  fLogIndexLock;
+
+        // Published once, then only taken down when the manager goes away,
+        // after everyone who picked it up (fWriterUsers) is done with it
+        std::atomic<plStatusLogWriter*> fWriter;
+        std::atomic<uint32_t>           fWriterUsers;
+
         static plFileName IGetBasePath();
 
+        void        IRemoveFromIndex(plStatusLog* log);
+
     public:
 
         enum
@@ -284,6 +304,13 @@ class plStatusLogMgr
 
         void        BounceLogs();
 
+        // Hands file output to a background thread that writes and flushes
+        // it in batches.  Lines are still formatted (and timestamped) by the
+        // thread adding them.  There's no turning it off again; the writer
+        // runs until the manager is destroyed.
+        void        EnableAsyncWrites();
+        bool        GetAsyncWrites() const { return fWriter != nullptr; }
+
         // Create a new folder and copy all log files into it (returns false on failure)
         bool        DumpLogs( const plFileName &newFolderName );
 };
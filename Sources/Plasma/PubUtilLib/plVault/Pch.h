@@ -61,6 +61,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include <sstream>
 #include <string_theory/string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "hsGeometry3.h"
 #include "hsSTLStream.h"
@@ -47,6 +47,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 
 #include "Pch.h"
+#include "plVaultNodeCache.h"
 
 
 /*****************************************************************************
@@ -105,6 +106,12 @@ struct IRelVaultNode {
         link
     ) children;
 
+    // Our place in s_nodeIndex
+    std::vector<uint64_t>   indexKeys;
+    uint64_t                indexSerial;
+    bool                    indexed;
+    bool                    indexDirty;
+
     IRelVaultNode(hsWeakRef<RelVaultNode> node);
     ~IRelVaultNode ();
 
@@ -113,6 +120,33 @@ struct IRelVaultNode {
     
     // Unlink the node from our parent and children lists
     void Unlink(hsWeakRef<RelVaultNode> other);
+
+    bool HasMoreChildrenThan (size_t count) const;
+};
+
+
+// Looks up the nodes in s_nodes by the keys from NetVaultNode::GetIndexKeys,
+// so that finding them by template doesn't mean checking every one of them.
+// Nodes that change are filed again the next time anyone looks.
+struct VaultNodeIndex {
+    typedef std::unordered_set<RelVaultNode*> Bucket;
+
+    std::unordered_map<uint64_t, Bucket>    buckets;
+    std::unordered_set<RelVaultNode*>       dirty;
+    uint64_t                                nextSerial;
+
+    VaultNodeIndex () : nextSerial() { }
+
+    void Add (hsWeakRef<RelVaultNode> node);
+    void Remove (hsWeakRef<RelVaultNode> node);
+    void MarkDirty (hsWeakRef<RelVaultNode> node);
+
+    // Returns every node that could match the template, or nullptr if the
+    // template has nothing we can look up.
+    const Bucket * Find (const NetVaultNode * templateNode);
+
+private:
+    void IRefresh ();
 };
 
 
@@ -165,6 +199,32 @@ struct VaultFindNodeTrans {
 };
 
 
+struct VaultCachedNode {
+    hsRef<NetVaultNode>         node;
+    unsigned                    vaultId;
+    bool                        current;        // the server says it hasn't changed
+    FNetCliAuthVaultNodeFetched fetchCallback;  // set if asked for before the server answered
+    void *                      fetchParam;
+
+    VaultCachedNode (hsRef<NetVaultNode> _node, unsigned _vaultId)
+        : node(std::move(_node)), vaultId(_vaultId), current(), fetchCallback(), fetchParam() { }
+};
+
+struct VaultCachedNodeTrans {
+    hsRef<NetVaultNode>         node;
+
+    VaultCachedNodeTrans (hsRef<NetVaultNode> _node)
+        : node(std::move(_node)) { }
+
+    static void VaultNodeFound (
+        ENetError           result,
+        void *              param,
+        unsigned            nodeIdCount,
+        const unsigned      nodeIds[]
+    );
+};
+
+
 struct VaultDownloadTrans {
     FVaultDownloadCallback      callback;
     void *                      cbParam;
@@ -287,6 +347,11 @@ static HASHTABLEDECL(
     link
 ) s_nodes;
 
+static VaultNodeIndex s_nodeIndex;
+
+// Nodes read from the on-disk cache that haven't been asked for yet
+static std::unordered_map<unsigned, VaultCachedNode> s_cachedNodes;
+
 static LISTDECL(
     IVaultCallback,
     link
@@ -373,6 +438,7 @@ static void BuildNodeTree (
             parentLink = new RelVaultNodeLink(false, 0, refs[i].parentId);
             parentLink->node->SetNodeId_NoDirty(refs[i].parentId);
             s_nodes.Add(parentLink);
+            s_nodeIndex.Add(parentLink->node);
         }
         else {
             existingNodeIds->emplace_back(refs[i].parentId);
@@ -383,6 +449,7 @@ static void BuildNodeTree (
             childLink = new RelVaultNodeLink(refs[i].seen, refs[i].ownerId, refs[i].childId);
             childLink->node->SetNodeId_NoDirty(refs[i].childId);
             s_nodes.Add(childLink);
+            s_nodeIndex.Add(childLink->node);
         }
         else {
             existingNodeIds->emplace_back(refs[i].childId);
@@ -468,6 +535,113 @@ static void FetchRefOwners (
     }
 }
 
+//============================================================================
+// Reads the cached nodes and asks the server which of them are still
+// current, while the refs are still being fetched, so that by the time we
+// know which nodes we need we know which ones we have.
+static void LoadNodeCache (unsigned vaultId) {
+    std::vector<hsRef<NetVaultNode>> nodes;
+    if (!VaultReadNodeCache(vaultId, &nodes))
+        return;
+
+    LogMsg(kLogDebug, "Vault: Read {} cached nodes for vault {}", nodes.size(), vaultId);
+    for (hsRef<NetVaultNode> & node : nodes) {
+        auto [it, added] = s_cachedNodes.try_emplace(node->GetNodeId(), node, vaultId);
+        if (!added)
+            continue;
+
+        // The server only answers with a node id if it was last changed when
+        // our copy says it was
+        NetVaultNode templateNode;
+        templateNode.SetNodeId(node->GetNodeId());
+        templateNode.SetNodeType(node->GetNodeType());
+        templateNode.SetModifyTime(node->GetModifyTime());
+        NetCliAuthVaultNodeFind(
+            &templateNode,
+            VaultCachedNodeTrans::VaultNodeFound,
+            new VaultCachedNodeTrans(std::move(node))
+        );
+    }
+}
+
+//============================================================================
+static void SaveNodeCache (unsigned vaultId) {
+    RelVaultNodeLink * root = s_nodes.Find(vaultId);
+    if (!root || root->node->GetNodeType() == 0)
+        return;
+
+    // Modify times are whole seconds, so a node changed again in the second
+    // we fetched it would still look current. Leave out anything that hasn't
+    // been left alone for a while, with room for our clock being off.
+    const uint32_t kMinCacheAgeSecs = 24 * 60 * 60;
+    uint32_t cutoff = uint32_t(plUnifiedTime::GetCurrent().GetSecs()) - kMinCacheAgeSecs;
+
+    // Everything under the root that we have all of, and that the server
+    // has all of. Anything still waiting to be saved may never make it.
+    std::vector<hsWeakRef<NetVaultNode>> nodes;
+    std::vector<RelVaultNode *> pending { root->node.Get() };
+    std::unordered_set<RelVaultNode *> visited { root->node.Get() };
+    while (!pending.empty()) {
+        RelVaultNode * node = pending.back();
+        pending.pop_back();
+        if (node->GetNodeType() != 0 && !node->IsDirty() && node->GetModifyTime() < cutoff)
+            nodes.emplace_back(node);
+
+        RelVaultNodeLink * link = node->state->children.Head();
+        for (; link; link = node->state->children.Next(link)) {
+            if (visited.insert(link->node.Get()).second)
+                pending.emplace_back(link->node.Get());
+        }
+    }
+
+    if (!VaultWriteNodeCache(vaultId, nodes))
+        LogMsg(kLogError, "Vault: Failed to write the node cache for vault {}", vaultId);
+}
+
+//============================================================================
+// Forgets the cached nodes the download didn't need, and if it went well,
+// saves what we have now for next time.
+static void FinishNodeCache (unsigned vaultId, bool save) {
+    for (auto it = s_cachedNodes.begin(); it != s_cachedNodes.end(); ) {
+        // Another download may still be waiting on one we share with it
+        if (it->second.vaultId == vaultId && !it->second.fetchCallback)
+            it = s_cachedNodes.erase(it);
+        else
+            ++it;
+    }
+
+    if (save)
+        SaveNodeCache(vaultId);
+}
+
+//============================================================================
+// Fetches the node, unless we have a copy of it cached that the server says
+// is still current. If the server already said so, that's returned for the
+// caller to use now. Otherwise the callback gets it either way.
+static hsRef<NetVaultNode> FetchNode (
+    unsigned                    nodeId,
+    FNetCliAuthVaultNodeFetched fetchCallback,
+    void *                      fetchParam
+) {
+    auto it = s_cachedNodes.find(nodeId);
+    if (it == s_cachedNodes.end() || it->second.fetchCallback) {
+        NetCliAuthVaultNodeFetch(nodeId, fetchCallback, fetchParam);
+        return nullptr;
+    }
+
+    VaultCachedNode & cached = it->second;
+    if (cached.current) {
+        hsRef<NetVaultNode> node = std::move(cached.node);
+        s_cachedNodes.erase(it);
+        return node;
+    }
+
+    // Still waiting to hear from the server
+    cached.fetchCallback = fetchCallback;
+    cached.fetchParam = fetchParam;
+    return nullptr;
+}
+
 //============================================================================
 static void FetchNodesFromRefs (
     NetVaultNodeRef *           refs,
@@ -502,12 +676,10 @@ static void FetchNodesFromRefs (
         if (link->node->GetNodeId() == prevId)
             continue;
         prevId = link->node->GetNodeId();
-        NetCliAuthVaultNodeFetch(
-            nodeId,
-            fetchCallback,
-            fetchParam
-        );
-        ++(*fetchCount);
+        if (hsRef<NetVaultNode> cached = FetchNode(nodeId, fetchCallback, fetchParam))
+            VaultNodeFetched(kNetSuccess, nullptr, cached.Get());
+        else
+            ++(*fetchCount);
     }
 }
 
@@ -552,6 +724,7 @@ static void VaultNodeFetched (
         link = new RelVaultNodeLink(false, 0, node->GetNodeId());
         link->node->SetNodeId_NoDirty(node->GetNodeId());
         s_nodes.Add(link);
+        s_nodeIndex.Add(link->node);
     }
     link->node->CopyFrom(node);
     InitFetchedNode(link->node);
@@ -850,6 +1023,56 @@ void VaultFindNodeTrans::VaultNodeFound (
 }
 
 
+/*****************************************************************************
+*
+*   VaultCachedNodeTrans
+*
+***/
+
+//============================================================================
+void VaultCachedNodeTrans::VaultNodeFound (
+    ENetError           result,
+    void *              param,
+    unsigned            nodeIdCount,
+    const unsigned      nodeIds[]
+) {
+    VaultCachedNodeTrans * trans = (VaultCachedNodeTrans *)param;
+    unsigned nodeId = trans->node->GetNodeId();
+
+    // Dropped since we asked, or replaced by another download's copy
+    auto it = s_cachedNodes.find(nodeId);
+    if (it == s_cachedNodes.end() || it->second.node != trans->node) {
+        delete trans;
+        return;
+    }
+
+    VaultCachedNode & cached = it->second;
+    bool current = IS_NET_SUCCESS(result) && nodeIdCount == 1 && nodeIds[0] == nodeId;
+    if (!cached.fetchCallback) {
+        // Nobody's asked for it yet
+        if (current)
+            cached.current = true;
+        else
+            s_cachedNodes.erase(it);
+    }
+    else {
+        FNetCliAuthVaultNodeFetched fetchCallback = cached.fetchCallback;
+        void * fetchParam = cached.fetchParam;
+        s_cachedNodes.erase(it);
+
+        if (current) {
+            fetchCallback(kNetSuccess, fetchParam, trans->node.Get());
+        }
+        else {
+            // Changed since we cached it (or we couldn't tell), get it for real
+            NetCliAuthVaultNodeFetch(nodeId, fetchCallback, fetchParam);
+        }
+    }
+
+    delete trans;
+}
+
+
 /*****************************************************************************
 *
 *   VaultDownloadTrans
@@ -883,6 +1106,7 @@ void VaultDownloadTrans::VaultNodeFetched (
     
     if (!trans->nodesLeft) {
         VaultDump(trans->tag, trans->vaultId);
+        FinishNodeCache(trans->vaultId, IS_NET_SUCCESS(trans->result));
 
         if (trans->callback)
             trans->callback(
@@ -935,6 +1159,8 @@ void VaultDownloadTrans::VaultNodeRefsFetched (
 
     // Make the callback now if there are no nodes to fetch, or if error
     if (!trans->nodesLeft) {
+        FinishNodeCache(trans->vaultId, IS_NET_SUCCESS(trans->result) && refCount);
+
         if (trans->callback)
             trans->callback(
                 trans->result,
@@ -1047,7 +1273,7 @@ void AddChildNodeFetchTrans::VaultNodeFetched (
 
 //============================================================================
 IRelVaultNode::IRelVaultNode(hsWeakRef<RelVaultNode> node)
-    : node(node)
+    : node(node), indexSerial(), indexed(), indexDirty()
 { }
 
 //============================================================================
@@ -1102,6 +1328,143 @@ void IRelVaultNode::Unlink(hsWeakRef<RelVaultNode> other) {
     }
 }
 
+//============================================================================
+bool IRelVaultNode::HasMoreChildrenThan (size_t count) const {
+    for (const RelVaultNodeLink * link = children.Head(); link; link = children.Next(link)) {
+        if (count-- == 0)
+            return true;
+    }
+    return false;
+}
+
+
+/*****************************************************************************
+*
+*   VaultNodeIndex
+*
+***/
+
+//============================================================================
+void VaultNodeIndex::Add (hsWeakRef<RelVaultNode> node) {
+    IRelVaultNode * state = node->state;
+    if (state->indexed)
+        return;
+
+    // Nodes usually get filled in right after this, so leave the keys to
+    // the next refresh
+    state->indexed = true;
+    state->indexDirty = true;
+    state->indexSerial = nextSerial++;
+    dirty.insert(node.Get());
+}
+
+//============================================================================
+void VaultNodeIndex::Remove (hsWeakRef<RelVaultNode> node) {
+    IRelVaultNode * state = node->state;
+    if (!state->indexed)
+        return;
+
+    for (uint64_t key : state->indexKeys) {
+        auto it = buckets.find(key);
+        if (it != buckets.end()) {
+            it->second.erase(node.Get());
+            if (it->second.empty())
+                buckets.erase(it);
+        }
+    }
+    state->indexKeys.clear();
+
+    if (state->indexDirty)
+        dirty.erase(node.Get());
+    state->indexed = false;
+    state->indexDirty = false;
+}
+
+//============================================================================
+void VaultNodeIndex::MarkDirty (hsWeakRef<RelVaultNode> node) {
+    IRelVaultNode * state = node->state;
+    if (state->indexed && !state->indexDirty) {
+        state->indexDirty = true;
+        dirty.insert(node.Get());
+    }
+}
+
+//============================================================================
+void VaultNodeIndex::IRefresh () {
+    // Clearing even an empty set costs as much as its bucket count
+    if (dirty.empty())
+        return;
+
+    uint64_t keys[NetVaultNode::kMaxIndexKeys];
+    for (RelVaultNode * node : dirty) {
+        IRelVaultNode * state = node->state;
+        for (uint64_t key : state->indexKeys) {
+            auto it = buckets.find(key);
+            if (it != buckets.end()) {
+                it->second.erase(node);
+                if (it->second.empty())
+                    buckets.erase(it);
+            }
+        }
+
+        size_t numKeys = node->GetIndexKeys(keys);
+        state->indexKeys.assign(keys, keys + numKeys);
+        for (uint64_t key : state->indexKeys)
+            buckets[key].insert(node);
+        state->indexDirty = false;
+    }
+    dirty.clear();
+}
+
+//============================================================================
+const VaultNodeIndex::Bucket * VaultNodeIndex::Find (const NetVaultNode * templateNode) {
+    static const Bucket kEmpty;
+
+    uint64_t keys[NetVaultNode::kMaxIndexKeys];
+    size_t numKeys = templateNode->GetIndexKeys(keys);
+    if (!numKeys)
+        return nullptr;
+
+    IRefresh();
+
+    // Anything that matches is filed under all of these, so the smallest
+    // one will do
+    const Bucket * best = nullptr;
+    for (size_t i = 0; i < numKeys; ++i) {
+        auto it = buckets.find(keys[i]);
+        if (it == buckets.end())
+            return &kEmpty;
+        if (!best || it->second.size() < best->size())
+            best = &it->second;
+    }
+    return best;
+}
+
+//============================================================================
+// Returns whether node is no more than maxDepth links below ancestor.
+static bool IsBelow (
+    RelVaultNode *  node,
+    RelVaultNode *  ancestor,
+    unsigned        maxDepth
+) {
+    std::vector<RelVaultNode *> level { node }, nextLevel;
+    std::unordered_set<RelVaultNode *> visited { node };
+    for (unsigned depth = 1; depth <= maxDepth && !level.empty(); ++depth) {
+        for (RelVaultNode * child : level) {
+            RelVaultNodeLink * link = child->state->parents.Head();
+            for (; link; link = child->state->parents.Next(link)) {
+                if (link->node == ancestor)
+                    return true;
+                if (visited.insert(link->node.Get()).second)
+                    nextLevel.emplace_back(link->node.Get());
+            }
+        }
+        level.swap(nextLevel);
+        nextLevel.clear();
+    }
+    return false;
+}
+
 /*****************************************************************************
 *
 *   RelVaultNode
@@ -1118,6 +1481,12 @@ RelVaultNode::~RelVaultNode () {
     delete state;
 }
 
+//============================================================================
+void RelVaultNode::IFieldsChanged (uint64_t fields) {
+    if (state && (fields & kIndexedFields))
+        s_nodeIndex.MarkDirty(this);
+}
+
 //============================================================================
 bool RelVaultNode::IsParentOf (unsigned childId, unsigned maxDepth) {
     if (GetNodeId() == childId)
@@ -1227,6 +1596,27 @@ hsRef<RelVaultNode> RelVaultNode::GetChildNode (
     if (maxDepth == 0)
         return nullptr;
 
+    // When there are fewer nodes that could match than we have children
+    // (think a big inbox), look at those and see which of them are below us.
+    // Which one the scan below finds first depends on the order of every
+    // child list on the way down, so if it's more than one, leave it to that.
+    const VaultNodeIndex::Bucket * candidates = s_nodeIndex.Find(templateNode.Get());
+    if (candidates && state->HasMoreChildrenThan(candidates->size())) {
+        hsWeakRef<RelVaultNode> found;
+        bool ambiguous = false;
+        for (RelVaultNode * node : *candidates) {
+            if (!node->Matches(templateNode.Get()) || !IsBelow(node, this, maxDepth))
+                continue;
+            if (found) {
+                ambiguous = true;
+                break;
+            }
+            found = node;
+        }
+        if (!ambiguous)
+            return found;
+    }
+
     RelVaultNodeLink * link;
     link = state->children.Head();
     for (; link; link = state->children.Next(link)) {
@@ -1547,11 +1937,13 @@ void VaultDestroy () {
     NetCliAuthVaultSetRecvNodeDeletedHandler(nullptr);
 
     VaultClearDeviceInboxMap();
+    s_cachedNodes.clear();
     
     RelVaultNodeLink * next, * link = s_nodes.Head();
     for (; link; link = next) {
         next = s_nodes.Next(link);
         link->node->state->UnlinkFromRelatives();
+        s_nodeIndex.Remove(link->node);
         delete link;
     }
 }
@@ -1573,6 +1965,18 @@ hsRef<RelVaultNode> VaultGetNode (
     hsWeakRef<NetVaultNode> templateNode
 ) {
     ASSERT(templateNode);
+
+    if (const VaultNodeIndex::Bucket * candidates = s_nodeIndex.Find(templateNode.Get())) {
+        // Same answer as the scan below: the first one we got
+        hsWeakRef<RelVaultNode> found;
+        for (RelVaultNode * node : *candidates) {
+            if (node->Matches(templateNode.Get()) &&
+                (!found || node->state->indexSerial < found->state->indexSerial))
+                found = node;
+        }
+        return found;
+    }
+
     RelVaultNodeLink * link = s_nodes.Head();
     while (link) {
         if (link->node->Matches(templateNode.Get()))
@@ -1616,6 +2020,7 @@ void VaultAddChildNode (
             childLink = new RelVaultNodeLink(false, ownerId, childId);
             childLink->node->SetNodeId_NoDirty(childId);
             s_nodes.Add(childLink);
+            s_nodeIndex.Add(childLink->node);
         }
         else if (ownerId) {
             childLink->ownerId = ownerId;
@@ -1729,6 +2134,22 @@ static void _AddChildNodeCallback (
 
 } // namespace _VaultAddChildNodeAndWait
 
+//============================================================================
+void VaultLocalAddChildNode (
+    unsigned    parentId,
+    unsigned    childId,
+    unsigned    ownerId
+) {
+    NetVaultNodeRef refs[] = {
+        { parentId, childId, ownerId }
+    };
+
+    std::vector<unsigned> newNodeIds;
+    std::vector<unsigned> existingNodeIds;
+
+    BuildNodeTree(refs, std::size(refs), &newNodeIds, &existingNodeIds);
+}
+
 //============================================================================
 void VaultAddChildNodeAndWait (
     unsigned                    parentId,
@@ -2050,6 +2471,22 @@ void VaultLocalFindNodes (
     hsWeakRef<NetVaultNode> templateNode,
     std::vector<unsigned> * nodeIds
 ) {
+    if (const VaultNodeIndex::Bucket * candidates = s_nodeIndex.Find(templateNode.Get())) {
+        std::vector<RelVaultNode *> found;
+        for (RelVaultNode * node : *candidates) {
+            if (node->Matches(templateNode.Get()))
+                found.emplace_back(node);
+        }
+
+        // In the order we got them, like the scan below
+        std::sort(found.begin(), found.end(), [](RelVaultNode * a, RelVaultNode * b) {
+            return a->state->indexSerial < b->state->indexSerial;
+        });
+        for (RelVaultNode * node : found)
+            nodeIds->emplace_back(node->GetNodeId());
+        return;
+    }
+
     for (RelVaultNodeLink * link = s_nodes.Head(); link != nullptr; link = s_nodes.Next(link)) {
         if (link->node->Matches(templateNode.Get()))
             nodeIds->emplace_back(link->node->GetNodeId());
@@ -4603,6 +5040,7 @@ void VaultDownload (
     VaultDownloadTrans * trans = new VaultDownloadTrans(tag, callback, cbParam,
         progressCallback, cbProgressParam, vaultId);
 
+    LoadNodeCache(vaultId);
     NetCliAuthVaultFetchNodeRefs(
         vaultId,
         VaultDownloadTrans::VaultNodeRefsFetched,
@@ -4622,6 +5060,7 @@ void VaultDownloadNoCallbacks (
     VaultDownloadNoCallbacksTrans * trans = new VaultDownloadNoCallbacksTrans(tag,
         callback, cbParam, progressCallback, cbProgressParam, vaultId);
 
+    LoadNodeCache(vaultId);
     NetCliAuthVaultFetchNodeRefs(
         vaultId,
         VaultDownloadTrans::VaultNodeRefsFetched,
@@ -4676,6 +5115,7 @@ void VaultCull (unsigned vaultId) {
     if (RelVaultNodeLink * link = s_nodes.Find(vaultId)) {
         LogMsg(kLogDebug, "Vault: Culling node {}", link->node->GetNodeId());
         link->node->state->UnlinkFromRelatives();
+        s_nodeIndex.Remove(link->node);
         delete link;
     }
 
@@ -4699,6 +5139,7 @@ void VaultCull (unsigned vaultId) {
         if (!foundRoot) {
             LogMsg(kLogDebug, "Vault: Culling node {}", link->node->GetNodeId());
             link->node->state->UnlinkFromRelatives();
+            s_nodeIndex.Remove(link->node);
             delete link;
         }
     }   
@@ -187,6 +187,9 @@ struct RelVaultNode : NetVaultNode {
     
     // AgeInfoNode-specific (and it checks!)
     hsRef<RelVaultNode> GetParentAgeLink ();
+
+protected:
+    void IFieldsChanged (uint64_t fields) override;
 };
 
 
@@ -228,6 +231,13 @@ void VaultAddChildNodeAndWait (
     unsigned                    childId,
     unsigned                    ownerId
 );
+// Links the nodes locally only, making empty ones for any we don't have
+// yet. The server never hears about it, so this is for offline trees.
+void VaultLocalAddChildNode (
+    unsigned                    parentId,
+    unsigned                    childId,
+    unsigned                    ownerId
+);
 typedef void (*FVaultRemoveChildNodeCallback)(
     ENetError       result,
     void *          param
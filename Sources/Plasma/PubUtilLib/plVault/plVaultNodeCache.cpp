@@ -0,0 +1,189 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+/*****************************************************************************
+*
+*   $/Plasma20/Sources/Plasma/PubUtilLib/plVault/plVaultNodeCache.cpp
+*   
+***/
+
+#include "Pch.h"
+#include "plVaultNodeCache.h"
+
+#include "hsStream.h"
+
+#include "pnEncryption/plChecksum.h"
+
+
+/*****************************************************************************
+*
+*   Private
+*
+***/
+
+// File layout, all little endian:
+//   magic, version, vault id, node count
+//   MD5 of everything after it
+//   per node: node id, size, then the node as written by NetVaultNode::Write
+static const uint32_t kCacheMagic   = 0x434E5650;   // 'PVNC'
+static const uint32_t kCacheVersion = 1;
+static const size_t   kHeaderSize   = sizeof(uint32_t) * 4 + MD5_DIGEST_LENGTH;
+
+//============================================================================
+static uint32_t ReadLE32 (const uint8_t *& cur) {
+    uint32_t value;
+    memcpy(&value, cur, sizeof(value));
+    cur += sizeof(value);
+    return hsToLE32(value);
+}
+
+//============================================================================
+static void AppendLE32 (std::vector<uint8_t> * buf, uint32_t value) {
+    value = hsToLE32(value);
+    const uint8_t * bytes = reinterpret_cast<const uint8_t *>(&value);
+    buf->insert(buf->end(), bytes, bytes + sizeof(value));
+}
+
+
+/*****************************************************************************
+*
+*   Exports
+*
+***/
+
+//============================================================================
+plFileName VaultGetNodeCachePath (unsigned vaultId) {
+    return plFileName::Join(plFileSystem::GetUserDataPath(), "VaultCache",
+                            ST::format("{}.dat", vaultId));
+}
+
+//============================================================================
+bool VaultReadNodeCache (
+    unsigned                            vaultId,
+    std::vector<hsRef<NetVaultNode>> *  nodes
+) {
+    hsUNIXStream s;
+    if (!s.Open(VaultGetNodeCachePath(vaultId), "rb"))
+        return false;
+    std::vector<uint8_t> data(s.GetEOF());
+    bool readOk = s.Read(uint32_t(data.size()), data.data()) == data.size();
+    s.Close();
+    if (!readOk || data.size() < kHeaderSize)
+        return false;
+
+    const uint8_t * cur = data.data();
+    const uint8_t * end = cur + data.size();
+    if (ReadLE32(cur) != kCacheMagic || ReadLE32(cur) != kCacheVersion || ReadLE32(cur) != vaultId)
+        return false;
+    uint32_t count = ReadLE32(cur);
+
+    // NetVaultNode::Read trusts what it's given, so don't give it anything
+    // that didn't come out of VaultWriteNodeCache
+    const uint8_t * body = cur + MD5_DIGEST_LENGTH;
+    plMD5Checksum sum(end - body, body);
+    if (memcmp(sum.GetValue(), cur, MD5_DIGEST_LENGTH) != 0)
+        return false;
+    cur = body;
+
+    // The count isn't under the checksum, but every node takes at least its
+    // id and size, so it can't ask for more than the body could hold
+    if (count > size_t(end - cur) / (sizeof(uint32_t) * 2))
+        return false;
+
+    std::vector<hsRef<NetVaultNode>> result;
+    result.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (size_t(end - cur) < sizeof(uint32_t) * 2)
+            return false;
+        uint32_t nodeId = ReadLE32(cur);
+        uint32_t size = ReadLE32(cur);
+        if (size_t(end - cur) < size)
+            return false;
+
+        hsRef<NetVaultNode> node(new NetVaultNode, hsStealRef);
+        node->Read(cur, size);
+        cur += size;
+        if (node->GetNodeId() != nodeId)
+            return false;
+        result.emplace_back(std::move(node));
+    }
+    if (cur != end)
+        return false;
+
+    nodes->insert(nodes->end(), result.begin(), result.end());
+    return true;
+}
+
+//============================================================================
+bool VaultWriteNodeCache (
+    unsigned                                        vaultId,
+    const std::vector<hsWeakRef<NetVaultNode>> &    nodes
+) {
+    std::vector<uint8_t> body;
+    std::vector<uint8_t> nodeData;
+    for (const hsWeakRef<NetVaultNode> & node : nodes) {
+        nodeData.clear();
+        node->Write(&nodeData);
+        AppendLE32(&body, node->GetNodeId());
+        AppendLE32(&body, uint32_t(nodeData.size()));
+        body.insert(body.end(), nodeData.begin(), nodeData.end());
+    }
+    plMD5Checksum sum(body.size(), body.data());
+
+    // Write it next to the old one and swap them, so that a crash part way
+    // through leaves the last good cache
+    plFileName path = VaultGetNodeCachePath(vaultId);
+    plFileName tempPath = path + ".tmp";
+    plFileSystem::CreateDir(path.StripFileName(), true);
+    hsUNIXStream s;
+    if (!s.Open(tempPath, "wb"))
+        return false;
+    s.WriteLE32(kCacheMagic);
+    s.WriteLE32(kCacheVersion);
+    s.WriteLE32(uint32_t(vaultId));
+    s.WriteLE32(uint32_t(nodes.size()));
+    s.Write(MD5_DIGEST_LENGTH, sum.GetValue());
+    s.Write(uint32_t(body.size()), body.data());
+    s.Close();
+
+    // A short write is caught by the checksum when it's read back
+    return plFileSystem::Move(tempPath, path);
+}
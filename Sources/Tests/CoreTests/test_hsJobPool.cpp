@@ -0,0 +1,118 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "hsJobPool.h"
+
+// Runs a batch where every job just counts how often it ran
+static void RunCounted(size_t numJobs)
+{
+    std::unique_ptr<std::atomic<int>[]> runs(new std::atomic<int>[numJobs]);
+    for (size_t i = 0; i < numJobs; ++i)
+        runs[i] = 0;
+
+    hsJobPool::Instance().Run(numJobs, [&runs](size_t i) { runs[i]++; });
+
+    for (size_t i = 0; i < numJobs; ++i)
+        ASSERT_EQ(1, runs[i].load()) << "job " << i << " of " << numJobs;
+}
+
+TEST(hsJobPool, RunsEachJobOnce)
+{
+    for (size_t numJobs : { 0, 1, 2, 3, 7, 64, 1000 })
+        RunCounted(numJobs);
+}
+
+TEST(hsJobPool, BackToBackBatches)
+{
+    // Workers can still be finishing up with one batch when the next one
+    // shows up, which mustn't let them claim jobs from the wrong batch.
+    for (int n = 0; n < 2000; ++n)
+        RunCounted(1 + n % 13);
+}
+
+TEST(hsJobPool, ConcurrentCallers)
+{
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; ++t)
+    {
+        callers.emplace_back([] {
+            for (int n = 0; n < 500; ++n)
+                RunCounted(1 + n % 29);
+        });
+    }
+    for (std::thread& caller : callers)
+        caller.join();
+}
+
+TEST(hsJobPool, NestedRun)
+{
+    std::atomic<int> total(0);
+    hsJobPool::Instance().Run(8, [&total](size_t) {
+        hsJobPool::Instance().Run(16, [&total](size_t) { total++; });
+    });
+    EXPECT_EQ(8 * 16, total.load());
+}
+
+TEST(hsJobPool, RunRanges)
+{
+    for (uint32_t count : { 0, 1, 5, 100, 1001 })
+    {
+        for (uint32_t perJob : { 0, 1, 7, 100, 2000 })
+        {
+            std::vector<std::atomic<int>> hits(count);
+            hsJobPool::Instance().RunRanges(count, perJob, [&hits](uint32_t first, uint32_t end) {
+                ASSERT_LT(first, end);
+                for (uint32_t i = first; i < end; ++i)
+                    hits[i]++;
+            });
+            for (uint32_t i = 0; i < count; ++i)
+                ASSERT_EQ(1, hits[i].load()) << i << " of " << count << " by " << perJob;
+        }
+    }
+}
@@ -0,0 +1,128 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+
+#include "HeadSpin.h"
+#include "hsMappedStream.h"
+#include "plFileSystem.h"
+
+static plFileName WriteTestFile(const void* data, uint32_t size)
+{
+    plFileName path = "test_hsMappedStream.tmp";
+    hsUNIXStream s;
+    s.Open(path, "wb");
+    s.Write(size, data);
+    s.Close();
+    return path;
+}
+
+TEST(hsMappedStream, read)
+{
+    const char data[] = "The quick brown fox jumps over the lazy dog";
+    plFileName path = WriteTestFile(data, sizeof(data));
+
+    hsMappedStream s;
+    ASSERT_TRUE(s.Open(path, "rb"));
+    EXPECT_EQ(s.GetEOF(), sizeof(data));
+
+    char buf[sizeof(data)];
+    EXPECT_EQ(s.Read(4, buf), 4);
+    EXPECT_EQ(memcmp(buf, data, 4), 0);
+    EXPECT_EQ(s.GetPosition(), 4);
+
+    s.SetPosition(10);
+    EXPECT_EQ(s.ReadByte(), 'b');
+
+    s.Rewind();
+    EXPECT_EQ(s.Read(sizeof(buf), buf), sizeof(buf));
+    EXPECT_EQ(memcmp(buf, data, sizeof(buf)), 0);
+    EXPECT_TRUE(s.AtEnd());
+
+    s.Close();
+    EXPECT_FALSE(s.IsOpen());
+    plFileSystem::Unlink(path);
+}
+
+TEST(hsMappedStream, read_past_end)
+{
+    const char data[] = "0123456789";
+    plFileName path = WriteTestFile(data, 10);
+
+    hsMappedStream s;
+    ASSERT_TRUE(s.Open(path, "rb"));
+
+    char buf[16];
+    s.SetPosition(6);
+    EXPECT_EQ(s.Read(sizeof(buf), buf), 4);
+    EXPECT_EQ(memcmp(buf, "6789", 4), 0);
+    EXPECT_TRUE(s.AtEnd());
+    EXPECT_EQ(s.Read(sizeof(buf), buf), 0);
+
+    s.SetPosition(8);
+    s.Skip(100);
+    EXPECT_EQ(s.GetPosition(), 10);
+    EXPECT_TRUE(s.AtEnd());
+
+    s.Close();
+    plFileSystem::Unlink(path);
+}
+
+TEST(hsMappedStream, empty_file)
+{
+    plFileName path = WriteTestFile(nullptr, 0);
+
+    hsMappedStream s;
+    ASSERT_TRUE(s.Open(path, "rb"));
+    EXPECT_EQ(s.GetEOF(), 0);
+    EXPECT_TRUE(s.AtEnd());
+
+    s.Close();
+    plFileSystem::Unlink(path);
+}
+
+TEST(hsMappedStream, missing_file)
+{
+    hsMappedStream s;
+    EXPECT_FALSE(s.Open("this_file_does_not_exist.prp", "rb"));
+    EXPECT_FALSE(s.IsOpen());
+}
@@ -0,0 +1,193 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "hsCpuID.h"
+#include "plFile/plBlockCipher.h"
+
+static const uint32_t kKey[4] = { 0x6c0a5452, 0x03827d0f, 0x3a170b92, 0x16db7fc2 };
+static const uint32_t kDelta = 0x9E3779B9;
+
+// Same as plSecureStream::IEncipher for one 8-byte chunk
+static void XXTeaEncipher(uint32_t* v)
+{
+    uint32_t y = v[0], z = v[1], sum = 0;
+    for (uint32_t q = 6 + 52 / 2; q > 0; --q)
+    {
+        sum += kDelta;
+        uint32_t e = (sum >> 2) & 3;
+        y = v[1];
+        v[0] += ((z>>5 ^ y<<2) + (y>>3 ^ z<<4)) ^ ((sum^y) + (kKey[0^e]^z));
+        z = v[0];
+        y = v[0];
+        v[1] += ((z>>5 ^ y<<2) + (y>>3 ^ z<<4)) ^ ((sum^y) + (kKey[1^e]^z));
+        z = v[1];
+    }
+}
+
+// Same as plEncryptedStream::IEncipher
+static void TeaEncipher(uint32_t* v)
+{
+    uint32_t y = v[0], z = v[1], sum = 0;
+    for (uint32_t n = 0; n < 32; ++n)
+    {
+        y += ((z << 4 ^ z >> 5) + z) ^ (sum + kKey[sum&3]);
+        sum += kDelta;
+        z += ((y << 4 ^ y >> 5) + y) ^ (sum + kKey[sum>>11 & 3]);
+    }
+    v[0] = y;
+    v[1] = z;
+}
+
+static std::vector<uint32_t> RandomBlocks(size_t numBlocks)
+{
+    std::mt19937 rng(static_cast<uint32_t>(numBlocks));
+    std::vector<uint32_t> data(numBlocks * 2);
+    for (uint32_t& word : data)
+        word = rng();
+    return data;
+}
+
+typedef void(*decipher_ptr)(const uint32_t*, uint32_t*, size_t);
+
+// Odd sizes make sure the scalar leftovers after the SIMD runs are handled
+static const size_t kBlockCounts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 100, 1027 };
+
+static void ExpectMatchesFpu(decipher_ptr fpu, decipher_ptr simd)
+{
+    for (size_t numBlocks : kBlockCounts) {
+        std::vector<uint32_t> expected = RandomBlocks(numBlocks);
+        std::vector<uint32_t> actual = expected;
+        fpu(kKey, expected.data(), numBlocks);
+        simd(kKey, actual.data(), numBlocks);
+        EXPECT_EQ(expected, actual) << numBlocks << " blocks";
+    }
+}
+
+TEST(plBlockCipher, xxtea_round_trip)
+{
+    std::vector<uint32_t> plain = RandomBlocks(37);
+    std::vector<uint32_t> data = plain;
+    for (size_t i = 0; i < data.size(); i += 2)
+        XXTeaEncipher(&data[i]);
+    EXPECT_NE(plain, data);
+
+    plBlockCipher::XXTeaDecipher(kKey, data.data(), 37);
+    EXPECT_EQ(plain, data);
+}
+
+TEST(plBlockCipher, tea_round_trip)
+{
+    std::vector<uint32_t> plain = RandomBlocks(37);
+    std::vector<uint32_t> data = plain;
+    for (size_t i = 0; i < data.size(); i += 2)
+        TeaEncipher(&data[i]);
+    EXPECT_NE(plain, data);
+
+    plBlockCipher::TeaDecipher(kKey, data.data(), 37);
+    EXPECT_EQ(plain, data);
+}
+
+TEST(plBlockCipher, xxtea_sse2_matches_fpu)
+{
+    if (!hsCpuId::Instance().has_sse2)
+        return;
+    ExpectMatchesFpu(&plBlockCipher::xxtea_decipher_fpu, &plBlockCipher::xxtea_decipher_sse2);
+}
+
+TEST(plBlockCipher, xxtea_avx2_matches_fpu)
+{
+    if (!hsCpuId::Instance().has_avx2)
+        return;
+    ExpectMatchesFpu(&plBlockCipher::xxtea_decipher_fpu, &plBlockCipher::xxtea_decipher_avx2);
+}
+
+TEST(plBlockCipher, tea_sse2_matches_fpu)
+{
+    if (!hsCpuId::Instance().has_sse2)
+        return;
+    ExpectMatchesFpu(&plBlockCipher::tea_decipher_fpu, &plBlockCipher::tea_decipher_sse2);
+}
+
+TEST(plBlockCipher, tea_avx2_matches_fpu)
+{
+    if (!hsCpuId::Instance().has_avx2)
+        return;
+    ExpectMatchesFpu(&plBlockCipher::tea_decipher_fpu, &plBlockCipher::tea_decipher_avx2);
+}
+
+// Deciphering speed of each kernel, on an age-sized (4 MB) file. This isn't
+// a pass/fail test, so it only runs when asked for:
+//      test_pnEncryption --gtest_also_run_disabled_tests --gtest_filter=*throughput
+TEST(plBlockCipher, DISABLED_decipher_throughput)
+{
+    const size_t kNumBlocks = 4 * 1024 * 1024 / 8;
+    const int kReps = 5;
+    const hsCpuId& cpu = hsCpuId::Instance();
+    std::vector<uint32_t> data = RandomBlocks(kNumBlocks);
+
+    auto measure = [&](const char* name, decipher_ptr decipher)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kReps; ++i)
+            decipher(kKey, data.data(), kNumBlocks);
+        std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        printf("%-10s %8.1f MB/s\n", name, kNumBlocks * 8. * kReps / secs.count() / (1024. * 1024.));
+    };
+
+    measure("xxtea fpu", &plBlockCipher::xxtea_decipher_fpu);
+    if (cpu.has_sse2)
+        measure("xxtea sse2", &plBlockCipher::xxtea_decipher_sse2);
+    if (cpu.has_avx2)
+        measure("xxtea avx2", &plBlockCipher::xxtea_decipher_avx2);
+
+    measure("tea fpu", &plBlockCipher::tea_decipher_fpu);
+    if (cpu.has_sse2)
+        measure("tea sse2", &plBlockCipher::tea_decipher_sse2);
+    if (cpu.has_avx2)
+        measure("tea avx2", &plBlockCipher::tea_decipher_avx2);
+}
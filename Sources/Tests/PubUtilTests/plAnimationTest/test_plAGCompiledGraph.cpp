@@ -0,0 +1,227 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <iterator>
+
+#include "plAnimation/plAGCompiledGraph.h"
+#include "plAnimation/plMatrixChannel.h"
+#include "plAnimation/plPointChannel.h"
+#include "plAnimation/plQuatChannel.h"
+#include "plAnimation/plScalarChannel.h"
+
+// A bias that ramps from 0 to 1 over [start, start + 1], so the blends it
+// drives see both ends as well as the middle.
+class RampChannel : public plScalarChannel
+{
+    double fStart;
+
+public:
+    RampChannel(double start) : fStart(start) { }
+
+    const float& Value(double time, bool peek = false) override
+    {
+        fResult = (float)std::clamp(time - fStart, 0., 1.);
+        return fResult;
+    }
+};
+
+// An animated transform spinning about an axis and drifting along a
+// direction. Counts its evaluations, so we can check the compiled program
+// skips the same channels the graph does.
+class SpinChannel : public plMatrixChannel
+{
+    hsVector3 fAxis;
+    hsVector3 fDrift;
+    float fScale;
+
+public:
+    int fEvals;
+
+    SpinChannel(const hsVector3& axis, const hsVector3& drift, float scale)
+        : fAxis(axis), fDrift(drift), fScale(scale), fEvals() { }
+
+    const hsMatrix44& Value(double time, bool peek = false) override
+    {
+        AffineValue(time, peek).ComposeMatrix(&fResult);
+        return fResult;
+    }
+
+    const hsAffineParts& AffineValue(double time, bool peek = false) override
+    {
+        fEvals++;
+        fAP.Reset();
+        fAP.fQ.SetAngleAxis((float)time, fAxis);
+        fAP.fT = fDrift * (float)time;
+        fAP.fK.Set(fScale, fScale, fScale);
+        return fAP;
+    }
+};
+
+// Rotation from a quat channel and translation from a point channel, like
+// plQuatPointCombine. That one's Value() and AffineValue() don't override
+// plMatrixChannel's, so it can't be driven through a blend.
+class QuatPointChannel : public plMatrixChannel
+{
+    plQuatChannel* fQuat;
+    plPointChannel* fPoint;
+
+public:
+    int fEvals;
+
+    QuatPointChannel(plQuatChannel* quat, plPointChannel* point)
+        : fQuat(quat), fPoint(point), fEvals() { }
+
+    const hsMatrix44& Value(double time, bool peek = false) override
+    {
+        AffineValue(time, peek).ComposeMatrix(&fResult);
+        return fResult;
+    }
+
+    const hsAffineParts& AffineValue(double time, bool peek = false) override
+    {
+        fEvals++;
+        fAP.Reset();
+        fAP.fQ = fQuat->Value(time);
+        fAP.fT = hsVector3(fPoint->Value(time));
+        return fAP;
+    }
+};
+
+// Compiles a bare channel graph, without a master mod or applicator around it.
+class TestGraph : public plAGCompiledGraph
+{
+public:
+    void Compile(plMatrixChannel* root)
+    {
+        Clear();
+
+        Target target = {};
+        target.fRoot = root;
+        target.fFirstOp = (uint32_t)fOps.size();
+        target.fResult = ICompileChannel(root);
+        target.fEndOp = (uint32_t)fOps.size();
+        target.fCurrent = true;
+        target.fActive = true;
+        fTargets.push_back(target);
+        fL2P.resize(fTargets.size());
+        fP2L.resize(fTargets.size());
+        Finish();
+    }
+
+    void Run(double time)
+    {
+        fBlends.clear();
+        IRunOps(fTargets[0], time);
+        IRunBlends();
+        ICompose();
+    }
+
+    const hsMatrix44& GetL2P() const { return fL2P[0]; }
+    const hsMatrix44& GetP2L() const { return fP2L[0]; }
+};
+
+static void ExpectMatrixEq(const hsMatrix44& expected, const hsMatrix44& actual, double time)
+{
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            EXPECT_FLOAT_EQ(expected.fMap[i][j], actual.fMap[i][j])
+                << "element [" << i << "][" << j << "] at time " << time;
+        }
+    }
+}
+
+TEST(plAGCompiledGraph, MatchesChannelGraph)
+{
+    hsAffineParts fixedParts;
+    fixedParts.Reset();
+    fixedParts.fQ.SetAngleAxis(0.7f, hsVector3(0.f, 1.f, 0.f));
+    fixedParts.fT.Set(4.f, -1.f, 2.f);
+    fixedParts.fK.Set(1.5f, 1.5f, 1.5f);
+    hsMatrix44 fixedMat;
+    fixedParts.ComposeMatrix(&fixedMat);
+    plMatrixConstant fixed(fixedMat);
+
+    SpinChannel spinZ(hsVector3(0.f, 0.f, 1.f), hsVector3(1.f, 2.f, 3.f), 1.f);
+    SpinChannel spinX(hsVector3(1.f, 0.f, 0.f), hsVector3(-2.f, 0.f, 1.f), 2.f);
+
+    hsQuat quatA, quatB;
+    quatA.SetAngleAxis(0.3f, hsVector3(0.f, 0.f, 1.f));
+    quatB.SetAngleAxis(2.1f, hsVector3(0.f, 1.f, 0.f));
+    plQuatConstant quatConstA(quatA);
+    plQuatConstant quatConstB(quatB);
+    RampChannel quatBias(0.5);
+    plQuatBlend quatBlend(&quatConstA, &quatConstB, &quatBias);
+    plPointConstant point(hsPoint3(0.f, 5.f, -3.f));
+    QuatPointChannel quatPoint(&quatBlend, &point);
+
+    // Each bias is 0 for a while, then ramps, then sits at 1, at different
+    // times, so we go through every combination of skipped sides.
+    RampChannel innerBias(0.);
+    plMatrixBlend inner(&spinZ, &quatPoint, &innerBias, 0);
+    RampChannel otherBias(1.5);
+    plMatrixBlend other(&fixed, &spinX, &otherBias, 0);
+    RampChannel rootBias(1.);
+    plMatrixBlend root(&inner, &other, &rootBias, 1);
+
+    TestGraph graph;
+    graph.Compile(&root);
+
+    for (double time : { -1., 0., 0.25, 0.5, 0.75, 1., 1.25, 1.5, 1.75, 2., 2.25, 2.5, 3. }) {
+        spinZ.fEvals = spinX.fEvals = quatPoint.fEvals = 0;
+        graph.Run(time);
+        int compiledEvals[] = { spinZ.fEvals, spinX.fEvals, quatPoint.fEvals };
+
+        spinZ.fEvals = spinX.fEvals = quatPoint.fEvals = 0;
+        hsMatrix44 l2p = root.Value(time);
+        int graphEvals[] = { spinZ.fEvals, spinX.fEvals, quatPoint.fEvals };
+
+        hsMatrix44 p2l;
+        root.AffineValue(time).ComposeInverseMatrix(&p2l);
+
+        ExpectMatrixEq(l2p, graph.GetL2P(), time);
+        ExpectMatrixEq(p2l, graph.GetP2L(), time);
+        for (size_t i = 0; i < std::size(graphEvals); i++)
+            EXPECT_EQ(graphEvals[i], compiledEvals[i]) << "channel " << i << " at time " << time;
+    }
+}
@@ -0,0 +1,375 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "hsCpuID.h"
+#include "hsMatrix44.h"
+
+#include "plDrawable/plCpuSkinner.h"
+#include "plDrawable/plGBufferGroup.h"
+
+static const uint32_t kNumMatrices = 40;
+
+// Vertex formats to try: no weights through three, with and without
+// indices, and a few UV counts.
+static const uint8_t kFormats[] = {
+    plGBufferGroup::kSkinNoWeights | 1,
+    plGBufferGroup::kSkin1Weight | 1,
+    plGBufferGroup::kSkin2Weights | 2,
+    plGBufferGroup::kSkin3Weights | 1,
+    plGBufferGroup::kSkin1Weight | plGBufferGroup::kSkinIndices | 1,
+    plGBufferGroup::kSkin2Weights | plGBufferGroup::kSkinIndices | 3,
+    plGBufferGroup::kSkin3Weights | plGBufferGroup::kSkinIndices | 2,
+    plGBufferGroup::kSkin3Weights | plGBufferGroup::kSkinIndices | 0,
+};
+
+static const uint32_t kCounts[] = { 0, 1, 2, 3, 7, 100, 5000 };
+
+// Some slack past the end of the output, to catch writes off the end
+static const size_t kGuardSize = 16;
+
+struct TestVerts
+{
+    uint32_t fNumWeights;
+    bool fHasIndices;
+    uint32_t fNumUVs;
+    uint32_t fSrcStride;
+    uint32_t fDestStride;
+    std::vector<uint8_t> fSrc;
+
+    uint32_t TailSize() const { return sizeof(uint32_t) * 2 + sizeof(float) * 3 * fNumUVs; }
+    uint32_t NormalOffset() const { return sizeof(float) * (3 + fNumWeights) + (fHasIndices ? sizeof(uint32_t) : 0); }
+};
+
+static TestVerts MakeVerts(std::mt19937& rng, uint8_t format, uint32_t count)
+{
+    std::uniform_real_distribution<float> coord(-1.f, 1.f);
+
+    TestVerts verts;
+    verts.fNumWeights = (format & plGBufferGroup::kSkinWeightMask) >> 4;
+    verts.fHasIndices = verts.fNumWeights && (format & plGBufferGroup::kSkinIndices);
+    verts.fNumUVs = plGBufferGroup::CalcNumUVs(format);
+    verts.fSrcStride = verts.NormalOffset() + sizeof(float) * 3 + verts.TailSize();
+    verts.fDestStride = sizeof(float) * 6 + verts.TailSize();
+    verts.fSrc.resize(verts.fSrcStride * count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint8_t* vtx = &verts.fSrc[i * verts.fSrcStride];
+
+        float pos[3] = { coord(rng), coord(rng), coord(rng) };
+        memcpy(vtx, pos, sizeof(pos));
+        vtx += sizeof(pos);
+
+        for (uint32_t j = 0; j < verts.fNumWeights; ++j)
+        {
+            // Throw in some zero weights, which the kernels skip
+            float weight = (rng() % 4 == 0) ? 0.f : std::fabs(coord(rng)) / verts.fNumWeights;
+            memcpy(vtx, &weight, sizeof(weight));
+            vtx += sizeof(weight);
+        }
+
+        if (verts.fHasIndices)
+        {
+            uint32_t indices = 0;
+            for (int j = 0; j < 4; ++j)
+                indices |= (rng() % kNumMatrices) << (8 * j);
+            memcpy(vtx, &indices, sizeof(indices));
+            vtx += sizeof(indices);
+        }
+
+        float norm[3] = { coord(rng), coord(rng), coord(rng) };
+        memcpy(vtx, norm, sizeof(norm));
+        vtx += sizeof(norm);
+
+        for (uint32_t j = 0; j < verts.TailSize(); ++j)
+            vtx[j] = uint8_t(rng());
+    }
+    return verts;
+}
+
+static std::vector<hsMatrix44> MakePalette(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> elem(-1.f, 1.f);
+
+    std::vector<hsMatrix44> palette(kNumMatrices);
+    for (hsMatrix44& m : palette)
+    {
+        m.Reset();
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 4; ++c)
+                m.fMap[r][c] = elem(rng);
+        m.NotIdentity();
+    }
+    return palette;
+}
+
+// Transforms each vertex by each of its matrices and blends the results,
+// which is how the hardware does it.
+static void ReferenceBlend(const std::vector<hsMatrix44>& palette, const TestVerts& verts, uint8_t* dest, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i, dest += verts.fDestStride)
+    {
+        const uint8_t* vtx = &verts.fSrc[i * verts.fSrcStride];
+
+        float pos[3], norm[3], weights[4];
+        memcpy(pos, vtx, sizeof(pos));
+        memcpy(norm, vtx + verts.NormalOffset(), sizeof(norm));
+
+        float sum = 0.f;
+        for (uint32_t j = 0; j < verts.fNumWeights; ++j)
+        {
+            memcpy(&weights[j], vtx + sizeof(float) * (3 + j), sizeof(float));
+            sum += weights[j];
+        }
+        weights[verts.fNumWeights] = 1.f - sum;
+
+        uint32_t indices = 1 << 8;
+        if (verts.fHasIndices)
+            memcpy(&indices, vtx + sizeof(float) * (3 + verts.fNumWeights), sizeof(indices));
+
+        double outPos[3] = {}, outNorm[3] = {};
+        for (uint32_t j = 0; j <= verts.fNumWeights; ++j, indices >>= 8)
+        {
+            const hsMatrix44& m = palette[indices & 0xFF];
+            for (int r = 0; r < 3; ++r)
+            {
+                outPos[r] += (m.fMap[r][0] * pos[0] + m.fMap[r][1] * pos[1] + m.fMap[r][2] * pos[2] + m.fMap[r][3]) * weights[j];
+                outNorm[r] += (m.fMap[r][0] * norm[0] + m.fMap[r][1] * norm[1] + m.fMap[r][2] * norm[2]) * weights[j];
+            }
+        }
+
+        float out[6];
+        for (int r = 0; r < 3; ++r)
+        {
+            out[r] = float(outPos[r]);
+            out[3 + r] = float(outNorm[r]);
+        }
+        memcpy(dest, out, sizeof(out));
+        memcpy(dest + sizeof(out), vtx + verts.NormalOffset() + sizeof(norm), verts.TailSize());
+    }
+}
+
+// Same thing BlendVerts does with the palette before handing it to a kernel
+static std::vector<plCpuSkinner::Matrix> MakeKernelPalette(const std::vector<hsMatrix44>& palette)
+{
+    std::vector<plCpuSkinner::Matrix> result(256);
+    for (size_t i = 0; i < palette.size(); ++i)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            for (int r = 0; r < 3; ++r)
+                result[i].fCol[col][r] = palette[i].fMap[r][col];
+            result[i].fCol[col][3] = 0.f;
+        }
+    }
+    return result;
+}
+
+static plCpuSkinner::Layout MakeLayout(const TestVerts& verts)
+{
+    plCpuSkinner::Layout layout;
+    layout.fNumWeights = verts.fNumWeights;
+    layout.fIndicesOffset = verts.fHasIndices ? sizeof(float) * (3 + verts.fNumWeights) : 0;
+    layout.fNormalOffset = verts.NormalOffset();
+    layout.fTailSize = verts.TailSize();
+    return layout;
+}
+
+static void ExpectSameVerts(const TestVerts& verts, const std::vector<uint8_t>& expected,
+                            const std::vector<uint8_t>& actual, uint32_t count, float tolerance)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint8_t* e = &expected[i * verts.fDestStride];
+        const uint8_t* a = &actual[i * verts.fDestStride];
+
+        float ef[6], af[6];
+        memcpy(ef, e, sizeof(ef));
+        memcpy(af, a, sizeof(af));
+        for (int k = 0; k < 6; ++k)
+        {
+            if (tolerance == 0.f)
+                ASSERT_FLOAT_EQ(ef[k], af[k]) << "vert " << i << " component " << k;
+            else
+                ASSERT_NEAR(ef[k], af[k], tolerance) << "vert " << i << " component " << k;
+        }
+        ASSERT_EQ(0, memcmp(e + sizeof(ef), a + sizeof(af), verts.TailSize())) << "vert " << i;
+    }
+
+    // Nothing past the last vert got touched
+    size_t end = verts.fDestStride * count;
+    ASSERT_EQ(0, memcmp(&expected[end], &actual[end], kGuardSize));
+}
+
+TEST(plCpuSkinner, KernelsMatchFpu)
+{
+    std::mt19937 rng(1);
+    std::vector<hsMatrix44> palette = MakePalette(rng);
+    std::vector<plCpuSkinner::Matrix> kernelPalette = MakeKernelPalette(palette);
+    const hsCpuId& cpu = hsCpuId::Instance();
+
+    for (uint8_t format : kFormats)
+    {
+        for (uint32_t count : kCounts)
+        {
+            TestVerts verts = MakeVerts(rng, format, count);
+            plCpuSkinner::Layout layout = MakeLayout(verts);
+
+            std::vector<uint8_t> fpu(verts.fDestStride * count + kGuardSize, 0xCD);
+            plCpuSkinner::blend_verts_fpu(kernelPalette.data(), layout, verts.fSrc.data(), verts.fSrcStride,
+                                          fpu.data(), verts.fDestStride, count);
+
+            if (cpu.has_sse2)
+            {
+                std::vector<uint8_t> sse2(fpu.size(), 0xCD);
+                plCpuSkinner::blend_verts_sse2(kernelPalette.data(), layout, verts.fSrc.data(), verts.fSrcStride,
+                                               sse2.data(), verts.fDestStride, count);
+                ExpectSameVerts(verts, fpu, sse2, count, 0.f);
+            }
+
+            if (cpu.has_avx)
+            {
+                std::vector<uint8_t> avx(fpu.size(), 0xCD);
+                plCpuSkinner::blend_verts_avx(kernelPalette.data(), layout, verts.fSrc.data(), verts.fSrcStride,
+                                              avx.data(), verts.fDestStride, count);
+                ExpectSameVerts(verts, fpu, avx, count, 0.f);
+            }
+        }
+    }
+}
+
+TEST(plCpuSkinner, BlendVertsMatchesReference)
+{
+    std::mt19937 rng(2);
+    std::vector<hsMatrix44> palette = MakePalette(rng);
+
+    // Small enough that the big counts get split across the job pool
+    uint32_t oldMinThreaded = plCpuSkinner::GetMinThreadedVerts();
+    plCpuSkinner::SetMinThreadedVerts(64);
+
+    for (uint8_t format : kFormats)
+    {
+        for (uint32_t count : kCounts)
+        {
+            TestVerts verts = MakeVerts(rng, format, count);
+
+            std::vector<uint8_t> expected(verts.fDestStride * count + kGuardSize, 0xCD);
+            ReferenceBlend(palette, verts, expected.data(), count);
+
+            std::vector<uint8_t> actual(expected.size(), 0xCD);
+            plCpuSkinner::BlendVerts(palette.data(), kNumMatrices, verts.fSrc.data(), format, verts.fSrcStride,
+                                     actual.data(), verts.fDestStride, count);
+            ExpectSameVerts(verts, expected, actual, count, 1.e-5f);
+        }
+    }
+
+    plCpuSkinner::SetMinThreadedVerts(oldMinThreaded);
+}
+
+// Skinning throughput, for measuring the kernels headless. This isn't a
+// pass/fail test, so it only runs when asked for:
+//      test_plDrawable --gtest_also_run_disabled_tests --gtest_filter=*Throughput
+TEST(plCpuSkinner, DISABLED_Throughput)
+{
+    const uint32_t kVerts = 100000;
+    const int kReps = 50;
+
+    std::mt19937 rng(3);
+    std::vector<hsMatrix44> palette = MakePalette(rng);
+    std::vector<plCpuSkinner::Matrix> kernelPalette = MakeKernelPalette(palette);
+    const hsCpuId& cpu = hsCpuId::Instance();
+
+    // An avatar's body (one weight plus indices) and a heavily weighted mesh
+    const uint8_t formats[] = {
+        plGBufferGroup::kSkin1Weight | plGBufferGroup::kSkinIndices | 1,
+        plGBufferGroup::kSkin3Weights | plGBufferGroup::kSkinIndices | 2,
+    };
+
+    for (uint8_t format : formats)
+    {
+        TestVerts verts = MakeVerts(rng, format, kVerts);
+        plCpuSkinner::Layout layout = MakeLayout(verts);
+        std::vector<uint8_t> dest(verts.fDestStride * kVerts);
+
+        auto measure = [&](const char* name, auto blend)
+        {
+            blend();
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < kReps; ++i)
+                blend();
+            std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+            printf("%u weights, %-10s %8.1f Mverts/s\n", verts.fNumWeights + 1, name,
+                   double(kVerts) * kReps / secs.count() / 1.e6);
+        };
+
+        measure("fpu", [&] {
+            plCpuSkinner::blend_verts_fpu(kernelPalette.data(), layout, verts.fSrc.data(), verts.fSrcStride,
+                                          dest.data(), verts.fDestStride, kVerts);
+        });
+        if (cpu.has_sse2)
+        {
+            measure("sse2", [&] {
+                plCpuSkinner::blend_verts_sse2(kernelPalette.data(), layout, verts.fSrc.data(), verts.fSrcStride,
+                                               dest.data(), verts.fDestStride, kVerts);
+            });
+        }
+        if (cpu.has_avx)
+        {
+            measure("avx", [&] {
+                plCpuSkinner::blend_verts_avx(kernelPalette.data(), layout, verts.fSrc.data(), verts.fSrcStride,
+                                              dest.data(), verts.fDestStride, kVerts);
+            });
+        }
+        measure("BlendVerts", [&] {
+            plCpuSkinner::BlendVerts(palette.data(), kNumMatrices, verts.fSrc.data(), format, verts.fSrcStride,
+                                     dest.data(), verts.fDestStride, kVerts);
+        });
+    }
+}
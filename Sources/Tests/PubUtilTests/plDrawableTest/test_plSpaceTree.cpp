@@ -0,0 +1,368 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "hsBounds.h"
+#include "hsCpuID.h"
+#include "hsGeometry3.h"
+#include "hsMatrix44.h"
+
+#include "plDrawable/plSpaceTree.h"
+#include "plDrawable/plSpaceTreeMaker.h"
+#include "plIntersect/plVolumeIsect.h"
+
+// Not a multiple of 8 or 4, so the SIMD kernels have leftovers
+static const size_t kNumBounds = 1003;
+
+static const float kSafetyDist = -0.1f;
+
+static hsVector3 RandomNormal(std::mt19937& rng)
+{
+    std::normal_distribution<float> dist;
+    hsVector3 norm(dist(rng), dist(rng), dist(rng));
+    norm.Normalize();
+    return norm;
+}
+
+// Boxes all through and around the volumes, from specks to ones bigger than
+// the volumes themselves.
+static std::vector<hsBounds3Ext> MakeBounds(std::mt19937& rng, size_t count)
+{
+    std::uniform_real_distribution<float> pos(-100.f, 100.f);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    std::vector<hsBounds3Ext> bounds(count);
+    for (hsBounds3Ext& bnd : bounds)
+    {
+        hsPoint3 lo(pos(rng), pos(rng), pos(rng));
+        float scale = std::pow(10.f, 4.f * unit(rng) - 2.f);
+        hsPoint3 hi(lo.fX + scale * unit(rng), lo.fY + scale * unit(rng), lo.fZ + scale * unit(rng));
+        bnd.Reset(&lo);
+        bnd.Union(&hi);
+    }
+    return bounds;
+}
+
+// The ten rows plSpaceTree flattens its bounds into
+static std::vector<float> MakeRows(const std::vector<hsBounds3Ext>& bounds)
+{
+    const size_t stride = bounds.size();
+    std::vector<float> rows(10 * stride);
+    for (size_t n = 0; n < stride; n++)
+    {
+        const hsPoint3& center = bounds[n].GetCenter();
+        for (int i = 0; i < 3; i++)
+        {
+            rows[i * stride + n] = bounds[n].GetMins()[i];
+            rows[(i + 3) * stride + n] = bounds[n].GetMaxs()[i];
+            rows[(i + 6) * stride + n] = center[i];
+        }
+        rows[9 * stride + n] = bounds[n].GetRadius();
+    }
+    return rows;
+}
+
+// Every other node, out of order, to check the kernels only touch those
+static std::vector<int16_t> MakeNodes(std::mt19937& rng, size_t count)
+{
+    std::vector<int16_t> nodes;
+    for (size_t n = 0; n < count; n += 2)
+        nodes.emplace_back(int16_t(n));
+    std::shuffle(nodes.begin(), nodes.end(), rng);
+    return nodes;
+}
+
+// A convex volume around the origin
+static void MakeConvex(std::mt19937& rng, plConvexIsect& isect)
+{
+    std::uniform_real_distribution<float> dist(10.f, 80.f);
+    for (int i = 0; i < 7; i++)
+        isect.AddPlaneUnchecked(RandomNormal(rng), dist(rng));
+    isect.SetTransform(hsMatrix44::IdentityMatrix(), hsMatrix44::IdentityMatrix());
+}
+
+// Three slabs through the origin
+static void MakeParallel(std::mt19937& rng, plParallelIsect& isect)
+{
+    std::uniform_real_distribution<float> dist(5.f, 60.f);
+    isect.SetNumPlanes(3);
+    for (size_t i = 0; i < 3; i++)
+    {
+        hsVector3 norm = RandomNormal(rng);
+        hsPoint3 one(norm * -dist(rng));
+        hsPoint3 two(norm * dist(rng));
+        isect.SetPlane(i, one, two);
+    }
+    isect.SetTransform(hsMatrix44::IdentityMatrix(), hsMatrix44::IdentityMatrix());
+}
+
+// A copy of plCullNode::TestBounds(), which lives up in plPipeline
+static plVolumeCullResult RefTestBounds(const hsBounds3Ext& bnd, const hsVector3& norm, float dist)
+{
+    float sphereDist = norm.InnerProduct(bnd.GetCenter()) + dist;
+    float rad = bnd.GetRadius();
+    if (sphereDist < -rad)
+        return kVolumeCulled;
+    if (sphereDist > rad)
+        return kVolumeClear;
+
+    hsPoint2 depth;
+    bnd.TestPlane(norm, depth);
+    if (depth.fY + dist < kSafetyDist)
+        return kVolumeCulled;
+    if (depth.fX + dist >= 0)
+        return kVolumeClear;
+    return kVolumeSplit;
+}
+
+typedef void(*CullBoundsFunc)(const float*, size_t, const int16_t*, size_t,
+                              const plVolumeSlab*, size_t, uint8_t*);
+typedef void(*CullPlaneFunc)(const float*, size_t, const int16_t*, size_t,
+                             const hsVector3&, float, float, uint8_t*);
+
+static std::vector<CullBoundsFunc> GetCullBounds()
+{
+    std::vector<CullBoundsFunc> funcs { &plSpaceTree::cull_bounds_fpu };
+    if (hsCpuId::Instance().has_sse2)
+        funcs.emplace_back(&plSpaceTree::cull_bounds_sse2);
+    if (hsCpuId::Instance().has_avx)
+        funcs.emplace_back(&plSpaceTree::cull_bounds_avx);
+    return funcs;
+}
+
+static std::vector<CullPlaneFunc> GetCullPlane()
+{
+    std::vector<CullPlaneFunc> funcs { &plSpaceTree::cull_plane_fpu };
+    if (hsCpuId::Instance().has_sse2)
+        funcs.emplace_back(&plSpaceTree::cull_plane_sse2);
+    if (hsCpuId::Instance().has_avx)
+        funcs.emplace_back(&plSpaceTree::cull_plane_avx);
+    return funcs;
+}
+
+static void ExpectCullBoundsMatchTest(std::mt19937& rng, const plVolumeIsect& isect)
+{
+    std::vector<hsBounds3Ext> bounds = MakeBounds(rng, kNumBounds);
+    std::vector<float> rows = MakeRows(bounds);
+    std::vector<int16_t> nodes = MakeNodes(rng, kNumBounds);
+
+    std::vector<plVolumeSlab> slabs;
+    ASSERT_TRUE(isect.GetSlabs(slabs));
+
+    size_t numCulled = 0, numSplit = 0;
+    for (CullBoundsFunc func : GetCullBounds())
+    {
+        std::vector<uint8_t> results(kNumBounds, 0xCD);
+        func(rows.data(), kNumBounds, nodes.data(), nodes.size(), slabs.data(), slabs.size(), results.data());
+
+        for (size_t n = 0; n < kNumBounds; n++)
+        {
+            if (n & 1)
+            {
+                EXPECT_EQ(0xCD, results[n]) << "node " << n;
+                continue;
+            }
+            plVolumeCullResult res = isect.Test(bounds[n]);
+            EXPECT_EQ(res, results[n]) << "node " << n;
+            numCulled += res == kVolumeCulled;
+            numSplit += res == kVolumeSplit;
+        }
+    }
+
+    // Make sure the volume isn't missing everything, or swallowing it
+    EXPECT_NE(0u, numCulled);
+    EXPECT_NE(0u, numSplit);
+}
+
+TEST(plSpaceTree, CullBoundsMatchesConvexTest)
+{
+    std::mt19937 rng(1);
+    for (int i = 0; i < 10; i++)
+    {
+        plConvexIsect isect;
+        MakeConvex(rng, isect);
+        ExpectCullBoundsMatchTest(rng, isect);
+    }
+}
+
+TEST(plSpaceTree, CullBoundsMatchesParallelTest)
+{
+    std::mt19937 rng(2);
+    for (int i = 0; i < 10; i++)
+    {
+        plParallelIsect isect;
+        MakeParallel(rng, isect);
+        ExpectCullBoundsMatchTest(rng, isect);
+    }
+}
+
+TEST(plSpaceTree, CullPlaneMatchesTestBounds)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(-50.f, 50.f);
+    for (int i = 0; i < 20; i++)
+    {
+        std::vector<hsBounds3Ext> bounds = MakeBounds(rng, kNumBounds);
+        std::vector<float> rows = MakeRows(bounds);
+        std::vector<int16_t> nodes = MakeNodes(rng, kNumBounds);
+        hsVector3 norm = RandomNormal(rng);
+        float planeDist = dist(rng);
+
+        for (CullPlaneFunc func : GetCullPlane())
+        {
+            std::vector<uint8_t> results(kNumBounds, 0xCD);
+            func(rows.data(), kNumBounds, nodes.data(), nodes.size(), norm, planeDist, kSafetyDist, results.data());
+
+            for (size_t n = 0; n < kNumBounds; n++)
+            {
+                if (n & 1)
+                    EXPECT_EQ(0xCD, results[n]) << "node " << n;
+                else
+                    EXPECT_EQ(RefTestBounds(bounds[n], norm, planeDist), results[n]) << "node " << n;
+            }
+        }
+    }
+}
+
+static std::unique_ptr<plSpaceTree> MakeTree(const std::vector<hsBounds3Ext>& bounds)
+{
+    plSpaceTreeMaker maker;
+    maker.Reset();
+    for (const hsBounds3Ext& bnd : bounds)
+        maker.AddLeaf(bnd);
+    std::unique_ptr<plSpaceTree> tree(maker.MakeTree());
+    maker.Cleanup();
+    return tree;
+}
+
+// The harvest the way it was done before the level pass
+static void RefHarvest(const plSpaceTree& tree, int16_t who, const plVolumeIsect& isect,
+                       bool test, std::vector<int16_t>& list)
+{
+    const plSpaceTreeNode& node = tree.GetNode(who);
+    if (node.fFlags & plSpaceTreeNode::kDisabled)
+        return;
+
+    plVolumeCullResult res = test ? isect.Test(node.fWorldBounds) : kVolumeClear;
+    if (res == kVolumeCulled)
+        return;
+
+    if (node.IsLeaf())
+    {
+        list.emplace_back(node.GetLeaf());
+        return;
+    }
+    RefHarvest(tree, node.GetChild(0), isect, res == kVolumeSplit, list);
+    RefHarvest(tree, node.GetChild(1), isect, res == kVolumeSplit, list);
+}
+
+TEST(plSpaceTree, HarvestMatchesRecursive)
+{
+    std::mt19937 rng(4);
+    std::vector<hsBounds3Ext> bounds = MakeBounds(rng, kNumBounds);
+    std::unique_ptr<plSpaceTree> tree = MakeTree(bounds);
+    ASSERT_TRUE(tree);
+
+    // Knock out a few, to check disabled subtrees get skipped
+    for (int16_t i = 0; i < int16_t(kNumBounds); i += 37)
+        tree->SetLeafFlag(i, plSpaceTreeNode::kDisabled);
+
+    for (int i = 0; i < 10; i++)
+    {
+        plConvexIsect isect;
+        MakeConvex(rng, isect);
+
+        std::vector<int16_t> list;
+        tree->HarvestLeaves(&isect, list);
+
+        std::vector<int16_t> ref;
+        RefHarvest(*tree, tree->GetRoot(), isect, true, ref);
+        std::sort(ref.begin(), ref.end());
+
+        EXPECT_EQ(ref, list);
+    }
+}
+
+// Every node plCullNode's recursion would test, with what it would get
+static void ExpectPlaneResults(const plSpaceTree& tree, int16_t who, const hsVector3& norm, float dist)
+{
+    const plSpaceTreeNode& node = tree.GetNode(who);
+    if (tree.IsDisabled(who) || node.fWorldBounds.GetType() != kBoundsNormal)
+        return;
+
+    plVolumeCullResult res;
+    ASSERT_TRUE(tree.GetPlaneResult(who, res)) << "node " << who;
+    EXPECT_EQ(RefTestBounds(node.fWorldBounds, norm, dist), res) << "node " << who;
+
+    if (res == kVolumeSplit && !node.IsLeaf())
+    {
+        ExpectPlaneResults(tree, node.GetChild(0), norm, dist);
+        ExpectPlaneResults(tree, node.GetChild(1), norm, dist);
+    }
+}
+
+TEST(plSpaceTree, CullPlaneLevelsMatchesTestBounds)
+{
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> dist(-50.f, 50.f);
+    std::vector<hsBounds3Ext> bounds = MakeBounds(rng, kNumBounds);
+    std::unique_ptr<plSpaceTree> tree = MakeTree(bounds);
+    ASSERT_TRUE(tree);
+
+    for (int16_t i = 0; i < int16_t(kNumBounds); i += 37)
+        tree->SetLeafFlag(i, plSpaceTreeNode::kDisabled);
+
+    for (int i = 0; i < 20; i++)
+    {
+        hsVector3 norm = RandomNormal(rng);
+        float planeDist = dist(rng);
+
+        tree->CullPlaneLevels(tree->GetRoot(), norm, planeDist, kSafetyDist);
+        ExpectPlaneResults(*tree, tree->GetRoot(), norm, planeDist);
+    }
+}
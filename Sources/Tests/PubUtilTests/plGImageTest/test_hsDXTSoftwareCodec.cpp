@@ -0,0 +1,723 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include "hsCodecManager.h"
+#include "hsCpuID.h"
+
+#include "plGImage/hsDXTSoftwareCodec.h"
+#include "plGImage/plMipmap.h"
+
+// Pixels are ARGB8888, blocks are 4x4 pixels in rows.
+
+// The software decoder shifts 565 colors up without filling in the low bits
+static uint32_t Expand565(uint16_t c)
+{
+    return ((c & 0xF800) << 8) | ((c & 0x07E0) << 5) | ((c & 0x001F) << 3);
+}
+
+static uint16_t Read16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+// Decodes a block the way the old IUncompressMipmapDXT1To32 and
+// IUncompressMipmapDXT5To32 did, fixed point roundoff and all, for checking
+// the new decoder against.
+static void RefDecodeBlock(const uint8_t* block, bool dxt1, uint32_t* pixels)
+{
+    const uint8_t* colorBlock = dxt1 ? block : block + 8;
+    uint16_t c0 = Read16(colorBlock), c1 = Read16(colorBlock + 2);
+
+    uint32_t colors[4] = { Expand565(c0), Expand565(c1), 0, 0 };
+    bool fourColor = !dxt1 || c0 > c1;
+    for (uint32_t mask : { 0x00FF0000U, 0x0000FF00U, 0x000000FFU })
+    {
+        uint32_t a = colors[0] & mask, b = colors[1] & mask;
+        if (fourColor)
+        {
+            colors[2] |= ((a + a + b) / 3) & mask;
+            colors[3] |= ((b + b + a) / 3) & mask;
+        }
+        else
+            colors[2] |= ((a + b) >> 1) & mask;
+    }
+    if (dxt1)
+    {
+        for (uint32_t& color : colors)
+            color |= 0xFF000000;
+        if (!fourColor)
+            colors[3] = 0;
+    }
+
+    uint32_t alphas[8];
+    uint64_t alphaBits = 0;
+    if (!dxt1)
+    {
+        alphas[0] = uint32_t(block[0]) << 24;
+        alphas[1] = uint32_t(block[1]) << 24;
+        uint32_t alpha = alphas[0];
+        if (block[0] > block[1])
+        {
+            uint32_t step = ((alphas[1] / 7) & 0xFF000000) - ((alphas[0] / 7) & 0xFF000000);
+            for (int j = 2; j < 8; j++)
+                alphas[j] = alpha += step;
+        }
+        else
+        {
+            uint32_t step = (alphas[1] - alphas[0]) / 5;
+            for (int j = 2; j < 6; j++)
+                alphas[j] = (alpha += step) & 0xFF000000;
+            alphas[6] = 0;
+            alphas[7] = 0xFF000000;
+        }
+        for (int i = 0; i < 6; i++)
+            alphaBits |= (uint64_t)block[2 + i] << (8 * i);
+    }
+
+    uint32_t colorBits = Read16(colorBlock + 4) | (Read16(colorBlock + 6) << 16);
+    for (int i = 0; i < 16; i++)
+    {
+        pixels[i] = colors[(colorBits >> (2 * i)) & 3];
+        if (!dxt1)
+            pixels[i] |= alphas[(alphaBits >> (3 * i)) & 7];
+    }
+}
+
+// Decodes a block the way the hardware does, which is what the encoder aims
+// for: the 565 colors get their top bits replicated into the bottom ones,
+// and the mixed colors and alphas are rounded.
+static uint32_t HardwareExpand565(uint16_t c)
+{
+    uint32_t r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    r = (r << 3) | (r >> 2);
+    g = (g << 2) | (g >> 4);
+    b = (b << 3) | (b >> 2);
+    return (r << 16) | (g << 8) | b;
+}
+
+static void HardwareDecodeBlock(const uint8_t* block, bool dxt1, uint32_t* pixels)
+{
+    const uint8_t* colorBlock = dxt1 ? block : block + 8;
+    uint16_t c0 = Read16(colorBlock), c1 = Read16(colorBlock + 2);
+
+    uint32_t colors[4] = { HardwareExpand565(c0), HardwareExpand565(c1), 0, 0 };
+    bool fourColor = !dxt1 || c0 > c1;
+    for (int shift = 0; shift < 24; shift += 8)
+    {
+        uint32_t a = (colors[0] >> shift) & 0xFF, b = (colors[1] >> shift) & 0xFF;
+        if (fourColor)
+        {
+            colors[2] |= ((2 * a + b + 1) / 3) << shift;
+            colors[3] |= ((a + 2 * b + 1) / 3) << shift;
+        }
+        else
+            colors[2] |= ((a + b + 1) / 2) << shift;
+    }
+    for (uint32_t& color : colors)
+        color |= 0xFF000000;
+    if (!fourColor)
+        colors[3] = 0;
+
+    uint8_t alphas[8];
+    uint64_t alphaBits = 0;
+    if (!dxt1)
+    {
+        alphas[0] = block[0];
+        alphas[1] = block[1];
+        if (alphas[0] > alphas[1])
+        {
+            for (int j = 2; j < 8; j++)
+                alphas[j] = ((8 - j) * alphas[0] + (j - 1) * alphas[1] + 3) / 7;
+        }
+        else
+        {
+            for (int j = 2; j < 6; j++)
+                alphas[j] = ((6 - j) * alphas[0] + (j - 1) * alphas[1] + 2) / 5;
+            alphas[6] = 0;
+            alphas[7] = 255;
+        }
+        for (int i = 0; i < 6; i++)
+            alphaBits |= (uint64_t)block[2 + i] << (8 * i);
+    }
+
+    uint32_t colorBits = Read16(colorBlock + 4) | (Read16(colorBlock + 6) << 16);
+    for (int i = 0; i < 16; i++)
+    {
+        pixels[i] = colors[(colorBits >> (2 * i)) & 3];
+        if (!dxt1)
+            pixels[i] = (pixels[i] & 0x00FFFFFF) | ((uint32_t)alphas[(alphaBits >> (3 * i)) & 7] << 24);
+    }
+}
+
+static uint32_t ColorDistance(uint32_t c1, uint32_t c2)
+{
+    int r = int((c1 >> 16) & 0xFF) - int((c2 >> 16) & 0xFF);
+    int g = int((c1 >> 8) & 0xFF) - int((c2 >> 8) & 0xFF);
+    int b = int(c1 & 0xFF) - int(c2 & 0xFF);
+    return r * r + g * g + b * b;
+}
+
+static uint32_t BlendColors(uint32_t w1, uint32_t c1, uint32_t w2, uint32_t c2)
+{
+    uint32_t result = 0;
+    for (int shift = 0; shift < 24; shift += 8)
+        result |= ((((c1 >> shift) & 0xFF) * w1 + ((c2 >> shift) & 0xFF) * w2) / (w1 + w2)) << shift;
+    return result;
+}
+
+static uint16_t Color32To16(uint32_t c)
+{
+    return ((c >> 8) & 0xF800) | ((c >> 5) & 0x07E0) | ((c >> 3) & 0x001F);
+}
+
+// The old brute-force encoder (CompressMipmapLevel), one block at a time:
+// the two most distant pixels are the endpoints, and the alpha endpoints
+// are the extremes.
+static void OldEncodeBlock(const uint32_t* pixels, bool dxt5, uint8_t* block)
+{
+    uint8_t maxAlpha = 0, minAlpha = 255, oldMaxAlpha = 0, oldMinAlpha = 255;
+    uint32_t maxDistance = 0;
+    uint32_t color[4] = {};
+    bool hasTransparency = false;
+
+    for (int i = 0; i < 16; i++)
+    {
+        uint8_t a = pixels[i] >> 24;
+        if (a != 255)
+            hasTransparency = true;
+        if (dxt5)
+        {
+            maxAlpha = std::max(maxAlpha, a);
+            if (a > oldMaxAlpha && a < 255)
+                oldMaxAlpha = a;
+            minAlpha = std::min(minAlpha, a);
+            if (a < oldMinAlpha && a > 0)
+                oldMinAlpha = minAlpha;     // sic
+        }
+        for (int j = 0; j < 16; j++)
+        {
+            uint32_t distance = ColorDistance(pixels[i], pixels[j]);
+            if (distance >= maxDistance)
+            {
+                maxDistance = distance;
+                color[0] = pixels[i];
+                color[1] = pixels[j];
+            }
+        }
+    }
+    if (oldMinAlpha == 255)
+    {
+        oldMinAlpha = 0;
+        oldMaxAlpha = 255;
+    }
+
+    uint8_t alpha[8] = {};
+    if (dxt5)
+    {
+        if ((maxAlpha == 255 && minAlpha == 0) || maxAlpha == minAlpha)
+        {
+            alpha[0] = (maxAlpha == minAlpha) ? minAlpha : oldMinAlpha;
+            alpha[1] = (maxAlpha == minAlpha) ? maxAlpha : oldMaxAlpha;
+            for (int j = 2; j < 6; j++)
+                alpha[j] = ((6 - j) * alpha[0] + (j - 1) * alpha[1]) / 5;
+            alpha[6] = 0;
+            alpha[7] = 255;
+        }
+        else
+        {
+            alpha[0] = maxAlpha;
+            alpha[1] = minAlpha;
+            for (int j = 2; j < 8; j++)
+                alpha[j] = ((8 - j) * alpha[0] + (j - 1) * alpha[1]) / 7;
+        }
+    }
+
+    uint16_t shortColor[2] = { Color32To16(color[0]), Color32To16(color[1]) };
+    bool threeColor = shortColor[0] == shortColor[1] || (!dxt5 && hasTransparency);
+    if (threeColor ? shortColor[0] > shortColor[1] : shortColor[0] < shortColor[1])
+    {
+        std::swap(shortColor[0], shortColor[1]);
+        std::swap(color[0], color[1]);
+    }
+    if (threeColor)
+    {
+        color[2] = BlendColors(1, color[0], 1, color[1]);
+        color[3] = 0;
+    }
+    else
+    {
+        color[2] = BlendColors(2, color[0], 1, color[1]);
+        color[3] = BlendColors(1, color[0], 2, color[1]);
+    }
+
+    uint32_t colorBits = 0;
+    uint64_t alphaBits = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        uint8_t a = pixels[i] >> 24;
+        if (dxt5)
+        {
+            uint32_t best = 0;
+            for (uint32_t j = 1; j < 8; j++)
+                if (std::abs(a - alpha[j]) < std::abs(a - alpha[best]))
+                    best = j;
+            alphaBits |= (uint64_t)best << (3 * i);
+        }
+
+        uint32_t best = 0;
+        if (threeColor && a == 0)
+            best = 3;
+        else
+        {
+            for (uint32_t j = 1; j < (threeColor ? 3u : 4u); j++)
+                if (ColorDistance(pixels[i], color[j]) < ColorDistance(pixels[i], color[best]))
+                    best = j;
+        }
+        colorBits |= best << (2 * i);
+    }
+
+    uint8_t* colorBlock = block;
+    if (dxt5)
+    {
+        block[0] = alpha[0];
+        block[1] = alpha[1];
+        for (int i = 0; i < 6; i++)
+            block[2 + i] = uint8_t(alphaBits >> (8 * i));
+        colorBlock = block + 8;
+    }
+    colorBlock[0] = uint8_t(shortColor[0]);
+    colorBlock[1] = uint8_t(shortColor[0] >> 8);
+    colorBlock[2] = uint8_t(shortColor[1]);
+    colorBlock[3] = uint8_t(shortColor[1] >> 8);
+    for (int i = 0; i < 4; i++)
+        colorBlock[4 + i] = uint8_t(colorBits >> (8 * i));
+}
+
+enum ImageKind
+{
+    kGradient,      // smooth, like most real textures
+    kChecker,       // hard edges
+    kNoise,         // worst case
+};
+
+static plMipmap* MakeImage(uint32_t size, ImageKind kind, bool alpha, uint32_t seed)
+{
+    // ARGB32 mipmaps are flagged as having alpha, which picks DXT5
+    plMipmap* image = new plMipmap(size, size, alpha ? plMipmap::kARGB32Config : plMipmap::kRGB32Config);
+
+    std::mt19937 rng(seed);
+    for (uint8_t level = 0; level < image->GetNumLevels(); level++)
+    {
+        uint32_t width, height, rowBytes;
+        uint32_t* pixels = (uint32_t*)image->GetLevelPtr(level, &width, &height, &rowBytes);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                float fx = x / float(width), fy = y / float(height);
+                int r, g, b, a = 255;
+                if (kind == kNoise)
+                {
+                    r = rng() & 0xFF;
+                    g = rng() & 0xFF;
+                    b = rng() & 0xFF;
+                    if (alpha)
+                        a = rng() & 0xFF;
+                }
+                else
+                {
+                    r = int(128 + 100 * std::sin(fx * 9 + fy * 3)) + rng() % 12;
+                    g = int(128 + 90 * std::cos(fy * 7)) + rng() % 12;
+                    b = (kind == kChecker && ((x / 4 + y / 4) & 1)) ? 200 : 40;
+                    b += rng() % 8;
+                    if (alpha)
+                        a = ((x / 8) % 5 == 0) ? 0 : int(255 * fx);
+                }
+                pixels[y * (rowBytes / 4) + x] = uint32_t(a) << 24 | std::min(r, 255) << 16 | std::min(g, 255) << 8 | std::min(b, 255);
+            }
+        }
+    }
+    return image;
+}
+
+static void GetBlockPixels(plMipmap* image, uint8_t level, uint32_t bx, uint32_t by, uint32_t* pixels)
+{
+    uint32_t rowBytes;
+    const uint32_t* src = (const uint32_t*)image->GetLevelPtr(level, nullptr, nullptr, &rowBytes);
+    for (uint32_t i = 0; i < 16; i++)
+        pixels[i] = src[(by * 4 + i / 4) * (rowBytes / 4) + bx * 4 + i % 4];
+}
+
+struct EncodeError
+{
+    double fColor;
+    double fAlpha;
+};
+
+// Total squared error of a block, as the hardware decodes it
+static void AddBlockError(const uint32_t* original, const uint8_t* block, bool dxt1, EncodeError& error)
+{
+    uint32_t decoded[16];
+    HardwareDecodeBlock(block, dxt1, decoded);
+    for (int i = 0; i < 16; i++)
+    {
+        if (dxt1 && (original[i] >> 24) == 0)
+        {
+            // Has to come out transparent, the color doesn't matter
+            EXPECT_EQ(0U, decoded[i] >> 24);
+            continue;
+        }
+        error.fColor += ColorDistance(original[i], decoded[i]);
+        double a = double(original[i] >> 24) - double(decoded[i] >> 24);
+        error.fAlpha += dxt1 ? 0. : a * a;
+    }
+}
+
+class DXTCodecTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite() { hsDXTSoftwareCodec::Init(); }
+
+    void TearDown() override
+    {
+        hsDXTSoftwareCodec::SetCompressionQuality(hsDXTSoftwareCodec::kNormal);
+        hsDXTSoftwareCodec::SetMinThreadedBlocks(1024);
+    }
+};
+
+TEST_F(DXTCodecTest, DecodeMatchesOldDecoder)
+{
+    std::mt19937 rng(1);
+
+    for (uint8_t format : { plMipmap::DirectXInfo::kDXT1, plMipmap::DirectXInfo::kDXT5 })
+    {
+        for (uint32_t minThreaded : { 1U << 30, 4U })
+        {
+            hsDXTSoftwareCodec::SetMinThreadedBlocks(minThreaded);
+
+            plMipmap compressed(128, 64, plMipmap::kARGB32Config, 0, plMipmap::kDirectXCompression, format);
+            uint8_t* data = compressed.GetLevelPtr(0);
+            for (uint32_t i = 0; i < compressed.GetTotalSize(); i++)
+                data[i] = uint8_t(rng());
+
+            std::unique_ptr<plMipmap> decoded(hsDXTSoftwareCodec::Instance().CreateUncompressedMipmap(&compressed, hsCodecManager::k32BitDepth));
+            ASSERT_TRUE(decoded);
+
+            bool dxt1 = format == plMipmap::DirectXInfo::kDXT1;
+            for (uint8_t level = 0; level < compressed.GetNumLevels(); level++)
+            {
+                uint32_t width, height;
+                const uint8_t* blocks = compressed.GetLevelPtr(level, &width, &height);
+                if ((width | height) & 3)
+                    break;
+
+                for (uint32_t by = 0; by < height / 4; by++)
+                {
+                    for (uint32_t bx = 0; bx < width / 4; bx++)
+                    {
+                        uint32_t expected[16], actual[16];
+                        RefDecodeBlock(blocks + (by * (width / 4) + bx) * compressed.fDirectXInfo.fBlockSize, dxt1, expected);
+                        GetBlockPixels(decoded.get(), level, bx, by, actual);
+                        ASSERT_EQ(0, memcmp(expected, actual, sizeof(expected)))
+                            << "DXT" << int(format) << " level " << int(level) << " block " << bx << "," << by;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(DXTCodecTest, EncodeNoWorseThanOldEncoder)
+{
+    for (ImageKind kind : { kGradient, kChecker, kNoise })
+    {
+        for (bool alpha : { false, true })
+        {
+            std::unique_ptr<plMipmap> image(MakeImage(64, kind, alpha, 7 + kind));
+
+            // The old encoder's error, on level 0
+            bool dxt1 = !alpha;
+            EncodeError oldError = {};
+            for (uint32_t by = 0; by < 16; by++)
+            {
+                for (uint32_t bx = 0; bx < 16; bx++)
+                {
+                    uint32_t pixels[16];
+                    uint8_t block[16];
+                    GetBlockPixels(image.get(), 0, bx, by, pixels);
+                    OldEncodeBlock(pixels, !dxt1, block);
+                    AddBlockError(pixels, block, dxt1, oldError);
+                }
+            }
+
+            for (auto quality : { hsDXTSoftwareCodec::kFastest, hsDXTSoftwareCodec::kNormal, hsDXTSoftwareCodec::kHighest })
+            {
+                hsDXTSoftwareCodec::SetCompressionQuality(quality);
+                std::unique_ptr<plMipmap> compressed(hsDXTSoftwareCodec::Instance().CreateCompressedMipmap(image.get()));
+                ASSERT_TRUE(compressed);
+                ASSERT_EQ(dxt1 ? plMipmap::DirectXInfo::kDXT1 : plMipmap::DirectXInfo::kDXT5, compressed->fDirectXInfo.fCompressionType);
+
+                EncodeError newError = {};
+                const uint8_t* blocks = compressed->GetLevelPtr(0);
+                for (uint32_t by = 0; by < 16; by++)
+                {
+                    for (uint32_t bx = 0; bx < 16; bx++)
+                    {
+                        uint32_t pixels[16];
+                        GetBlockPixels(image.get(), 0, bx, by, pixels);
+                        AddBlockError(pixels, blocks + (by * 16 + bx) * compressed->fDirectXInfo.fBlockSize, dxt1, newError);
+                    }
+                }
+
+                EXPECT_LE(newError.fColor, oldError.fColor) << "image " << kind << " alpha " << alpha << " quality " << quality;
+                EXPECT_LE(newError.fAlpha, oldError.fAlpha) << "image " << kind << " alpha " << alpha << " quality " << quality;
+            }
+        }
+    }
+}
+
+TEST_F(DXTCodecTest, RoundTrip)
+{
+    // Colors that fit in 565 exactly, and alphas that the DXT5 endpoints can
+    // hit exactly, have to come back unchanged: one color per block always,
+    // and two once the endpoints are refined.
+    std::mt19937 rng(3);
+
+    for (bool alpha : { false, true })
+    {
+        plMipmap image(32, 32, alpha ? plMipmap::kARGB32Config : plMipmap::kRGB32Config, 1);
+
+        uint32_t* pixels = (uint32_t*)image.GetLevelPtr(0);
+        for (uint32_t by = 0; by < 8; by++)
+        {
+            for (uint32_t bx = 0; bx < 8; bx++)
+            {
+                uint32_t colors[2];
+                for (uint32_t& color : colors)
+                    color = HardwareExpand565(uint16_t(rng())) | (alpha ? (rng() % 256) << 24 : 0xFF000000);
+                if (bx & 1)
+                    colors[1] = colors[0];
+                for (uint32_t i = 0; i < 16; i++)
+                    pixels[(by * 4 + i / 4) * 32 + bx * 4 + i % 4] = colors[rng() % 2];
+            }
+        }
+
+        for (auto quality : { hsDXTSoftwareCodec::kFastest, hsDXTSoftwareCodec::kNormal, hsDXTSoftwareCodec::kHighest })
+        {
+            hsDXTSoftwareCodec::SetCompressionQuality(quality);
+            std::unique_ptr<plMipmap> compressed(hsDXTSoftwareCodec::Instance().CreateCompressedMipmap(&image));
+            ASSERT_TRUE(compressed);
+
+            const uint8_t* blocks = compressed->GetLevelPtr(0);
+            for (uint32_t by = 0; by < 8; by++)
+            {
+                for (uint32_t bx = 0; bx < 8; bx++)
+                {
+                    if (!(bx & 1) && quality != hsDXTSoftwareCodec::kHighest)
+                        continue;
+
+                    uint32_t expected[16], actual[16];
+                    GetBlockPixels(&image, 0, bx, by, expected);
+                    HardwareDecodeBlock(blocks + (by * 8 + bx) * compressed->fDirectXInfo.fBlockSize, !alpha, actual);
+                    for (uint32_t i = 0; i < 16; i++)
+                    {
+                        EXPECT_EQ(expected[i], actual[i])
+                            << "block " << bx << "," << by << " pixel " << i << " alpha " << alpha << " quality " << quality;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(DXTCodecTest, DXT1Transparency)
+{
+    // Only pixels with zero alpha go transparent in DXT1
+    std::unique_ptr<plMipmap> image(MakeImage(32, kGradient, false, 5));
+    uint32_t* pixels = (uint32_t*)image->GetLevelPtr(0);
+    for (uint32_t i = 0; i < 32 * 32; i += 3)
+        pixels[i] &= 0x00FFFFFF;
+    for (uint32_t i = 1; i < 32 * 32; i += 7)
+        pixels[i] = (pixels[i] & 0x00FFFFFF) | 0x80000000;
+
+    std::unique_ptr<plMipmap> compressed(hsDXTSoftwareCodec::Instance().CreateCompressedMipmap(image.get()));
+    ASSERT_TRUE(compressed);
+    std::unique_ptr<plMipmap> decoded(hsDXTSoftwareCodec::Instance().CreateUncompressedMipmap(compressed.get(), hsCodecManager::k32BitDepth));
+    ASSERT_TRUE(decoded);
+
+    const uint32_t* result = (const uint32_t*)decoded->GetLevelPtr(0);
+    for (uint32_t i = 0; i < 32 * 32; i++)
+        EXPECT_EQ((pixels[i] >> 24) == 0 ? 0U : 0xFFU, result[i] >> 24) << "pixel " << i;
+}
+
+TEST_F(DXTCodecTest, KernelsMatchFpu)
+{
+    const hsCpuId& cpu = hsCpuId::Instance();
+    std::mt19937 rng(4);
+
+    for (int n = 0; n < 2000; n++)
+    {
+        uint32_t pixels[16], palette[4];
+        uint8_t alphas[8];
+        for (uint32_t& pixel : pixels)
+            pixel = rng();
+        for (uint32_t& color : palette)
+            color = rng() | 0xFF000000;
+        for (uint8_t& a : alphas)
+            a = uint8_t(rng());
+        uint32_t transparent = (n % 3 == 0) ? (rng() & 0xFFFF) : 0;
+        uint32_t numColors = (n % 2) ? 4 : 3;
+
+        if (cpu.has_sse2)
+        {
+            uint32_t fpuIndices, sse2Indices;
+            uint32_t fpuError = hsDXTSoftwareCodec::fit_colors_fpu(pixels, palette, numColors, transparent, fpuIndices);
+            uint32_t sse2Error = hsDXTSoftwareCodec::fit_colors_sse2(pixels, palette, numColors, transparent, sse2Indices);
+            ASSERT_EQ(fpuError, sse2Error);
+            ASSERT_EQ(fpuIndices, sse2Indices);
+
+            uint64_t fpuAlphaIndices, sse2AlphaIndices;
+            fpuError = hsDXTSoftwareCodec::fit_alphas_fpu(pixels, alphas, fpuAlphaIndices);
+            sse2Error = hsDXTSoftwareCodec::fit_alphas_sse2(pixels, alphas, sse2AlphaIndices);
+            ASSERT_EQ(fpuError, sse2Error);
+            ASSERT_EQ(fpuAlphaIndices, sse2AlphaIndices);
+        }
+
+        if (cpu.has_ssse3)
+        {
+            uint32_t alphaPalette[8];
+            for (int j = 0; j < 8; j++)
+                alphaPalette[j] = uint32_t(alphas[j]) << 24;
+            uint32_t colorBits = rng();
+            uint64_t alphaBits = ((uint64_t)rng() << 32 | rng()) & 0xFFFFFFFFFFFFULL;
+
+            for (const uint32_t* alphaPtr : { (const uint32_t*)nullptr, (const uint32_t*)alphaPalette })
+            {
+                // Pad the rows out, to check nothing gets written in between
+                uint32_t fpu[4 * 6], ssse3[4 * 6];
+                memset(fpu, 0xCD, sizeof(fpu));
+                memset(ssse3, 0xCD, sizeof(ssse3));
+                uint32_t colors[4];
+                for (int j = 0; j < 4; j++)
+                    colors[j] = alphaPtr ? (palette[j] & 0x00FFFFFF) : palette[j];
+                hsDXTSoftwareCodec::decode_block_fpu(colors, colorBits, alphaPtr, alphaBits, fpu, 6);
+                hsDXTSoftwareCodec::decode_block_ssse3(colors, colorBits, alphaPtr, alphaBits, ssse3, 6);
+                ASSERT_EQ(0, memcmp(fpu, ssse3, sizeof(fpu)));
+            }
+        }
+    }
+}
+
+// Encode and decode throughput, for measuring the codec headless. This isn't
+// a pass/fail test, so it only runs when asked for:
+//      test_plGImage --gtest_also_run_disabled_tests --gtest_filter=*Throughput
+TEST_F(DXTCodecTest, DISABLED_Throughput)
+{
+    const uint32_t kSize = 1024;
+    const int kReps = 4;
+
+    auto measure = [](const char* name, uint32_t pixels, auto run)
+    {
+        run();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kReps; i++)
+            run();
+        std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        printf("%-28s %8.1f Mpixels/s\n", name, double(pixels) * kReps / secs.count() / 1.e6);
+    };
+
+    for (bool alpha : { false, true })
+    {
+        std::unique_ptr<plMipmap> image(MakeImage(kSize, kGradient, alpha, 11));
+        const char* format = alpha ? "DXT5" : "DXT1";
+        char name[64];
+
+        // What the encoder used to do, on the top level only
+        snprintf(name, sizeof(name), "%s encode, old", format);
+        measure(name, kSize * kSize, [&] {
+            uint32_t pixels[16];
+            uint8_t block[16];
+            for (uint32_t by = 0; by < kSize / 4; by++)
+            {
+                for (uint32_t bx = 0; bx < kSize / 4; bx++)
+                {
+                    GetBlockPixels(image.get(), 0, bx, by, pixels);
+                    OldEncodeBlock(pixels, alpha, block);
+                }
+            }
+        });
+
+        const char* qualityNames[] = { "fastest", "normal", "highest" };
+        for (auto quality : { hsDXTSoftwareCodec::kFastest, hsDXTSoftwareCodec::kNormal, hsDXTSoftwareCodec::kHighest })
+        {
+            hsDXTSoftwareCodec::SetCompressionQuality(quality);
+            for (uint32_t minThreaded : { 1U << 30, 1024U })
+            {
+                hsDXTSoftwareCodec::SetMinThreadedBlocks(minThreaded);
+                snprintf(name, sizeof(name), "%s encode, %s%s", format, qualityNames[quality],
+                         minThreaded == 1024 ? ", pool" : "");
+                measure(name, image->GetTotalSize() / 4, [&] {
+                    delete hsDXTSoftwareCodec::Instance().CreateCompressedMipmap(image.get());
+                });
+            }
+        }
+
+        hsDXTSoftwareCodec::SetCompressionQuality(hsDXTSoftwareCodec::kNormal);
+        std::unique_ptr<plMipmap> compressed(hsDXTSoftwareCodec::Instance().CreateCompressedMipmap(image.get()));
+        ASSERT_TRUE(compressed);
+        for (uint32_t minThreaded : { 1U << 30, 1024U })
+        {
+            hsDXTSoftwareCodec::SetMinThreadedBlocks(minThreaded);
+            snprintf(name, sizeof(name), "%s decode%s", format, minThreaded == 1024 ? ", pool" : "");
+            measure(name, image->GetTotalSize() / 4, [&] {
+                delete hsDXTSoftwareCodec::Instance().CreateUncompressedMipmap(compressed.get(), hsCodecManager::k32BitDepth);
+            });
+        }
+    }
+}
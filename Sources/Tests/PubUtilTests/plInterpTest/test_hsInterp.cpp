@@ -0,0 +1,326 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "plInterp/hsInterp.h"
+#include "plInterp/hsKeys.h"
+
+// The linear search GetBoundaryKeyFrames used to do, kept here to check the
+// hinted/binary/uniform lookups against.
+static void RefBoundaryKeyFrames(float time, uint32_t numKeys, hsScalarKey* keys,
+                                 hsScalarKey** kF1, hsScalarKey** kF2, uint32_t* lastKeyIdx, float* p, bool forwards)
+{
+    int k1 = 0;
+    float frame = time * MAX_FRAMES_PER_SEC;
+
+    if (frame > keys[numKeys - 1].fFrame)
+    {
+        k1 = numKeys - 1;
+        *kF1 = *kF2 = &keys[k1];
+        *p = 0.f;
+        *lastKeyIdx = k1;
+        return;
+    }
+
+    hsScalarKey* key1 = &keys[0];
+    hsScalarKey* key2 = nullptr;
+    if (frame < key1->fFrame)
+    {
+        *kF1 = *kF2 = key1;
+        *p = 0.f;
+        *lastKeyIdx = 0;
+        return;
+    }
+
+    int i = 1;
+    if (*lastKeyIdx > 0 && *lastKeyIdx < numKeys - 1)
+    {
+        if (forwards)
+            key1 = &keys[*lastKeyIdx];
+        else
+            key2 = &keys[*lastKeyIdx + 1];
+        i = *lastKeyIdx + 1;
+    }
+    else if (!forwards)
+    {
+        key2 = &keys[1];
+    }
+
+    for (uint32_t count = 1; count <= numKeys; count++, forwards ? i++ : i--)
+    {
+        if (forwards)
+        {
+            if (i >= (int)numKeys)
+            {
+                key1 = &keys[0];
+                i = 1;
+                count++;
+            }
+            key2 = &keys[i];
+        }
+        else
+        {
+            if (i < 1)
+            {
+                i = numKeys - 1;
+                key2 = &keys[i];
+                count++;
+            }
+            key1 = &keys[i - 1];
+        }
+
+        if (frame <= key2->fFrame && frame >= key1->fFrame)
+        {
+            k1 = i - 1;
+            *kF1 = key1;
+            *kF2 = key2;
+            *p = (time - key1->fFrame / MAX_FRAMES_PER_SEC) / ((key2->fFrame - key1->fFrame) / MAX_FRAMES_PER_SEC);
+            break;
+        }
+
+        if (forwards)
+            key1 = key2;
+        else
+            key2 = key1;
+    }
+    *lastKeyIdx = k1;
+}
+
+static std::vector<hsScalarKey> MakeKeys(std::mt19937& rng, uint32_t numKeys, uint16_t step)
+{
+    std::uniform_int_distribution<int> gap(1, 12);
+
+    std::vector<hsScalarKey> keys(numKeys);
+    uint16_t frame = 5;
+    for (hsScalarKey& key : keys)
+    {
+        key.fFrame = frame;
+        key.fValue = float(frame % 17);
+        frame += step ? step : gap(rng);
+    }
+    return keys;
+}
+
+// Times a little way off the keys, so there's exactly one right pair
+static float OffKeyTime(std::mt19937& rng, const std::vector<hsScalarKey>& keys)
+{
+    std::uniform_real_distribution<float> frame(0.f, keys.back().fFrame + 10.f);
+    float f = std::floor(frame(rng)) + 0.25f;
+    return f / MAX_FRAMES_PER_SEC;
+}
+
+static void CheckTrack(std::mt19937& rng, std::vector<hsScalarKey>& keys, uint32_t uniformStep)
+{
+    std::uniform_real_distribution<float> step(0.f, 3.f);
+    std::uniform_int_distribution<int> action(0, 9);
+
+    uint32_t numKeys = (uint32_t)keys.size();
+    uint32_t refIdx = 0, newIdx = 0;
+    float time = OffKeyTime(rng, keys);
+    bool forwards = true;
+
+    for (int n = 0; n < 5000; n++)
+    {
+        int a = action(rng);
+        if (a == 0)
+        {
+            // Scrub somewhere else entirely
+            time = OffKeyTime(rng, keys);
+        }
+        else if (a == 1)
+        {
+            forwards = !forwards;
+        }
+        else
+        {
+            // Normal playback, a frame or so at a time
+            float f = std::floor(time * MAX_FRAMES_PER_SEC) + (forwards ? std::floor(step(rng)) : -std::floor(step(rng)));
+            if (f < 0.f)
+                f = 0.f;
+            time = (f + 0.25f) / MAX_FRAMES_PER_SEC;
+        }
+
+        hsScalarKey *ref1, *ref2, *new1, *new2;
+        float refP, newP;
+        RefBoundaryKeyFrames(time, numKeys, keys.data(), &ref1, &ref2, &refIdx, &refP, forwards);
+        hsInterp::GetBoundaryKeyFrames(time, numKeys, keys.data(), sizeof(hsScalarKey),
+                                       (hsKeyFrame**)&new1, (hsKeyFrame**)&new2, &newIdx, &newP, forwards, uniformStep);
+
+        ASSERT_EQ(ref1, new1) << "time " << time;
+        ASSERT_EQ(ref2, new2) << "time " << time;
+        ASSERT_EQ(refP, newP) << "time " << time;
+        ASSERT_EQ(refIdx, newIdx) << "time " << time;
+    }
+}
+
+TEST(hsInterp, BoundaryKeyFramesIrregular)
+{
+    std::mt19937 rng(1234);
+    for (uint32_t numKeys : { 2, 3, 7, 64, 1000 })
+    {
+        std::vector<hsScalarKey> keys = MakeKeys(rng, numKeys, 0);
+        CheckTrack(rng, keys, 0);
+    }
+}
+
+TEST(hsInterp, BoundaryKeyFramesUniform)
+{
+    std::mt19937 rng(5678);
+    for (uint32_t numKeys : { 2, 3, 7, 64, 1000 })
+    {
+        for (uint16_t step : { 1, 2, 5 })
+        {
+            std::vector<hsScalarKey> keys = MakeKeys(rng, numKeys, step);
+            CheckTrack(rng, keys, step);
+
+            // Not telling it about the spacing must give the same answers
+            CheckTrack(rng, keys, 0);
+        }
+    }
+}
+
+TEST(hsInterp, BoundaryKeyFramesOnKey)
+{
+    // Right on a key, either neighboring pair is fine as long as it lands
+    // on that key's value.
+    std::mt19937 rng(42);
+    std::vector<hsScalarKey> keys = MakeKeys(rng, 50, 0);
+
+    for (bool forwards : { true, false })
+    {
+        uint32_t idx = 0;
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            size_t k = forwards ? i : keys.size() - 1 - i;
+            float time = keys[k].fFrame / MAX_FRAMES_PER_SEC;
+
+            hsScalarKey *k1, *k2;
+            float p, value;
+            hsInterp::GetBoundaryKeyFrames(time, (uint32_t)keys.size(), keys.data(), sizeof(hsScalarKey),
+                                           (hsKeyFrame**)&k1, (hsKeyFrame**)&k2, &idx, &p, forwards);
+            hsInterp::LinInterp(k1->fValue, k2->fValue, p, &value);
+            EXPECT_NEAR(keys[k].fValue, value, 1.e-4f) << "key " << k;
+        }
+    }
+}
+
+// Key lookup speed on a long track, for normal playback and for scrubbing,
+// against the old linear search. This isn't a pass/fail test, so it only
+// runs when asked for:
+//      test_plInterp --gtest_also_run_disabled_tests --gtest_filter=*Throughput
+TEST(hsInterp, DISABLED_BoundaryKeyFramesThroughput)
+{
+    const uint32_t kNumKeys = 2000;
+    const int kNumLookups = 200000;
+
+    std::mt19937 rng(99);
+    std::vector<hsScalarKey> irregular = MakeKeys(rng, kNumKeys, 0);
+    std::vector<hsScalarKey> uniform = MakeKeys(rng, kNumKeys, 2);
+
+    // Playback steps through the track a frame at a time, scrubbing jumps
+    // anywhere.
+    auto makeTimes = [&](const std::vector<hsScalarKey>& keys, bool scrub)
+    {
+        std::vector<float> times(kNumLookups);
+        float end = keys.back().fFrame / MAX_FRAMES_PER_SEC;
+        for (int i = 0; i < kNumLookups; i++)
+        {
+            if (scrub)
+                times[i] = OffKeyTime(rng, keys);
+            else
+                times[i] = std::fmod((i + 0.25f) / MAX_FRAMES_PER_SEC, end);
+        }
+        return times;
+    };
+
+    auto measure = [](const char* what, std::vector<hsScalarKey>& keys, const std::vector<float>& times, auto lookup)
+    {
+        uint32_t idx = 0;
+        float sum = 0.f;
+        auto start = std::chrono::steady_clock::now();
+        for (float time : times)
+        {
+            hsScalarKey *k1, *k2;
+            float p;
+            lookup(time, keys, &k1, &k2, &idx, &p);
+            sum += p;
+        }
+        std::chrono::duration<double, std::nano> nsecs = std::chrono::steady_clock::now() - start;
+        EXPECT_GT(sum, 0.f);
+        printf("%-20s %8.1f ns per lookup\n", what, nsecs.count() / times.size());
+    };
+
+    auto ref = [](float time, std::vector<hsScalarKey>& keys, hsScalarKey** k1, hsScalarKey** k2, uint32_t* idx, float* p)
+    {
+        RefBoundaryKeyFrames(time, (uint32_t)keys.size(), keys.data(), k1, k2, idx, p, true);
+    };
+    auto lookup = [](uint32_t uniformStep)
+    {
+        return [uniformStep](float time, std::vector<hsScalarKey>& keys, hsScalarKey** k1, hsScalarKey** k2, uint32_t* idx, float* p)
+        {
+            hsInterp::GetBoundaryKeyFrames(time, (uint32_t)keys.size(), keys.data(), sizeof(hsScalarKey),
+                                           (hsKeyFrame**)k1, (hsKeyFrame**)k2, idx, p, true, uniformStep);
+        };
+    };
+
+    for (bool scrub : { false, true })
+    {
+        const char* pattern = scrub ? "scrub" : "play";
+        char name[64];
+
+        std::vector<float> times = makeTimes(irregular, scrub);
+        snprintf(name, sizeof(name), "%s, linear", pattern);
+        measure(name, irregular, times, ref);
+        snprintf(name, sizeof(name), "%s, irregular", pattern);
+        measure(name, irregular, times, lookup(0));
+
+        times = makeTimes(uniform, scrub);
+        snprintf(name, sizeof(name), "%s, uniform", pattern);
+        measure(name, uniform, times, lookup(2));
+    }
+}
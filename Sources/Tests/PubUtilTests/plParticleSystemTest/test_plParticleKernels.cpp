@@ -0,0 +1,267 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+#include "hsCpuID.h"
+
+#include "plParticleSystem/plParticle.h"
+#include "plParticleSystem/plParticleEmitter.h"
+#include "plParticleSystem/plParticleKernels.h"
+
+// Counts around the SSE2 (4) and AVX (8) widths, so the leftovers get tried
+static const size_t kCounts[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 1000, 1003 };
+
+static std::vector<float> RandomFloats(std::mt19937& rng, size_t count)
+{
+    std::uniform_real_distribution<float> dist(-100.f, 100.f);
+    std::vector<float> values(count);
+    for (float& v : values)
+        v = dist(rng);
+    return values;
+}
+
+// A kernel takes the same pointer it's checked on, so each one gets its own
+// copy of the inputs, and the results are compared afterwards.
+typedef void(*decay_life_ptr)(float*, size_t, float);
+typedef void(*integrate_ptr)(float*, const float*, size_t, float);
+typedef void(*apply_drag_ptr)(float*, size_t, float, float, float, float);
+typedef void(*compute_bounds_ptr)(const float*, size_t, float*, float*);
+
+static void CheckDecayLife(decay_life_ptr kernel)
+{
+    std::mt19937 rng(1);
+    for (size_t count : kCounts)
+    {
+        std::vector<float> life = RandomFloats(rng, count + 1);
+        std::vector<float> expected = life;
+        plParticleKernels::decay_life_fpu(expected.data(), count, 0.25f);
+        kernel(life.data(), count, 0.25f);
+        for (size_t i = 0; i < count + 1; i++)
+            ASSERT_FLOAT_EQ(expected[i], life[i]) << "count " << count << ", index " << i;
+    }
+}
+
+static void CheckIntegrate(integrate_ptr kernel)
+{
+    std::mt19937 rng(2);
+    for (size_t count : kCounts)
+    {
+        std::vector<float> pos = RandomFloats(rng, count * 3 + 1);
+        std::vector<float> vel = RandomFloats(rng, count * 3);
+        std::vector<float> expected = pos;
+        plParticleKernels::integrate_fpu(expected.data(), vel.data(), count, 0.03f);
+        kernel(pos.data(), vel.data(), count, 0.03f);
+        for (size_t i = 0; i < count * 3 + 1; i++)
+            ASSERT_FLOAT_EQ(expected[i], pos[i]) << "count " << count << ", index " << i;
+    }
+}
+
+static void CheckApplyDrag(apply_drag_ptr kernel)
+{
+    std::mt19937 rng(3);
+    for (size_t count : kCounts)
+    {
+        std::vector<float> vel = RandomFloats(rng, count * 3 + 1);
+        std::vector<float> expected = vel;
+        plParticleKernels::apply_drag_fpu(expected.data(), count, 0.9f, 1.f, -2.f, 3.f);
+        kernel(vel.data(), count, 0.9f, 1.f, -2.f, 3.f);
+        for (size_t i = 0; i < count * 3 + 1; i++)
+            ASSERT_FLOAT_EQ(expected[i], vel[i]) << "count " << count << ", index " << i;
+    }
+}
+
+static void CheckComputeBounds(compute_bounds_ptr kernel)
+{
+    std::mt19937 rng(4);
+    for (size_t count : kCounts)
+    {
+        std::vector<float> pos = RandomFloats(rng, count * 3);
+
+        // Put the extremes in the leftovers, where a kernel would miss them
+        pos[count * 3 - 3] = -1000.f;
+        pos[count * 3 - 1] = 1000.f;
+
+        float expectedMin[3], expectedMax[3], min[3], max[3];
+        plParticleKernels::compute_bounds_fpu(pos.data(), count, expectedMin, expectedMax);
+        kernel(pos.data(), count, min, max);
+        for (size_t j = 0; j < 3; j++)
+        {
+            ASSERT_EQ(expectedMin[j], min[j]) << "count " << count;
+            ASSERT_EQ(expectedMax[j], max[j]) << "count " << count;
+        }
+    }
+}
+
+TEST(plParticleKernels, SSE2MatchesFpu)
+{
+    if (!hsCpuId::Instance().has_sse2)
+        GTEST_SKIP() << "No SSE2";
+
+    CheckDecayLife(&plParticleKernels::decay_life_sse2);
+    CheckIntegrate(&plParticleKernels::integrate_sse2);
+    CheckApplyDrag(&plParticleKernels::apply_drag_sse2);
+    CheckComputeBounds(&plParticleKernels::compute_bounds_sse2);
+}
+
+TEST(plParticleKernels, AVXMatchesFpu)
+{
+    if (!hsCpuId::Instance().has_avx)
+        GTEST_SKIP() << "No AVX";
+
+    CheckDecayLife(&plParticleKernels::decay_life_avx);
+    CheckIntegrate(&plParticleKernels::integrate_avx);
+    CheckApplyDrag(&plParticleKernels::apply_drag_avx);
+    CheckComputeBounds(&plParticleKernels::compute_bounds_avx);
+}
+
+// Gets at the emitter's particle arrays without needing a whole particle
+// system around it.  Each particle is tagged with its original index in
+// both the Core and the Ext arrays.
+class TestEmitter : public plParticleEmitter
+{
+public:
+    TestEmitter(uint32_t count)
+    {
+        fMaxParticles = count;
+        ISetupParticleMem();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float tag = float(i);
+            fParticleCores[i].fHSize = tag;
+            fParticleExts.fPos[i].Set(tag, tag, tag);
+            fParticleExts.fVelocity[i].Set(tag, -tag, tag);
+            fParticleExts.fInvMass[i] = tag;
+            fParticleExts.fAcceleration[i].Set(-tag, tag, -tag);
+            fParticleExts.fLife[i] = 1.f;
+            fParticleExts.fStartLife[i] = 2.f;
+            fParticleExts.fScale[i] = tag;
+            fParticleExts.fRadsPerSec[i] = tag;
+            fParticleExts.fMiscFlags[i] = 0;
+        }
+        fNumValidParticles = count;
+    }
+
+    void Kill(uint32_t i) { fParticleExts.fMiscFlags[i] |= plParticleExt::kDead; }
+    void Expire(uint32_t i, bool immortal)
+    {
+        fParticleExts.fLife[i] = 0.f;
+        if (immortal)
+            fParticleExts.fMiscFlags[i] |= plParticleExt::kImmortal;
+    }
+
+    void RemoveDead() { IRemoveDeadParticles(); }
+    void KillExpired() { IKillExpiredParticles(); }
+
+    // The survivors must be exactly these, in this order, in every array
+    void CheckSurvivors(const std::vector<uint32_t>& expected) const
+    {
+        ASSERT_EQ(expected.size(), fNumValidParticles);
+        for (uint32_t i = 0; i < fNumValidParticles; i++)
+        {
+            float tag = float(expected[i]);
+            EXPECT_EQ(tag, fParticleCores[i].fHSize) << "slot " << i;
+            EXPECT_EQ(tag, fParticleExts.fPos[i].fY) << "slot " << i;
+            EXPECT_EQ(-tag, fParticleExts.fVelocity[i].fY) << "slot " << i;
+            EXPECT_EQ(tag, fParticleExts.fInvMass[i]) << "slot " << i;
+            EXPECT_EQ(-tag, fParticleExts.fAcceleration[i].fZ) << "slot " << i;
+            EXPECT_EQ(tag, fParticleExts.fScale[i]) << "slot " << i;
+            EXPECT_EQ(tag, fParticleExts.fRadsPerSec[i]) << "slot " << i;
+            EXPECT_FALSE(fParticleExts.fMiscFlags[i] & plParticleExt::kDead) << "slot " << i;
+        }
+    }
+};
+
+TEST(plParticleEmitter, RemoveDeadKeepsOrder)
+{
+    std::mt19937 rng(5);
+    for (uint32_t count : { 1U, 2U, 10U, 257U })
+    {
+        TestEmitter emitter(count);
+        std::vector<uint32_t> survivors;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            // Runs of both, including dead ones at either end
+            if (i == 0 || i == count - 1 || rng() % 3 == 0)
+                emitter.Kill(i);
+            else
+                survivors.push_back(i);
+        }
+
+        emitter.RemoveDead();
+        emitter.CheckSurvivors(survivors);
+    }
+}
+
+TEST(plParticleEmitter, RemoveDeadWithNoneDead)
+{
+    TestEmitter emitter(16);
+    emitter.RemoveDead();
+
+    std::vector<uint32_t> survivors;
+    for (uint32_t i = 0; i < 16; i++)
+        survivors.push_back(i);
+    emitter.CheckSurvivors(survivors);
+}
+
+TEST(plParticleEmitter, RemoveDeadWithAllDead)
+{
+    TestEmitter emitter(16);
+    for (uint32_t i = 0; i < 16; i++)
+        emitter.Kill(i);
+    emitter.RemoveDead();
+    emitter.CheckSurvivors({});
+}
+
+TEST(plParticleEmitter, KillExpiredSparesImmortals)
+{
+    TestEmitter emitter(8);
+    emitter.Expire(1, false);
+    emitter.Expire(2, true);
+    emitter.Expire(5, false);
+    emitter.Expire(7, false);
+
+    emitter.KillExpired();
+    emitter.CheckSurvivors({ 0, 2, 3, 4, 6 });
+}
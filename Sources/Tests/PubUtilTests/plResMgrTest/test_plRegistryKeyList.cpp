@@ -0,0 +1,172 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <string_theory/format>
+#include <vector>
+
+#include "pnKeyedObject/plKeyImp.h"
+#include "pnKeyedObject/plUoid.h"
+#include "plResMgr/plRegistryKeyList.h"
+
+static const plLocation kTestLoc = plLocation::MakeNormal(0x10001);
+static const uint16_t kTestClass = 1;
+
+static plKeyImp* MakeKey(const ST::string& name, uint32_t objectID = 0)
+{
+    plUoid uoid(kTestLoc, kTestClass, name);
+    uoid.SetObjectID(objectID);
+    return new plKeyImp(uoid, 0, 0);
+}
+
+// What FindKey used to do before it had an index
+static plKeyImp* LinearFind(const std::vector<plKeyImp*>& keys, const ST::string& name)
+{
+    for (plKeyImp* key : keys) {
+        if (key && key->GetName().compare_i(name) == 0)
+            return key;
+    }
+    return nullptr;
+}
+
+TEST(plRegistryKeyList, FindKeyMatchesLinearSearch)
+{
+    plRegistryKeyList list(kTestClass);
+    std::vector<plKeyImp*> keys;
+    plRegistryKeyList::LoadStatus status;
+
+    // Every fifth name repeats an earlier one with different case
+    for (int i = 0; i < 200; ++i) {
+        ST::string name = (i % 5 == 4) ? ST::format("KEY{}", i - 3) : ST::format("Key{}", i);
+        keys.push_back(MakeKey(name));
+        list.AddKey(keys.back(), status);
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        ST::string name = ST::format("key{}", i);
+        EXPECT_EQ(LinearFind(keys, name), list.FindKey(name)) << name.c_str();
+    }
+    EXPECT_EQ(nullptr, list.FindKey(ST_LITERAL("NoSuchKey")));
+}
+
+TEST(plRegistryKeyList, FindKeyAfterAppend)
+{
+    plRegistryKeyList list(kTestClass);
+    plRegistryKeyList::LoadStatus status;
+
+    plKeyImp* first = MakeKey(ST_LITERAL("Dupe"));
+    list.AddKey(first, status);
+    EXPECT_EQ(first, list.FindKey(ST_LITERAL("dupe")));
+
+    // Added after the index was built; the earlier key must still win
+    plKeyImp* second = MakeKey(ST_LITERAL("DUPE"));
+    plKeyImp* other = MakeKey(ST_LITERAL("Other"));
+    list.AddKey(second, status);
+    list.AddKey(other, status);
+    EXPECT_EQ(first, list.FindKey(ST_LITERAL("Dupe")));
+    EXPECT_EQ(other, list.FindKey(ST_LITERAL("other")));
+    EXPECT_EQ(2, second->GetUoid().GetObjectID());
+}
+
+TEST(plRegistryKeyList, FindKeyAfterExplicitID)
+{
+    plRegistryKeyList list(kTestClass);
+    plRegistryKeyList::LoadStatus status;
+
+    plKeyImp* late = MakeKey(ST_LITERAL("Shared"), 3);
+    list.AddKey(late, status);
+    EXPECT_EQ(late, list.FindKey(ST_LITERAL("shared")));
+
+    // Fills an earlier slot with the same name, so it now comes first
+    plKeyImp* early = MakeKey(ST_LITERAL("SHARED"), 1);
+    list.AddKey(early, status);
+    EXPECT_EQ(early, list.FindKey(ST_LITERAL("Shared")));
+
+    plUoid byID(kTestLoc, kTestClass, ST_LITERAL("Shared"));
+    byID.SetObjectID(3);
+    EXPECT_EQ(late, list.FindKey(byID));
+}
+
+// Name lookup speed in a class with as many keys as the biggest pages have
+// scene objects, against the old linear search. This isn't a pass/fail
+// test, so it only runs when asked for:
+//      test_plResMgr --gtest_also_run_disabled_tests --gtest_filter=*Throughput
+TEST(plRegistryKeyList, DISABLED_FindKeyThroughput)
+{
+    const int kNumKeys = 10000;
+    const int kNumFinds = 10000;
+
+    plRegistryKeyList list(kTestClass);
+    std::vector<plKeyImp*> keys;
+    plRegistryKeyList::LoadStatus status;
+    for (int i = 0; i < kNumKeys; ++i) {
+        keys.push_back(MakeKey(ST::format("SceneObject{}", i)));
+        list.AddKey(keys.back(), status);
+    }
+
+    std::vector<ST::string> names;
+    for (int i = 0; i < kNumFinds; ++i)
+        names.push_back(ST::format("sceneobject{}", (i * 7919) % kNumKeys));
+
+    auto measure = [&](const char* what, auto find)
+    {
+        size_t found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const ST::string& name : names)
+            found += find(name) != nullptr;
+        std::chrono::duration<double, std::micro> usecs = std::chrono::steady_clock::now() - start;
+        EXPECT_EQ(names.size(), found);
+        printf("%-8s %8.3f us per find\n", what, usecs.count() / names.size());
+    };
+
+    measure("linear", [&](const ST::string& name) { return LinearFind(keys, name); });
+
+    // The first name lookup builds the index, which is timed separately
+    auto start = std::chrono::steady_clock::now();
+    list.FindKey(names[0]);
+    std::chrono::duration<double, std::micro> indexUsecs = std::chrono::steady_clock::now() - start;
+    printf("%-8s %8.1f us\n", "index", indexUsecs.count());
+
+    measure("FindKey", [&](const ST::string& name) { return list.FindKey(name); });
+}
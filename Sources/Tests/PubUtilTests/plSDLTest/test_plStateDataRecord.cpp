@@ -0,0 +1,256 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+
+#include "hsStream.h"
+
+#include "plFile/plStreamSource.h"
+#include "plSDL/plSDL.h"
+
+static const char kTestSDL[] =
+    "STATEDESC compactChild\n"
+    "{\n"
+    "    VERSION 1\n"
+    "    VAR INT value[1] DEFAULT=0\n"
+    "}\n"
+    "STATEDESC compactTest\n"
+    "{\n"
+    "    VERSION 1\n"
+    "    VAR POINT3 position[1] DEFAULT=(0,0,0)\n"
+    "    VAR VECTOR3 velocity[1] DEFAULT=(0,0,0)\n"
+    "    VAR QUATERNION orientation[1] DEFAULT=(0,0,0,1)\n"
+    "    VAR FLOAT speed[1] DEFAULT=0\n"
+    "    VAR RGB tint[1] DEFAULT=(1,1,1)\n"
+    "    VAR INT count[1] DEFAULT=0\n"
+    "    VAR STRING32 name[1]\n"
+    "    VAR $compactChild child[1]\n"
+    "}\n";
+
+class plStateDataRecordTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        // Parse the descriptors from memory rather than a file on disk
+        hsRAMStream* stream = new hsRAMStream;
+        stream->Write(sizeof(kTestSDL) - 1, kTestSDL);
+        plStreamSource::GetInstance()->InsertFile("test_plSDL/compact.sdl", stream);
+
+        plSDLMgr::GetInstance()->SetSDLDir("test_plSDL");
+        ASSERT_TRUE(plSDLMgr::GetInstance()->Init());
+    }
+
+    static void TearDownTestSuite()
+    {
+        plSDLMgr::GetInstance()->DeInit();
+    }
+
+    static void RoundTrip(const plStateDataRecord& src, plStateDataRecord& dst, uint32_t writeOptions, uint32_t* size = nullptr)
+    {
+        hsRAMStream stream;
+        src.Write(&stream, 0, writeOptions);
+        if (size)
+            *size = stream.GetEOF();
+        stream.Rewind();
+        ASSERT_TRUE(dst.Read(&stream, 0));
+        EXPECT_TRUE(stream.AtEnd());
+    }
+
+    static void SetFloats(plStateDataRecord& rec, const char* name, float a, float b, float c, float d = 0.f)
+    {
+        float values[] = { a, b, c, d };
+        ASSERT_TRUE(rec.FindVar(name)->Set(values));
+    }
+
+    static void GetFloats(const plStateDataRecord& rec, const char* name, float* values)
+    {
+        ASSERT_TRUE(rec.FindVar(name)->Get(values));
+    }
+};
+
+TEST_F(plStateDataRecordTest, compact_version)
+{
+    plStateDataRecord rec("compactTest");
+    rec.FindVar("count")->Set(1);
+
+    hsRAMStream stream;
+    rec.Write(&stream, 0, plSDL::kCompactDelta);
+    stream.Rewind();
+    stream.ReadLE16();
+    EXPECT_EQ(7, stream.ReadByte());
+
+    hsRAMStream legacy;
+    rec.Write(&legacy, 0);
+    legacy.Rewind();
+    legacy.ReadLE16();
+    EXPECT_NE(7, legacy.ReadByte());
+}
+
+TEST_F(plStateDataRecordTest, compact_round_trip)
+{
+    plStateDataRecord src("compactTest");
+
+    // Points and vectors go over in 1/1024 steps, so these come back exactly
+    SetFloats(src, "position", 1.5f, -2.25f, 1000.f + 1.f / 1024.f);
+    SetFloats(src, "velocity", -300.f / 1024.f, 0.f, 77.f);
+    SetFloats(src, "speed", 3.75f, 0.f, 0.f);
+    SetFloats(src, "tint", 0.25f, 0.5f, 1.f);
+    float len = std::sqrt(0.1f*0.1f + 0.2f*0.2f + 0.3f*0.3f + 0.9f*0.9f);
+    SetFloats(src, "orientation", 0.1f / len, -0.2f / len, 0.3f / len, 0.9f / len);
+    src.FindVar("count")->Set(42);
+    src.FindVar("name")->Set("compact");
+    plSDStateVariable* child = src.FindSDVar("child");
+    child->GetStateDataRecord(0)->FindVar("value")->Set(-7);
+
+    plStateDataRecord dst("compactTest");
+    RoundTrip(src, dst, plSDL::kCompactDelta);
+
+    float v[4];
+    GetFloats(dst, "position", v);
+    EXPECT_EQ(1.5f, v[0]);
+    EXPECT_EQ(-2.25f, v[1]);
+    EXPECT_EQ(1000.f + 1.f / 1024.f, v[2]);
+
+    GetFloats(dst, "velocity", v);
+    EXPECT_EQ(-300.f / 1024.f, v[0]);
+    EXPECT_EQ(0.f, v[1]);
+    EXPECT_EQ(77.f, v[2]);
+
+    GetFloats(dst, "speed", v);
+    EXPECT_EQ(3.75f, v[0]);
+
+    GetFloats(dst, "tint", v);
+    EXPECT_NEAR(0.25f, v[0], 1.f / 65535.f);
+    EXPECT_NEAR(0.5f, v[1], 1.f / 65535.f);
+    EXPECT_NEAR(1.f, v[2], 1.f / 65535.f);
+
+    GetFloats(dst, "orientation", v);
+    EXPECT_NEAR(0.1f / len, v[0], 1e-4f);
+    EXPECT_NEAR(-0.2f / len, v[1], 1e-4f);
+    EXPECT_NEAR(0.3f / len, v[2], 1e-4f);
+    EXPECT_NEAR(0.9f / len, v[3], 1e-4f);
+
+    int count;
+    ASSERT_TRUE(dst.FindVar("count")->Get(&count));
+    EXPECT_EQ(42, count);
+
+    char name[256];
+    ASSERT_TRUE(dst.FindVar("name")->Get(name));
+    EXPECT_STREQ("compact", name);
+
+    int value;
+    ASSERT_TRUE(dst.FindSDVar("child")->GetStateDataRecord(0)->FindVar("value")->Get(&value));
+    EXPECT_EQ(-7, value);
+}
+
+TEST_F(plStateDataRecordTest, compact_quantization_error)
+{
+    // Positions off the 1/1024 grid are rounded to the nearest step
+    for (int i = 0; i < 100; ++i) {
+        float x = (i - 50) * 12.3456f + 0.000123f * i;
+
+        plStateDataRecord src("compactTest");
+        SetFloats(src, "position", x, -x, x * 0.5f);
+
+        plStateDataRecord dst("compactTest");
+        RoundTrip(src, dst, plSDL::kCompactDelta);
+
+        float v[3];
+        GetFloats(dst, "position", v);
+        EXPECT_NEAR(x, v[0], 0.5f / 1024.f);
+        EXPECT_NEAR(-x, v[1], 0.5f / 1024.f);
+        EXPECT_NEAR(x * 0.5f, v[2], 0.5f / 1024.f);
+    }
+}
+
+TEST_F(plStateDataRecordTest, compact_full_width_fallback)
+{
+    // Neither of these can be quantized, so they go over at full width
+    plStateDataRecord src("compactTest");
+    SetFloats(src, "speed", 0.1f, 0.f, 0.f);
+    SetFloats(src, "position", 3.0e6f, 0.001f, -5.f);
+
+    plStateDataRecord dst("compactTest");
+    RoundTrip(src, dst, plSDL::kCompactDelta);
+
+    float v[3];
+    GetFloats(dst, "speed", v);
+    EXPECT_EQ(0.1f, v[0]);
+
+    GetFloats(dst, "position", v);
+    EXPECT_EQ(3.0e6f, v[0]);
+    EXPECT_EQ(0.001f, v[1]);
+    EXPECT_EQ(-5.f, v[2]);
+}
+
+TEST_F(plStateDataRecordTest, compact_dirty_only)
+{
+    plStateDataRecord src("compactTest");
+    SetFloats(src, "position", 1.f, 2.f, 3.f);
+    src.FindVar("count")->Set(5);
+    src.FindVar("position")->SetDirty(false);
+
+    plStateDataRecord dst("compactTest");
+    RoundTrip(src, dst, plSDL::kCompactDelta | plSDL::kDirtyOnly);
+
+    EXPECT_FALSE(dst.FindVar("position")->IsUsed());
+    int count;
+    ASSERT_TRUE(dst.FindVar("count")->Get(&count));
+    EXPECT_EQ(5, count);
+}
+
+TEST_F(plStateDataRecordTest, compact_smaller_than_legacy)
+{
+    plStateDataRecord src("compactTest");
+    SetFloats(src, "position", 10.f, 20.f, 30.f);
+    SetFloats(src, "velocity", 1.f, 0.f, -1.f);
+    src.FindVar("count")->Set(3);
+
+    plStateDataRecord legacyDst("compactTest"), compactDst("compactTest");
+    uint32_t legacySize, compactSize;
+    RoundTrip(src, legacyDst, 0, &legacySize);
+    RoundTrip(src, compactDst, plSDL::kCompactDelta, &compactSize);
+    EXPECT_LT(compactSize, legacySize);
+}
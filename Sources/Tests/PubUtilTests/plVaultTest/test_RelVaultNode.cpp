@@ -0,0 +1,227 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string_theory/format>
+#include <vector>
+
+#include "plVault/plVault.h"
+
+// What GetChildNode has always done: our children in order, then each of
+// them depth first
+static hsRef<RelVaultNode> ScanForChild(RelVaultNode* parent, NetVaultNode* templateNode, unsigned maxDepth)
+{
+    if (maxDepth == 0)
+        return nullptr;
+
+    RelVaultNode::RefList children;
+    parent->GetChildNodes(1, &children);
+    for (const hsRef<RelVaultNode>& child : children) {
+        if (child->Matches(templateNode))
+            return child;
+    }
+    for (const hsRef<RelVaultNode>& child : children) {
+        if (hsRef<RelVaultNode> node = ScanForChild(child.Get(), templateNode, maxDepth - 1))
+            return node;
+    }
+    return nullptr;
+}
+
+class RelVaultNodeTest : public ::testing::Test
+{
+protected:
+    static constexpr unsigned kRootId = 1;
+    static constexpr unsigned kFolderIdBase = 1000;
+    static constexpr unsigned kNoteIdBase = 100000;
+
+    void TearDown() override
+    {
+        VaultDestroy();
+    }
+
+    static hsRef<RelVaultNode> AddChild(unsigned parentId, unsigned childId, unsigned nodeType,
+                                        const ST::string& name = {})
+    {
+        VaultLocalAddChildNode(parentId, childId, 0);
+        hsRef<RelVaultNode> node = VaultGetNode(childId);
+        node->SetNodeType(nodeType);
+        if (!name.empty())
+            node->SetString64_1(name);
+        return node;
+    }
+
+    // A root with lots of folders under it, so the index is worth using
+    static hsRef<RelVaultNode> MakeBigRoot(unsigned numFolders)
+    {
+        VaultLocalAddChildNode(kRootId, kFolderIdBase, 0);
+        hsRef<RelVaultNode> root = VaultGetNode(kRootId);
+        root->SetNodeType(plVault::kNodeType_Folder);
+        VaultGetNode(kFolderIdBase)->SetNodeType(plVault::kNodeType_Folder);
+        for (unsigned i = 1; i < numFolders; ++i)
+            AddChild(kRootId, kFolderIdBase + i, plVault::kNodeType_Folder);
+        return root;
+    }
+
+    static void SetTemplate(NetVaultNode& templateNode, const ST::string& name)
+    {
+        templateNode.SetNodeType(plVault::kNodeType_TextNote);
+        templateNode.SetString64_1(name);
+    }
+};
+
+TEST_F(RelVaultNodeTest, GetChildNodeFindsOnlyMatch)
+{
+    hsRef<RelVaultNode> root = MakeBigRoot(200);
+    AddChild(kFolderIdBase + 150, kFolderIdBase + 200, plVault::kNodeType_Folder);
+    hsRef<RelVaultNode> note = AddChild(kFolderIdBase + 200, kNoteIdBase, plVault::kNodeType_TextNote, ST_LITERAL("deep"));
+
+    NetVaultNode templateNode;
+    SetTemplate(templateNode, ST_LITERAL("deep"));
+    EXPECT_EQ(note.Get(), root->GetChildNode(&templateNode, 3).Get());
+    EXPECT_EQ(nullptr, root->GetChildNode(&templateNode, 2).Get());
+
+    templateNode.SetString64_1(ST_LITERAL("missing"));
+    EXPECT_EQ(nullptr, root->GetChildNode(&templateNode, 3).Get());
+}
+
+TEST_F(RelVaultNodeTest, GetChildNodeKeepsScanOrder)
+{
+    hsRef<RelVaultNode> root = MakeBigRoot(200);
+
+    // Made in the opposite order from how the scan reaches them, and the
+    // shallowest one is the last the scan would get to
+    AddChild(kFolderIdBase + 190, kNoteIdBase, plVault::kNodeType_TextNote, ST_LITERAL("note"));
+    AddChild(kFolderIdBase + 100, kFolderIdBase + 300, plVault::kNodeType_Folder);
+    AddChild(kFolderIdBase + 300, kNoteIdBase + 1, plVault::kNodeType_TextNote, ST_LITERAL("note"));
+    AddChild(kFolderIdBase + 10, kFolderIdBase + 301, plVault::kNodeType_Folder);
+    AddChild(kFolderIdBase + 301, kFolderIdBase + 302, plVault::kNodeType_Folder);
+    AddChild(kFolderIdBase + 302, kNoteIdBase + 2, plVault::kNodeType_TextNote, ST_LITERAL("note"));
+
+    NetVaultNode templateNode;
+    SetTemplate(templateNode, ST_LITERAL("note"));
+    for (unsigned maxDepth = 1; maxDepth <= 5; ++maxDepth) {
+        hsRef<RelVaultNode> expected = ScanForChild(root.Get(), &templateNode, maxDepth);
+        EXPECT_EQ(expected.Get(), root->GetChildNode(&templateNode, maxDepth).Get()) << "maxDepth " << maxDepth;
+    }
+    EXPECT_EQ(VaultGetNode(kNoteIdBase + 2).Get(), root->GetChildNode(&templateNode, 4).Get());
+
+    // A direct child beats all of them
+    hsRef<RelVaultNode> direct = AddChild(kRootId, kNoteIdBase + 3, plVault::kNodeType_TextNote, ST_LITERAL("note"));
+    EXPECT_EQ(direct.Get(), root->GetChildNode(&templateNode, 4).Get());
+}
+
+TEST_F(RelVaultNodeTest, GetChildNodeSharedChild)
+{
+    hsRef<RelVaultNode> root = MakeBigRoot(200);
+
+    // One note reachable two ways, plus another one the scan gets to first
+    AddChild(kFolderIdBase + 50, kNoteIdBase, plVault::kNodeType_TextNote, ST_LITERAL("note"));
+    AddChild(kFolderIdBase + 150, kNoteIdBase, plVault::kNodeType_TextNote, ST_LITERAL("note"));
+    AddChild(kFolderIdBase + 20, kFolderIdBase + 300, plVault::kNodeType_Folder);
+    AddChild(kFolderIdBase + 300, kNoteIdBase + 1, plVault::kNodeType_TextNote, ST_LITERAL("note"));
+
+    NetVaultNode templateNode;
+    SetTemplate(templateNode, ST_LITERAL("note"));
+    EXPECT_EQ(VaultGetNode(kNoteIdBase).Get(), root->GetChildNode(&templateNode, 2).Get());
+    EXPECT_EQ(VaultGetNode(kNoteIdBase + 1).Get(), root->GetChildNode(&templateNode, 3).Get());
+}
+
+// Template finds in a vault the size of a long-time player's: a 20k note
+// inbox, 5k chronicles and a few hundred age folders, against the scans
+// they used to be. This isn't a pass/fail test, so it only runs when
+// asked for:
+//      test_plVault --gtest_also_run_disabled_tests --gtest_filter=*Throughput
+TEST_F(RelVaultNodeTest, DISABLED_FindThroughput)
+{
+    const unsigned kNumFolders = 300;
+    const unsigned kNumNotes = 20000;
+    const unsigned kNumChronicles = 5000;
+    const int kNumFinds = 1000;
+
+    hsRef<RelVaultNode> root = MakeBigRoot(kNumFolders);
+    std::vector<hsRef<RelVaultNode>> allNodes;
+    for (unsigned i = 0; i < kNumNotes; ++i)
+        allNodes.push_back(AddChild(kFolderIdBase + 1, kNoteIdBase + i, plVault::kNodeType_TextNote, ST::format("note{}", i)));
+    for (unsigned i = 0; i < kNumChronicles; ++i)
+        allNodes.push_back(AddChild(kFolderIdBase + 2, kNoteIdBase + kNumNotes + i, plVault::kNodeType_Chronicle, ST::format("chron{}", i)));
+
+    std::mt19937 rng(7);
+    auto measure = [&](const char* what, unsigned nodeType, const char* prefix, unsigned count, auto find)
+    {
+        NetVaultNode templateNode;
+        templateNode.SetNodeType(nodeType);
+
+        unsigned found = 0;
+        std::chrono::duration<double, std::micro> usecs{};
+        for (int i = 0; i < kNumFinds; ++i) {
+            templateNode.SetString64_1(ST::format("{}{}", prefix, rng() % count));
+            auto start = std::chrono::steady_clock::now();
+            found += find(&templateNode);
+            usecs += std::chrono::steady_clock::now() - start;
+        }
+        EXPECT_EQ(unsigned(kNumFinds), found);
+        printf("%-24s %10.2f us per find\n", what, usecs.count() / kNumFinds);
+    };
+
+    // VaultLocalFindNodes used to check every node
+    measure("find chronicle, scan", plVault::kNodeType_Chronicle, "chron", kNumChronicles, [&](NetVaultNode* templateNode) {
+        unsigned matches = 0;
+        for (const hsRef<RelVaultNode>& node : allNodes)
+            matches += node->Matches(templateNode);
+        return matches;
+    });
+    measure("find chronicle", plVault::kNodeType_Chronicle, "chron", kNumChronicles, [](NetVaultNode* templateNode) {
+        std::vector<unsigned> nodeIds;
+        VaultLocalFindNodes(templateNode, &nodeIds);
+        return (unsigned)nodeIds.size();
+    });
+
+    measure("GetChildNode, scan", plVault::kNodeType_TextNote, "note", kNumNotes, [&](NetVaultNode* templateNode) {
+        return ScanForChild(root.Get(), templateNode, 2) != nullptr;
+    });
+    measure("GetChildNode", plVault::kNodeType_TextNote, "note", kNumNotes, [&](NetVaultNode* templateNode) {
+        return root->GetChildNode(templateNode, 2) != nullptr;
+    });
+}
@@ -0,0 +1,191 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011 Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string_theory/format>
+
+#include "hsStream.h"
+
+#include "plVault/plVault.h"
+#include "plVault/plVaultNodeCache.h"
+
+class plVaultNodeCacheTest : public ::testing::Test
+{
+protected:
+    // Far away from any real vault
+    static constexpr unsigned kVaultId = 0xFFFFFF00;
+
+    std::vector<hsRef<NetVaultNode>> fNodes;
+
+    void SetUp() override
+    {
+        plFileSystem::Unlink(VaultGetNodeCachePath(kVaultId));
+
+        static const uint8_t kBlob[] = { 0x00, 0x01, 0x7F, 0x80, 0xFF };
+        for (unsigned i = 0; i < 3; ++i) {
+            hsRef<NetVaultNode> node(new NetVaultNode, hsStealRef);
+            node->SetNodeId(kVaultId + i);
+            node->SetNodeType(plVault::kNodeType_Chronicle + i);
+            node->SetModifyTime(1234567890 + i);
+            node->SetString64_1(ST::format("node {}", i));
+            node->SetText_1(ST_LITERAL("Some text with a\nnewline"));
+            node->SetBlob_1(kBlob, i + 2);
+            fNodes.emplace_back(std::move(node));
+        }
+    }
+
+    void TearDown() override
+    {
+        plFileSystem::Unlink(VaultGetNodeCachePath(kVaultId));
+        plFileSystem::Unlink(VaultGetNodeCachePath(kVaultId + 1));
+    }
+
+    bool WriteNodes(unsigned vaultId)
+    {
+        std::vector<hsWeakRef<NetVaultNode>> nodes(fNodes.begin(), fNodes.end());
+        return VaultWriteNodeCache(vaultId, nodes);
+    }
+
+    static std::vector<uint8_t> ReadFile(const plFileName& path)
+    {
+        hsUNIXStream s;
+        if (!s.Open(path, "rb"))
+            return {};
+        std::vector<uint8_t> data(s.GetEOF());
+        s.Read(uint32_t(data.size()), data.data());
+        return data;
+    }
+
+    static void WriteFile(const plFileName& path, const std::vector<uint8_t>& data)
+    {
+        hsUNIXStream s;
+        ASSERT_TRUE(s.Open(path, "wb"));
+        s.Write(uint32_t(data.size()), data.data());
+    }
+
+    static std::vector<uint8_t> NodeData(hsWeakRef<NetVaultNode> node)
+    {
+        std::vector<uint8_t> data;
+        node->Write(&data);
+        return data;
+    }
+};
+
+TEST_F(plVaultNodeCacheTest, RoundTrip)
+{
+    ASSERT_TRUE(WriteNodes(kVaultId));
+
+    std::vector<hsRef<NetVaultNode>> nodes;
+    ASSERT_TRUE(VaultReadNodeCache(kVaultId, &nodes));
+    ASSERT_EQ(fNodes.size(), nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        EXPECT_EQ(fNodes[i]->GetNodeId(), nodes[i]->GetNodeId());
+        EXPECT_EQ(fNodes[i]->GetModifyTime(), nodes[i]->GetModifyTime());
+        EXPECT_EQ(fNodes[i]->GetString64_1(), nodes[i]->GetString64_1());
+        EXPECT_EQ(NodeData(fNodes[i]), NodeData(nodes[i]));
+    }
+
+    // Writing again replaces what was there
+    fNodes.pop_back();
+    ASSERT_TRUE(WriteNodes(kVaultId));
+    nodes.clear();
+    ASSERT_TRUE(VaultReadNodeCache(kVaultId, &nodes));
+    EXPECT_EQ(fNodes.size(), nodes.size());
+}
+
+TEST_F(plVaultNodeCacheTest, Empty)
+{
+    fNodes.clear();
+    ASSERT_TRUE(WriteNodes(kVaultId));
+
+    std::vector<hsRef<NetVaultNode>> nodes;
+    EXPECT_TRUE(VaultReadNodeCache(kVaultId, &nodes));
+    EXPECT_TRUE(nodes.empty());
+}
+
+TEST_F(plVaultNodeCacheTest, Missing)
+{
+    std::vector<hsRef<NetVaultNode>> nodes;
+    EXPECT_FALSE(VaultReadNodeCache(kVaultId, &nodes));
+    EXPECT_TRUE(nodes.empty());
+}
+
+TEST_F(plVaultNodeCacheTest, Corrupt)
+{
+    ASSERT_TRUE(WriteNodes(kVaultId));
+    plFileName path = VaultGetNodeCachePath(kVaultId);
+    const std::vector<uint8_t> good = ReadFile(path);
+    ASSERT_FALSE(good.empty());
+
+    std::vector<hsRef<NetVaultNode>> nodes;
+
+    // Every single flipped byte, in the header or the body, is caught
+    for (size_t i = 0; i < good.size(); ++i) {
+        std::vector<uint8_t> bad = good;
+        bad[i] ^= 0x20;
+        WriteFile(path, bad);
+        EXPECT_FALSE(VaultReadNodeCache(kVaultId, &nodes)) << "byte " << i;
+    }
+
+    // And so is every short write
+    for (size_t size = 0; size < good.size(); ++size) {
+        WriteFile(path, std::vector<uint8_t>(good.begin(), good.begin() + size));
+        EXPECT_FALSE(VaultReadNodeCache(kVaultId, &nodes)) << "size " << size;
+    }
+
+    // Nothing comes back from a file that didn't check out
+    EXPECT_TRUE(nodes.empty());
+
+    WriteFile(path, good);
+    EXPECT_TRUE(VaultReadNodeCache(kVaultId, &nodes));
+}
+
+TEST_F(plVaultNodeCacheTest, WrongVault)
+{
+    ASSERT_TRUE(WriteNodes(kVaultId));
+    WriteFile(VaultGetNodeCachePath(kVaultId + 1), ReadFile(VaultGetNodeCachePath(kVaultId)));
+
+    std::vector<hsRef<NetVaultNode>> nodes;
+    EXPECT_FALSE(VaultReadNodeCache(kVaultId + 1, &nodes));
+    EXPECT_TRUE(nodes.empty());
+}